@@ -231,6 +231,14 @@ int DeterminantComplexMatrix(complex *result, const ComplexMatrix &a, const Matr
 */
 int InvertCroutComplexMatrix (ComplexMatrix &b, const ComplexMatrix &a, unsigned int col);
 
+/*!
+  \brief compute several columns of inv(a) in one block solve
+  \param b destination matrix, one column per entry of cols
+  \param a Crout factored source matrix
+  \param cols the columns of inv(a) wanted
+*/
+int InvertCroutComplexMatrix (ComplexMatrix &b, const ComplexMatrix &a, const cvector1<unsigned> &cols);
+
 /*!
   \brief Crout factorize A and store in A
   \param A source and destination matrix
@@ -244,6 +252,23 @@ int CroutFactorComplexMatrix (ComplexMatrix &A);
 */
 int CroutBackSolveComplexMatrix (const ComplexMatrix &A, ComplexMatrix &b);
 
+/*!
+  \brief  solve AX=B for many right hand sides and store X in B
+  \param A Crout factored LHS matrix
+  \param B full matrix with one RHS (and solution) per column
+*/
+int CroutBackSolveComplexBlock (const ComplexMatrix &A, ComplexMatrix &B);
+
+/*!
+  \brief x . y (unconjugated) over n contiguous coefficients
+*/
+complex ComplexDotKernel (const complex *x, const complex *y, unsigned int n);
+
+/*!
+  \brief y += alpha*x over n contiguous coefficients
+*/
+void ComplexAxpyKernel (complex *y, complex alpha, const complex *x, unsigned int n);
+
         /*
          * prototypes for the PROPERTY routines
          */
@@ -35,6 +35,8 @@ extern "C" {
 
 typedef union instruction *Code;
 
+typedef struct compiled_code *CompiledCode;
+
 typedef enum {
     JmpOp,		/* unconditional jump	    */
     JnzOp,		/* jump if not zero	    */
@@ -90,7 +92,8 @@ extern Code   InCore;
 void EmitCode(Opcode op, ...);
 
 /*!
-  Copies a piece of code.
+  Copies a piece of code, folding any part of it that does not depend
+  on time into a single value.
 */
 Code CopyCode(Code code);
 
@@ -104,6 +107,48 @@ void FreeCode(Code code);
 */
 double EvalCode(Code code, double time);
 
+/*!
+  Evaluates a piece of code at each of n times (or frequencies), the
+  same as n calls to EvalCode but much faster: the code is compiled
+  once and each operation is applied to a block of values at a time.
+  Tables are looked up fastest when the times increase.
+*/
+void EvalCodeArray(Code code, const double *time, double *result, unsigned n);
+
+/*!
+  EvalCodeArray that also gives the derivative of the code with respect
+  to time at each point, worked out exactly from the compiled code (the
+  slope of a table is the slope of the segment the time falls on).
+*/
+void EvalCodeSlopeArray(Code code, const double *time, double *result,
+                        double *slope, unsigned n);
+
+/*!
+  Compiles a piece of code once for any number of calls to EvalCodeTree
+  and EvalCodeTreeSlope.  The code must outlive the result, which is
+  freed with FreeCodeTree.  A compiled piece of code remembers where
+  its tables were last looked up, so it must only be used by one
+  thread at a time.
+*/
+CompiledCode CompileCodeTree(Code code);
+
+/*!
+  Deallocates a piece of code compiled by CompileCodeTree.
+*/
+void FreeCodeTree(CompiledCode c);
+
+/*!
+  EvalCodeArray for code that has already been compiled.
+*/
+void EvalCodeTree(CompiledCode c, const double *time, double *result,
+                  unsigned n);
+
+/*!
+  EvalCodeSlopeArray for code that has already been compiled.
+*/
+void EvalCodeTreeSlope(CompiledCode c, const double *time, double *result,
+                       double *slope, unsigned n);
+
 /*!
   Print a piece of stack code as instructions.
 */
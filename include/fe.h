@@ -99,6 +99,7 @@ struct definition_t {
     unsigned numdofs;		/* number of degrees of freedom       */
     unsigned dofs [7];		/* degrees of freedom                 */
     unsigned retainK;		/* retain element K after assemblage  */
+    unsigned shareK;		/* K, M depend only on relative coords */
 };
 
 typedef boost::shared_ptr<definition_t> Definition;
@@ -322,10 +323,15 @@ typedef struct analysis {
     double	Rm;			/* global Rayleigh M damping    */
     double      gravity [4];		/* gravitational accel vector	*/
     double      tolerance;		/* convergence control factor   */
+    double	error_tolerance;	/* adaptive time step control	*/
     double	relaxation;		/* iterative relaxation factor  */
     unsigned	iterations;		/* iteration count control      */
     unsigned	load_steps;		/* number of incremental steps  */
+    unsigned	modes;			/* lowest modes to find (0 all)	*/
     char	mass_mode;		/* 'c'onsistent or 'l'umped	*/
+    char	solver;			/* skyline (0), 's'parse, or pcg ('c') */
+    char	preconditioner;		/* 'j'acobi, 's'sor, or 'i'c(0)	*/
+    char	tabulate;		/* tabulate forcing expressions	*/
     cvector1<Node> nodes;			/* list of nodes of interest    */
     char	dofs [7];		/* dofs of interest		*/
     unsigned	numdofs;		/* number of dofs of interest	*/
@@ -346,6 +352,15 @@ typedef struct analysis {
 */
 int FindDOFS(void);
 
+/*!
+  Numbers the equations of the problem.  Each node gets only those of
+  the active DOF that one of its elements uses; the equation of active
+  DOF j of node n is problem.equations [(n-1)*num_dofs + j], or zero if
+  no element uses it.  Called by FindDOFS and again whenever the node
+  numbers change.  Returns the number of equations.
+*/
+int NumberEquations(void);
+
 /*!
   For a given set of elements (possibly of varying types) this will
   assemble all element stiffness matrices into the global stiffness
@@ -362,6 +377,22 @@ int FindDOFS(void);
 */ 
 Matrix ConstructStiffness(int *status);
 
+/*!
+  Builds the symbolic structure of the global stiffness matrix as a
+  symmetric sparse matrix with every coefficient zero.  Two DOF are
+  coupled if their nodes share an element and those elements affect
+  both DOF; only the element connectivity is used.  Every diagonal is
+  part of the structure.
+*/
+SparseMatrix ConstructSparsePattern(void);
+
+/*!
+  The same as ConstructStiffness except that the global stiffness
+  matrix is assembled into the sparse structure given by
+  ConstructSparsePattern rather than into compact column storage.
+*/
+SparseMatrix ConstructSparseStiffness(int *status);
+
 /*!
   For a fixed BC at a given DOF all we'll do is zero out the rows and
   columns of the stiffness matrix associated with that DOF (with a one
@@ -375,6 +406,61 @@ Matrix ConstructStiffness(int *status);
 */
 void ZeroConstrainedDOF(const Vector &K, const Vector &F, Vector *Kc, Vector *Fc);
 
+/*!
+  The same for a sparse matrix; the copy keeps the nonzero structure
+  of K.
+*/
+void ZeroConstrainedDOF(const SparseMatrix &K, const Vector &F, SparseMatrix *Kc, Vector *Fc);
+
+/*
+  The rows of a compact matrix at the constrained DOF, kept so that
+  the constraints can be applied to the matrix itself.  Row m belongs
+  to equation dofs [m] and has coefficient value [k] in column col [k]
+  for start [m] <= k < start [m+1]; index maps an equation back to its
+  row (zero if the equation is not constrained).
+*/
+typedef struct {
+    cvector1u	dofs;
+    cvector1u	start;
+    cvector1u	col;
+    cvector1d	value;
+    cvector1u	index;
+} ConstrainedRows;
+
+/*!
+  Saves the rows of K at every constrained DOF.  By symmetry these are
+  also the columns that a displacement BC needs to adjust the force
+  vector with.
+*/
+void SaveConstrainedRows(const Matrix &K, ConstrainedRows &saved);
+
+/*!
+  The same for the upper triangle of a sparse stiffness matrix.
+*/
+void SaveConstrainedRows(const SparseMatrix &K, ConstrainedRows &saved);
+
+/*!
+  ZeroConstrainedDOF without the copies: K and F (which may be null)
+  are changed in place.  If saved is given the constrained rows of K
+  are stored there first, which is all that SolveForReactions and
+  ResolveBC need of the original matrix.
+*/
+void ApplyConstraints(Matrix &K, const Matrix &F, ConstrainedRows *saved);
+
+/*!
+  The same for a sparse stiffness matrix, in a single pass over its
+  coefficients.
+*/
+void ApplyConstraints(SparseMatrix &K, const Matrix &F, ConstrainedRows *saved);
+
+/*!
+  Adjusts F for a displacement dx at the constrained equation dof
+  using the saved rows of the unconstrained matrix.  The rows of the
+  other constrained DOF are left alone since their value is set by
+  their own constraint.
+*/
+void AdjustConstrainedForce(Vector F, const ConstrainedRows &saved, unsigned int dof, double dx);
+
 /*!
   As opposed to simply zeroing out the rows and columns associated
   with a constrained DOF, here we actually reduce the size of the
@@ -384,6 +470,19 @@ void ZeroConstrainedDOF(const Vector &K, const Vector &F, Vector *Kc, Vector *Fc
 void RemoveConstrainedDOF(const Matrix &K, const Matrix &M, const Matrix &C, 
                           Matrix &Kcond, Matrix &Mcond, Matrix &Ccond);
 
+/*!
+  RemoveConstrainedDOF done in place.  The remaining coefficients of
+  each matrix are packed down into the front of its own storage, so
+  no second set of matrices is ever allocated.  C may be null.
+*/
+void CondenseConstrainedDOF(Matrix &K, Matrix &M, Matrix &C);
+
+/*!
+  The same for sparse matrices that share one nonzero structure, as
+  those from ConstructSparseDynamic do.
+*/
+void CondenseConstrainedDOF(SparseMatrix &K, SparseMatrix &M, SparseMatrix &C);
+
 /*!
   Zeros out the row and column given by dof.  Places a one on the
   diagonal.
@@ -414,14 +513,42 @@ Vector ConstructForceVector(void);
 
 /*!
   Builds a table of nodal DOF displacements for all defined loadcases.
+  If rtable is given and saved holds the constrained rows of the
+  stiffness matrix, rtable gets a row of reaction forces for each
+  loadcase, in the order of FindReactionDOF.
 */
-Matrix SolveStaticLoadCases(Matrix &K, const Matrix &Fbase);
+Matrix SolveStaticLoadCases(Matrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable);
+
+/*!
+  The same, starting from a sparse stiffness matrix (which goes to the
+  sparse or conjugate gradient solver).
+*/
+Matrix SolveStaticLoadCases(SparseMatrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable);
 
 /*!
  Builds a table of nodal DOF displacements for input forcing at a
- single DOF over a range of force magnitudes.
+ single DOF over a range of force magnitudes.  The response to the
+ base loads and to a unit input force are solved for once and then
+ superposed for each force.  Reactions are returned in rtable as for
+ SolveStaticLoadCases.
 */
-Matrix SolveStaticLoadRange(Matrix &K, const Matrix &Fbase);
+Matrix SolveStaticLoadRange(Matrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable);
+
+/*!
+  The same, starting from a sparse stiffness matrix.
+*/
+Matrix SolveStaticLoadRange(SparseMatrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable);
+
+/*!
+ As SolveStaticLoadRange, but solves the full system for every force
+ magnitude.  felt-bench checks the superposed results against it.
+*/
+Matrix SolveStaticLoadRangeDirect(Matrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable);
+
+/*!
+  The same, starting from a sparse stiffness matrix.
+*/
+Matrix SolveStaticLoadRangeDirect(SparseMatrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable);
 
 void AssembleLoadCaseForce(Matrix F, LoadCase lc);
 
@@ -433,9 +560,63 @@ void AssembleLoadCaseForce(Matrix F, LoadCase lc);
 Vector SolveForDisplacements(Vector &K, Vector &F);
 
 /*!
-  Factorizes the problem stiffness matrix in place.
+  The same, starting from a sparse stiffness matrix.
+*/
+Vector SolveForDisplacements(SparseMatrix &K, Vector &F);
+
+/*!
+  The state of the linear solver chosen by analysis.solver: nothing for
+  the skyline solver (K itself is factored), the factorization for the
+  sparse solver, or the matrix, its preconditioner and the last solution
+  (the next starting guess) for conjugate gradients.
+*/
+typedef struct {
+    SparseFactor	factor;
+    SparseMatrix	A;
+    Preconditioner	M;
+    Matrix		x;
+} LinearSolver;
+
+/*!
+  Factorizes the problem stiffness matrix.  With the skyline solver K is
+  factored in place; the other solvers keep what they need in S and
+  leave K alone.
+*/
+int FactorStiffnessMatrix(Vector &K, LinearSolver &S);
+
+/*!
+  The same for a sparse stiffness matrix, which is left alone.
 */
-int FactorStiffnessMatrix(Vector &K);
+int FactorStiffnessMatrix(SparseMatrix &K, LinearSolver &S);
+
+/*!
+  Factorizes (or preconditions) a condensed global matrix with the
+  solver selected in the analysis parameters.
+*/
+int FactorSystemMatrix(Matrix &K, LinearSolver &S);
+
+/*!
+  Factorizes (or preconditions) a condensed sparse matrix with the
+  sparse solver, or with conjugate gradients if those are selected.
+  S keeps a reference to K rather than a copy.  SolveSystemMatrix and
+  SolveSystemBlock then take a null compact matrix.
+*/
+int FactorSystemMatrix(SparseMatrix &K, LinearSolver &S);
+
+/*!
+  Solves Kx=b using the result of FactorSystemMatrix, storing x in b.
+  The conjugate gradient solver stops at analysis.tolerance (relative
+  residual) or analysis.iterations, and starts from the previous
+  solution.
+*/
+int SolveSystemMatrix(const Matrix &K, LinearSolver &S, Matrix &b);
+
+/*!
+  Solves KX=B for every column of B at once, storing X in B.  The
+  skyline solver reads its factor once per block of columns; the other
+  solvers go through SolveSystemMatrix column by column.
+*/
+int SolveSystemBlock(const Matrix &K, LinearSolver &S, Matrix &B);
 
 void ApplyNodalDisplacements(Matrix d);
 
@@ -449,6 +630,97 @@ void ApplyNodalDisplacements(Matrix d);
  */
 int ElementSetup(Element element, char mass_mode);
 
+/*!
+  \brief sets the number of threads used to set up and assemble elements
+  \param n thread count, 0 or 1 to work through the elements in order
+*/
+void SetAssemblyThreads(unsigned int n);
+
+/*!
+  \brief the number of threads used to set up and assemble elements
+*/
+unsigned AssemblyThreads(void);
+
+/*!
+  The fewest elements worth starting assembly threads for; with fewer
+  the elements are worked through in order on the calling thread.
+*/
+# define MinParallelElements	64
+
+/*!
+  \brief turns the sharing of element matrices between identical elements
+  on or off
+  \param flag non-zero to set up only one element of each group of
+  elements with the same definition, material and node coordinates
+  relative to their first node
+*/
+void SetElementCache(int flag);
+
+/*!
+  \brief whether identical elements share their matrices
+*/
+int ElementCache(void);
+
+/*!
+  Greedily colors the elements so that no two elements of the same
+  color share a node.  colors[c] lists the indices into problem.elements
+  of the elements of color c, in increasing order.
+*/
+void ColorElements(cvector1< cvector1u > &colors);
+
+typedef void (*ElementTask)(Element element, unsigned i, void *arg);
+
+/*!
+  Calls task for every element, along with its index i into
+  problem.elements.  With more than one assembly thread the
+  elements are handed out to all of the threads; if colored is set they
+  go one color at a time, so that no two concurrent calls see elements
+  that share a node and a task may scatter into nodal or global storage.
+*/
+void ForEachElement(ElementTask task, void *arg, int colored);
+
+/*!
+  Sets up every element (in parallel if there is more than one assembly
+  thread) and checks the element stiffness matrix and, if need_mass is
+  set, the element mass matrix.  Returns the number of errors.  With
+  the element cache on, elements without distributed loads or hinges
+  that are identical to an earlier element are given its matrices
+  rather than being set up themselves.
+*/
+int SetupElements(char mass_mode, int need_mass);
+
+/*!
+  Where the coefficients of each element matrix go in the storage of a
+  global matrix.  The entries of element i are first[i] through
+  first[i+1]-1: coefficient entry[n] of the (flat, 1-based) element
+  matrix is added to coefficient address[n] of the global matrix.  Its
+  rows are rfirst[i] through rfirst[i+1]-1 in the same way, mapping
+  element vector row rentry[n] to global row row[n].
+*/
+struct ScatterMap {
+    cvector1u	first;		/* first entry of each element		*/
+    cvector1u	entry;		/* offset into the element matrix	*/
+    cvector1u	address;	/* offset into the global storage	*/
+    cvector1u	rfirst;		/* first row of each element		*/
+    cvector1u	rentry;		/* row of the element vector		*/
+    cvector1u	row;		/* row of the global vector		*/
+    cvector1u	topology;	/* connectivity the map was built for	*/
+    cvector1u	structure;	/* global storage it was built for	*/
+};
+
+/*!
+  Returns the scatter map into the compact column matrix K.  The map
+  is cached and only rebuilt when the element connectivity, the active
+  DOF or the profile of K change, so reassembling the same problem
+  costs one comparison instead of an address computation per entry.
+*/
+const ScatterMap &CompactScatterMap(const Matrix &K);
+
+/*!
+  The sparse analog of CompactScatterMap.
+*/
+const ScatterMap &SparseScatterMap(const SparseMatrix &K);
+
 /*!
  Sets all the displacements on the nodes to zero and clears the
  equivalent force vector.
@@ -463,7 +735,8 @@ int ElementStresses(void);
 /*!
   Calculates the global DOF number based on a given local DOF (Tx
   ... Rz), a node number and a dofs map.  Zero is returned if the
-  given local DOF is not active in the current dofs map.
+  given local DOF is not active in the current dofs map or if none of
+  the elements at the node uses it.
 */
 int GlobalDOF(unsigned int node, unsigned int dx);
 
@@ -497,6 +770,13 @@ int CheckAnalysisParameters(AnalysisType mode);
 
 int ComputeEigenModes(const Matrix &K, const Matrix &M, Matrix &lambda_r, Matrix &x_r);
 
+/*!
+  ComputeEigenModes for the (condensed) sparse K and M.  Lanczos works
+  on them directly; when every mode is wanted the dense solution is
+  used on a compact copy.
+*/
+int ComputeEigenModes(const SparseMatrix &K, const SparseMatrix &M, Matrix &lambda_r, Matrix &x_r);
+
 /*!
   Given a table of mode shapes and a list of nodes and active dofs,
   put together a table of nodal displacements at each node (including
@@ -544,8 +824,16 @@ int ComputeOutputSpectraFFT(Matrix dtable, Matrix *Pr, Vector *Fr, int nfft);
 */
 Matrix CreateNonlinearStiffness(int *status);
 
+/*!
+  The sparse counterpart of CreateNonlinearStiffness, with the
+  structure of every element DOF from ConstructSparsePattern.
+*/
+SparseMatrix CreateNonlinearSparseStiffness(int *status);
+
 int AssembleCurrentState(Matrix K, Matrix F, int tangent);
 
+int AssembleCurrentState(SparseMatrix K, Matrix F, int tangent);
+
 int AssembleCurrentForce(Matrix F, Matrix Fnodal);
 
 int RestoreCoordinates(Matrix d);
@@ -562,8 +850,16 @@ int UpdateCoordinates(Matrix d);
 */
 Matrix StaticNonlinearDisplacements(Matrix K, Matrix Fnodal, int tangent);
 
+/*!
+  The same with K assembled, constrained and factored in sparse
+  storage by the sparse or iterative solver.
+*/
+Matrix StaticNonlinearDisplacements(SparseMatrix K, Matrix Fnodal, int tangent);
+
 Matrix SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent);
 
+Matrix SolveNonlinearLoadRange(SparseMatrix K, Matrix Fnodal, int tangent);
+
 /*----------------------------------------------------------------------*/
 
 # endif /* _FE_H */
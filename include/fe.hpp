@@ -35,11 +35,27 @@ struct Reaction {
   Pretty simple really, first we find how many reaction forces there
   should be, then we allocate space for them, then we multiply rows of
   the stiffness matrix by the global displacement vector to get an
-  entry that was previously unknown in the global force vector
+  entry that was previously unknown in the global force vector.  All
+  of the rows come out of a single pass over the skyline of K.
 */
 
 cvector1<Reaction> SolveForReactions(Vector K, Vector d, unsigned int *old_numbers);
 
+/*!
+  The same, but working from the constrained rows that ApplyConstraints
+  saved rather than from the unconstrained stiffness matrix itself.
+*/
+
+cvector1<Reaction> SolveForReactions(const ConstrainedRows &saved, Vector d, unsigned int *old_numbers);
+
+/*!
+  Lists the node and DOF of every reaction force (with zero forces),
+  in the order of the columns of the loadcase and load range reaction
+  tables.
+*/
+
+cvector1<Reaction> FindReactionDOF(unsigned int *old_numbers);
+
 /*!
   Builds a list of global DOF numbers which have some sort of input
   applied to them.  We make two passes rather than dealing with
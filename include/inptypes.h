@@ -47,6 +47,7 @@ typedef enum {
     StaticLoadRange = 10,
     StaticSubstitutionLoadRange = 11,
     StaticIncrementalLoadRange = 12,
+    TransientExplicit = 13,
 } AnalysisType;
 
 
@@ -101,7 +102,7 @@ typedef struct
     unsigned	 line;			/* current line number	   */
 } ProblemSource;
 
-extern ProblemSource psource;
+extern thread_local ProblemSource psource;
 
 /*!
   Specifies whether yytext should be copied into a local buffer.  The
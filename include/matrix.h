@@ -35,7 +35,7 @@ struct matrix {
    ~matrix();
    unsigned	nrows;		/* number of rows 			 */
    unsigned	ncols;		/* number of columns			 */
-   double	**data;		/* matrix data				 */
+   double	**data;		/* matrix data (one flat row if compact) */
    cvector1<unsigned> diag; /* diagonal addresses for compact column */
    unsigned	size;		/* actual size of compact storage	 */
 private:
@@ -54,6 +54,14 @@ private:
 # define IsColumnVector(m) (Mcols(m) == 1)
 
 # define sdata(m,i,j)   ((m) -> data [(i)][(j)])
+
+	/*
+	 * compact column (skyline) matrices keep all of their coefficients
+	 * in a single unit-offset array; diag [j] is the address of the
+	 * diagonal of column j within it
+	 */
+
+# define CompactData(m) ((m) -> data [1])
 	
 	/*
 	 * for backward compatibility with the old matrix routines
@@ -73,6 +81,89 @@ typedef Matrix Vector;
 # define CreateMatrix  CreateFullMatrix
 # define CreateVector  CreateColumnVector
 
+	/*
+	 * general sparse matrices are kept in compressed column form.
+	 * The entries of column j live at addresses colptr [j] through
+	 * colptr [j+1] - 1 of rowind and values, sorted by row.  A symmetric
+	 * matrix stores only its upper triangle (row <= col), so the same
+	 * arrays serve for the matrix and its transpose.
+	 */
+
+struct sparse_matrix;
+typedef boost::shared_ptr<sparse_matrix> SparseMatrix;
+
+struct sparse_matrix {
+   sparse_matrix() { /* NO-OP */ };
+   unsigned	nrows;		/* number of rows			 */
+   unsigned	ncols;		/* number of columns			 */
+   unsigned	nnz;		/* number of stored coefficients	 */
+   int		symmetric;	/* only the upper triangle is stored	 */
+   cvector1<unsigned> colptr;	/* column start addresses (ncols + 1)	 */
+   cvector1<unsigned> rowind;	/* row of each stored coefficient	 */
+   cvector1<double> values;	/* the stored coefficients		 */
+private:
+     sparse_matrix& operator=(const sparse_matrix &rhs);
+     sparse_matrix(const sparse_matrix &am);
+};
+
+# define SparseData(m)  ((m) -> values.c_ptr1())
+
+	/*
+	 * the LDL^T factorization of a symmetric sparse matrix, with the
+	 * columns of L grouped into supernodes.  Pivot k is original
+	 * row/column perm [k].  The rows of supernode s (its own pivots
+	 * first) are rows [rowptr [s] .. rowptr [s+1]-1], and its columns
+	 * of L are stored as one dense column major block starting at
+	 * L [Lptr [s]].
+	 */
+
+struct sparse_factor;
+typedef boost::shared_ptr<sparse_factor> SparseFactor;
+
+struct sparse_factor {
+   sparse_factor() { /* NO-OP */ };
+   unsigned	n;		/* order of the factored matrix		 */
+   unsigned	nsuper;		/* number of supernodes			 */
+   unsigned	maxfront;	/* rows in the largest supernode	 */
+   cvector1<unsigned> perm;	/* fill reducing (and post) ordering	 */
+   cvector1<unsigned> iperm;	/* inverse of perm			 */
+   cvector1<unsigned> super;	/* first pivot of each supernode	 */
+   cvector1<unsigned> nchild;	/* child supernodes in the tree		 */
+   cvector1<unsigned> rowptr;	/* start of each supernode's rows	 */
+   cvector1<unsigned> rows;	/* row structure of the supernodes	 */
+   cvector1<unsigned long> Lptr; /* start of each supernode's block	 */
+   cvector1<double> L;		/* unit lower triangular factor		 */
+   cvector1<double> D;		/* diagonal pivots			 */
+   cvector1<unsigned> Acolptr;	/* lower triangle of P A P^T ...	 */
+   cvector1<unsigned> Arow;	/* ... its row indices ...		 */
+   cvector1<unsigned> Aaddr;	/* ... and coefficient addresses in A	 */
+private:
+     sparse_factor& operator=(const sparse_factor &rhs);
+     sparse_factor(const sparse_factor &am);
+};
+
+	/*
+	 * a preconditioner for the conjugate gradient solver: 'j'acobi
+	 * (inverse of the diagonal), 's'sor (the diagonal and omega, the
+	 * triangles come from A itself), or 'i'ncomplete Cholesky (U^T U
+	 * with U stored in the upper triangle pattern of A)
+	 */
+
+struct preconditioner;
+typedef boost::shared_ptr<preconditioner> Preconditioner;
+
+struct preconditioner {
+   preconditioner() { /* NO-OP */ };
+   int		type;		/* 'j', 's' or 'i'			 */
+   double	omega;		/* SSOR relaxation factor		 */
+   cvector1<double> diag;	/* inverse or plain diagonal		 */
+   SparseMatrix	A;		/* the preconditioned matrix		 */
+   SparseMatrix	U;		/* incomplete Cholesky factor		 */
+private:
+     preconditioner& operator=(const preconditioner &rhs);
+     preconditioner(const preconditioner &am);
+};
+
 	/*
 	 * prototypes for DATA manipulation routines
 	 */
@@ -235,6 +326,24 @@ int Saxpy (Matrix &c, const Matrix &a, const Matrix &b, double alpha);
 */
 int Gaxpy (Matrix &c, const Matrix &a, const Matrix &b, const Matrix &A);
 
+/*!
+  \brief y = alpha * A * a + beta * B * b + gamma * C * c for symmetric
+         compact matrices, computed in a single pass over the profile
+  \param y destination vector
+  \param alpha scale factor for A
+  \param A source compact Matrix
+  \param a source vector for A
+  \param beta scale factor for B
+  \param B source compact Matrix with the profile of A, or a null Matrix
+  \param b source vector for B
+  \param gamma scale factor for C
+  \param C source compact Matrix with the profile of A, or a null Matrix
+  \param c source vector for C
+*/
+int MultiplyCompactMatrices (Matrix &y, double alpha, const Matrix &A, const Matrix &a,
+                             double beta, const Matrix &B, const Matrix &b,
+                             double gamma, const Matrix &C, const Matrix &c);
+
 /*!
   \brief b(i,j) = factor*a(i,j) + offset
   \param b destination matrix
@@ -390,9 +499,35 @@ int FormLUPMatrices (Matrix &L, Matrix &U, Matrix &P, const Matrix &a, const Mat
 /*!
   \brief crout factorize A and store in A
   \param A source and destination matrix
+
+  Large enough matrices are factored with ParallelCroutFactorMatrix
+  when more than one factorization thread has been requested.
 */
 int CroutFactorMatrix (Matrix &A);
 
+/*!
+  \brief crout factorize A in place using several threads
+  \param A source and destination matrix
+  \param nthreads number of threads (including the caller)
+
+  The columns are pipelined across the threads; the result is bitwise
+  identical to CroutFactorMatrix for any number of threads.  The helper
+  threads are started on first use and kept for later factorizations;
+  a call made while another is using them factors on the caller alone.
+*/
+int ParallelCroutFactorMatrix (Matrix &A, unsigned int nthreads);
+
+/*!
+  \brief sets the number of threads CroutFactorMatrix may use
+  \param n thread count, 0 or 1 for sequential factorization
+*/
+void SetFactorThreads (unsigned int n);
+
+/*!
+  \brief the number of threads CroutFactorMatrix may use
+*/
+unsigned FactorThreads (void);
+
 /*!
   \brief  solve Ax=b and store x in b
   \param A Crout factored LHS matrix
@@ -400,6 +535,16 @@ int CroutFactorMatrix (Matrix &A);
 */
 int CroutBackSolveMatrix (const Matrix &A, Matrix &b);
 
+/*!
+  \brief  solve AX=B for many right hand sides and store X in B
+  \param A Crout factored LHS matrix
+  \param B full matrix with one RHS (and solution) per column
+
+  The columns of B are carried through the factor in blocks, so the
+  factor is read once per block rather than once per column.
+*/
+int CroutBackSolveBlock (const Matrix &A, Matrix &B);
+
 	/*
  	 * prototypes for the EIGEN routines
 	 */
@@ -429,6 +574,34 @@ int TridiagSymmMatrixEigenModes (const Matrix &diag, const Matrix &sub_diag, con
 */
 int SymmetricMatrixEigenModes (const Matrix &a, const Matrix &lambda, Matrix &x, unsigned int maxit);
 
+/*!
+  Finds the lowest eigenpairs of K x = lambda M x by shift-invert
+  Lanczos with full reorthogonalization.  Only K is factored, and the
+  Lanczos basis is held to about twice the number of modes and
+  restarted from its best Ritz vectors until they converge, so the
+  storage grows with n times the number of modes, not with n^2.
+  \param K compact stiffness matrix
+  \param M compact mass matrix with the same profile as K
+  \param lambda vector for the eigenvalues; its length sets the number
+	 of modes, returned lowest first
+  \param x n by (number of modes) matrix for the M-orthonormal eigenvectors
+  \param tol relative residual tolerance (0 for the default of 1e-10)
+  \param maxit iteration limit for the tridiagonal eigensolver
+*/
+int LanczosEigenModes (const Matrix &K, const Matrix &M, const Matrix &lambda, Matrix &x, double tol, unsigned int maxit);
+
+/*!
+  LanczosEigenModes for symmetric sparse matrices; K (shifted if it
+  is singular) is factored with the sparse LDL^T solver.
+  \param K sparse stiffness matrix
+  \param M sparse mass matrix with the nonzero structure of K
+  \param lambda vector for the eigenvalues, lowest first
+  \param x n by (number of modes) matrix for the eigenvectors
+  \param tol relative residual tolerance (0 for the default of 1e-10)
+  \param maxit iteration limit for the tridiagonal eigensolver
+*/
+int LanczosEigenModes (const SparseMatrix &K, const SparseMatrix &M, const Matrix &lambda, Matrix &x, double tol, unsigned int maxit);
+
 /*!
   \param a symmetric, tri-diagonal input
   \param diag output vector of diag elements
@@ -527,12 +700,212 @@ int MatricesToMatlab (const Matrix *a, unsigned int n, FILE *fp, const char **na
 
 Matrix MatlabToMatrix (FILE *fp);
 
+	/*
+	 * prototypes for the SPARSE routines
+	 */
+
+/*!
+  Creates a sparse matrix with the given nonzero structure and all of
+  its coefficients set to zero.  The row indices within each column
+  must be sorted and, for a symmetric matrix, lie on or above the
+  diagonal.
+
+  \param rows number of rows
+  \param cols number of columns
+  \param colptr column start addresses (cols + 1 entries)
+  \param rowind row index of every stored coefficient
+  \param symmetric store only the upper triangle
+*/
+SparseMatrix CreateSparseMatrix (unsigned int rows, unsigned int cols,
+                                 const cvector1<unsigned> &colptr,
+                                 const cvector1<unsigned> &rowind, int symmetric);
+
+/*!
+  The sparse analog of ConvertRowColumn.
+
+  \param row the row of what would be the full matrix
+  \param col the column of what would be the full matrix
+  \param A sparse matrix
+  \return the address of (row, col) in the coefficient array, 0 if
+  that entry is not part of the nonzero structure
+*/
+unsigned SparseAddress (unsigned int row, unsigned int col, const SparseMatrix &A);
+
+/*!
+  \param A sparse matrix to fetch data from
+  \param row row index
+  \param col column index
+*/
+double smdata (const SparseMatrix &A, unsigned int row, unsigned int col);
+
+/*!
+  \brief A = 0, keeping the nonzero structure
+  \param A the sparse Matrix to fill with zeros
+*/
+int ZeroSparseMatrix (SparseMatrix &A);
+
+/*!
+  \brief y = A * x
+  \param y destination vector
+  \param A source sparse Matrix
+  \param x source vector
+*/
+int MultiplySparseMatrix (Matrix &y, const SparseMatrix &A, const Matrix &x);
+
+/*!
+  \brief y = alpha * A * a + beta * B * b + gamma * C * c for symmetric
+         sparse matrices with one nonzero structure, computed in a single
+         pass over it; the sparse analog of MultiplyCompactMatrices
+  \param y destination vector
+  \param alpha scale factor for A
+  \param A source symmetric sparse Matrix
+  \param a source vector for A
+  \param beta scale factor for B
+  \param B source sparse Matrix with the structure of A, or a null Matrix
+  \param b source vector for B
+  \param gamma scale factor for C
+  \param C source sparse Matrix with the structure of A, or a null Matrix
+  \param c source vector for C
+*/
+int MultiplySparseMatrices (Matrix &y, double alpha, const SparseMatrix &A, const Matrix &a,
+                            double beta, const SparseMatrix &B, const Matrix &b,
+                            double gamma, const SparseMatrix &C, const Matrix &c);
+
+/*!
+  Builds a symmetric sparse matrix from the nonzero coefficients (and
+  every diagonal) of a compact column matrix.
+
+  \param A compact matrix to convert
+*/
+SparseMatrix MakeSparseFromCompact (const Matrix &A);
+
+/*!
+  Builds the compact column (skyline) matrix that holds a symmetric
+  sparse matrix.
+
+  \param A symmetric sparse matrix to convert
+*/
+Matrix MakeCompactFromSparse (const SparseMatrix &A);
+
+/*!
+  Computes an approximate minimum degree ordering of a symmetric sparse
+  matrix.  Indistinguishable rows (such as the DOF of a node) are merged
+  before the ordering is computed.
+
+  \param A symmetric sparse matrix
+  \param perm on return perm [k] is the k-th row/column to eliminate
+*/
+int MinimumDegreeOrdering (const SparseMatrix &A, cvector1<unsigned> &perm);
+
+/*!
+  The symbolic phase of the sparse LDL^T solver: ordering, elimination
+  tree, supernodes (small ones amalgamated at the cost of a few
+  explicit zeros) and the structure of L.  The result can be factored
+  any number of times for matrices with the nonzero structure of A.
+
+  \param A symmetric sparse matrix
+  \return the (not yet factored) factorization, null on failure
+*/
+SparseFactor AnalyzeSparseMatrix (const SparseMatrix &A);
+
+/*!
+  \brief numeric LDL^T factorization of A into F
+  \param F result of AnalyzeSparseMatrix on A's structure
+  \param A symmetric sparse matrix
+*/
+int FactorSparseMatrix (SparseFactor &F, const SparseMatrix &A);
+
+/*!
+  \brief solve Ax=b and store x in b
+  \param F sparse factorization of A
+  \param b RHS (and dest) vector
+*/
+int SolveSparseMatrix (const SparseFactor &F, Matrix &b);
+
+	/*
+	 * prototypes for the KERNEL routines
+	 */
+
+/*!
+  \brief x . y over n contiguous coefficients
+*/
+double DotKernel (const double *x, const double *y, unsigned int n);
+
+/*!
+  \brief y += alpha*x over n contiguous coefficients
+*/
+void AxpyKernel (double *y, double alpha, const double *x, unsigned int n);
+
+/*!
+  \brief c -= a b for a block of four columns of c
+  \param c m x 4 block, columns ldc apart
+  \param a m x k block, columns lda apart
+  \param b k x 4 block stored by rows, b [4*q + j]
+  \param m rows of c and a
+  \param k columns of a
+*/
+void UpdateKernel (double *c, unsigned int ldc, const double *a, unsigned int lda,
+                   const double *b, unsigned int m, unsigned int k);
+
+/*!
+  \brief chooses the instruction set used by the kernels
+  \param name "avx512", "avx2", "sse2", "scalar", or NULL for the best
+  one this processor supports (the default)
+  \return nonzero if the set is unknown or not supported
+*/
+int SelectKernels (const char *name);
+
+/*!
+  \brief the name of the instruction set the kernels are using
+*/
+const char *KernelName (void);
+
 	/*
 	 * prototypes for the SOLVER routines
 	 */
 
 int GaussSeidel(Matrix &x, const Matrix &A, const Matrix &b);
 
+/*!
+  \brief builds a preconditioner for ConjugateGradient
+  \param A symmetric sparse matrix
+  \param type 'j'acobi, 's'sor or 'i'ncomplete Cholesky
+  \return the preconditioner, null if A has a non-positive diagonal
+*/
+Preconditioner CreatePreconditioner (const SparseMatrix &A, int type);
+
+/*!
+  \brief z = M^-1 r
+  \param M preconditioner
+  \param z destination vector
+  \param r source vector
+*/
+int ApplyPreconditioner (const Preconditioner &M, Matrix &z, const Matrix &r);
+
+/*!
+  \brief solves Ax=b by preconditioned conjugate gradients
+  \param x initial guess on entry, solution on return
+  \param A symmetric positive definite sparse matrix
+  \param b RHS vector
+  \param M preconditioner for A (null for none)
+  \param tol convergence when |b - Ax| <= tol*|b|
+  \param maxits iteration limit
+  \param its if not null, the number of iterations taken
+  \return M_NOTCONVERGED if the limit was reached first
+*/
+int ConjugateGradient (Matrix &x, const SparseMatrix &A, const Matrix &b,
+                       const Preconditioner &M, double tol, unsigned maxits,
+                       unsigned *its);
+
+/*!
+  \brief ConjugateGradient on a compact (skyline) matrix
+
+  The profile is converted to sparse form (dropping its zeros) and
+  preconditioned by incomplete Cholesky.
+*/
+int ConjugateGradient (Matrix &x, const Matrix &A, const Matrix &b,
+                       double tol, unsigned maxits, unsigned *its);
+
 /*----------------------------------------------------------------------*/
 
 # endif	/* _MATRIX_H */
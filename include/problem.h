@@ -64,11 +64,41 @@ typedef struct {
     unsigned	 dofs_pos [7];		/* global DOF position map */
     unsigned	 dofs_num [7];		/* global DOF number map   */
     unsigned	 num_dofs;		/* number of global DOF    */
+    cvector1u	 equations;		/* equation of node DOF    */
+    cvector1u	 eq_slots;		/* node DOF of equation    */
+    unsigned	 num_equations;		/* number of equations     */
     unsigned	 num_errors;		/* number of errors	   */
 } Problem;
 
-extern Problem  problem;
-extern Analysis analysis;
+/*!
+  A problem instance together with its analysis parameters.  The
+  library always works on the context that is current for the calling
+  thread; problem and analysis name the parts of that context.  A
+  thread starts out with the default context, so a program that only
+  ever holds one problem never needs to know about contexts at all.
+  Element definitions are shared by every context and are kept in the
+  default one.
+*/
+struct ProblemContext {
+    Problem	instance;		/* problem instance	   */
+    Analysis	parameters;		/* analysis parameters	   */
+
+    ProblemContext() : instance(), parameters() { }
+};
+
+extern ProblemContext default_context;
+extern thread_local ProblemContext *current_context;
+
+# define problem	(current_context -> instance)
+# define analysis	(current_context -> parameters)
+
+/*!
+  Makes context the current problem context of the calling thread
+  (the default context if context is NULL) and returns the previous
+  one.  Threads started by the library to work on a problem run in the
+  context of the thread that started them.
+*/
+ProblemContext *SetProblemContext(ProblemContext *context);
 
 Definition defnlookup(char *name);
 
@@ -78,6 +108,13 @@ Definition defnlookup(char *name);
 */
 int ParseCppOptions(int *argc, char **argv);
 
+/*!
+  Lets ReadFeltFile read a file without the preprocessor when nothing
+  in it needs one (flag nonzero).  The default is to preprocess every
+  file.
+*/
+void SetPreprocessorSkip(int flag);
+
 /*!
  Returns the current analysis mode for given problem instance.
  Applications cannot simply use problem.mode blindly because we may
@@ -90,7 +127,8 @@ AnalysisType SetAnalysisMode(void);
 /*!
   Reads a felt file using the preprocessor if desired.  A filename of
   "-" indicates standard input (can only be used initially) and a NULL
-  filename indicates no file (an empty problem is created).
+  filename indicates no file (an empty problem is created).  The file
+  is read into the current context; only one file is read at a time.
 */
 int ReadFeltFile(const char *filename);
 
@@ -125,7 +163,7 @@ void detail(const char *format, ...);
 /*!
   Turns on (or off) and sets the stream that describes where detail
   messages should be printed.  To toggle detail messages off, set the
-  stream to NULL.
+  stream to NULL.  The stream is set for the calling thread only.
 */
 void SetDetailStream(FILE *fp);
 
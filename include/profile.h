@@ -0,0 +1,127 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/************************************************************************
+ * File:	profile.h						*
+ *									*
+ * Description:	This file contains the public type and function		*
+ *		declarations for the phase timers and counters.		*
+ ************************************************************************/
+
+# ifndef _PROFILE_H
+# define _PROFILE_H
+
+# include <stdio.h>
+
+/*----------------------------------------------------------------------*/
+
+/*!
+  The phases of a solution that are timed.  The order is the order in
+  which they are reported.
+*/
+typedef enum {
+    ParsePhase,				/* reading the input file  */
+    ResolvePhase,			/* resolving object names  */
+    FindDOFPhase,			/* numbering the equations */
+    RenumberPhase,			/* reordering the nodes	   */
+    SetupPhase,				/* element setup	   */
+    AssemblyPhase,			/* global matrix assembly  */
+    ConstraintPhase,			/* applying constraints	   */
+    FactorPhase,			/* factorization	   */
+    SolvePhase,				/* back substitution	   */
+    EigenPhase,				/* eigenvalue problem	   */
+    StressPhase,			/* element stresses	   */
+    ReactionPhase,			/* reaction forces	   */
+    OutputPhase,			/* writing the results	   */
+    NumProfilePhases
+} ProfilePhase;
+
+/*!
+  The things that are counted.  Sizes are recorded with ProfileSet,
+  which keeps the largest value seen; events are added up with
+  ProfileCount.
+*/
+typedef enum {
+    NodesCounter,			/* number of nodes	   */
+    ElementsCounter,			/* number of elements	   */
+    EquationsCounter,			/* number of equations	   */
+    SharedCounter,			/* elements sharing a K    */
+    ProfileSizeCounter,			/* skyline profile size    */
+    NonzerosCounter,			/* nonzeros in a factored matrix */
+    FactorEntriesCounter,		/* entries in its factor   */
+    FillCounter,			/* factor entries - nonzeros */
+    FactorizationsCounter,		/* factorizations	   */
+    BackSolvesCounter,			/* right hand sides solved */
+    IterationsCounter,			/* conjugate gradient its  */
+    ReactionsCounter,			/* reaction forces	   */
+    NumProfileCounters
+} ProfileCounter;
+
+/*!
+  Turns profiling of the calling thread on (clearing every timer and
+  counter and starting the total clock) or off.  Profiling is off to
+  begin with and costs next to nothing while it stays off.
+*/
+void EnableProfile(int flag);
+
+int ProfileEnabled(void);
+
+/*!
+  Starts and stops the clock of a phase.  Phases nest: while a phase
+  runs inside another one, its time is charged to it alone, so the
+  phase times never add up to more than the total.  A phase that is
+  started again while it is already running is only counted once.
+*/
+void ProfileStart(ProfilePhase phase);
+
+void ProfileStop(ProfilePhase phase);
+
+/*!
+  Adds amount to (or records value as the largest value of) a counter.
+*/
+void ProfileCount(ProfileCounter counter, unsigned long amount);
+
+void ProfileSet(ProfileCounter counter, unsigned long value);
+
+/*!
+  Writes the timers and counters of the calling thread as a JSON
+  object.  Times are wall clock and processor seconds (the processor
+  time includes every thread of the process); memory is the peak
+  resident set size of the process in kilobytes when the phase last
+  ran and how much a phase raised it.
+*/
+int WriteProfile(FILE *fp, const char *input);
+
+/*!
+  Times a phase for the life of the object, whichever way the scope
+  that holds it is left.
+*/
+class PhaseTimer {
+public:
+    PhaseTimer(ProfilePhase phase) : phase(phase) { ProfileStart(phase); }
+    ~PhaseTimer() { ProfileStop(phase); }
+private:
+    ProfilePhase phase;
+    PhaseTimer(const PhaseTimer &);
+    PhaseTimer &operator=(const PhaseTimer &);
+};
+
+/*----------------------------------------------------------------------*/
+
+# endif /* _PROFILE_H */
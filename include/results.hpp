@@ -17,6 +17,10 @@ void WriteLoadCaseTable (Matrix dtable, FILE *fp);
 
 void WriteLoadRangeTable (Matrix dtable, FILE *fp);
 
+void WriteLoadCaseReactions (const Matrix &rtable, const cvector1<Reaction> &R, FILE *fp);
+
+void WriteLoadRangeReactions (const Matrix &rtable, const cvector1<Reaction> &R, FILE *fp);
+
 void WriteModalResults (FILE *fp, Matrix M, Matrix C, Matrix K, Matrix lambda);
 
 void WriteTransientTable (const Matrix &dtable, const Matrix &ttable, FILE *fp);
@@ -31,7 +31,80 @@
 */
 int ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr);
 
-void AssembleTransientForce(double t, Vector F);
+/*!
+  The sparse counterpart of ConstructDynamic; K, M and C are assembled
+  into the shared structure given by ConstructSparsePattern.
+*/
+int ConstructSparseDynamic(SparseMatrix *Kr, SparseMatrix *Mr, SparseMatrix *Cr);
+
+/*!
+  The equations of a transient problem that carry a force or a
+  constraint, gathered once before integration so that each step only
+  visits them.  Equation dofs [k] has the constant value [k] plus, if
+  expr [k] is not null, the value of that expression.  Once the
+  expressions are tabulated, row [k] of series (and of slope, if their
+  derivatives were asked for) holds expression k at the times start,
+  start + step, ...; row [k] is zero for a constant.  If the list has
+  been compiled, tree [k] is expression k compiled once for all of
+  the times it is evaluated at.
+*/
+typedef boost::shared_ptr<struct compiled_code> CodeTree;
+
+typedef struct {
+    cvector1u		dofs;
+    cvector1d		value;
+    cvector1<Code>	expr;
+    cvector1<CodeTree>	tree;
+    cvector1u		row;
+    Matrix		series;
+    Matrix		slope;
+    double		start;
+    double		step;
+} TransientDOFs;
+
+/*!
+  The forced DOF (with any equivalent nodal forces folded into their
+  constant part) and the constrained DOF (with their prescribed
+  displacements) of the current problem.
+*/
+typedef struct {
+    TransientDOFs	forced;
+    TransientDOFs	prescribed;
+} TransientBC;
+
+void BuildTransientBC(TransientBC &bc);
+
+/*!
+  Evaluates the expressions of a list of DOF at count times, step
+  apart from start, (and their derivatives if slopes is non-zero) in
+  one pass, so that looking up a value at one of those times costs
+  nothing.  Any other time is still evaluated as it comes.  The
+  integrators tabulate their forcing this way when analysis.tabulate
+  is set.
+*/
+void TabulateTransientDOFs(TransientDOFs &d, double start, double step,
+                           unsigned count, int slopes);
+
+/*!
+  Compiles the expressions of a list of DOF once, for integrators that
+  evaluate them (or their derivatives) at times that aren't tabulated.
+*/
+void CompileTransientDOFs(TransientDOFs &d);
+
+/*!
+  Forms F(t) from the forced DOF in bc.  Every other equation is zero.
+*/
+void AssembleTransientForce(double t, const TransientBC &bc, Vector F);
+
+/*!
+  Forms dF/dt at t, differentiating the force expressions exactly.
+*/
+void AssembleTransientForceRate(double t, const TransientBC &bc, Vector dF);
+
+/*!
+  Sets the constrained DOF of d to their prescribed displacements at t.
+*/
+void AssignPrescribedDisplacement(double t, const TransientBC &bc, Vector d);
 
 cvector1i BuildConstraintMask(void);
 
@@ -60,6 +133,12 @@ void BuildParabolicIC(Vector d);
  */
 Matrix IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C);
 
+/*!
+  IntegrateHyperbolicDE for K, M and C from ConstructSparseDynamic;
+  K' is formed, constrained and factored in sparse storage.
+*/
+Matrix IntegrateHyperbolicDE(const SparseMatrix &K, const SparseMatrix &M, const SparseMatrix &C);
+
 /*
  Solves the discrete equation of motion, Ma + Cv + Ky = F(t) starting
  from initial values v(0) and y(0). Uses modified L-stable,
@@ -68,6 +147,11 @@ Matrix IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C);
 */
 Matrix RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable);
 
+/*
+ The same for K, M and C from ConstructSparseDynamic.
+*/
+Matrix RosenbrockHyperbolicDE(SparseMatrix k0, SparseMatrix m, SparseMatrix c0, Matrix *ttable);
+
 /*!
   Solves the discrete parabolic differential equation Mv + Kd = F for
   the length of a model using a generalized trapezoidal method.  The
@@ -77,12 +161,38 @@ Matrix RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable);
 */
 Matrix IntegrateParabolicDE(const Vector &K, const Vector &M);
 
+/*!
+  IntegrateParabolicDE for K and M from ConstructSparseDynamic.
+*/
+Matrix IntegrateParabolicDE(const SparseMatrix &K, const SparseMatrix &M);
+
+/*!
+  Sets up every element, keeping its stiffness and mass matrices for
+  IntegrateExplicitDE, and sums the diagonals of the (lumped) element
+  mass matrices and the nodal masses into the vector M.  No global
+  stiffness matrix is formed.  Returns the number of errors.
+*/
+int ConstructLumpedMass(Vector *Mr);
+
+/*!
+  Solves Ma + Cv + Kd = F with the explicit central difference method
+  and the lumped mass M from ConstructLumpedMass.  The internal forces
+  come from the element matrices (in parallel with more than one
+  assembly thread) so nothing is factored.  The step is a fraction of
+  the critical step estimated from the size and highest frequency of
+  each element; analysis.step only sets the output interval, and is
+  set to the integration step if it is not given.
+*/
+Matrix IntegrateExplicitDE(const Vector &M);
+
 
 /*!
  Basically like ZeroConstrainedDOF () for the static case, but here we
  only make adjustments for displacement boundary conditions (i.e., we
  don't bother with zeroing rows and columns of the stiffness matrix).
+ The adjustments come from the rows saved by ApplyConstraints, so the
+ unconstrained matrix does not have to be kept.
 */
-void ResolveBC(double t, Vector K, Vector F);
+void ResolveBC(double t, const TransientBC &bc, const ConstrainedRows &saved, Vector F);
 
 #endif
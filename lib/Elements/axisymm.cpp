@@ -51,6 +51,7 @@ void axisymmetricInit()
     dd->numdofs = 2;
     dd->dofs = {0, 1, 2, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 0;
     AddDefinition(dd);
 }
 
@@ -134,9 +135,9 @@ axisymmetricEltSetup(Element element, char mass_mode, int tangent)
 static int
 axisymmetricEltStress(Element element)
 {
-   static Vector	stress, d;
+   static thread_local Vector	stress, d;
    unsigned		i, j;
-   static Matrix	temp;
+   static thread_local Matrix	temp;
    Matrix		D, B;
    double		r_avg;
    double		z_avg;
@@ -204,7 +205,7 @@ axisymmetricEltStress(Element element)
 static Matrix
 AxisymmetricLocalB(Element element, double *area, double *r_avg, double *z_avg)
 {
-   static Matrix 	B;
+   static thread_local Matrix 	B;
    double		rc1, zc1;
    double		rc2, zc2;
    double		rc3, zc3;
@@ -296,7 +297,7 @@ AxisymmetricEquivNodalForces(Element element, double area, int *err_count)
    unsigned		node_a,
 			node_b;
    unsigned		i;
-   static Vector 	equiv;
+   static thread_local Vector 	equiv;
  
    if (!equiv) 
       equiv = CreateVector (6);
@@ -52,6 +52,7 @@ void beamInit()
     dd->numdofs = 3;
     dd->dofs = {0, 1, 2, 6, 0, 0, 0};
     dd->retainK = 1;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -145,14 +146,14 @@ beamEltStress(Element element)
 {
    unsigned		i;
    int			count;
-   static Vector	f,
+   static thread_local Vector	f,
 			dlocal,
 			d;
    Matrix		T;
-   static Matrix	ke;
-   static Matrix	Tt;
+   static thread_local Matrix	ke;
+   static thread_local Matrix	Tt;
    Vector		equiv;
-   static Vector	eq_local;
+   static thread_local Vector	eq_local;
 
    if (!d) {
       ke = CreateMatrix (6,6);
@@ -228,7 +229,7 @@ BeamLocalK(Element element)
 			L2;
    double		EI,
 			AEonL;
-   static Matrix	ke;
+   static thread_local Matrix	ke;
 
    if (!ke) 
       ke = CreateMatrix (6,6);
@@ -272,7 +273,7 @@ BeamLocalK(Element element)
 static Matrix
 BeamLumpedMassMatrix(Element element)
 {
-   static Matrix	me;
+   static thread_local Matrix	me;
    double		L;
    double		factor;
    double		I_factor;
@@ -299,7 +300,7 @@ BeamLumpedMassMatrix(Element element)
 static Matrix
 BeamConsistentMassMatrix(Element element)
 {
-   static Matrix	me;
+   static thread_local Matrix	me;
    double		L;
    double		f1,f2;
 
@@ -337,7 +338,7 @@ BeamTransformMatrix(Element element)
 {
    double		cx,cy,
 			L;
-   static Matrix	T;
+   static thread_local Matrix	T;
 
    if (!T) {
       T = CreateMatrix (6,6);
@@ -377,9 +378,9 @@ BeamEquivNodalForces(Element element, int *err_count)
    int			count;
    unsigned		i,j;
    Matrix		T;
-   static Matrix	Tt;
-   static Vector 	equiv;
-   static Vector	result;
+   static thread_local Matrix	Tt;
+   static thread_local Vector 	equiv;
+   static thread_local Vector	result;
    double		theta;
  
    if (!equiv) {
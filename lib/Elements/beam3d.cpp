@@ -53,6 +53,7 @@ void beam3dInit()
     dd->numdofs = 6;
     dd->dofs = {0, 1, 2, 3, 4, 5, 6};
     dd->retainK = 1;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -153,13 +154,13 @@ beam3dEltStress(Element element)
 {
    unsigned		i;
    int			count;
-   static Vector	f,
+   static thread_local Vector	f,
 			eq_local,
 			dlocal,
 			d;
    Vector		equiv;
-   static Matrix	ke;
-   static Matrix	Tt;
+   static thread_local Matrix	ke;
+   static thread_local Matrix	Tt;
    Matrix		T;
 
    if (!d) {
@@ -226,7 +227,7 @@ Beam3dLocalK(Element element)
 			EIy,
 			GJ,
 			AEonL;
-   static Matrix	ke;
+   static thread_local Matrix	ke;
 
    if (!ke) 
       ke = CreateMatrix (12,12);
@@ -272,7 +273,7 @@ Beam3dLocalK(Element element)
 static Matrix
 Beam3dLumpedMassMatrix(Element element)
 {
-   static Matrix	me;
+   static thread_local Matrix	me;
    double		L;
    double		factor;
    double		I_factor;
@@ -311,7 +312,7 @@ Beam3dTransformMatrix(Element element)
 			cn,
 			d,	
 			L;
-   static Matrix	T;
+   static thread_local Matrix	T;
 
    if (!T) 
       T = CreateMatrix (12,12);
@@ -365,9 +366,9 @@ Beam3dEquivNodalForces(Element element, int *err_count)
 			cxy,cyy,czy,
 			cxz,cyz,czz;
    double		l,m,n,d;
-   static Matrix	Tt;
-   static Vector 	equiv;
-   static Vector	result;
+   static thread_local Matrix	Tt;
+   static thread_local Vector 	equiv;
+   static thread_local Vector	result;
  
    if (!equiv) {
       equiv = CreateVector (12);
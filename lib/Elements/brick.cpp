@@ -35,24 +35,24 @@
 static int brickEltSetup (Element element, char mass_mode, int tangent);
 static int brickEltStress (Element element);
 
-static void	LocalShapeFunctions (Element element, Matrix N, Matrix dNdxi, Matrix dNde, Matrix dNdzt, int first, int nodal);
+static void	LocalShapeFunctions (Element element, Matrix N, Matrix dNdxi, Matrix dNde, Matrix dNdzt, int nodal);
 static Vector	GlobalShapeFunctions (Element element, Matrix dNdxi, Matrix dNde, Matrix dNdzt, Matrix dNdx, Matrix dNdy, Matrix dNdz);
 static void     AddContribution (Matrix K, Matrix B, Matrix D, double jac);
 static Matrix   LocalB (Element element, Matrix dNdx, Matrix dNdy, Matrix dNdz, unsigned int point);
 
 	/*
-	 * shape function / shape function derivative matrices - we
- 	 * only need space for them once and we use them in both
-	 * setup and stressess ...
+	 * shape function / shape function derivative matrices - each
+	 * thread needs space for them once and the local ones are
+	 * computed when that space is first created
 	 */
 
-static Matrix	N;
-static Matrix	dNde;
-static Matrix	dNdxi;
-static Matrix	dNdzt;
-static Matrix	dNdx;
-static Matrix 	dNdy;
-static Matrix	dNdz;
+static thread_local Matrix	N;
+static thread_local Matrix	dNde;
+static thread_local Matrix	dNdxi;
+static thread_local Matrix	dNdzt;
+static thread_local Matrix	dNdx;
+static thread_local Matrix 	dNdy;
+static thread_local Matrix	dNdz;
 
 void brickInit()
 {
@@ -66,6 +66,7 @@ void brickInit()
     dd->numdofs = 3;
     dd->dofs = {0, 1, 2, 3, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -86,6 +87,7 @@ brickEltSetup(Element element, char mass_mode, int tangent)
       dNdx  = CreateMatrix (8, 8);
       dNdy  = CreateMatrix (8, 8);
       dNdz  = CreateMatrix (8, 8);
+      LocalShapeFunctions (element, N, dNdxi, dNde, dNdzt, 0);
    }
 
    count = 0;
@@ -103,7 +105,6 @@ brickEltSetup(Element element, char mass_mode, int tangent)
    if (count)
       return count;
 
-   LocalShapeFunctions (element, N, dNdxi, dNde, dNdzt, element -> number == 1, 0);
    jac = GlobalShapeFunctions (element, dNdxi, dNde, dNdzt, dNdx, dNdy, dNdz);
 
    D = IsotropicD (element);
@@ -126,11 +127,11 @@ brickEltSetup(Element element, char mass_mode, int tangent)
 static int
 brickEltStress(Element element)
 {
-   static Vector	stress,
+   static thread_local Vector	stress,
 			d;
-   static Matrix	temp;
-   static Vector	weights;
-   static Matrix	N, dNdxi, dNde, dNdzt,
+   static thread_local Matrix	temp;
+   static thread_local Vector	weights;
+   static thread_local Matrix	N, dNdxi, dNde, dNdzt,
                         dNdx, dNdy, dNdz;
    Matrix		D,
 			B;
@@ -148,6 +149,7 @@ brickEltStress(Element element)
       dNdy  = CreateMatrix (8,8);
       dNdz  = CreateMatrix (8,8);
       weights = CreateVector (8);
+      LocalShapeFunctions (element, N, dNdxi, dNde, dNdzt, 1);
    }
    
    if (!stress) {
@@ -160,7 +162,6 @@ brickEltStress(Element element)
    if (!D)
       return 1;
 
-   LocalShapeFunctions (element, N, dNdxi, dNde, dNdzt, element -> number == 1, 1);
    jac = GlobalShapeFunctions (element, dNdxi, dNde, dNdzt, dNdx, dNdy, dNdz);
 
    for (i = 1 ; i <= 8 ; i++) {
@@ -217,7 +218,7 @@ brickEltStress(Element element)
 static Matrix
 LocalB(Element element, Matrix dNdx, Matrix dNdy, Matrix dNdz, unsigned int point)
 {
-   static Matrix	B;
+   static thread_local Matrix	B;
    unsigned		i;
 
    if (!B) 
@@ -278,7 +279,7 @@ static double eta_points [ ]  = {0, -PT, -PT, PT, PT, -PT, -PT, PT, PT};
 static double zeta_points [ ] = {0, -PT, -PT, -PT, -PT, PT, PT, PT, PT};
 
 static void
-LocalShapeFunctions(Element element, Matrix N, Matrix dNdxi, Matrix dNde, Matrix dNdzt, int first, int nodal)
+LocalShapeFunctions(Element element, Matrix N, Matrix dNdxi, Matrix dNde, Matrix dNdzt, int nodal)
 {
    double	eta, en;
    double	xi, xn;
@@ -288,9 +289,6 @@ LocalShapeFunctions(Element element, Matrix N, Matrix dNdxi, Matrix dNde, Matrix
    double      *eta_p;
    double      *zeta_p;
 
-   if (!first)
-      return;
-
    if (nodal) {
       xi_p = xi_n;
       eta_p = e_n;
@@ -325,7 +323,7 @@ LocalShapeFunctions(Element element, Matrix N, Matrix dNdxi, Matrix dNde, Matrix
 static Vector
 GlobalShapeFunctions(Element element, Matrix dNdxi, Matrix dNde, Matrix dNdzt, Matrix dNdx, Matrix dNdy, Matrix dNdz)
 {
-   static Vector	jac;
+   static thread_local Vector	jac;
    unsigned		i, j;
    double		dxdxi, dydxi, dzdxi;
    double		dxde,dyde, dzde;
@@ -58,6 +58,7 @@ void CSTPlaneStrainInit()
     dd->numdofs = 2;
     dd->dofs = {0, 1, 2, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -73,6 +74,7 @@ void CSTPlaneStressInit()
     dd->numdofs = 2;
     dd->dofs = {0, 1, 2, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -179,10 +181,10 @@ CSTElementSetup(Element element, char mass_mode, int tangent, unsigned int type)
 static int
 CSTElementStress(Element element, unsigned int type)
 {
-   static Vector	stress,
+   static thread_local Vector	stress,
 			d;
    unsigned		i, j;
-   static Matrix	temp;
+   static thread_local Matrix	temp;
    Matrix		D,
 			B;
    double		x,y;
@@ -258,7 +260,7 @@ CSTElementStress(Element element, unsigned int type)
 static Matrix
 CSTLocalB(Element element, double *area)
 {
-   static Matrix 	B;
+   static thread_local Matrix 	B;
    double		xc1,yc1,
 			xc2,yc2,
 			xc3,yc3,
@@ -345,7 +347,7 @@ CSTEquivNodalForces(Element element, int *err_count)
    unsigned		node_a,
 			node_b;
    unsigned		i;
-   static Vector 	equiv;
+   static thread_local Vector 	equiv;
  
    if (!equiv) 
        equiv = CreateVector (6);
@@ -53,6 +53,7 @@ void ctgInit()
     dd->numdofs = 1;
     dd->dofs = {0, 1, 0, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -156,7 +157,7 @@ CTGConsistentCapacityMatrix(Element e, double area)
 static Matrix
 PlanarConductivity(Element element)
 {
-   static Matrix	D;
+   static thread_local Matrix	D;
 
    if (!D) {
       D = CreateMatrix (2,2);
@@ -172,7 +173,7 @@ PlanarConductivity(Element element)
 static Matrix
 CTGLocalB(Element element, double *area)
 {
-   static Matrix 	B;
+   static thread_local Matrix 	B;
    double		xc1,yc1,
 			xc2,yc2,
 			xc3,yc3,
@@ -241,8 +242,8 @@ CTGResolveConvection(Element element, int *err_count)
    unsigned		node_a,
 			node_b;
    unsigned		i;
-   static Vector 	equiv;
-   static Matrix	convK;
+   static thread_local Vector 	equiv;
+   static thread_local Matrix	convK;
  
    if (!equiv) {
       equiv = CreateVector (3);
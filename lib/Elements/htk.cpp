@@ -54,6 +54,7 @@ void htkInit()
     dd->numdofs = 3;
     dd->dofs = {0, 3, 4, 5, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -79,16 +80,16 @@ static Matrix   FormDbMatrix  (Element element);
 	 * we defined them at.
 	 */
 
-static Matrix	N1;/* shape functions 		     */
-static Matrix	dNde1;		/* shape func derivs in local coord  */
-static Matrix	dNdxi1;		/* shape func derivs in local coord  */
-static Matrix	dNdx1;		/* shape func derivs in global coord */
-static Matrix 	dNdy1;		/* shape func derivs in global coord */
-static Matrix	N2;		/* shape functions 		     */
-static Matrix	dNde2;		/* shape func derivs in local coord  */
-static Matrix	dNdxi2;		/* shape func derivs in local coord  */
-static Matrix	dNdx2;		/* shape func derivs in global coord */
-static Matrix 	dNdy2;		/* shape func derivs in global coord */
+static thread_local Matrix	N1;/* shape functions 		     */
+static thread_local Matrix	dNde1;		/* shape func derivs in local coord  */
+static thread_local Matrix	dNdxi1;		/* shape func derivs in local coord  */
+static thread_local Matrix	dNdx1;		/* shape func derivs in global coord */
+static thread_local Matrix 	dNdy1;		/* shape func derivs in global coord */
+static thread_local Matrix	N2;		/* shape functions 		     */
+static thread_local Matrix	dNde2;		/* shape func derivs in local coord  */
+static thread_local Matrix	dNdxi2;		/* shape func derivs in local coord  */
+static thread_local Matrix	dNdx2;		/* shape func derivs in global coord */
+static thread_local Matrix 	dNdy2;		/* shape func derivs in global coord */
 
 static int
 htkEltSetup(Element element, char mass_mode, int tangent)
@@ -260,7 +261,7 @@ static Vector
 GlobalShapeFunctions(Element element, Matrix dNdxi, Matrix dNde, Matrix dNdx, Matrix dNdy, unsigned int ninteg, unsigned int shape)
 {
    unsigned		i,j;
-   static Vector	jac;
+   static thread_local Vector	jac;
    double		dxdxi [5];
    double		dxde [5];
    double		dydxi [5];
@@ -305,7 +306,7 @@ TwoPointLocalShapeFunctions(Element element, Matrix N, Matrix dNdxi, Matrix dNde
    double		eta;
    double		xi;
    unsigned		p;
-   static unsigned	prev_shape = 0;
+   static thread_local unsigned	prev_shape = 0;
 
    if (shape == prev_shape)
       return;
@@ -348,7 +349,7 @@ OnePointLocalShapeFunctions(Element element, Matrix N, Matrix dNdxi, Matrix dNde
    double		eta;
    double		xi;
    unsigned		p;
-   static unsigned	prev_shape = 0;
+   static thread_local unsigned	prev_shape = 0;
 
    if (shape == prev_shape)
       return;
@@ -387,7 +388,7 @@ static Matrix
 FormBsMatrix(Element element, Matrix N, Matrix dNdx, Matrix dNdy, unsigned int numnodes, unsigned int point)
 {
    unsigned		i;
-   static Matrix 	B;
+   static thread_local Matrix 	B;
 
    if (!B) 
       B = CreateMatrix (2, 12);
@@ -410,7 +411,7 @@ static Matrix
 FormBbMatrix(Element element, Matrix dNdx, Matrix dNdy, unsigned int numnodes, unsigned int point)
 {
    unsigned		i;
-   static Matrix 	B;
+   static thread_local Matrix 	B;
 
    if (!B) 
       B = CreateMatrix (3, 12);
@@ -431,8 +432,8 @@ FormBbMatrix(Element element, Matrix dNdx, Matrix dNdy, unsigned int numnodes, u
 static Matrix
 FormDsMatrix(Element element)
 {
-   static Material	prev_material;
-   static Matrix	D;
+   static thread_local Material	prev_material;
+   static thread_local Matrix	D;
 
    if (!D) {
       D = CreateMatrix (2,2);
@@ -458,8 +459,8 @@ FormDsMatrix(Element element)
 static Matrix
 FormDbMatrix(Element element)
 {
-   static Material	prev_material;
-   static Matrix	D;
+   static thread_local Material	prev_material;
+   static thread_local Matrix	D;
    double		c1, c2;
    double		t;
 
@@ -498,9 +499,9 @@ htkEltStress(Element element)
    Matrix		Bs, Bb;		
    Vector		jac1;		/* vector of Jacobian determinants   */
    Vector		jac2;		/* vector of Jacobian determinants   */
-   static Vector	d;
-   static Vector	m;
-   static Vector	q;
+   static thread_local Vector	d;
+   static thread_local Vector	m;
+   static thread_local Vector	q;
    unsigned		shape;		/* triangle or quadrilateral ?	     */
    double		xsum, ysum;
 
@@ -617,7 +618,7 @@ static int
 EquivNodalForces(Element e, Matrix N, unsigned int shape, unsigned int ninteg)
 {
    int		  count;
-   static Vector  equiv;
+   static thread_local Vector  equiv;
    unsigned	  i,j;
    double	  area;
    double	  w[5];
@@ -54,6 +54,7 @@ void iso2d_PlaneStressInit()
     dd->numdofs = 2;
     dd->dofs = {0, 1, 2, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -69,6 +70,7 @@ void iso2d_PlaneStrainInit()
     dd->numdofs = 2;
     dd->dofs = {0, 1, 2, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -110,11 +112,11 @@ iso2dElementSetup(Element element, char mass_mode, int tangent, unsigned int typ
    Matrix		B;
    Matrix		D;
    Vector		jac;
-   static Vector	weights;
-   static Matrix	tempK;
-   static Matrix	N, dNdxi, dNde,
+   static thread_local Vector	weights;
+   static thread_local Matrix	tempK;
+   static thread_local Matrix	N, dNdxi, dNde,
                         dNdx, dNdy;
-   static Matrix	Bt, temp;
+   static thread_local Matrix	Bt, temp;
 
    if (!dNdy) {
   
@@ -251,7 +253,7 @@ static Matrix
 Iso2dLocalB(Element element, unsigned int numnodes, Matrix dNdx, Matrix dNdy, unsigned int point)
 {
    unsigned		i;
-   static Matrix	B;
+   static thread_local Matrix	B;
 
    if (!B) 
       B = CreateMatrix (3,18);
@@ -273,7 +275,7 @@ Iso2dLocalB(Element element, unsigned int numnodes, Matrix dNdx, Matrix dNdy, un
 static Vector
 GlobalIsoShapeFunctions(Element element, Matrix N, Matrix dNdxi, Matrix dNde, Matrix dNdx, Matrix dNdy, int ninteg, unsigned int nodes)
 {
-   static Vector	jac,
+   static thread_local Vector	jac,
 			dxdxi, dxde,
 			dydxi, dyde;
 
@@ -358,9 +360,9 @@ LocalIsoShapeFunctions(Element element, Matrix N, Matrix dNdx, Matrix dNde, Vect
    double		de[10],dx[10];
    double		*gauss_points;
    double		*gauss_wts;
-   static unsigned	numnodes;
-   static int 	        points [10];
-   static int	        prev_points [10] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
+   static thread_local unsigned	numnodes;
+   static thread_local int 	        points [10];
+   static thread_local int	        prev_points [10] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
    unsigned		same_flag;
 
    same_flag = 1;
@@ -37,11 +37,8 @@
 # define PLANESTRESS 1
 # define PLANESTRAIN 2
 
-# define FORCE	 1
-# define NOFORCE 0
-
 static void     QuadLumpedMassMatrix (Element element, unsigned int numnodes);
-static unsigned LocalQuadShapeFunctions   (Element element, unsigned int ninteg, Matrix N, Matrix dNdx, Matrix dNde, Vector weights, unsigned int force_init);
+static unsigned LocalQuadShapeFunctions   (Element element, unsigned int ninteg, Matrix N, Matrix dNdx, Matrix dNde, Vector weights, unsigned *prev_nodes);
 static Vector   GlobalQuadShapeFunctions  (Element element, Matrix dNdxi, Matrix dNde, Matrix dNdx, Matrix dNdy, int ninteg, unsigned int nodes);
 static Matrix   IsoQuadLocalB (Element element, unsigned int numnodes, Matrix dNdx, Matrix dNdy, unsigned int point);
 static Vector	 IsoQuadEquivNodalForces (Element element, int *err_count);
@@ -63,6 +60,7 @@ void quad_PlaneStrainInit()
     dd->numdofs = 2;
     dd->dofs = {0, 1, 2, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -78,6 +76,7 @@ void quad_PlaneStressInit()
     dd->numdofs = 2;
     dd->dofs = {0, 1, 2, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -115,11 +114,12 @@ QuadElementSetup(Element element, char mass_mode, int tangent, unsigned int type
    Vector		jac;
    Vector		equiv;
    int			count;
-   static Vector	weights;
-   static Matrix	tempK;
-   static Matrix	N, dNdxi, dNde,
+   static thread_local Vector	weights;
+   static thread_local Matrix	tempK;
+   static thread_local Matrix	N, dNdxi, dNde,
                         dNdx, dNdy;
-   static Matrix	Bt, temp;
+   static thread_local Matrix	Bt, temp;
+   static thread_local unsigned	shape;
 
    if (!dNdy) {
   
@@ -150,7 +150,7 @@ QuadElementSetup(Element element, char mass_mode, int tangent, unsigned int type
    ninteg = 4;	/* 2 x 2 quadrature */
   
    numnodes = LocalQuadShapeFunctions (element, ninteg, N, 
-                                       dNdxi, dNde, weights, NOFORCE);  
+                                       dNdxi, dNde, weights, &shape);  
 
    jac = GlobalQuadShapeFunctions (element,dNdxi,dNde,dNdx,dNdy,
                                    ninteg,numnodes);
@@ -248,12 +248,13 @@ QuadElementSetup(Element element, char mass_mode, int tangent, unsigned int type
 static int
 QuadElementStress(Element element, unsigned int type)
 {
-   static Vector	stress,
+   static thread_local Vector	stress,
 			d;
-   static Matrix	temp;
-   static Vector	weights;
-   static Matrix	N, dNdxi, dNde,
+   static thread_local Matrix	temp;
+   static thread_local Vector	weights;
+   static thread_local Matrix	N, dNdxi, dNde,
                         dNdx, dNdy;
+   static thread_local unsigned	shape;
    unsigned		numnodes;
    int			ninteg;
    Matrix		D,
@@ -293,12 +294,8 @@ QuadElementStress(Element element, unsigned int type)
    if (!D)
       return 1;
 
-   if (element -> number == 1)
-      numnodes = LocalQuadShapeFunctions (element, ninteg, N, 
-                                          dNdxi, dNde, weights, FORCE);  
-   else
-      numnodes = LocalQuadShapeFunctions (element, ninteg, N, 
-                                          dNdxi, dNde, weights, NOFORCE);  
+   numnodes = LocalQuadShapeFunctions (element, ninteg, N, 
+                                       dNdxi, dNde, weights, &shape);  
 
    ninteg = 4;
    
@@ -385,7 +382,7 @@ static Matrix
 IsoQuadLocalB(Element element, unsigned int numnodes, Matrix dNdx, Matrix dNdy, unsigned int point)
 {
    unsigned		i;
-   static Matrix	B;
+   static thread_local Matrix	B;
 
    if (!B) 
       B = CreateMatrix (3,8);
@@ -408,7 +405,7 @@ static Vector
 GlobalQuadShapeFunctions(Element element, Matrix dNdxi, Matrix dNde, Matrix dNdx, Matrix dNdy, int ninteg, unsigned int nodes)
 {
    unsigned		i,j;
-   static Vector	jac,
+   static thread_local Vector	jac,
 			dxdxi, dxde,
 			dydxi, dyde;
 
@@ -468,7 +465,8 @@ GlobalQuadShapeFunctions(Element element, Matrix dNdxi, Matrix dNde, Matrix dNdx
 *
 * Description:  calculates the shape functions and the derivatives (w/ respect
 *		to xi, eta coordinates) of the shape function for a four to 
-*		nine node plane stress / plane strain element	
+*		nine node plane stress / plane strain element.  The
+*		shape last computed into N is kept in *prev_nodes.
 *
 * Note:		The approach looks rather brutish, but it seems much clearer
 *		to me this way and we have to do each individual computation 
@@ -478,7 +476,7 @@ GlobalQuadShapeFunctions(Element element, Matrix dNdxi, Matrix dNde, Matrix dNdx
 ******************************************************************************/
 
 static unsigned
-LocalQuadShapeFunctions(Element element, unsigned int ninteg, Matrix N, Matrix dNdx, Matrix dNde, Vector weights, unsigned int force_init)
+LocalQuadShapeFunctions(Element element, unsigned int ninteg, Matrix N, Matrix dNdx, Matrix dNde, Vector weights, unsigned *prev_nodes)
 {
    unsigned		i,j,k;
    double		eta,xi;
@@ -487,15 +485,14 @@ LocalQuadShapeFunctions(Element element, unsigned int ninteg, Matrix N, Matrix d
    double		*gauss_points;
    double		*gauss_wts;
    unsigned		numnodes;
-   static unsigned	prev_nodes = 0;
-   
+
 
    if (element -> node[3] -> number == element -> node[4] -> number) 
       numnodes = 3;
    else   
       numnodes = 4;   
 
-   if (numnodes == prev_nodes && !force_init)
+   if (numnodes == *prev_nodes)
       return numnodes;
 
    ninteg /= 2;	/* how many in each dimension? */
@@ -536,7 +533,7 @@ LocalQuadShapeFunctions(Element element, unsigned int ninteg, Matrix N, Matrix d
       }
    }
 
-   prev_nodes = numnodes;
+   *prev_nodes = numnodes;
    return numnodes;
 }
 
@@ -554,7 +551,7 @@ IsoQuadEquivNodalForces(Element element, int *err_count)
    unsigned		node_a,
 			node_b;
    unsigned		i;
-   static Vector 	equiv;
+   static thread_local Vector 	equiv;
  
    if (!equiv) 
       equiv = CreateVector (8);
@@ -56,9 +56,9 @@ GaussPoints(unsigned int npoints, double **xpoints, double **weights)
 Matrix 
 PlaneStrainD(Element element)
 {
-   static Matrix	D;
-   static double	prev_nu = -99;
-   static double	prev_E = -99;
+   static thread_local Matrix	D;
+   static thread_local double	prev_nu = -99;
+   static thread_local double	prev_E = -99;
    double 		poisson,
 			factor;
 
@@ -96,9 +96,9 @@ PlaneStrainD(Element element)
 Matrix
 PlaneStressD(Element element)
 {
-   static Matrix	D;
-   static double	prev_nu = -99;
-   static double	prev_E = -99;
+   static thread_local Matrix	D;
+   static thread_local double	prev_nu = -99;
+   static thread_local double	prev_E = -99;
    double 		poisson,
 			factor;
 
@@ -136,9 +136,9 @@ PlaneStressD(Element element)
 Matrix
 AxisymmetricD(Element element)
 {
-   static Matrix	D;
-   static double	prev_nu = -99;
-   static double	prev_E = -99;
+   static thread_local Matrix	D;
+   static thread_local double	prev_nu = -99;
+   static thread_local double	prev_E = -99;
    double 		poisson,
 			factor;
 
@@ -184,9 +184,9 @@ AxisymmetricD(Element element)
 Matrix
 IsotropicD(Element element)
 {
-   static Matrix	D;
-   static double	prev_nu = -99;
-   static double	prev_E = -99;
+   static thread_local Matrix	D;
+   static thread_local double	prev_nu = -99;
+   static thread_local double	prev_E = -99;
    double 		poisson,
 			factor;
 
@@ -50,6 +50,7 @@ void rodInit()
     dd->numdofs = 1;
     dd->dofs = {0, 1, 0, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -177,8 +178,8 @@ RodResolveConvection(Element element, int *err_count)
    unsigned		node_a,
 			node_b;
    unsigned		i;
-   static Vector 	equiv;
-   static Matrix	convK;
+   static thread_local Vector 	equiv;
+   static thread_local Matrix	convK;
  
    if (!equiv) {
       equiv = CreateVector (2);
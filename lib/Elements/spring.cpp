@@ -49,6 +49,7 @@ void springInit()
     dd->numdofs = 1;
     dd->dofs = {0, 1, 0, 0, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -52,6 +52,7 @@ void timoshenkoInit()
     dd->numdofs = 3;
     dd->dofs = {0, 1, 2, 6, 0, 0, 0};
     dd->retainK = 1;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
@@ -234,13 +235,13 @@ timoshenkoEltStress(Element element)
 {
     unsigned	    i;			/* loop index			 */
     int		    count;		/* count of errors		 */
-    static Vector   dlocal;	/* local nodal displacements	 */
-    static Vector   d;			/* global nodal displacements	 */
-    static Vector   f;  		/* actual internal forces	 */
+    static thread_local Vector   dlocal;	/* local nodal displacements	 */
+    static thread_local Vector   d;			/* global nodal displacements	 */
+    static thread_local Vector   f;  		/* actual internal forces	 */
     Vector	    equiv;		/* equivalent nodal forces	 */
     Matrix	    T;			/* transform matrix		 */
-    static Matrix   khat;		/* local stiffness matrix	 */
-    static Matrix   Tt;			/* transpose of transform	 */
+    static thread_local Matrix   khat;		/* local stiffness matrix	 */
+    static thread_local Matrix   Tt;			/* transpose of transform	 */
 
 	/*
 	 * our usual trick to set-up the matrices and vectors that
@@ -348,7 +349,7 @@ timoshenkoEltStress(Element element)
 static Matrix
 LocalK(Element element)
 {
-    static Matrix k;	/* the local stiffness matrix	       */
+    static thread_local Matrix k;	/* the local stiffness matrix	       */
     double	  L;		/* the element length		       */
     double	  phi;		/* bending stiffness / shear stiffness */
     double	  factor;	/* common factor in stiffness matrix   */
@@ -423,7 +424,7 @@ LocalK(Element element)
 static Matrix
 ConsistentMassMatrix(Element element)
 {
-    static Matrix m;       /* the local stiffness matrix	          */
+    static thread_local Matrix m;       /* the local stiffness matrix	          */
     double	  L;		  /* the element length		          */
     double	  phi;		  /* bending stiffness / shear stiffness  */
     double        phi2;           /* phi squared		          */
@@ -486,7 +487,7 @@ ConsistentMassMatrix(Element element)
 static Matrix
 LumpedMassMatrix(Element element)
 {
-    static Matrix m;       /* the local stiffness matrix	 */
+    static thread_local Matrix m;       /* the local stiffness matrix	 */
     double	  factor ;	  /* constant term		 */
     double	  I_factor;
     double	  L;
@@ -519,7 +520,7 @@ static Matrix
 TransformMatrix(Element element)
 {
     double         s,c; 	/* direction cosines			*/
-    static Matrix  T; 	/* transform matrix to return		*/
+    static thread_local Matrix  T; 	/* transform matrix to return		*/
     double	   L;		/* element length			*/
 
 	/*
@@ -571,15 +572,15 @@ TransformMatrix(Element element)
 static int
 EquivNodalForces(Element element, Matrix T, Vector *eq_stress, int mode)
 {
-    static Vector  equiv;	/* the equiv vector in local coord */
-    static Vector  eq_global;		/* equiv in global coordinates     */
+    static thread_local Vector  equiv;	/* the equiv vector in local coord */
+    static thread_local Vector  eq_global;		/* equiv in global coordinates     */
     double	   wa, wb;		/* values of load at nodes	   */
     double	   L;			/* the element length		   */
     unsigned	   i,j;			/* some loop conuters		   */
     double	   factor;		/* constant factor for sloped load */
     double	   phi;			/* bending / shear stiffness	   */
     int		   count;		/* error count			   */
-    static Matrix  Tt;			/* transpose of transform matrixi  */
+    static thread_local Matrix  Tt;			/* transpose of transform matrixi  */
 
     if (!equiv) {
         equiv     = CreateVector (4);
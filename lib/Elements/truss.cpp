@@ -46,13 +46,14 @@ void trussInit()
     dd->numdofs = 3;
     dd->dofs = {0, 1, 2, 3, 0, 0, 0};
     dd->retainK = 0;
+    dd->shareK = 1;
     AddDefinition(dd);
 }
 
 static Matrix
 TrussMassMatrix(Element element, char mass_mode)
 {
-   static Matrix	me;
+   static thread_local Matrix	me;
    double		L;
    double		factor;
 
@@ -85,7 +86,7 @@ static Matrix
 TrussTransformMatrix(Element element, double cx, double cy, double cz)
 {
    double		L;
-   static Matrix	T;
+   static thread_local Matrix	T;
 
    if (!T) 
       T = CreateMatrix (2,6);
@@ -117,9 +118,9 @@ TrussEquivNodalForces(Element element, Matrix T, int *err_count)
 			force2;
    int			count;
    unsigned		i;
-   static Matrix	Tt;
-   static Vector 	equiv;
-   static Vector	result;
+   static thread_local Matrix	Tt;
+   static thread_local Vector 	equiv;
+   static thread_local Vector	result;
  
    if (!equiv) {
       equiv = CreateVector (2);
@@ -243,9 +244,9 @@ trussEltSetup(Element element, char mass_mode, int tangent)
 {
    double		AEonL,L;
    Matrix		T;
-   static Vector	equiv;
+   static thread_local Vector	equiv;
    int			count;
-   static Matrix	ke;
+   static thread_local Matrix	ke;
    Matrix		me;
    double		factor;
    double		sign;
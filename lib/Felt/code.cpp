@@ -29,9 +29,10 @@
 # include <stdarg.h>
 # include "code.h"
 # include "allocate.h"
+# include "error.h"
 
 # define MaxStackDepth	1024
-# define MaxCodeSize	1024
+# define BlockSize	256
 
 # define push(x)	(* ++ sp = (x))
 # define pop()		(* sp --)
@@ -102,13 +103,28 @@ typedef union instruction {
 } Instruction;
 
 
-static Instruction in_core [MaxCodeSize];
-static Code	   ip = in_core;
+	/*
+	 * the code being compiled grows as needed, since a table of a
+	 * recorded history can run to many thousands of points
+	 */
 
-static double	   stack [MaxStackDepth];
-static double	  *sp;
+static unsigned	   core_size = 0;
+static unsigned	   ip = 0;
 
-Code InCore = in_core;
+Code InCore = NULL;
+
+static void
+ReserveCode(unsigned needed)
+{
+    if (ip + needed <= core_size)
+	return;
+
+    while (ip + needed > core_size)
+	core_size = core_size ? core_size << 1 : 1024;
+
+    if (!Reallocate (InCore, Instruction, core_size))
+	Fatal ("unable to expand code");
+}
 
 void
 EmitCode(Opcode op, ...)
@@ -119,45 +135,48 @@ EmitCode(Opcode op, ...)
     double *array;
 
 
-    ip ++ -> op = op;
+    ReserveCode (2);
+    InCore [ip ++].op = op;
 
     switch (data [op].arg_type) {
     case Integer:
 	va_start (ap, op);
-	ip ++ -> offset = va_arg (ap, int);
+	InCore [ip ++].offset = va_arg (ap, int);
 	va_end (ap);
 	break;
 
     case Double:
 	va_start (ap, op);
-	ip ++ -> arg = va_arg (ap, double);
+	InCore [ip ++].arg = va_arg (ap, double);
 	va_end (ap);
 	break;
 
     case Array:
 	va_start (ap, op);
 	array = va_arg (ap, double *);
-	ip ++ -> offset = length = va_arg (ap, int);
+	InCore [ip ++].offset = length = va_arg (ap, int);
 	va_end (ap);
+	ReserveCode (length);
 	for (i = 0; i < length; i ++)
-	    ip ++ -> arg = array [i];
+	    InCore [ip ++].arg = array [i];
 	break;
     }
 }
 
-Code
-CopyCode(Code code)
+	/*
+	 * the number of instructions in a piece of code, halt included
+	 */
+
+static unsigned
+CodeSize(Code code)
 {
     Code     pc;
-    Code     ptr;
-    Code     copy;
     Opcode   op;
     unsigned size;
 
 
     size = 0;
-    if (!(pc = code))
-	return NULL;
+    pc = code;
 
     while (1) {
 	size ++;
@@ -173,16 +192,7 @@ CopyCode(Code code)
 	}
     }
 
-    if (!(copy = Allocate (Instruction, size)))
-	return NULL;
-
-    pc = code;
-    ptr = copy;
-
-    while (size --)
-	*ptr ++ = *pc ++;
-
-    return copy;
+    return size;
 }
 
 void
@@ -195,24 +205,71 @@ FreeCode(Code code)
 void
 SetIP(int new_ip)
 {
-    ip = InCore + new_ip;
+    ip = new_ip;
 }
 
 int
 GetIP(void)
 {
-    return ip - InCore;
+    return ip;
+}
+
+
+/************************************************************************
+ * Function:	FindPoint						*
+ *									*
+ * Description:	Returns the index of the first point of a table whose	*
+ *		time is not less than the given time (or the length of	*
+ *		the table if there is none).  The times never decrease	*
+ *		so a binary search will do, but if a hint is given the	*
+ *		point found last time and the one after it are tried	*
+ *		first, which is all it takes when the times being	*
+ *		looked up increase steadily.				*
+ ************************************************************************/
+
+static int
+FindPoint(Code array, int length, double time, int *hint)
+{
+    int lo;
+    int hi;
+    int mid;
+
+
+    if (hint) {
+	for (lo = *hint; lo <= *hint + 2 && lo < length; lo += 2)
+	    if (time <= array[lo].arg && (!lo || array[lo - 2].arg < time))
+		return *hint = lo;
+	if (lo == length && array[lo - 2].arg < time)
+	    return *hint = lo;
+    }
+
+    lo = 0;
+    hi = length / 2;
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (array[2 * mid].arg < time)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    if (hint)
+	*hint = 2 * lo;
+
+    return 2 * lo;
 }
 
 
 /************************************************************************
  * Function:	EvalTable						*
  *									*
- * Description:	Evaluates a table or cycle opcode.			*
+ * Description:	Evaluates a table or cycle opcode, and if asked, the	*
+ *		slope of the table at that time.			*
  ************************************************************************/
 
 static double
-EvalTable(Code array, int length, double time, int flag)
+EvalTable(Code array, int length, double time, int flag, int *hint,
+	  double *slope)
 {
     int    i1;
     int    i2;
@@ -223,18 +280,22 @@ EvalTable(Code array, int length, double time, int flag)
     double x2;
 
 
+    if (slope)
+	*slope = 0;
+
     if (length == 2)
 	return time == array[0].arg ? array[1].arg : 0;
 
     if (flag) {
 	max = array[length - 2].arg;
-	while (time > max)
-	    time -= max;
+	if (time > max && max > 0) {
+	    time = fmod (time, max);
+	    if (time == 0)
+		time = max;
+	}
     }
 
-    for (i1 = 0; i1 < length; i1 += 2)
-	if (time <= array[i1].arg)
-	    break;
+    i1 = FindPoint (array, length, time, hint);
 
     if (i1 == length) {
 	i1 = i1 - 2;
@@ -249,6 +310,9 @@ EvalTable(Code array, int length, double time, int flag)
     x1 = array[i1 + 1].arg;
     x2 = array[i2 + 1].arg;
 
+    if (slope && t1 != t2)
+	*slope = (x2 - x1) / (t2 - t1);
+
     /*printf ("(%g,%g) %g (%g,%g)\n", t1, x1, time, t2, x2);*/
     return t1 != t2 ? (x2 - x1) / (t2 - t1) * (time - t1) + x1 : x2;
 }
@@ -261,6 +325,8 @@ EvalCode(Code code, double time)
     double a;
     double b;
     Code   pc;
+    double stack [MaxStackDepth];
+    double *sp;
 
 
     sp = stack;
@@ -489,13 +555,13 @@ EvalCode(Code code, double time)
 
 	case TableOp:
 	    y = pc ++ -> offset;
-	    push (EvalTable (pc, y, time, 0));
+	    push (EvalTable (pc, y, time, 0, NULL, NULL));
 	    pc += y;
 	    break;
 
 	case CycleOp:
 	    y = pc ++ -> offset;
-	    push (EvalTable (pc, y, time, 1));
+	    push (EvalTable (pc, y, time, 1, NULL, NULL));
 	    pc += y;
 	    break;
 
@@ -504,6 +570,948 @@ EvalCode(Code code, double time)
 	}
 }
 
+/************************************************************************
+ * The stack code is also compiled into a tree: the jumps that the	*
+ * parser emits for the conditional and logical operators are turned	*
+ * back into the nodes they came from, constant subtrees are folded	*
+ * to a single value, and the tree is then either emitted again as	*
+ * stack code or evaluated over a whole array of times at once.  Code	*
+ * that does not follow the parser's patterns is left as it is.	*
+ ************************************************************************/
+
+# define IfElse	 JzOp		/* c ? a : b		       */
+# define OrElse	 JnzOp		/* a if a is true, otherwise b */
+# define AndThen CopyOp		/* a if a is false, otherwise b */
+
+typedef struct tree {
+    Opcode	 op;		/* operation (or one of the above) */
+    int		 nargs;		/* number of operands		   */
+    struct tree	*arg [3];	/* operands			   */
+    double	 value;		/* value of a push		   */
+    Code	 array;		/* points of a table or cycle	   */
+    int		 length;	/* number of values in array	   */
+    int		 hint;		/* point found by the last lookup  */
+} *Tree;
+
+typedef struct {
+    Tree	 pool;		/* at most one node per instruction */
+    unsigned	 used;
+    Tree	 stack [MaxStackDepth];
+    int		 sp;
+} Decoder;
+
+
+/************************************************************************
+ * Function:	Apply							*
+ *									*
+ * Description:	Applies an operator to one or two values, exactly as	*
+ *		EvalCode does.						*
+ ************************************************************************/
+
+static inline double
+Apply(Opcode op, double a, double b)
+{
+    int x;
+    int y;
+
+
+    switch (op) {
+    case TestOp:  return a != 0;
+    case NegOp:   return -a;
+    case NotOp:   return !a;
+    case InvOp:   x = a; return ~x;
+    case MulOp:   return a * b;
+    case DivOp:   return b ? a / b : 0;
+    case ModOp:   x = a; y = b; return y ? x % y : 0;
+    case AddOp:   return a + b;
+    case SubOp:   return a - b;
+    case LsftOp:  x = a; y = b; return x << y;
+    case RsftOp:  x = a; y = b; return x >> y;
+    case LtOp:    return a < b;
+    case GtOp:    return a > b;
+    case LteqOp:  return a <= b;
+    case GteqOp:  return a >= b;
+    case EqOp:    return a == b;
+    case NeqOp:   return a != b;
+    case AndOp:   x = a; y = b; return x & y;
+    case XorOp:   x = a; y = b; return x ^ y;
+    case OrOp:    x = a; y = b; return x | y;
+    case SinOp:   return sin (a);
+    case CosOp:   return cos (a);
+    case TanOp:   return tan (a);
+    case ExpOp:   return exp (a);
+    case LnOp:    return a > 0 ? log (a) : 0;
+    case LogOp:   return a > 0 ? log10 (a) : 0;
+    case PowOp:   return a >= 0 || b == (int) b ? pow (a, b) : 0;
+    case SqrtOp:  return a >= 0 ? sqrt (a) : 0;
+    case HypotOp: return hypot (a, b);
+    case FloorOp: return floor (a);
+    case CeilOp:  return ceil (a);
+    case FmodOp:  return b ? fmod (a, b) : 0;
+    case FabsOp:  return fabs (a);
+    default:	  return 0;
+    }
+}
+
+
+/************************************************************************
+ * Function:	Operands						*
+ *									*
+ * Description:	Returns the number of values an operator takes off the	*
+ *		stack, or -1 for the instructions that direct control.	*
+ ************************************************************************/
+
+static int
+Operands(Opcode op)
+{
+    switch (op) {
+    case PushOp:
+    case TimeOp:
+    case TableOp:
+    case CycleOp:
+	return 0;
+
+    case TestOp:
+    case NegOp:
+    case NotOp:
+    case InvOp:
+    case SinOp:
+    case CosOp:
+    case TanOp:
+    case ExpOp:
+    case LnOp:
+    case LogOp:
+    case SqrtOp:
+    case FloorOp:
+    case CeilOp:
+    case FabsOp:
+	return 1;
+
+    case MulOp:
+    case DivOp:
+    case ModOp:
+    case AddOp:
+    case SubOp:
+    case LsftOp:
+    case RsftOp:
+    case LtOp:
+    case GtOp:
+    case LteqOp:
+    case GteqOp:
+    case EqOp:
+    case NeqOp:
+    case AndOp:
+    case XorOp:
+    case OrOp:
+    case PowOp:
+    case HypotOp:
+    case FmodOp:
+	return 2;
+
+    default:
+	return -1;
+    }
+}
+
+static Tree
+NewTree(Decoder *d, Opcode op, int nargs)
+{
+    Tree t;
+    int  i;
+
+
+    t = &d -> pool [d -> used ++];
+    t -> op = op;
+    t -> nargs = nargs;
+    t -> value = 0;
+    t -> array = NULL;
+    t -> length = 0;
+    t -> hint = 0;
+
+    for (i = nargs - 1; i >= 0; i --)
+	t -> arg [i] = d -> stack [-- d -> sp];
+
+    return t;
+}
+
+
+/************************************************************************
+ * Function:	DecodeCode						*
+ *									*
+ * Description:	Decodes the instructions from pc up to end onto the	*
+ *		decoder's stack, returning nonzero if they are not	*
+ *		something the parser would have emitted.		*
+ ************************************************************************/
+
+static int
+DecodeCode(Decoder *d, Code pc, Code end)
+{
+    Opcode op;
+    Code   mid;
+    Code   stop;
+    Tree   t;
+    int    depth;
+    int    n;
+
+
+    while (pc < end) {
+	if (d -> sp >= MaxStackDepth - 1)
+	    return 1;
+
+	switch (op = pc ++ -> op) {
+	case JzOp:			/* c ? a : b */
+	    if (d -> sp < 1)
+		return 1;
+	    mid = pc + 1 + pc -> offset;
+	    pc ++;
+	    if (mid - 2 < pc || mid > end || mid [-2].op != JmpOp)
+		return 1;
+	    stop = mid + mid [-1].offset;
+	    if (stop < mid || stop > end)
+		return 1;
+
+	    depth = d -> sp;
+	    if (DecodeCode (d, pc, mid - 2) || d -> sp != depth + 1)
+		return 1;
+	    if (DecodeCode (d, mid, stop) || d -> sp != depth + 2)
+		return 1;
+
+	    t = NewTree (d, IfElse, 3);
+	    d -> stack [d -> sp ++] = t;
+	    pc = stop;
+	    break;
+
+	case CopyOp:			/* a || b and a && b */
+	    if (d -> sp < 1 || end - pc < 3 || pc [2].op != PopOp)
+		return 1;
+	    if (pc -> op != JzOp && pc -> op != JnzOp)
+		return 1;
+	    op = pc -> op == JnzOp ? OrElse : AndThen;
+	    stop = pc + 2 + pc [1].offset;
+	    pc += 3;
+	    if (stop < pc || stop > end)
+		return 1;
+
+	    depth = d -> sp;
+	    if (DecodeCode (d, pc, stop) || d -> sp != depth + 1)
+		return 1;
+
+	    t = NewTree (d, op, 2);
+	    d -> stack [d -> sp ++] = t;
+	    pc = stop;
+	    break;
+
+	case PushOp:
+	    t = NewTree (d, op, 0);
+	    t -> value = pc ++ -> arg;
+	    d -> stack [d -> sp ++] = t;
+	    break;
+
+	case TableOp:
+	case CycleOp:
+	    t = NewTree (d, op, 0);
+	    t -> length = pc ++ -> offset;
+	    t -> array = pc;
+	    pc += t -> length;
+	    d -> stack [d -> sp ++] = t;
+	    break;
+
+	default:
+	    if ((n = Operands (op)) < 0 || d -> sp < n)
+		return 1;
+	    t = NewTree (d, op, n);
+	    d -> stack [d -> sp ++] = t;
+	    break;
+	}
+    }
+
+    return 0;
+}
+
+/************************************************************************
+ * Function:	BuildTree						*
+ *									*
+ * Description:	Decodes a piece of code into a tree whose nodes come	*
+ *		from pool, which must have room for one node per	*
+ *		instruction.  Returns NULL if the code can't be decoded.*
+ ************************************************************************/
+
+static Tree
+BuildTree(Code code, Tree pool)
+{
+    Decoder *d;
+    Tree     root;
+
+
+    if (!(d = AllocNew (Decoder)))
+	return NULL;
+
+    d -> pool = pool;
+    d -> used = 0;
+    d -> sp = 0;
+
+    root = NULL;
+    if (!DecodeCode (d, code, code + CodeSize (code) - 1) && d -> sp == 1)
+	root = d -> stack [0];
+
+    Deallocate (d);
+    return root;
+}
+
+
+/************************************************************************
+ * Function:	FoldTree						*
+ *									*
+ * Description:	Replaces every subtree that does not depend on time by	*
+ *		its value.						*
+ ************************************************************************/
+
+static void
+FoldTree(Tree t)
+{
+    int i;
+    int x;
+
+
+    for (i = 0; i < t -> nargs; i ++)
+	FoldTree (t -> arg [i]);
+
+    switch (t -> op) {
+    case PushOp:
+    case TimeOp:
+    case TableOp:
+    case CycleOp:
+	return;
+
+    case IfElse:
+	if (t -> arg [0] -> op == PushOp) {
+	    x = t -> arg [0] -> value;
+	    *t = *t -> arg [x ? 1 : 2];
+	}
+	return;
+
+    case OrElse:
+    case AndThen:
+	if (t -> arg [0] -> op == PushOp) {
+	    x = t -> arg [0] -> value;
+	    *t = *t -> arg [(t -> op == OrElse) == !x ? 1 : 0];
+	}
+	return;
+
+    default:
+	for (i = 0; i < t -> nargs; i ++)
+	    if (t -> arg [i] -> op != PushOp)
+		return;
+
+	t -> value = Apply (t -> op, t -> arg [0] -> value,
+			    t -> nargs > 1 ? t -> arg [1] -> value : 0);
+	t -> op = PushOp;
+	t -> nargs = 0;
+	return;
+    }
+}
+
+
+/************************************************************************
+ * Function:	EmitTree						*
+ *									*
+ * Description:	Emits a tree as stack code in the form the parser uses,	*
+ *		returning the address after the last instruction.	*
+ ************************************************************************/
+
+static Code
+EmitTree(Tree t, Code pc)
+{
+    Code jump;
+    Code skip;
+    int  i;
+
+
+    switch (t -> op) {
+    case PushOp:
+	pc ++ -> op = PushOp;
+	pc ++ -> arg = t -> value;
+	break;
+
+    case TableOp:
+    case CycleOp:
+	pc ++ -> op = t -> op;
+	pc ++ -> offset = t -> length;
+	for (i = 0; i < t -> length; i ++)
+	    *pc ++ = t -> array [i];
+	break;
+
+    case IfElse:
+	pc = EmitTree (t -> arg [0], pc);
+	pc ++ -> op = JzOp;
+	jump = pc ++;
+	pc = EmitTree (t -> arg [1], pc);
+	pc ++ -> op = JmpOp;
+	skip = pc ++;
+	jump -> offset = pc - (jump + 1);
+	pc = EmitTree (t -> arg [2], pc);
+	skip -> offset = pc - (skip + 1);
+	break;
+
+    case OrElse:
+    case AndThen:
+	pc = EmitTree (t -> arg [0], pc);
+	pc ++ -> op = CopyOp;
+	pc ++ -> op = t -> op == OrElse ? JnzOp : JzOp;
+	jump = pc ++;
+	pc ++ -> op = PopOp;
+	pc = EmitTree (t -> arg [1], pc);
+	jump -> offset = pc - (jump + 1);
+	break;
+
+    default:
+	for (i = 0; i < t -> nargs; i ++)
+	    pc = EmitTree (t -> arg [i], pc);
+	pc ++ -> op = t -> op;
+	break;
+    }
+
+    return pc;
+}
+
+
+	/*
+	 * every level of a tree needs two blocks of scratch space for
+	 * the values of its operands
+	 */
+
+static unsigned
+TreeDepth(Tree t)
+{
+    unsigned depth;
+    unsigned d;
+    int      i;
+
+
+    depth = 0;
+    for (i = 0; i < t -> nargs; i ++)
+	if ((d = TreeDepth (t -> arg [i])) > depth)
+	    depth = d;
+
+    return depth + 1;
+}
+
+
+/************************************************************************
+ * Function:	EvalTree						*
+ *									*
+ * Description:	Evaluates a tree at n times (at most a block) at once.	*
+ *		Each node is applied to all of the values of its	*
+ *		operands in one loop.  Both branches of a conditional	*
+ *		are evaluated and the result selected afterwards, which	*
+ *		is safe since no operator has side effects.		*
+ ************************************************************************/
+
+static void
+EvalTree(Tree t, const double *time, double *result, unsigned n, double *scratch)
+{
+    double  *b;
+    double  *c;
+    unsigned i;
+    int      x;
+
+
+    b = scratch;
+    c = scratch + BlockSize;
+
+    if (t -> nargs > 0)
+	EvalTree (t -> arg [0], time, result, n, scratch + 2 * BlockSize);
+    if (t -> nargs > 1)
+	EvalTree (t -> arg [1], time, b, n, scratch + 2 * BlockSize);
+    if (t -> nargs > 2)
+	EvalTree (t -> arg [2], time, c, n, scratch + 2 * BlockSize);
+
+    switch (t -> op) {
+    case PushOp:
+	for (i = 0; i < n; i ++)
+	    result [i] = t -> value;
+	break;
+
+    case TimeOp:
+	for (i = 0; i < n; i ++)
+	    result [i] = time [i];
+	break;
+
+    case TableOp:
+    case CycleOp:
+	for (i = 0; i < n; i ++)
+	    result [i] = EvalTable (t -> array, t -> length, time [i],
+				    t -> op == CycleOp, &t -> hint, NULL);
+	break;
+
+    case IfElse:
+	for (i = 0; i < n; i ++) {
+	    x = result [i];
+	    result [i] = x ? b [i] : c [i];
+	}
+	break;
+
+    case OrElse:
+	for (i = 0; i < n; i ++) {
+	    x = result [i];
+	    result [i] = x ? result [i] : b [i];
+	}
+	break;
+
+    case AndThen:
+	for (i = 0; i < n; i ++) {
+	    x = result [i];
+	    result [i] = x ? b [i] : result [i];
+	}
+	break;
+
+    case AddOp:
+	for (i = 0; i < n; i ++)
+	    result [i] += b [i];
+	break;
+
+    case SubOp:
+	for (i = 0; i < n; i ++)
+	    result [i] -= b [i];
+	break;
+
+    case MulOp:
+	for (i = 0; i < n; i ++)
+	    result [i] *= b [i];
+	break;
+
+    case DivOp:
+	for (i = 0; i < n; i ++)
+	    result [i] = b [i] ? result [i] / b [i] : 0;
+	break;
+
+    case NegOp:
+	for (i = 0; i < n; i ++)
+	    result [i] = -result [i];
+	break;
+
+    default:
+	if (t -> nargs > 1)
+	    for (i = 0; i < n; i ++)
+		result [i] = Apply (t -> op, result [i], b [i]);
+	else
+	    for (i = 0; i < n; i ++)
+		result [i] = Apply (t -> op, result [i], 0);
+	break;
+    }
+}
+
+
+/************************************************************************
+ * Function:	SlopeTree						*
+ *									*
+ * Description:	Like EvalTree, but also carries the derivative with	*
+ *		respect to time through every node.  Operators that	*
+ *		are constant between jumps (comparisons, integer	*
+ *		operators, floor and ceil) have no slope, and neither	*
+ *		does a guarded function where its guard applies.  Each	*
+ *		level needs four blocks of scratch space.		*
+ ************************************************************************/
+
+static void
+SlopeTree(Tree t, const double *time, double *result, double *slope,
+	  unsigned n, double *scratch)
+{
+    double  *b;
+    double  *db;
+    double  *c;
+    double  *dc;
+    double   a;
+    double   v;
+    unsigned i;
+    int      x;
+
+
+    b  = scratch;
+    db = scratch + BlockSize;
+    c  = scratch + 2 * BlockSize;
+    dc = scratch + 3 * BlockSize;
+
+    if (t -> nargs > 0)
+	SlopeTree (t -> arg [0], time, result, slope, n, scratch + 4 * BlockSize);
+    if (t -> nargs > 1)
+	SlopeTree (t -> arg [1], time, b, db, n, scratch + 4 * BlockSize);
+    if (t -> nargs > 2)
+	SlopeTree (t -> arg [2], time, c, dc, n, scratch + 4 * BlockSize);
+
+    switch (t -> op) {
+    case PushOp:
+	for (i = 0; i < n; i ++) {
+	    result [i] = t -> value;
+	    slope [i] = 0;
+	}
+	break;
+
+    case TimeOp:
+	for (i = 0; i < n; i ++) {
+	    result [i] = time [i];
+	    slope [i] = 1;
+	}
+	break;
+
+    case TableOp:
+    case CycleOp:
+	for (i = 0; i < n; i ++)
+	    result [i] = EvalTable (t -> array, t -> length, time [i],
+				    t -> op == CycleOp, &t -> hint, &slope [i]);
+	break;
+
+    case IfElse:
+	for (i = 0; i < n; i ++) {
+	    x = result [i];
+	    result [i] = x ? b [i] : c [i];
+	    slope [i] = x ? db [i] : dc [i];
+	}
+	break;
+
+    case OrElse:
+    case AndThen:
+	for (i = 0; i < n; i ++) {
+	    x = result [i];
+	    if ((t -> op == OrElse) == !x) {
+		result [i] = b [i];
+		slope [i] = db [i];
+	    }
+	}
+	break;
+
+    case AddOp:
+	for (i = 0; i < n; i ++) {
+	    result [i] += b [i];
+	    slope [i] += db [i];
+	}
+	break;
+
+    case SubOp:
+	for (i = 0; i < n; i ++) {
+	    result [i] -= b [i];
+	    slope [i] -= db [i];
+	}
+	break;
+
+    case MulOp:
+	for (i = 0; i < n; i ++) {
+	    slope [i] = slope [i] * b [i] + result [i] * db [i];
+	    result [i] *= b [i];
+	}
+	break;
+
+    case DivOp:
+	for (i = 0; i < n; i ++) {
+	    slope [i] = b [i] ? (slope [i] * b [i] - result [i] * db [i]) / (b [i] * b [i]) : 0;
+	    result [i] = b [i] ? result [i] / b [i] : 0;
+	}
+	break;
+
+    case NegOp:
+	for (i = 0; i < n; i ++) {
+	    result [i] = -result [i];
+	    slope [i] = -slope [i];
+	}
+	break;
+
+    case SinOp:
+	for (i = 0; i < n; i ++) {
+	    slope [i] *= cos (result [i]);
+	    result [i] = sin (result [i]);
+	}
+	break;
+
+    case CosOp:
+	for (i = 0; i < n; i ++) {
+	    slope [i] *= -sin (result [i]);
+	    result [i] = cos (result [i]);
+	}
+	break;
+
+    case TanOp:
+	for (i = 0; i < n; i ++) {
+	    v = cos (result [i]);
+	    slope [i] /= v * v;
+	    result [i] = tan (result [i]);
+	}
+	break;
+
+    case ExpOp:
+	for (i = 0; i < n; i ++) {
+	    result [i] = exp (result [i]);
+	    slope [i] *= result [i];
+	}
+	break;
+
+    case LnOp:
+    case LogOp:
+	for (i = 0; i < n; i ++) {
+	    a = result [i];
+	    slope [i] = a > 0 ? slope [i] / (t -> op == LnOp ? a : a * M_LN10) : 0;
+	    result [i] = Apply (t -> op, a, 0);
+	}
+	break;
+
+    case SqrtOp:
+	for (i = 0; i < n; i ++) {
+	    result [i] = Apply (SqrtOp, result [i], 0);
+	    slope [i] = result [i] > 0 ? slope [i] / (2 * result [i]) : 0;
+	}
+	break;
+
+    case PowOp:
+	for (i = 0; i < n; i ++) {
+	    a = result [i];
+	    v = Apply (PowOp, a, b [i]);
+	    if (a >= 0 || b [i] == (int) b [i])
+		slope [i] = (a ? b [i] * v / a * slope [i] : 0) +
+			    (a > 0 ? v * log (a) * db [i] : 0);
+	    else
+		slope [i] = 0;
+	    result [i] = v;
+	}
+	break;
+
+    case HypotOp:
+	for (i = 0; i < n; i ++) {
+	    v = hypot (result [i], b [i]);
+	    slope [i] = v ? (result [i] * slope [i] + b [i] * db [i]) / v : 0;
+	    result [i] = v;
+	}
+	break;
+
+    case FmodOp:
+	for (i = 0; i < n; i ++) {
+	    a = result [i];
+	    slope [i] = b [i] ? slope [i] - trunc (a / b [i]) * db [i] : 0;
+	    result [i] = Apply (FmodOp, a, b [i]);
+	}
+	break;
+
+    case FabsOp:
+	for (i = 0; i < n; i ++) {
+	    slope [i] = result [i] < 0 ? -slope [i] : result [i] > 0 ? slope [i] : 0;
+	    result [i] = fabs (result [i]);
+	}
+	break;
+
+    default:
+	for (i = 0; i < n; i ++) {
+	    result [i] = Apply (t -> op, result [i], t -> nargs > 1 ? b [i] : 0);
+	    slope [i] = 0;
+	}
+	break;
+    }
+}
+
+
+/************************************************************************
+ * Function:	CopyCode						*
+ *									*
+ * Description:	Copies a piece of code, folding its constant parts.	*
+ ************************************************************************/
+
+Code
+CopyCode(Code code)
+{
+    Code     copy;
+    Code     end;
+    Tree     pool;
+    Tree     root;
+    unsigned size;
+    unsigned i;
+
+
+    if (!code)
+	return NULL;
+
+    size = CodeSize (code);
+    if (!(copy = Allocate (Instruction, size)))
+	return NULL;
+
+    pool = Allocate (struct tree, size);
+    if (pool && (root = BuildTree (code, pool))) {
+	FoldTree (root);
+	end = EmitTree (root, copy);
+	end -> op = HaltOp;
+    } else
+	for (i = 0; i < size; i ++)
+	    copy [i] = code [i];
+
+    Deallocate (pool);
+    return copy;
+}
+
+
+	/*
+	 * a compiled piece of code keeps its tree (with the points its
+	 * tables last found) and enough scratch space to evaluate it or
+	 * its slope; root is NULL if the code couldn't be compiled
+	 */
+
+struct compiled_code {
+    Code	 code;
+    Tree	 pool;
+    Tree	 root;
+    double	*scratch;
+};
+
+
+/************************************************************************
+ * Function:	CompileCodeTree						*
+ *									*
+ * Description:	Compiles a piece of code for EvalCodeTree.		*
+ ************************************************************************/
+
+CompiledCode
+CompileCodeTree(Code code)
+{
+    CompiledCode c;
+
+
+    if (!code || !(c = AllocNew (struct compiled_code)))
+	return NULL;
+
+    c -> code = code;
+    c -> scratch = NULL;
+    c -> pool = Allocate (struct tree, CodeSize (code));
+    c -> root = c -> pool ? BuildTree (code, c -> pool) : NULL;
+
+    if (c -> root) {
+	FoldTree (c -> root);
+	c -> scratch = Allocate (double, 4 * BlockSize * TreeDepth (c -> root));
+	if (!c -> scratch)
+	    c -> root = NULL;
+    }
+
+    return c;
+}
+
+
+/************************************************************************
+ * Function:	FreeCodeTree						*
+ *									*
+ * Description:	Deallocates a compiled piece of code.			*
+ ************************************************************************/
+
+void
+FreeCodeTree(CompiledCode c)
+{
+    if (!c)
+	return;
+
+    Deallocate (c -> scratch);
+    Deallocate (c -> pool);
+    Deallocate (c);
+}
+
+
+/************************************************************************
+ * Function:	EvalCodeTree						*
+ *									*
+ * Description:	Evaluates a compiled piece of code at each of n times,	*
+ *		a block at a time.  Falls back to EvalCode if the code	*
+ *		couldn't be compiled.					*
+ ************************************************************************/
+
+void
+EvalCodeTree(CompiledCode c, const double *time, double *result, unsigned n)
+{
+    unsigned i;
+    unsigned count;
+
+
+    if (!c)
+	for (i = 0; i < n; i ++)
+	    result [i] = 0;
+
+    else if (c -> root)
+	for (i = 0; i < n; i += count) {
+	    count = n - i < BlockSize ? n - i : BlockSize;
+	    EvalTree (c -> root, time + i, result + i, count, c -> scratch);
+	}
+
+    else
+	for (i = 0; i < n; i ++)
+	    result [i] = EvalCode (c -> code, time [i]);
+}
+
+
+/************************************************************************
+ * Function:	EvalCodeTreeSlope					*
+ *									*
+ * Description:	Evaluates a compiled piece of code and its derivative	*
+ *		with respect to time at each of n times.  Code that	*
+ *		couldn't be compiled is differentiated numerically.	*
+ ************************************************************************/
+
+void
+EvalCodeTreeSlope(CompiledCode c, const double *time, double *result,
+		  double *slope, unsigned n)
+{
+    double   h;
+    unsigned i;
+    unsigned count;
+
+
+    if (!c)
+	for (i = 0; i < n; i ++)
+	    result [i] = slope [i] = 0;
+
+    else if (c -> root)
+	for (i = 0; i < n; i += count) {
+	    count = n - i < BlockSize ? n - i : BlockSize;
+	    SlopeTree (c -> root, time + i, result + i, slope + i, count, c -> scratch);
+	}
+
+    else
+	for (i = 0; i < n; i ++) {
+	    h = 1e-6 * (1 + fabs (time [i]));
+	    result [i] = EvalCode (c -> code, time [i]);
+	    slope [i] = (EvalCode (c -> code, time [i] + h) -
+			 EvalCode (c -> code, time [i] - h)) / (2 * h);
+	}
+}
+
+
+/************************************************************************
+ * Function:	EvalCodeArray						*
+ *									*
+ * Description:	Evaluates a piece of code at each of n times, compiling	*
+ *		it just for this call.					*
+ ************************************************************************/
+
+void
+EvalCodeArray(Code code, const double *time, double *result, unsigned n)
+{
+    CompiledCode c;
+
+
+    c = CompileCodeTree (code);
+    EvalCodeTree (c, time, result, n);
+    FreeCodeTree (c);
+}
+
+/************************************************************************
+ * Function:	EvalCodeSlopeArray					*
+ *									*
+ * Description:	Evaluates a piece of code and its derivative at each of	*
+ *		n times, compiling it just for this call.		*
+ ************************************************************************/
+
+void
+EvalCodeSlopeArray(Code code, const double *time, double *result,
+		   double *slope, unsigned n)
+{
+    CompiledCode c;
+
+
+    c = CompileCodeTree (code);
+    EvalCodeTreeSlope (c, time, result, slope, n);
+    FreeCodeTree (c);
+}
+
 void
 DebugCode(Code code)
 {
@@ -32,17 +32,17 @@
 int
 AddDefinition(Definition definition)
 {
-    return !problem.definition_set.insert(definition).second;
+    return !default_context.instance.definition_set.insert(definition).second;
 }
 
 int 
 RemoveDefinition(Definition definition)
 {
-    return problem.definition_set.erase(definition) != 1;
+    return default_context.instance.definition_set.erase(definition) != 1;
 }
 
 Definition
 LookupDefinition(const char *name)
 {
-    return SetSearch(problem.definition_set, name);
+    return SetSearch(default_context.instance.definition_set, name);
 }
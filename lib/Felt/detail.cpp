@@ -28,7 +28,7 @@
 # include <stdarg.h>
 # include "problem.h"
 
-static FILE	*detail_fp = NULL;
+static thread_local FILE *detail_fp = NULL;
 
 void
 SetDetailStream(FILE *fp)
@@ -0,0 +1,594 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/************************************************************************
+ *
+ * File:	explicit.cpp
+ *
+ * Description:	contains code for an explicit central difference
+ *		integration of the hyperbolic DE with a lumped mass.
+ *		The internal forces are formed element by element, so
+ *		there is no global stiffness matrix to assemble or
+ *		factor.
+ *
+ ************************************************************************/
+
+# include <stdio.h>
+# include <math.h>
+# include <boost/bind/bind.hpp>
+# include <boost/thread/barrier.hpp>
+# include <boost/thread/thread.hpp>
+# include "cvector1.hpp"
+# include "fe.h"
+# include "error.h"
+# include "problem.h"
+# include "profile.h"
+# include "transient.hpp"
+
+# define StepSafety		0.9	/* fraction of the critical step */
+
+	/*
+	 * the local forces of element i are force [first [i]] through
+	 * force [first [i+1]-1] and eqn [] gives the equation that each
+	 * one goes to (0 for none).  Equation k gathers the forces
+	 * rentry [rfirst [k]] through rentry [rfirst [k+1]-1], so no
+	 * two threads ever add into the same place.  Thread t steps
+	 * elements efirst [t] through efirst [t+1]-1 and equations
+	 * qfirst [t] through qfirst [t+1]-1.
+	 */
+
+struct ExplicitPass {
+   const Element	*element;
+   cvector1u		first;
+   cvector1u		eqn;
+   cvector1u		rfirst;
+   cvector1u		rentry;
+   cvector1d		force;
+   cvector1d		rk;
+   cvector1d		rm;
+   cvector1d		dt;
+   cvector1u		efirst;
+   cvector1u		qfirst;
+   cvector1u		column;
+   cvector1i		mask;
+   double		*d;
+   double		*vh;
+   double		*F;
+   const double		*m;
+   double		Rm;
+   double		step;
+   unsigned		substeps;
+   unsigned		nsteps;
+   Vector		dv;
+   Vector		Fv;
+   Matrix		dtable;
+   const TransientBC	*bc;
+   boost::barrier	*sync;
+   ProblemContext	*context;
+};
+
+int
+ConstructLumpedMass(Vector *Mr)
+{
+   unsigned	active;
+   unsigned	*dofs;
+   Vector	M;
+   unsigned	i, j, l, r;
+   unsigned	n;
+   unsigned	ndofs, nodes;
+   unsigned	base_row;
+   unsigned	row;
+   int		err_count;
+
+   active = problem.num_dofs;
+   dofs   = problem.dofs_pos;
+   const Node *node = problem.nodes.c_ptr1();
+   const Element *element = problem.elements.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   const unsigned numnodes = problem.nodes.size();
+   const unsigned numelts = problem.elements.size();
+
+   err_count = SetupElements (analysis.mass_mode, 1);
+   if (err_count)
+      return err_count;
+
+   PhaseTimer timer (AssemblyPhase);
+
+   M = CreateVector (problem.num_equations);
+   ZeroMatrix (M);
+
+   for (i = 1 ; i <= numelts ; i++) {
+      ndofs = element [i] -> definition -> numdofs;
+      nodes = element [i] -> definition -> numnodes;
+      n = ndofs*nodes;
+
+      for (j = 1 ; j <= nodes ; j++) {
+         if (element [i] -> node [j] == NULL) continue;
+         base_row = (element [i] -> node [j] -> number - 1)*active;
+
+         for (l = 1 ; l <= ndofs ; l++) {
+            row = eqn [base_row + dofs [element [i] -> definition -> dofs [l]]];
+            r = (j - 1)*ndofs + l;
+            if (row)
+               VectorData (M) [row] += MatrixData (element [i] -> M) [1][(r - 1)*n + r];
+         }
+      }
+   }
+
+   for (i = 1 ; i <= numnodes ; i++) {
+      base_row = active*(node [i] -> number - 1);
+
+      for (j = 1 ; j <= 3 ; j++) {
+         if (dofs [j] && (row = eqn [base_row + dofs [j]]))
+            VectorData (M) [row] += node [i] -> m;
+      }
+   }
+
+   *Mr = M;
+   return 0;
+}
+
+	/*
+	 * the critical step of an element is 2/omega, where omega is the
+	 * larger of the frequency of a bar wave crossing the shortest
+	 * distance between two of its nodes and the Gershgorin bound on
+	 * its highest frequency (the largest row sum of |K| over the
+	 * lumped mass of the row), which catches bending.  Stiffness
+	 * proportional damping shortens it.  Zero means no limit.
+	 */
+
+static void
+StableStepTask(Element element, unsigned i, void *arg)
+{
+   ExplicitPass	*pass = (ExplicitPass *) arg;
+   unsigned	j, k, r, c;
+   unsigned	n;
+   double	dx, dy, dz;
+   double	h, L;
+   double	sum;
+   double	omega;
+   double	xi;
+
+   const Material &material = element -> material;
+   const unsigned nodes = element -> definition -> numnodes;
+   const double *ke = MatrixData (element -> K) [1];
+   const double *me = MatrixData (element -> M) [1];
+
+   n = nodes*element -> definition -> numdofs;
+
+   L = 0.0;
+   for (j = 1 ; j <= nodes ; j++) {
+      if (element -> node [j] == NULL) continue;
+      for (k = j + 1 ; k <= nodes ; k++) {
+         if (element -> node [k] == NULL) continue;
+         dx = element -> node [k] -> x - element -> node [j] -> x;
+         dy = element -> node [k] -> y - element -> node [j] -> y;
+         dz = element -> node [k] -> z - element -> node [j] -> z;
+         h = sqrt (dx*dx + dy*dy + dz*dz);
+         if (h > 0.0 && (L == 0.0 || h < L))
+            L = h;
+      }
+   }
+
+   omega = 0.0;
+   if (L > 0.0 && material -> E > 0.0 && material -> rho > 0.0)
+      omega = 2.0*sqrt (material -> E/material -> rho)/L;
+
+   for (r = 1 ; r <= n ; r++) {
+      if (me [(r - 1)*n + r] <= 0.0)
+         continue;
+
+      sum = 0.0;
+      for (c = 1 ; c <= n ; c++)
+         sum += fabs (ke [(r - 1)*n + c]);
+
+      if (sum > omega*omega*me [(r - 1)*n + r])
+         omega = sqrt (sum/me [(r - 1)*n + r]);
+   }
+
+   if (omega > 0.0) {
+      xi = pass -> rk [i]*omega/2.0;
+      pass -> dt [i] = 2.0/omega*(sqrt (1.0 + xi*xi) - xi);
+   }
+   else
+      pass -> dt [i] = 0.0;
+}
+
+	/*
+	 * the local internal (and damping) force of elements lo through
+	 * hi, K(d + Rk vh) + Rm M vh, with vh the velocity half a step
+	 * back
+	 */
+
+static void
+ElementForces(ExplicitPass *pass, unsigned lo, unsigned hi)
+{
+   unsigned	i, r, c;
+   unsigned	n, p, k;
+   double	sum;
+   double	rk, rm;
+
+   const double *d = pass -> d;
+   const double *vh = pass -> vh;
+   double *force = pass -> force.c_ptr1();
+
+   for (i = lo ; i <= hi ; i++) {
+      const double *ke = MatrixData (pass -> element [i] -> K) [1];
+      const double *me = MatrixData (pass -> element [i] -> M) [1];
+      const unsigned *eq = &pass -> eqn [pass -> first [i]];
+
+      p = pass -> first [i];
+      n = pass -> first [i + 1] - p;
+      rk = pass -> rk [i];
+      rm = pass -> rm [i];
+
+      for (r = 0 ; r < n ; r++) {
+         sum = 0.0;
+         for (c = 0 ; c < n ; c++) {
+            if ((k = eq [c])) {
+               sum += ke [r*n + c + 1]*(d [k] + rk*vh [k]);
+               if (rm)
+                  sum += rm*me [r*n + c + 1]*vh [k];
+            }
+         }
+         force [p + r] = sum;
+      }
+   }
+}
+
+	/*
+	 * gathers the internal forces of equations lo through hi and
+	 * moves the free ones on by h times their acceleration
+	 */
+
+static void
+Accelerate(ExplicitPass *pass, unsigned lo, unsigned hi, double h)
+{
+   unsigned	i, k;
+   double	f;
+
+   const double *force = pass -> force.c_ptr1();
+   const unsigned *rentry = pass -> rentry.c_ptr1();
+
+   for (i = lo ; i <= hi ; i++) {
+      if (pass -> mask [i])
+         continue;
+
+      f = pass -> Rm*pass -> m [i]*pass -> vh [i];
+      for (k = pass -> rfirst [i] ; k < pass -> rfirst [i + 1] ; k++)
+         f += force [rentry [k]];
+
+      pass -> vh [i] += h*(pass -> F [i] - f)/pass -> m [i];
+   }
+}
+
+	/*
+	 * the part of step n that only one thread does: the constrained
+	 * DOF take their prescribed displacements (and the velocity that
+	 * got them there), F is formed and every substeps steps the
+	 * displacements go into the table
+	 */
+
+static void
+Boundary(ExplicitPass *pass, unsigned n)
+{
+   unsigned	i, k;
+   double	t;
+
+   const TransientDOFs &prescribed = pass -> bc -> prescribed;
+
+   t = n*pass -> step;
+
+   for (i = 1 ; i <= prescribed.dofs.size() ; i++) {
+      k = prescribed.dofs [i];
+      pass -> vh [k] = pass -> d [k];
+   }
+
+   AssignPrescribedDisplacement (t, *pass -> bc, pass -> dv);
+
+   for (i = 1 ; i <= prescribed.dofs.size() ; i++) {
+      k = prescribed.dofs [i];
+      pass -> vh [k] = (pass -> d [k] - pass -> vh [k])/pass -> step;
+   }
+
+   AssembleTransientForce (t, *pass -> bc, pass -> Fv);
+
+   if (n % pass -> substeps == 0)
+      for (i = 1 ; i <= pass -> column.size() ; i++)
+         MatrixData (pass -> dtable) [n/pass -> substeps + 1][i] =
+            (pass -> column [i] ? pass -> d [pass -> column [i]] : 0.0);
+}
+
+static void
+ExplicitWorker(ExplicitPass *pass, unsigned t)
+{
+   unsigned	n;
+   unsigned	i;
+
+   const unsigned total = (pass -> nsteps - 1)*pass -> substeps;
+   const unsigned lo = pass -> qfirst [t];
+   const unsigned hi = pass -> qfirst [t + 1] - 1;
+
+   SetProblemContext (pass -> context);
+
+   for (n = 1 ; n <= total ; n++) {
+      for (i = lo ; i <= hi ; i++)
+         if (!pass -> mask [i])
+            pass -> d [i] += pass -> step*pass -> vh [i];
+
+      pass -> sync -> wait ( );
+      if (t == 1)
+         Boundary (pass, n);
+      pass -> sync -> wait ( );
+
+      ElementForces (pass, pass -> efirst [t], pass -> efirst [t + 1] - 1);
+      pass -> sync -> wait ( );
+
+      Accelerate (pass, lo, hi, pass -> step);
+   }
+}
+
+Matrix
+IntegrateExplicitDE(const Vector &M)
+{
+   unsigned	i, j, k, r;
+   unsigned	n, t;
+   unsigned	ndofs, nodes;
+   unsigned	base_row;
+   unsigned	size;
+   unsigned	numelts;
+   unsigned	nthreads;
+   unsigned	total;
+   unsigned	node, dof;
+   double	critical;
+   double	work, share;
+   Vector	d, v, a;
+   TransientBC	bc;
+   ExplicitPass	pass;
+   int		build_a0;
+
+   const unsigned active = problem.num_dofs;
+   const unsigned *dofs = problem.dofs_pos;
+   const unsigned *eqn = problem.equations.c_ptr1();
+
+   size = problem.num_equations;
+   numelts = problem.elements.size();
+   pass.element = problem.elements.c_ptr1();
+
+	/*
+	 * where each element's forces go and, turned around, where
+	 * each equation's forces come from
+	 */
+
+   pass.first.resize (numelts + 1);
+   pass.first [1] = 1;
+   for (i = 1 ; i <= numelts ; i++) {
+      ndofs = pass.element [i] -> definition -> numdofs;
+      nodes = pass.element [i] -> definition -> numnodes;
+
+      for (j = 1 ; j <= nodes ; j++)
+         for (k = 1 ; k <= ndofs ; k++) {
+            if (pass.element [i] -> node [j] == NULL)
+               pass.eqn.push_back (0);
+            else {
+               base_row = (pass.element [i] -> node [j] -> number - 1)*active;
+               pass.eqn.push_back (eqn [base_row + dofs [pass.element [i] -> definition -> dofs [k]]]);
+            }
+         }
+
+      pass.first [i + 1] = pass.eqn.size() + 1;
+   }
+
+   pass.rfirst.resize (size + 1, 0);
+   for (i = 1 ; i <= pass.eqn.size() ; i++)
+      if (pass.eqn [i])
+         pass.rfirst [pass.eqn [i]] ++;
+
+   k = 1;
+   for (i = 1 ; i <= size + 1 ; i++) {
+      n = pass.rfirst [i];
+      pass.rfirst [i] = k;
+      k += n;
+   }
+
+   pass.rentry.resize (k > 1 ? k - 1 : 1);
+   cvector1u fill(size + 1);
+   for (i = 1 ; i <= size + 1 ; i++)
+      fill [i] = pass.rfirst [i];
+
+   for (i = 1 ; i <= pass.eqn.size() ; i++)
+      if (pass.eqn [i])
+         pass.rentry [fill [pass.eqn [i]] ++] = i;
+
+   pass.force.resize (pass.eqn.size() > 0 ? pass.eqn.size() : 1, 0.0);
+
+	/*
+	 * global Rayleigh damping replaces the elemental damping, as
+	 * it does in ConstructDynamic; its mass part uses the whole
+	 * lumped mass
+	 */
+
+   pass.rk.resize (numelts);
+   pass.rm.resize (numelts);
+   for (i = 1 ; i <= numelts ; i++) {
+      if (analysis.Rk || analysis.Rm) {
+         pass.rk [i] = analysis.Rk;
+         pass.rm [i] = 0.0;
+      }
+      else {
+         pass.rk [i] = pass.element [i] -> material -> Rk;
+         pass.rm [i] = pass.element [i] -> material -> Rm;
+      }
+   }
+   pass.Rm = analysis.Rk || analysis.Rm ? analysis.Rm : 0.0;
+
+	/*
+	 * every free DOF needs a mass to be accelerated
+	 */
+
+   pass.mask = BuildConstraintMask ( );
+   pass.m = VectorData (M);
+
+   for (i = 1 ; i <= size ; i++)
+      if (!pass.mask [i] && pass.m [i] <= 0.0) {
+         LocalDOF (i, &node, &dof);
+         error ("node %u has no mass in DOF %u - cannot integrate explicitly", node, dof);
+         return Matrix();
+      }
+
+	/*
+	 * the step is a fraction of the smallest critical step of any
+	 * element, shortened so that a whole number of steps fit in
+	 * each output interval
+	 */
+
+   pass.dt.resize (numelts);
+   ForEachElement (StableStepTask, &pass, 0);
+
+   critical = 0.0;
+   for (i = 1 ; i <= numelts ; i++)
+      if (pass.dt [i] > 0.0 && (critical == 0.0 || pass.dt [i] < critical))
+         critical = pass.dt [i];
+
+   if (critical == 0.0 && analysis.step <= 0.0) {
+      error ("unable to estimate a stable time step for explicit integration");
+      return Matrix();
+   }
+
+   if (analysis.step <= 0.0) {
+      pass.step = StepSafety*critical;
+      pass.substeps = 1;
+      analysis.step = pass.step;
+   }
+   else if (critical == 0.0 || analysis.step <= StepSafety*critical) {
+      pass.step = analysis.step;
+      pass.substeps = 1;
+   }
+   else {
+      pass.substeps = ceil (analysis.step/(StepSafety*critical));
+      pass.step = analysis.step/pass.substeps;
+   }
+
+   detail ("explicit integration: critical time step %g, time step %g, %u per output step",
+           critical, pass.step, pass.substeps);
+
+	/*
+	 * the table of nodal time displacements, and the equation of
+	 * each of its columns
+	 */
+
+   pass.nsteps = (analysis.stop + analysis.step/2.0) / analysis.step + 1.0;
+   pass.dtable = CreateMatrix (pass.nsteps, analysis.nodes.size()*analysis.numdofs);
+   total = (pass.nsteps - 1)*pass.substeps;
+
+   pass.column.resize (analysis.nodes.size()*analysis.numdofs);
+   for (i = 1 ; i <= analysis.nodes.size() ; i++)
+      for (j = 1 ; j <= analysis.numdofs ; j++)
+         pass.column [(i-1)*analysis.numdofs + j] =
+            GlobalDOF (analysis.nodes [i] -> number, analysis.dofs [j]);
+
+	/*
+	 * the initial conditions, with the velocity then taken half a
+	 * step forward: vh = v(0) + dt/2 a(0), where Ma(0) = F(0) -
+	 * Kd(0) - Cv(0) unless a(0) was given
+	 */
+
+   d = CreateVector (size);
+   v = CreateVector (size);
+   a = CreateVector (size);
+   pass.dv = d;
+   pass.Fv = CreateVector (size);
+   pass.d = VectorData (d);
+   pass.vh = VectorData (v);
+   pass.F = VectorData (pass.Fv);
+   pass.bc = &bc;
+
+   build_a0 = BuildHyperbolicIC (d, v, a);
+   BuildTransientBC (bc);
+
+   if (analysis.tabulate) {
+      TabulateTransientDOFs (bc.forced, 0.0, pass.step, total + 1, 0);
+      TabulateTransientDOFs (bc.prescribed, 0.0, pass.step, total + 1, 0);
+   }
+
+   AssembleTransientForce (0.0, bc, pass.Fv);
+
+   if (build_a0) {
+      ElementForces (&pass, 1, numelts);
+      Accelerate (&pass, 1, size, pass.step/2.0);
+   }
+   else
+      for (i = 1 ; i <= size ; i++)
+         if (!pass.mask [i])
+            pass.vh [i] += pass.step/2.0*VectorData (a) [i];
+
+   for (i = 1 ; i <= pass.column.size() ; i++)
+      MatrixData (pass.dtable) [1][i] =
+         (pass.column [i] ? pass.d [pass.column [i]] : 0.0);
+
+	/*
+	 * each thread takes a run of elements with about the same
+	 * amount of work (n^2 for an n DOF element) and a run of
+	 * equations
+	 */
+
+   nthreads = AssemblyThreads ( );
+   if (nthreads < 1 || numelts < MinParallelElements)
+      nthreads = 1;
+   if (nthreads > size)
+      nthreads = size > 0 ? size : 1;
+
+   work = 0.0;
+   for (i = 1 ; i <= numelts ; i++) {
+      n = pass.first [i + 1] - pass.first [i];
+      work += (double) n*n;
+   }
+
+   pass.efirst.resize (nthreads + 1);
+   pass.qfirst.resize (nthreads + 1);
+   pass.efirst [1] = pass.qfirst [1] = 1;
+
+   share = 0.0;
+   t = 1;
+   for (i = 1 ; i <= numelts && t < nthreads ; i++) {
+      n = pass.first [i + 1] - pass.first [i];
+      share += (double) n*n;
+      if (share >= work*t/nthreads)
+         pass.efirst [++ t] = i + 1;
+   }
+   while (t < nthreads)
+      pass.efirst [++ t] = numelts + 1;
+   pass.efirst [nthreads + 1] = numelts + 1;
+
+   for (r = 2 ; r <= nthreads + 1 ; r++)
+      pass.qfirst [r] = (unsigned long) size*(r - 1)/nthreads + 1;
+
+   boost::barrier sync (nthreads);
+   pass.sync = &sync;
+   pass.context = current_context;
+
+   boost::thread_group pool;
+   for (t = 2 ; t <= nthreads ; t++)
+      pool.create_thread (boost::bind (ExplicitWorker, &pass, t));
+
+   ExplicitWorker (&pass, 1);
+   pool.join_all ( );
+
+   return pass.dtable;
+}
@@ -33,11 +33,19 @@
 
 # include <stdio.h>
 # include <math.h>
+# include <algorithm>
+# include <vector>
+# include <boost/atomic.hpp>
+# include <boost/bind/bind.hpp>
+# include <boost/scoped_array.hpp>
+# include <boost/thread/barrier.hpp>
+# include <boost/thread/thread.hpp>
 # include "cvector1.hpp"
 # include "problem.h"
 # include "fe.h"
 # include "fe.hpp"
 # include "error.h"
+# include "profile.h"
 # include "transient.hpp"
 
 extern "C" Matrix ZeroRowCol(Matrix K, unsigned int dof);
@@ -55,6 +63,8 @@ FindDOFS(void)
    const unsigned ne = problem.elements.size();
    const Element *e = problem.elements.c_ptr1();
 
+   PhaseTimer timer (FindDOFPhase);
+
    for (i = 1 ; i <= 6 ; i++) {
       flag[i] = 0;
       problem.dofs_pos[i] = 0;
@@ -84,105 +94,181 @@ FindDOFS(void)
 
    problem.num_dofs = count;
 
+   NumberEquations ( );
+
+   ProfileSet (NodesCounter, problem.nodes.size());
+   ProfileSet (ElementsCounter, ne);
+   ProfileSet (EquationsCounter, problem.num_equations);
+
    return count;
 }
-      
-Matrix
-ConstructStiffness(int *status)
+
+int
+NumberEquations(void)
 {
+   unsigned	i, j, l;
    unsigned	active;
-   unsigned	*dofs;
-   unsigned	row,
-		col,
-		i,
-		j,
-		l,
-		k,
-		m;
-   unsigned	size,
-		ndofs,
-		nodes;
-   unsigned	base_row,
-		base_col,
-		affected_row_dof,
-		affected_col_dof;
-   unsigned	address;
-   double	value;
-   Vector 	K;
-   int	 	err,
-		err_count;
+   unsigned	slot;
+   unsigned	count;
 
-   const Element *element = problem.elements.c_ptr1();
-   const unsigned numelts = problem.elements.size();
    const unsigned numnodes = problem.nodes.size();
+   const unsigned ne = problem.elements.size();
+   const Element *e = problem.elements.c_ptr1();
    active = problem.num_dofs;
-   dofs = problem.dofs_pos;
 
-   err_count = 0;
-
-	/*	
-	 * first we make a pass over the elements to see how all the 
-	 * stiffnesses fit together so we can set up our compact column
-	 * storage sceme.  Inefficient as hell I concede.
+	/*
+	 * a node DOF only becomes an equation if some element attached
+	 * to the node actually uses it; everything else (the rotations
+	 * of a truss node in a frame problem, for instance) is dead and
+	 * never reaches the matrices or the vectors
 	 */
 
-   size = numnodes*active;
+   problem.equations.clear ( );
+   problem.equations.resize (numnodes*active, 0);
 
-   cvector1u ht(size, 0);
-   cvector1u dg(size, 0);
+   for (i = 1 ; i <= ne ; i++) {
+      for (j = 1 ; j <= e[i] -> definition -> numnodes ; j++) {
+         if (e[i] -> node[j] == NULL) continue;
+         slot = (e[i] -> node[j] -> number - 1)*active;
 
-   for (i = 1 ; i <= numelts ; i++) {
-      err = ElementSetup (element [i], 0);
-      if (err) {
-         err_count += err;
-         continue;
-      } 
-         
-      ndofs = element[i] -> definition -> numdofs;
-      nodes = element[i] -> definition -> numnodes;
+         for (l = 1 ; l <= e[i] -> definition -> numdofs ; l++)
+            if (problem.dofs_pos [e[i] -> definition -> dofs[l]])
+               problem.equations [slot + problem.dofs_pos [e[i] -> definition -> dofs[l]]] = 1;
+      }
+   }
 
-      if (!element[i] -> K || !IsSquare(element[i] -> K) || 
-          Mrows(element[i] -> K) > ndofs*nodes) {
+	/*
+	 * number them in node order so the profile of the stiffness
+	 * matrix still follows the node numbering (and the renumbering)
+	 */
 
-         error ("%s element %d has an invalid stiffness matrix",
-                element[i] -> definition -> name.c_str(), element[i] -> number);
+   problem.eq_slots.clear ( );
 
-         err_count ++;
-         continue;
+   count = 0;
+   for (slot = 1 ; slot <= numnodes*active ; slot++) {
+      if (problem.equations [slot]) {
+         problem.equations [slot] = ++count;
+         problem.eq_slots.push_back (slot);
       }
+   }
 
-      for (j = 1 ; j <= nodes ; j++) {
-         if (element [i] -> node[j] == NULL) continue;
-         base_row = (element[i] -> node[j] -> number - 1)*active + 1;
+   problem.num_equations = count;
 
-         for (k = 1 ; k <= nodes ; k++) {
-            if (element [i] -> node[k] == NULL) continue;
-            base_col = (element[i] -> node[k] -> number - 1)*active + 1;
+   return count;
+}
+      
+	/*
+	 * the profile and assembly passes over the elements scatter into
+	 * the columns of the element's nodes, so they run one color at a
+	 * time and no two threads ever touch the same column.  Assembly
+	 * itself just follows the scatter map.
+	 */
 
-            for (l = 1 ; l <= ndofs ; l++) {
-               affected_row_dof = dofs[element[i] -> definition -> dofs[l]];
-               row = base_row + affected_row_dof - 1;
+struct AssemblyPass {
+   unsigned		*ht;
+   Matrix		K;
+   SparseMatrix		Ks;
+   const ScatterMap	*map;
+};
 
-               for (m = 1 ; m <= ndofs ; m++) {
-                  affected_col_dof = dofs[element[i] -> definition -> dofs[m]];
-                  col = base_col + affected_col_dof - 1;
-                  value =  MatrixData (element[i] -> K) [(j-1)*ndofs + l]
-                                                        [(k-1)*ndofs + m]; 
-                  if (value != 0.0 && row <= col) { 
-                     if (col-(row-1) > ht [col])
-                        ht [col] = col - (row - 1);
-                  }
+static void
+ProfileTask(Element element, unsigned, void *arg)
+{
+   AssemblyPass	*pass = (AssemblyPass *) arg;
+   unsigned	*ht = pass -> ht;
+   unsigned	j, k, l, m;
+   unsigned	row, col;
+   unsigned	ndofs,
+		nodes;
+   unsigned	base_row,
+		base_col,
+		affected_row_dof,
+		affected_col_dof;
+   double	value;
+
+   const unsigned active = problem.num_dofs;
+   const unsigned *dofs = problem.dofs_pos;
+   const unsigned *eqn = problem.equations.c_ptr1();
+
+   ndofs = element -> definition -> numdofs;
+   nodes = element -> definition -> numnodes;
+
+   for (j = 1 ; j <= nodes ; j++) {
+      if (element -> node[j] == NULL) continue;
+      base_row = (element -> node[j] -> number - 1)*active;
+
+      for (k = 1 ; k <= nodes ; k++) {
+         if (element -> node[k] == NULL) continue;
+         base_col = (element -> node[k] -> number - 1)*active;
+
+         for (l = 1 ; l <= ndofs ; l++) {
+            affected_row_dof = dofs[element -> definition -> dofs[l]];
+            row = eqn [base_row + affected_row_dof];
+
+            for (m = 1 ; m <= ndofs ; m++) {
+               affected_col_dof = dofs[element -> definition -> dofs[m]];
+               col = eqn [base_col + affected_col_dof];
+               value =  MatrixData (element -> K) [(j-1)*ndofs + l]
+                                                  [(k-1)*ndofs + m]; 
+               if (value != 0.0 && row <= col) { 
+                  if (col-(row-1) > ht [col])
+                     ht [col] = col - (row - 1);
                }
             }
          }
       }
-   } /* end first loop over elements */
+   }
+}
+
+static void
+CompactAssemblyTask(Element element, unsigned i, void *arg)
+{
+   AssemblyPass	*pass = (AssemblyPass *) arg;
+   unsigned	n;
+
+   const ScatterMap &map = *pass -> map;
+   const double *ke = MatrixData (element -> K) [1];
+   double *k = CompactData (pass -> K);
+
+   for (n = map.first [i] ; n < map.first [i + 1] ; n++)
+      k [map.address [n]] += ke [map.entry [n]];
+
+   if (!element -> definition -> retainK)
+       element -> K.reset();
+}
+
+Matrix
+ConstructStiffness(int *status)
+{
+   unsigned	neqs;
+   unsigned	i;
+   unsigned	size;
+   AssemblyPass	pass;
+   Vector 	K;
+   int	 	err_count;
 
+   neqs = problem.num_equations;
+
+	/*
+	 * set up every element first, then make a pass over the elements
+	 * to see how all the stiffnesses fit together so we can set up
+	 * our compact column storage sceme.
+	 */
+
+   err_count = SetupElements (0, 0);
    if (err_count) {
       *status = err_count;
       return Matrix();
    }
 
+   PhaseTimer timer (AssemblyPhase);
+
+   cvector1u ht(neqs, 0);
+   cvector1u dg(neqs, 0);
+
+   pass.ht = ht.c_ptr1();
+   ForEachElement (ProfileTask, &pass, 1);
+
 	/*
 	 * setup the diagonal address array and figure out how big
 	 * we need to make the compact column vector
@@ -193,7 +279,7 @@ ConstructStiffness(int *status)
    if (ht [1] == 0)
       ht [1] = 1;
 
-   for (i = 2 ; i <= numnodes*active ; i++) {
+   for (i = 2 ; i <= neqs ; i++) {
       if (ht[i] == 0)
          ht[i] = 1;
 
@@ -201,61 +287,176 @@ ConstructStiffness(int *status)
       dg [i] = ht [i] + dg [i-1];
    }
 
-   K = CreateCompactMatrix (numnodes*active, numnodes*active, size, &dg);
+   K = CreateCompactMatrix (neqs, neqs, size, &dg);
 
    detail ("stiffness matrix size is %d", size);
+   ProfileSet (ProfileSizeCounter, size);
 
    ZeroMatrix (K);
 
 	/*
-	 * now we make just about the identical passes over the elements,
+	 * now we make just about the identical pass over the elements,
 	 * the result of this pass however will be that we actually
 	 * start sticking stuff into the vector which is the compact
 	 * column representation of the global stiffness matrix
 	 */
    
+   pass.K = K;
+   pass.map = &CompactScatterMap (K);
+   ForEachElement (CompactAssemblyTask, &pass, 1);
+
+	/*
+	 * set some things up for the return
+	 */
+
+   *status = 0;
+
+   return K;
+}
+
+SparseMatrix
+ConstructSparsePattern(void)
+{
+   unsigned	active;
+   unsigned	i, j, k, n;
+   unsigned	p, q;
+   unsigned	size;
+   unsigned	nodes;
+   unsigned	a, b;
+   unsigned	row, col;
+
+   const Element *element = problem.elements.c_ptr1();
+   const unsigned numelts = problem.elements.size();
+   const unsigned numnodes = problem.nodes.size();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   active = problem.num_dofs;
+
+	/*
+	 * the symbolic structure comes from the element connectivity
+	 * alone: each node gets the list of lower numbered nodes that
+	 * share an element with it
+	 */
+
+   cvector1< cvector1u > adj(numnodes);
+
+	/*
+	 * every equation gets its diagonal, even one whose node is in no
+	 * element, so that a constraint always has somewhere to put its one
+	 */
+
+   for (n = 1 ; n <= numnodes ; n++)
+      adj [n].push_back (n);
+
    for (i = 1 ; i <= numelts ; i++) {
-      ndofs = element[i] -> definition -> numdofs;
       nodes = element[i] -> definition -> numnodes;
-      
+
       for (j = 1 ; j <= nodes ; j++) {
          if (element [i] -> node[j] == NULL) continue;
-         base_row = (element[i] -> node[j] -> number - 1)*active + 1;
+         b = element[i] -> node[j] -> number;
 
          for (k = 1 ; k <= nodes ; k++) {
             if (element [i] -> node[k] == NULL) continue;
-            base_col = (element[i] -> node[k] -> number - 1)*active + 1;
+            a = element[i] -> node[k] -> number;
+            if (a <= b)
+               adj [b].push_back (a);
+         }
+      }
+   }
 
-            for (l = 1 ; l <= ndofs ; l++) {
-               affected_row_dof = dofs[element[i] -> definition -> dofs[l]];
-               row = base_row + affected_row_dof - 1;
+   for (n = 1 ; n <= numnodes ; n++) {
+      std::sort (adj [n].c_ptr(), adj [n].c_ptr() + adj [n].size());
+      adj [n].resize (std::unique (adj [n].c_ptr(), adj [n].c_ptr() + 
+                                   adj [n].size()) - adj [n].c_ptr());
+   }
 
-               for (m = 1 ; m <= ndofs ; m++) {
-                  affected_col_dof = dofs[element[i] -> definition -> dofs[m]];
-                  col = base_col + affected_col_dof - 1;
-                  value =  MatrixData (element[i] -> K) [(j-1)*ndofs + l]
-                                                        [(k-1)*ndofs + m]; 
-
-                  if (row <= col) {
-                     address = ConvertRowColumn (row, col, K);
-                     if (address) 
-                        VectorData (K) [address] += value;
-                  }
-               }
+	/*
+	 * expand the node graph into equation rows, column by column.
+	 * Equations are numbered in node order so the rows in each
+	 * column come out sorted.
+	 */
+
+   size = problem.num_equations;
+   cvector1u colptr(size + 1);
+   cvector1u rowind;
+
+   for (b = 1 ; b <= numnodes ; b++) {
+      for (q = 1 ; q <= active ; q++) {
+         col = eqn [(b - 1)*active + q];
+         if (!col)
+            continue;
+
+         colptr [col] = rowind.size() + 1;
+
+         for (n = 1 ; n <= adj [b].size() ; n++) {
+            a = adj [b][n];
+            for (p = 1 ; p <= active ; p++) {
+               row = eqn [(a - 1)*active + p];
+               if (!row)
+                  continue;
+               if (row > col)
+                  break;
+
+               rowind.push_back (row);
             }
          }
       }
+   }
+   colptr [size + 1] = rowind.size() + 1;
+
+   return CreateSparseMatrix (size, size, colptr, rowind, 1);
+}
+
+static void
+SparseAssemblyTask(Element element, unsigned i, void *arg)
+{
+   AssemblyPass	*pass = (AssemblyPass *) arg;
+   unsigned	n;
+
+   const ScatterMap &map = *pass -> map;
+   const double *ke = MatrixData (element -> K) [1];
+   double *k = SparseData (pass -> Ks);
 
-      if (!element[i] -> definition -> retainK)
-          element[i] -> K.reset();
+   for (n = map.first [i] ; n < map.first [i + 1] ; n++)
+      k [map.address [n]] += ke [map.entry [n]];
 
-   } /* end second loop over elements */
+   if (!element -> definition -> retainK)
+       element -> K.reset();
+}
+
+SparseMatrix
+ConstructSparseStiffness(int *status)
+{
+   AssemblyPass	pass;
+   SparseMatrix	K;
+   int	 	err_count;
 
 	/*
-	 * set some things up for the return
+	 * set up every element first; the nonzero structure itself
+	 * only depends on the connectivity
+	 */
+
+   err_count = SetupElements (0, 0);
+   if (err_count) {
+      *status = err_count;
+      return SparseMatrix();
+   }
+
+   PhaseTimer timer (AssemblyPhase);
+
+   K = ConstructSparsePattern ( );
+
+   detail ("sparse stiffness matrix has %d nonzeros", K -> nnz);
+
+	/*
+	 * assemble the upper triangle of each element stiffness
+	 * into the structure
 	 */
+   
+   pass.Ks = K;
+   pass.map = &SparseScatterMap (K);
+   ForEachElement (SparseAssemblyTask, &pass, 1);
 
-   *status = err_count;
+   *status = 0;
 
    return K;
 }
@@ -263,27 +464,58 @@ ConstructStiffness(int *status)
 void
 RemoveConstrainedDOF(const Matrix &K, const Matrix &M, const Matrix &C, Matrix &Kcond, Matrix &Mcond, Matrix &Ccond)
 {
-    unsigned active;
+   Matrix	Kc, Mc, Cc;
+
+	/*
+	 * the condensed matrices never need more room than the originals
+	 * so we simply condense a set of copies
+	 */
+
+   PhaseTimer timer (ConstraintPhase);
+
+   Kc = CreateCopyMatrix (K);
+   Mc = CreateCopyMatrix (M);
+   if (C)
+      Cc = CreateCopyMatrix (C);
+
+   CondenseConstrainedDOF (Kc, Mc, Cc);
+
+	/* 
+	 * set the pointers for return
+	 */
+
+   Kcond = Kc;
+   Mcond = Mc;
+   Ccond = Cc;
+   return;
+}
+
+void
+CondenseConstrainedDOF(Matrix &K, Matrix &M, Matrix &C)
+{
+   unsigned	active;
    unsigned	*dofs;
    unsigned	orig_dofs;
    unsigned	new_dofs;
    unsigned	height;
-   Matrix	Kc, Mc, Cc;
-   unsigned	size;
    unsigned	start;
    unsigned	i, j, n, m,
 		affected_dof,
 		base_dof;
+   double	*kd, *md, *cd;
 
    const unsigned numnodes = problem.nodes.size();
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+
+   PhaseTimer timer (ConstraintPhase);
+
    active   = problem.num_dofs;
    dofs     = problem.dofs_num;
    
-   orig_dofs = numnodes * active;
+   orig_dofs = problem.num_equations;
 
    cvector1c dof_map(orig_dofs, 1);
-   size = K -> size;
    new_dofs = orig_dofs;
 
 	/*
@@ -294,39 +526,27 @@ RemoveConstrainedDOF(const Matrix &K, const Matrix &M, const Matrix &C, Matrix &
    for (i = 1 ; i <= numnodes ; i++) {
       base_dof = active*(node[i] -> number - 1);
       for (j = 1 ; j <= active ; j++) {
-
-         if (node [i] -> constraint -> constraint [dofs[j]]) {
-            affected_dof = base_dof + j;
-            dof_map [affected_dof] = 0; 
+         if (node [i] -> constraint -> constraint [dofs[j]] && eqn [base_dof + j]) {
+            dof_map [eqn [base_dof + j]] = 0; 
             new_dofs --;
-            if (affected_dof == 1)
-               size -= 1;
-            else
-               size -= (K -> diag [affected_dof] - 
-                        K -> diag [affected_dof - 1]);
          }
       }
    }
 
-	/*
-	 * now we know how much space we are saving so we can allocate 
-	 * space for the condensed stiffness and mass matrices
-	 */
-
-   Cc.reset();
-   Kc = CreateCompactMatrix (new_dofs, new_dofs, size, NULL);
-   Mc = CreateCompactMatrix (new_dofs, new_dofs, size, NULL);
-   if (C)
-      Cc = CreateCompactMatrix (new_dofs, new_dofs, size, NULL);
-
    cvector1u diag(new_dofs);
 
+   kd = CompactData (K);
+   md = CompactData (M);
+   cd = (C ? CompactData (C) : NULL);
+
    n = 1;
    m = 1;
 
 	/*
 	 * now we make a column loop over all of the original DOF to see
-	 * which ones to copy through
+	 * which ones to copy through.  A coefficient never moves to a
+	 * higher address than the one it came from, so each matrix can
+	 * be packed down over itself.
 	 */
 
    for (i = 1 ; i <= orig_dofs ; i++) {
@@ -350,10 +570,10 @@ RemoveConstrainedDOF(const Matrix &K, const Matrix &M, const Matrix &C, Matrix &
             affected_dof = i - height  + 1 + (j - start);             
 
             if (dof_map [affected_dof]) {
-               Kc -> data [m][1] = K -> data [j][1];
-               Mc -> data [m][1] = M -> data [j][1];
-               if (C)
-                  Cc -> data [m][1] = C -> data [j][1]; 
+               kd [m] = kd [j];
+               md [m] = md [j];
+               if (cd)
+                  cd [m] = cd [j]; 
 
                m++; 
             }
@@ -362,113 +582,526 @@ RemoveConstrainedDOF(const Matrix &K, const Matrix &M, const Matrix &C, Matrix &
       }
    }
 
-   Kc -> diag = diag;
-
 	/*
-	 * allocate, copy and assign a different diag pointer for the mass
-	 * matrix to allow for the possibility that the stiffness and the
-	 * mass matrices will be destroyed at different times
+	 * each matrix keeps its own diag array so that they can still
+	 * be destroyed at different times
 	 */
 
-   Mc -> diag = cvector1u(new_dofs);
- 
-   for (i = 1 ; i <= new_dofs ; i++)
-      Mc -> diag [i] = Kc -> diag [i];
+   K -> nrows = K -> ncols = new_dofs;
+   K -> size = m - 1;
+   K -> diag = diag;
+
+   M -> nrows = M -> ncols = new_dofs;
+   M -> size = m - 1;
+   M -> diag = diag;
 
    if (C) {
-       Cc -> diag = cvector1u(new_dofs);
- 
-      for (i = 1 ; i <= new_dofs ; i++)
-         Cc -> diag [i] = Kc -> diag [i];
+      C -> nrows = C -> ncols = new_dofs;
+      C -> size = m - 1;
+      C -> diag = diag;
    }
 
-
-	/* 
-	 * set the pointers for return
-	 */
-
-   Kcond = Kc;
-   Mcond = Mc;
-   Ccond = Cc;
    return;
 }
 
 void
-ZeroConstrainedDOF(const Vector &K, const Vector &F, Vector *Kc, Vector *Fc)
+CondenseConstrainedDOF(SparseMatrix &K, SparseMatrix &M, SparseMatrix &C)
 {
    unsigned	active;
    unsigned	*dofs;
-   Vector	Kcond;
-   Vector	Fcond;
-   unsigned	i,j,
-		affected_dof,
-		base_dof;
+   unsigned	i, j, a, m;
+   unsigned	base_dof;
+   unsigned	orig_dofs;
+   unsigned	new_dofs;
+   unsigned	r;
+   double	*kd, *md, *cd;
 
+   const unsigned numnodes = problem.nodes.size();
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+
+   PhaseTimer timer (ConstraintPhase);
+
    active = problem.num_dofs;
    dofs = problem.dofs_num;
+   orig_dofs = problem.num_equations;
 
 	/*
-	 * allocate and copy the condensed objects
+	 * number the equations that stay; the constrained ones map to zero
 	 */
 
-   Kcond = CreateCopyMatrix (K);
-
-   Fcond.reset();
-   if (F)
-      Fcond = CreateCopyMatrix (F);
-   
-   for (i = 1 ; i <= problem.nodes.size(); i++) {
+   cvector1u renumber(orig_dofs, 1);
 
+   for (i = 1 ; i <= numnodes ; i++) {
       base_dof = active*(node[i] -> number - 1);
+      for (j = 1 ; j <= active ; j++)
+         if (node [i] -> constraint -> constraint [dofs[j]] && eqn [base_dof + j])
+            renumber [eqn [base_dof + j]] = 0;
+   }
 
-      for (j = 1 ; j <= active ; j++) {
-         if (node[i] -> constraint -> constraint[dofs[j]]) {
-            affected_dof = base_dof + j;
+   for (i = 1, new_dofs = 0 ; i <= orig_dofs ; i++)
+      if (renumber [i])
+         renumber [i] = ++ new_dofs;
+
+	/*
+	 * the numbering keeps the order of the rows, so the coefficients
+	 * that are left can be packed down over themselves a column at a
+	 * time and each column stays sorted
+	 */
 
-            if (node[i] -> constraint -> dx[dofs[j]].value == 0.0 ||
-                node[i] -> constraint -> constraint[dofs[j]] == 'h') {
-               Kcond = ZeroCompactRowCol (Kcond, affected_dof);
+   kd = SparseData (K);
+   md = SparseData (M);
+   cd = (C ? SparseData (C) : NULL);
 
-               if (F != NULL)
-                  VectorData (Fcond) [affected_dof] = 0; 
-            }
-            else {
-               if (F != NULL) {
-                  AdjustForceVector (Fcond, Kcond, affected_dof,
-                               node[i] -> constraint -> dx[dofs[j]].value);
-                  VectorData (Fcond) [affected_dof] = 
-                                      node[i] -> constraint -> dx[dofs[j]].value;
-               }
-               Kcond = ZeroCompactRowCol (Kcond, affected_dof);
-            }
-         }
+   cvector1u colptr(new_dofs + 1);
+   cvector1u rowind(K -> nnz);
+
+   m = 1;
+   for (j = 1 ; j <= orig_dofs ; j++) {
+      if (!renumber [j])
+         continue;
+
+      colptr [renumber [j]] = m;
+      for (a = K -> colptr [j] ; a < K -> colptr [j+1] ; a++) {
+         r = renumber [K -> rowind [a]];
+         if (!r)
+            continue;
+
+         rowind [m] = r;
+         kd [m] = kd [a];
+         md [m] = md [a];
+         if (cd)
+            cd [m] = cd [a];
+         m++;
       }
    }
-   *Kc = Kcond;
+   colptr [new_dofs + 1] = m;
+   rowind.resize (m - 1);
 
-   if (F != NULL)
-      *Fc = Fcond;
+   K -> nrows = K -> ncols = new_dofs;
+   K -> nnz = m - 1;
+   K -> colptr = colptr;
+   K -> rowind = rowind;
+   K -> values.resize (m > 1 ? m - 1 : 1);
+
+   M -> nrows = M -> ncols = new_dofs;
+   M -> nnz = m - 1;
+   M -> colptr = colptr;
+   M -> rowind = rowind;
+   M -> values.resize (m > 1 ? m - 1 : 1);
+
+   if (C) {
+      C -> nrows = C -> ncols = new_dofs;
+      C -> nnz = m - 1;
+      C -> colptr = colptr;
+      C -> rowind = rowind;
+      C -> values.resize (m > 1 ? m - 1 : 1);
+   }
 
    return;
 }
 
 void
-AdjustForceVector(Vector Fcond, Vector Kcond, unsigned int affected_dof, double dx)
+ZeroConstrainedDOF(const Vector &K, const Vector &F, Vector *Kc, Vector *Fc)
 {
-    unsigned	i;
-    unsigned	address;
-    unsigned	size;
-
-    size = Mrows(Fcond);
+   Vector	Kcond;
+   Vector	Fcond;
 
-    for (i = 1 ; i <= size ; i++) {
-       address = ConvertRowColumn (i, affected_dof, Kcond);
-       if (address)
-          VectorData (Fcond) [i] -= VectorData (Kcond) [address]*dx;
-    }
+   PhaseTimer timer (ConstraintPhase);
 
-    return;
+	/*
+	 * allocate and copy the condensed objects
+	 */
+
+   Kcond = CreateCopyMatrix (K);
+
+   Fcond.reset();
+   if (F)
+      Fcond = CreateCopyMatrix (F);
+
+   ApplyConstraints (Kcond, Fcond, NULL);
+   
+   *Kc = Kcond;
+
+   if (F != NULL)
+      *Fc = Fcond;
+
+   return;
+}
+
+void
+ZeroConstrainedDOF(const SparseMatrix &K, const Vector &F, SparseMatrix *Kc, Vector *Fc)
+{
+   SparseMatrix	Kcond;
+   Vector	Fcond;
+
+   PhaseTimer timer (ConstraintPhase);
+
+   Kcond = CreateSparseMatrix (K -> nrows, K -> ncols, K -> colptr, K -> rowind, K -> symmetric);
+   Kcond -> values = K -> values;
+
+   if (F)
+      Fcond = CreateCopyMatrix (F);
+
+   ApplyConstraints (Kcond, Fcond, NULL);
+
+   *Kc = Kcond;
+
+   if (F != NULL)
+      *Fc = Fcond;
+
+   return;
+}
+
+	/*
+	 * the constrained equations in node order, and the index that
+	 * maps an equation back to its place among them
+	 */
+
+static void
+IndexConstrainedRows(unsigned n, ConstrainedRows &saved)
+{
+   unsigned	active;
+   unsigned	*dofs;
+   unsigned	i, j;
+   unsigned	base_dof;
+
+   const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   active = problem.num_dofs;
+   dofs = problem.dofs_num;
+
+   saved.dofs.clear();
+   saved.index = cvector1u(n, 0);
+
+   for (i = 1 ; i <= problem.nodes.size() ; i++) {
+      base_dof = active*(node[i] -> number - 1);
+
+      for (j = 1 ; j <= active ; j++)
+         if (node[i] -> constraint -> constraint[dofs[j]] && eqn [base_dof + j]) {
+            saved.dofs.push_back (eqn [base_dof + j]);
+            saved.index [eqn [base_dof + j]] = saved.dofs.size();
+         }
+   }
+}
+
+void
+SaveConstrainedRows(const Matrix &K, ConstrainedRows &saved)
+{
+   unsigned	m;
+   unsigned	c, r, a, top;
+   unsigned	count;
+   double	k;
+
+   const unsigned n = Mrows(K);
+   const double *kd = CompactData (K);
+   const unsigned *diag = K -> diag.c_ptr1();
+
+   IndexConstrainedRows (n, saved);
+
+	/*
+	 * two sweeps down the skyline, one to size each row and one to
+	 * fill them in; a coefficient at (r,c) belongs to row r and, by
+	 * symmetry, to row c
+	 */
+
+   const unsigned *index = saved.index.c_ptr1();
+   saved.start = cvector1u(saved.dofs.size() + 1, 0);
+
+   for (c = 1 ; c <= n ; c++) {
+      a = (c == 1 ? 1 : diag [c-1] + 1);
+      top = c - (diag [c] - a);
+
+      for (r = top ; a <= diag [c] ; a++, r++) {
+         if (kd [a] == 0.0)
+            continue;
+         if (index [r])
+            saved.start [index [r]] ++;
+         if (r != c && index [c])
+            saved.start [index [c]] ++;
+      }
+   }
+
+   for (m = 1, a = 1 ; m <= saved.start.size() ; m++) {
+      count = saved.start [m];
+      saved.start [m] = a;
+      a += count;
+   }
+
+   saved.col = cvector1u(a - 1);
+   saved.value = cvector1d(a - 1);
+
+   cvector1u next(saved.start);
+
+   for (c = 1 ; c <= n ; c++) {
+      a = (c == 1 ? 1 : diag [c-1] + 1);
+      top = c - (diag [c] - a);
+
+      for (r = top ; a <= diag [c] ; a++, r++) {
+         k = kd [a];
+         if (k == 0.0)
+            continue;
+
+         if (index [r]) {
+            m = next [index [r]] ++;
+            saved.col [m] = c;
+            saved.value [m] = k;
+         }
+
+         if (r != c && index [c]) {
+            m = next [index [c]] ++;
+            saved.col [m] = r;
+            saved.value [m] = k;
+         }
+      }
+   }
+
+   return;
+}
+
+void
+SaveConstrainedRows(const SparseMatrix &K, ConstrainedRows &saved)
+{
+   unsigned	m;
+   unsigned	c, r, a;
+   unsigned	count;
+   double	k;
+
+   const unsigned n = K -> ncols;
+   const double *kd = SparseData (K);
+   const unsigned *colptr = K -> colptr.c_ptr1();
+   const unsigned *rowind = K -> rowind.c_ptr1();
+
+   IndexConstrainedRows (n, saved);
+
+	/*
+	 * the same two sweeps as for the compact matrix, over the stored
+	 * upper triangle a column at a time
+	 */
+
+   const unsigned *index = saved.index.c_ptr1();
+   saved.start = cvector1u(saved.dofs.size() + 1, 0);
+
+   for (c = 1 ; c <= n ; c++)
+      for (a = colptr [c] ; a < colptr [c+1] ; a++) {
+         r = rowind [a];
+         if (kd [a] == 0.0)
+            continue;
+         if (index [r])
+            saved.start [index [r]] ++;
+         if (r != c && index [c])
+            saved.start [index [c]] ++;
+      }
+
+   for (m = 1, a = 1 ; m <= saved.start.size() ; m++) {
+      count = saved.start [m];
+      saved.start [m] = a;
+      a += count;
+   }
+
+   saved.col = cvector1u(a - 1);
+   saved.value = cvector1d(a - 1);
+
+   cvector1u next(saved.start);
+
+   for (c = 1 ; c <= n ; c++)
+      for (a = colptr [c] ; a < colptr [c+1] ; a++) {
+         r = rowind [a];
+         k = kd [a];
+         if (k == 0.0)
+            continue;
+
+         if (index [r]) {
+            m = next [index [r]] ++;
+            saved.col [m] = c;
+            saved.value [m] = k;
+         }
+
+         if (r != c && index [c]) {
+            m = next [index [c]] ++;
+            saved.col [m] = r;
+            saved.value [m] = k;
+         }
+      }
+
+   return;
+}
+
+	/*
+	 * the prescribed displacement of each constrained equation (zero
+	 * for a fixed or hinged DOF); mask marks the constrained ones
+	 */
+
+static void
+ConstrainedMask(unsigned n, cvector1i &mask, cvector1d &dx)
+{
+   unsigned	active;
+   unsigned	*dofs;
+   unsigned	i, j;
+   unsigned	base_dof;
+   unsigned	eq;
+
+   const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   active = problem.num_dofs;
+   dofs = problem.dofs_num;
+
+   mask = cvector1i(n, 0);
+   dx = cvector1d(n, 0.0);
+
+   for (i = 1 ; i <= problem.nodes.size(); i++) {
+      base_dof = active*(node[i] -> number - 1);
+
+      for (j = 1 ; j <= active ; j++) {
+         eq = eqn [base_dof + j];
+         if (!node[i] -> constraint -> constraint[dofs[j]] || !eq)
+            continue;
+
+         mask [eq] = 1;
+         if (node[i] -> constraint -> constraint[dofs[j]] != 'h')
+            dx [eq] = node[i] -> constraint -> dx[dofs[j]].value;
+      }
+   }
+}
+
+void
+ApplyConstraints(Matrix &K, const Matrix &F, ConstrainedRows *saved)
+{
+   unsigned	c, r, a, top;
+   unsigned	eq;
+   cvector1i	mask;
+   cvector1d	dx;
+
+   const unsigned n = Mrows(K);
+   const unsigned *diag = K -> diag.c_ptr1();
+   double *kd = CompactData (K);
+
+   PhaseTimer timer (ConstraintPhase);
+
+   if (saved)
+      SaveConstrainedRows (K, *saved);
+
+   ConstrainedMask (n, mask, dx);
+
+	/*
+	 * one walk down each skyline column in place of a ZeroCompactRowCol
+	 * and AdjustForceVector per constrained equation, each of which
+	 * searched every row of the matrix for the coefficients it wanted
+	 */
+
+   for (c = 1 ; c <= n ; c++) {
+      a = (c == 1 ? 1 : diag [c-1] + 1);
+      top = c - (diag [c] - a);
+
+      for (r = top ; a <= diag [c] ; a++, r++) {
+         if (!mask [r] && !mask [c])
+            continue;
+
+         if (F) {
+            if (mask [c] && !mask [r])
+               VectorData (F) [r] -= kd [a]*dx [c];
+            else if (mask [r] && !mask [c])
+               VectorData (F) [c] -= kd [a]*dx [r];
+         }
+
+         kd [a] = (r == c ? 1.0 : 0.0);
+      }
+   }
+
+   if (F)
+      for (eq = 1 ; eq <= n ; eq++)
+         if (mask [eq])
+            VectorData (F) [eq] = dx [eq];
+
+   return;
+}
+
+void
+ApplyConstraints(SparseMatrix &K, const Matrix &F, ConstrainedRows *saved)
+{
+   unsigned	c, r, a;
+   unsigned	eq;
+   cvector1i	mask;
+   cvector1d	dx;
+
+   const unsigned n = K -> ncols;
+   const unsigned *colptr = K -> colptr.c_ptr1();
+   const unsigned *rowind = K -> rowind.c_ptr1();
+   double *kd = SparseData (K);
+
+   PhaseTimer timer (ConstraintPhase);
+
+   if (saved)
+      SaveConstrainedRows (K, *saved);
+
+   ConstrainedMask (n, mask, dx);
+
+	/*
+	 * the same sweep as for the compact matrix: the columns of the
+	 * constrained DOF move to the right hand side of the free rows,
+	 * and their rows and columns are left with just a one on the
+	 * diagonal
+	 */
+
+   for (c = 1 ; c <= n ; c++)
+      for (a = colptr [c] ; a < colptr [c+1] ; a++) {
+         r = rowind [a];
+         if (!mask [r] && !mask [c])
+            continue;
+
+         if (F) {
+            if (mask [c] && !mask [r])
+               VectorData (F) [r] -= kd [a]*dx [c];
+            else if (mask [r] && !mask [c])
+               VectorData (F) [c] -= kd [a]*dx [r];
+         }
+
+         kd [a] = (r == c ? 1.0 : 0.0);
+      }
+
+   if (F)
+      for (eq = 1 ; eq <= n ; eq++)
+         if (mask [eq])
+            VectorData (F) [eq] = dx [eq];
+
+   return;
+}
+
+void
+AdjustConstrainedForce(Vector F, const ConstrainedRows &saved, unsigned int dof, double dx)
+{
+   unsigned	k, m;
+   unsigned	col;
+
+   m = saved.index [dof];
+   if (!m)
+      return;
+
+   for (k = saved.start [m] ; k < saved.start [m+1] ; k++) {
+      col = saved.col [k];
+      if (!saved.index [col])
+         VectorData (F) [col] -= saved.value [k]*dx;
+   }
+
+   return;
+}
+
+void
+AdjustForceVector(Vector Fcond, Vector Kcond, unsigned int affected_dof, double dx)
+{
+    unsigned	i;
+    unsigned	address;
+    unsigned	size;
+
+    size = Mrows(Fcond);
+
+    for (i = 1 ; i <= size ; i++) {
+       address = ConvertRowColumn (i, affected_dof, Kcond);
+       if (address)
+          VectorData (Fcond) [i] -= CompactData (Kcond) [address]*dx;
+    }
+
+    return;
 }
 
 Vector
@@ -483,13 +1116,13 @@ ZeroCompactRowCol(Vector K, unsigned int dof)
    for (i = 1 ; i <= size ; i++) {
       address = ConvertRowColumn (i, dof, K);
       if (address)
-          VectorData (K) [address] = 0;
+          CompactData (K) [address] = 0;
    }
 
    address = ConvertRowColumn (dof, dof, K);
 
    if (address) /* though this should always be valid */
-      VectorData (K) [address] = 1;
+      CompactData (K) [address] = 1;
 
    return K;
 }
@@ -506,11 +1139,12 @@ ConstructForceVector(void)
    Vector	F;
 
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    active   = problem.num_dofs;
    dofs     = problem.dofs_num;
    const unsigned numnodes = problem.nodes.size();
    
-   size = numnodes*active;
+   size = problem.num_equations;
 
    F = CreateVector (size);
 
@@ -525,6 +1159,9 @@ ConstructForceVector(void)
       base_dof = active*(node[i] -> number - 1);
 
       for (j = 1 ; j <= active ; j++) {
+         if (!eqn [base_dof + j])
+            continue;
+
          force = 0.0;
          if (node[i] -> force != NULL) {
             if (node[i] -> force -> force[dofs[j]].value) 
@@ -534,7 +1171,7 @@ ConstructForceVector(void)
             if (node[i] -> eq_force[dofs[j]])
                force += node[i] -> eq_force[dofs[j]];
          }
-         VectorData (F) [base_dof + j] = force; 
+         VectorData (F) [eqn [base_dof + j]] = force; 
       }
    }
 
@@ -556,310 +1193,1505 @@ ClearNodes(void)
    }
 }
   
+	/*
+	 * the size of a factorization for the profile: the nonzeros of
+	 * the matrix and the entries of its factor, the difference being
+	 * the fill (for the skyline solver every zero inside the profile)
+	 */
+
+static void
+CountFactorEntries(unsigned long nonzeros, unsigned long entries)
+{
+   ProfileCount (FactorizationsCounter, 1);
+   ProfileSet (NonzerosCounter, nonzeros);
+   ProfileSet (FactorEntriesCounter, entries);
+   ProfileSet (FillCounter, entries - nonzeros);
+}
+
 int
-FactorStiffnessMatrix(Vector &K)
+FactorSystemMatrix(Matrix &K, LinearSolver &S)
 {
-   unsigned	 active;
-   unsigned	*dofs;
-   unsigned	 i;
-   unsigned	 size;
+   SparseMatrix	A;
+   unsigned	i;
+   unsigned long nonzeros;
 
-   active = problem.num_dofs;
-   dofs = problem.dofs_pos;
-   const Node *node = problem.nodes.c_ptr1();
-   const unsigned numnodes = problem.nodes.size();
+   PhaseTimer timer (FactorPhase);
 
-   size = active*numnodes;
+   if (analysis.solver != 's' && analysis.solver != 'c') {
+      S.factor.reset();
+      S.A.reset();
+      S.M.reset();
+      S.x.reset();
 
-   for (i = 1 ; i <= size ; i++) {
-      if (VectorData (K) [K -> diag[i]] == 0.0) {
-         error ("zero on the diagonal (row %d) of stiffness matrix",i);
-         return 1;
+      if (ProfileEnabled ( ) && IsCompact (K)) {
+         nonzeros = 0;
+         for (i = 1 ; i <= K -> size ; i++)
+            if (CompactData (K) [i] != 0.0)
+               nonzeros ++;
+
+         CountFactorEntries (nonzeros, K -> size);
       }
+
+      return CroutFactorMatrix (K);
+   }
+
+	/*
+	 * the skyline matrix is only the assembly format here; the
+	 * coefficients inside the profile that are zero are dropped
+	 * before the fill reducing ordering is computed or the
+	 * preconditioner is built
+	 */
+
+   A = MakeSparseFromCompact (K);
+   if (!A)
+      return M_NOTSQUARE;
+
+   return FactorSystemMatrix (A, S);
+}
+
+int
+FactorSystemMatrix(SparseMatrix &K, LinearSolver &S)
+{
+   int		status;
+
+   PhaseTimer timer (FactorPhase);
+
+   S.factor.reset();
+   S.A.reset();
+   S.M.reset();
+   S.x.reset();
+
+   if (analysis.solver == 'c') {
+      S.M = CreatePreconditioner (K, analysis.preconditioner ? analysis.preconditioner : 'i');
+      if (!S.M)
+         return M_NOTPOSITIVEDEFINITE;
+
+      if (analysis.relaxation > 0.0 && analysis.relaxation < 2.0)
+         S.M -> omega = analysis.relaxation;
+
+      S.A = K;
+      ProfileCount (FactorizationsCounter, 1);
+      ProfileSet (NonzerosCounter, K -> nnz);
+      return 0;
+   }
+
+   S.factor = AnalyzeSparseMatrix (K);
+   if (!S.factor)
+      return M_NOTSYMMETRIC;
+
+   status = FactorSparseMatrix (S.factor, K);
+   if (status)
+      S.factor.reset();
+   else
+      CountFactorEntries (K -> nnz, S.factor -> L.size() + S.factor -> D.size());
+
+   return status;
+}
+
+int
+SolveSystemMatrix(const Matrix &K, LinearSolver &S, Matrix &b)
+{
+   unsigned	its;
+   unsigned	maxits;
+   double	tol;
+   int		status;
+
+   PhaseTimer timer (SolvePhase);
+   ProfileCount (BackSolvesCounter, 1);
+
+   if (S.factor)
+      return SolveSparseMatrix (S.factor, b);
+
+   if (!S.A)
+      return CroutBackSolveMatrix (K, b);
+
+	/*
+	 * the previous solution is usually a much better starting guess
+	 * than zero (the next load case or time step)
+	 */
+
+   if (!S.x) {
+      S.x = CreateColumnVector (Mrows(b));
+      ZeroMatrix (S.x);
    }
 
-   if (CroutFactorMatrix (K)) {
-      error ("could not factorize global stiffness matrix");
-      return 1;
+   tol = (analysis.tolerance > 0.0 ? analysis.tolerance : 1e-10);
+   maxits = (analysis.iterations > 0 ? analysis.iterations : Mrows(b));
+
+   status = ConjugateGradient (S.x, S.A, b, S.M, tol, maxits, &its);
+   ProfileCount (IterationsCounter, its);
+   if (status == M_NOTCONVERGED)
+      error ("conjugate gradients did not converge in %u iterations", its);
+   else
+      detail ("conjugate gradients converged in %u iterations", its);
+
+   CopyMatrix (b, S.x);
+   return status;
+}
+
+int
+SolveSystemBlock(const Matrix &K, LinearSolver &S, Matrix &B)
+{
+   unsigned	i, j;
+   Matrix	b;
+   int		status;
+
+   PhaseTimer timer (SolvePhase);
+
+   if (!S.factor && !S.A) {
+      ProfileCount (BackSolvesCounter, Mcols(B));
+      return CroutBackSolveBlock (K, B);
+   }
+
+	/*
+	 * the sparse and iterative solvers take the columns one at a time
+	 */
+
+   b = CreateColumnVector (Mrows(B));
+   for (j = 1 ; j <= Mcols(B) ; j++) {
+      for (i = 1 ; i <= Mrows(B) ; i++)
+         sdata(b, i, 1) = mdata(B,i,j);
+
+      status = SolveSystemMatrix (K, S, b);
+      if (status)
+         return status;
+
+      for (i = 1 ; i <= Mrows(B) ; i++)
+         sdata(B, i, j) = mdata(b,i,1);
+   }
+
+   return 0;
+}
+
+int
+FactorStiffnessMatrix(Vector &K, LinearSolver &S)
+{
+   unsigned	 i;
+   unsigned	 size;
+
+   size = Mrows(K);
+
+   for (i = 1 ; i <= size ; i++) {
+      if (CompactData (K) [K -> diag[i]] == 0.0) {
+         error ("zero on the diagonal (row %d) of stiffness matrix",i);
+         return 1;
+      }
+   }
+
+   if (FactorSystemMatrix (K, S)) {
+      error ("could not factorize global stiffness matrix");
+      return 1;
+   }
+
+   return 0;
+}
+
+int
+FactorStiffnessMatrix(SparseMatrix &K, LinearSolver &S)
+{
+   unsigned	 i;
+
+	/*
+	 * the rows in a column are sorted, so the diagonal is its last
+	 * stored coefficient
+	 */
+
+   for (i = 1 ; i <= K -> ncols ; i++) {
+      if (K -> colptr [i+1] == K -> colptr [i] ||
+          K -> rowind [K -> colptr [i+1] - 1] != i ||
+          SparseData (K) [K -> colptr [i+1] - 1] == 0.0) {
+         error ("zero on the diagonal (row %d) of stiffness matrix",i);
+         return 1;
+      }
+   }
+
+   if (FactorSystemMatrix (K, S)) {
+      error ("could not factorize global stiffness matrix");
+      return 1;
+   }
+
+   return 0;
+}
+
+Vector
+SolveForDisplacements(Vector &K, Vector &F)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Vector();
+
+   if (SolveSystemMatrix (K, S, F)) {
+      error ("could not back substitute for nodal displacements");
+      return Vector();
+   }
+
+   ApplyNodalDisplacements (F);
+
+   return F;
+}
+
+Vector
+SolveForDisplacements(SparseMatrix &K, Vector &F)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Vector();
+
+   if (SolveSystemMatrix (Matrix(), S, F)) {
+      error ("could not back substitute for nodal displacements");
+      return Vector();
+   }
+
+   ApplyNodalDisplacements (F);
+
+   return F;
+}
+ 
+	/*
+	 * the reaction DOF in the order that every reaction list and
+	 * table uses; rows gets their equations and base the equivalent
+	 * nodal forces that come off the reactions
+	 */
+
+static cvector1<Reaction>
+CollectReactions(const unsigned *old_numbers, cvector1u *rows, cvector1d *base)
+{
+   unsigned	active,
+		*dofs;
+   unsigned	i,j,
+		base_dof;
+   Reaction	r;
+
+   const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   const unsigned numnodes = problem.nodes.size();
+   active = problem.num_dofs;
+   dofs = problem.dofs_num;
+
+   cvector1<Reaction> reac;
+   if (rows)
+      rows -> clear();
+   if (base)
+      base -> clear();
+
+	/*
+	 * a fixed DOF that no element touches has no equation (row 0)
+	 * but still gets its reaction, which is just the negative of
+	 * any equivalent nodal force there
+	 */
+
+   for (i = 1 ; i <= numnodes ; i++) {
+      base_dof = active*(node[i] -> number - 1);
+
+      for (j = 1 ; j <= active ; j++) {
+         if (node[i] -> constraint -> constraint[dofs[j]] != 1) 
+            continue;
+
+         r.node = (old_numbers == NULL ? node[i] -> number : old_numbers [i]);
+         r.dof = dofs[j];
+         r.force = 0.0;
+         reac.push_back (r);
+
+         if (rows)
+            rows -> push_back (eqn [base_dof + j]);
+         if (base)
+            base -> push_back (node[i] -> eq_force.empty() ? 0.0 : 
+                               node [i] -> eq_force [dofs[j]]);
+      }
+   }
+
+   return reac;
+}
+
+	/*
+	 * P(m,j) = row rows[m] of the unconstrained stiffness matrix
+	 * (as saved by SaveConstrainedRows) times column j of D
+	 */
+
+static void
+ReactionProducts(const ConstrainedRows &saved, const Matrix &D, const cvector1u &rows, Matrix &P)
+{
+   unsigned	j, k, m, row;
+   double	v;
+   double	*p;
+   const double	*x;
+
+   const unsigned ncols = Mcols(D);
+
+   PhaseTimer timer (ReactionPhase);
+   ProfileCount (ReactionsCounter, (unsigned long) rows.size()*ncols);
+
+   P = CreateFullMatrix (rows.size(), ncols);
+   ZeroMatrix (P);
+
+   for (m = 1 ; m <= rows.size() ; m++) {
+      row = rows [m] ? saved.index [rows [m]] : 0;
+      if (!row)
+         continue;
+
+      p = MatrixData (P) [m];
+      for (k = saved.start [row] ; k < saved.start [row+1] ; k++) {
+         v = saved.value [k];
+         x = MatrixData (D) [saved.col [k]];
+         for (j = 1 ; j <= ncols ; j++)
+            p [j] += v*x [j];
+      }
+   }
+}
+
+	/*
+	 * the reactions of a block of load cases (the columns of D) go
+	 * into rows first ... first + Mcols(D) - 1 of the reaction table
+	 */
+
+static void
+LoadCaseReactions(const ConstrainedRows &saved, const Matrix &D, unsigned first, Matrix &rtable)
+{
+   unsigned	i, m;
+   Matrix	P;
+
+   cvector1u rows;
+   cvector1d base;
+   CollectReactions (NULL, &rows, &base);
+
+   ReactionProducts (saved, D, rows, P);
+
+   for (i = 1 ; i <= Mcols(D) ; i++)
+      for (m = 1 ; m <= rows.size() ; m++)
+         sdata(rtable, first + i - 1, m) = mdata(P,m,i) - base [m];
+}
+
+	/*
+	 * a reaction table with a row for each of n load cases, or
+	 * nothing if there are no saved rows to work from or no reactions
+	 */
+
+static Matrix
+ReactionTable(const ConstrainedRows *saved, unsigned n)
+{
+   unsigned	count;
+
+   if (!saved)
+      return Matrix();
+
+   count = CollectReactions (NULL, NULL, NULL).size();
+   if (count == 0)
+      return Matrix();
+
+   return CreateFullMatrix (n, count);
+}
+
+	/*
+	 * the number of load cases (or load range steps) that are carried
+	 * through the factored stiffness matrix together
+	 */
+
+# define LoadCaseBlock	16
+
+	/*
+	 * the displacement (and reaction) tables of the load cases once
+	 * the stiffness matrix has been factored into S; K only matters
+	 * to the skyline solver
+	 */
+
+static Matrix
+LoadCaseTable(const Matrix &K, LinearSolver &S, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   unsigned	 i,j,k;
+   unsigned	 first, count;
+   unsigned	 dof;
+   Matrix	 dtable;
+   Matrix	 F;
+   Matrix	 B;
+   LoadCase	 lc;
+
+   F = CreateColumnVector (Mrows(Fbase));
+
+   cvector1i mask     = BuildConstraintMask ( );
+
+   dtable = CreateFullMatrix (problem.loadcases.size(), 
+                              analysis.nodes.size() * analysis.numdofs);
+
+   if (rtable)
+      *rtable = ReactionTable (saved, problem.loadcases.size());
+
+	/*
+	 * assemble a block of load cases as the columns of B and solve
+	 * for all of them in one pass over the factor
+	 */
+
+   for (first = 1 ; first <= problem.loadcases.size() ; first += count) {
+      count = problem.loadcases.size() - first + 1;
+      if (count > LoadCaseBlock)
+         count = LoadCaseBlock;
+
+      if (!B || Mcols(B) != count)
+         B = CreateFullMatrix (Mrows(Fbase), count);
+
+      for (i = 1 ; i <= count ; i++) {
+         lc = problem.loadcases [first + i - 1];
+
+         ZeroMatrix (F);
+         AssembleLoadCaseForce (F, lc); 
+
+	/*
+	 * Fbase already contains everything we need to know
+	 * about displacment BC so all we need to do is to
+ 	 * make sure that we add _nothing_ at all into the
+ 	 * force vector at any constrained DOF
+	 */
+
+         for (j = 1 ; j <= Mrows(F) ; j++)
+            sdata(B, j, i) = (mask [j] ? 0.0 :  mdata(F,j,1)) + mdata(Fbase,j,1);
+      }
+
+      if (SolveSystemBlock (K, S, B)) {
+          if (count == 1)
+             error ("could not back substitute for displacements in loadcase %s",
+                    problem.loadcases [first] -> name.c_str());
+          else
+             error ("could not back substitute for displacements in loadcases %s to %s",
+                    problem.loadcases [first] -> name.c_str(),
+                    problem.loadcases [first + count - 1] -> name.c_str());
+          return Matrix();
+      }
+
+      for (i = 1 ; i <= count ; i++) {
+         for (k = 1 ; k <= analysis.nodes.size() ; k++) {
+            for (j = 1 ; j <= analysis.numdofs ; j++) {
+               dof = GlobalDOF (analysis.nodes [k] -> number, analysis.dofs[j]);
+               sdata(dtable, first + i - 1, (k-1)*analysis.numdofs + j) =
+                 (dof ? mdata(B, dof, i) : 0.0);
+            }
+         }
+      }
+
+      if (rtable && *rtable)
+         LoadCaseReactions (*saved, B, first, *rtable);
+   }
+
+   return dtable;
+}
+
+Matrix
+SolveStaticLoadCases(Matrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Matrix();
+
+   return LoadCaseTable (K, S, Fbase, saved, rtable);
+}
+
+Matrix
+SolveStaticLoadCases(SparseMatrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Matrix();
+
+   return LoadCaseTable (Matrix(), S, Fbase, saved, rtable);
+}
+
+	/*
+	 * the displacement (and reaction) tables of the load range once
+	 * the stiffness matrix has been factored into S
+	 */
+
+static Matrix
+LoadRangeTable(const Matrix &K, LinearSolver &S, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   unsigned	 i,j,k;
+   Matrix	 dtable;
+   unsigned	 num_cases;
+   unsigned	 numcols;
+   double	 force;
+   unsigned	 input_pos;
+   Matrix	 B;
+   Matrix	 P;
+
+   cvector1i mask     = BuildConstraintMask ( );
+
+   num_cases = (fabs(analysis.stop - analysis.start) + 0.5*fabs(analysis.step)) 
+               / fabs(analysis.step) + 1;
+
+   numcols = analysis.nodes.size() * analysis.numdofs;
+   dtable = CreateFullMatrix (num_cases, numcols);
+   
+   input_pos = GlobalDOF (analysis.input_node -> number, analysis.input_dof);
+
+	/*
+	 * the problem is linear, so d(force) = d(0) + force*d(1) where
+	 * d(0) answers Fbase alone and d(1) a unit load at the input DOF;
+	 * those two are solved together and every step is then a scaling
+	 */
+
+   B = CreateFullMatrix (Mrows(Fbase), 2);
+   for (j = 1 ; j <= Mrows(Fbase) ; j++) {
+      sdata(B, j, 1) = mdata(Fbase,j,1);
+      sdata(B, j, 2) = 0.0;
+   }
+
+   if (input_pos && !mask [input_pos])
+      sdata(B, input_pos, 2) = 1.0;
+
+   if (SolveSystemBlock (K, S, B)) {
+      error ("could not back substitute for displacements");
+      return Matrix();
+   }
+
+   cvector1u dof(numcols);
+   for (k = 1 ; k <= analysis.nodes.size() ; k++)
+      for (j = 1 ; j <= analysis.numdofs ; j++)
+         dof [(k-1)*analysis.numdofs + j] = GlobalDOF (analysis.nodes [k] -> number, analysis.dofs[j]);
+
+   for (i = 1 ; i <= num_cases ; i++) {
+      force = analysis.start + (i - 1)*analysis.step;
+
+      for (j = 1 ; j <= numcols ; j++)
+         sdata(dtable, i, j) = (dof [j] ? mdata(B,dof [j],1) + force*mdata(B,dof [j],2) : 0.0);
+   }
+
+	/*
+	 * the reactions superpose the same way; the equivalent nodal
+	 * forces belong to the base loads only
+	 */
+
+   if (rtable)
+      *rtable = ReactionTable (saved, num_cases);
+
+   if (rtable && *rtable) {
+      cvector1u rows;
+      cvector1d base;
+      CollectReactions (NULL, &rows, &base);
+      ReactionProducts (*saved, B, rows, P);
+
+      for (i = 1 ; i <= num_cases ; i++) {
+         force = analysis.start + (i - 1)*analysis.step;
+
+         for (j = 1 ; j <= rows.size() ; j++)
+            sdata(*rtable, i, j) = mdata(P,j,1) - base [j] + force*mdata(P,j,2);
+      }
+   }
+
+   return dtable;
+}
+
+Matrix
+SolveStaticLoadRange(Matrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Matrix();
+
+   return LoadRangeTable (K, S, Fbase, saved, rtable);
+}
+
+Matrix
+SolveStaticLoadRange(SparseMatrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Matrix();
+
+   return LoadRangeTable (Matrix(), S, Fbase, saved, rtable);
+}
+
+	/*
+	 * the same tables solved the long way, with the full load at
+	 * every step, to check the superposition against
+	 */
+
+static Matrix
+LoadRangeDirectTable(const Matrix &K, LinearSolver &S, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   unsigned	 i,j,k;
+   unsigned	 first, count;
+   unsigned	 dof;
+   Matrix	 dtable;
+   unsigned	 num_cases;
+   double	 force;
+   unsigned	 input_pos;
+   Matrix	 B;
+
+   cvector1i mask     = BuildConstraintMask ( );
+
+   num_cases = (fabs(analysis.stop - analysis.start) + 0.5*fabs(analysis.step)) 
+               / fabs(analysis.step) + 1;
+
+   dtable = CreateFullMatrix (num_cases, analysis.nodes.size() * analysis.numdofs);
+
+   if (rtable)
+      *rtable = ReactionTable (saved, num_cases);
+   
+   input_pos = GlobalDOF (analysis.input_node -> number, analysis.input_dof);
+
+   for (first = 1 ; first <= num_cases ; first += count) {
+      count = num_cases - first + 1;
+      if (count > LoadCaseBlock)
+         count = LoadCaseBlock;
+
+      if (!B || Mcols(B) != count)
+         B = CreateFullMatrix (Mrows(Fbase), count);
+
+      for (i = 1 ; i <= count ; i++) {
+         force = analysis.start + (first + i - 2)*analysis.step;
+
+         for (j = 1 ; j <= Mrows(Fbase) ; j++)
+            sdata(B, j, i) = mdata(Fbase,j,1);
+    
+         if (input_pos && !mask [input_pos]) 
+            sdata(B, input_pos, i) = mdata(B,input_pos,i) + force;
+      }
+ 
+      if (SolveSystemBlock (K, S, B)) {
+         error ("could not back substitute for displacements");
+         return Matrix();
+      }
+
+      for (i = 1 ; i <= count ; i++) {
+         for (k = 1 ; k <= analysis.nodes.size() ; k++) {
+            for (j = 1 ; j <= analysis.numdofs ; j++) {
+               dof = GlobalDOF (analysis.nodes [k] -> number, analysis.dofs[j]);
+               sdata(dtable, first + i - 1, (k-1)*analysis.numdofs + j) =
+                 (dof ? mdata(B, dof, i) : 0.0);
+            }
+         }
+      }
+
+      if (rtable && *rtable)
+         LoadCaseReactions (*saved, B, first, *rtable);
+   }
+
+   return dtable;
+}
+
+Matrix
+SolveStaticLoadRangeDirect(Matrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Matrix();
+
+   return LoadRangeDirectTable (K, S, Fbase, saved, rtable);
+}
+
+Matrix
+SolveStaticLoadRangeDirect(SparseMatrix &K, const Matrix &Fbase, const ConstrainedRows *saved, Matrix *rtable)
+{
+   LinearSolver	 S;
+
+   if (FactorStiffnessMatrix (K, S))
+       return Matrix();
+
+   return LoadRangeDirectTable (Matrix(), S, Fbase, saved, rtable);
+}
+
+void
+AssembleLoadCaseForce(Matrix F, LoadCase lc)
+{
+   unsigned	 active;
+   unsigned	*dofs;
+   unsigned	 i,j;
+   unsigned	 base_dof;
+   double	 force;
+
+   active   = problem.num_dofs;
+   dofs     = problem.dofs_num;
+   const unsigned *eqn = problem.equations.c_ptr1();
+   
+   for (i = 1 ; i <= lc->forces.size(); i++) {
+     
+      base_dof = active*(lc -> nodes [i] -> number - 1);
+
+      for (j = 1 ; j <= active ; j++) {
+         if (!eqn [base_dof + j])
+            continue;
+
+         force = 0.0;
+         force += lc -> forces [i] -> force[dofs[j]].value;
+/*
+         if (node[i] -> eq_force != NULL) {
+            if (node[i] -> eq_force[dofs[j]])
+               force += node[i] -> eq_force[dofs[j]];
+         }
+*/
+         sdata(F, eqn [base_dof + j], 1) = force;
+      }
+   }
+
+   return;     
+}
+
+void
+ApplyNodalDisplacements(Matrix d)
+{
+   unsigned	i, j; 
+   unsigned	base_dof;
+   unsigned	prob_dof;
+   unsigned    *dofs;
+   unsigned	active;
+
+   active = problem.num_dofs;
+   dofs = problem.dofs_pos;
+   const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   const unsigned numnodes = problem.nodes.size();
+
+   for (i = 1 ; i <= numnodes ; i++) {
+      base_dof = active*(node[i] -> number - 1);
+      prob_dof = 1;
+      for (j = 1 ; j <= 6 ; j++) {
+         if (dofs [j]) {
+            if (eqn [base_dof + prob_dof])
+               node[i] -> dx[j] = mdata(d, eqn [base_dof + prob_dof], 1);
+            else
+               node[i] -> dx[j] = 0.0;
+            prob_dof++;
+         }
+         else
+            node[i] -> dx[j] = 0.0;
+      }
+   }
+
+   return;
+}
+
+cvector1<Reaction>
+FindReactionDOF(unsigned int *old_numbers)
+{
+   return CollectReactions (old_numbers, NULL, NULL);
+}
+
+cvector1<Reaction>
+SolveForReactions(const ConstrainedRows &saved, Vector d, unsigned int *old_numbers)
+{
+   unsigned	m;
+   Matrix	P;
+
+   cvector1u rows;
+   cvector1d base;
+   cvector1<Reaction> reac = CollectReactions (old_numbers, &rows, &base);
+
+   if (reac.size() == 0) 
+      return reac;
+
+   ReactionProducts (saved, d, rows, P);
+
+   for (m = 1 ; m <= reac.size() ; m++)
+      reac [m].force = mdata(P,m,1) - base [m];
+
+   return reac;
+}
+
+cvector1<Reaction>
+SolveForReactions(Vector K, Vector d, unsigned int *old_numbers)
+{
+   ConstrainedRows	saved;
+
+   PhaseTimer timer (ReactionPhase);
+
+   SaveConstrainedRows (K, saved);
+
+   return SolveForReactions (saved, d, old_numbers);
+}
+
+int
+ElementSetup(Element element, char mass_mode)
+{
+    int		status;
+
+	/*
+	 * setup writes into an element's existing matrices, so drop any
+	 * that are still shared with other elements by the element cache
+	 */
+
+    if (element -> K && element -> K.use_count() > 1)
+       element -> K.reset();
+    if (element -> M && element -> M.use_count() > 1)
+       element -> M.reset();
+  
+    status = element -> definition -> setup (element, mass_mode, 0);
+
+    return status;
+}
+
+	/*
+	 * threads are only started when there are enough elements to
+	 * keep them busy (MinParallelElements); the element kernels keep
+	 * their scratch space per thread so any number of them can run
+	 * at once
+	 */
+
+static unsigned assembly_threads = 1;
+
+void
+SetAssemblyThreads(unsigned int n)
+{
+   assembly_threads = (n ? n : 1);
+}
+
+unsigned
+AssemblyThreads(void)
+{
+   return assembly_threads;
+}
+
+void
+ColorElements(cvector1< cvector1u > &colors)
+{
+   unsigned	i, j, k, n;
+   unsigned	c, ncolors;
+
+   const Element *element = problem.elements.c_ptr1();
+   const unsigned numelts = problem.elements.size();
+   const unsigned numnodes = problem.nodes.size();
+
+	/*
+	 * the elements around each node, in compressed lists
+	 */
+
+   cvector1u first(numnodes + 1, 0);
+   for (i = 1 ; i <= numelts ; i++)
+      for (j = 1 ; j <= element [i] -> definition -> numnodes ; j++)
+         if (element [i] -> node [j])
+            first [element [i] -> node [j] -> number] ++;
+
+   k = 1;
+   for (n = 1 ; n <= numnodes + 1 ; n++) {
+      c = first [n];
+      first [n] = k;
+      k += c;
+   }
+
+   cvector1u incident(k > 1 ? k - 1 : 1);
+   cvector1u fill(numnodes + 1);
+   for (n = 1 ; n <= numnodes + 1 ; n++)
+      fill [n] = first [n];
+
+   for (i = 1 ; i <= numelts ; i++)
+      for (j = 1 ; j <= element [i] -> definition -> numnodes ; j++)
+         if (element [i] -> node [j])
+            incident [fill [element [i] -> node [j] -> number] ++] = i;
+
+	/*
+	 * each element takes the lowest color that none of the elements
+	 * already colored around its nodes has; used [c] == i marks
+	 * color c as taken for element i
+	 */
+
+   cvector1u color(numelts, 0);
+   cvector1u used(numelts, 0);
+   ncolors = 0;
+
+   for (i = 1 ; i <= numelts ; i++) {
+      for (j = 1 ; j <= element [i] -> definition -> numnodes ; j++) {
+         if (element [i] -> node [j] == NULL) continue;
+         n = element [i] -> node [j] -> number;
+         for (k = first [n] ; k < first [n + 1] ; k++)
+            if (color [incident [k]])
+               used [color [incident [k]]] = i;
+      }
+
+      for (c = 1 ; c <= ncolors && used [c] == i ; c++)
+         ;
+
+      if (c > ncolors)
+         ncolors = c;
+
+      color [i] = c;
+   }
+
+   colors.clear();
+   colors.resize (ncolors);
+   for (i = 1 ; i <= numelts ; i++)
+      colors [color [i]].push_back (i);
+}
+
+	/*
+	 * elements are handed out from a shared counter per list; every
+	 * thread waits at the barrier before moving on to the next list.
+	 * Workers take on the problem context of the thread that started
+	 * them.
+	 */
+
+static void
+ElementWorker(ElementTask task, void *arg, const cvector1< cvector1u > *lists,
+              boost::atomic<unsigned> *next, boost::barrier *sync,
+              ProblemContext *context)
+{
+   unsigned	c, i;
+
+   SetProblemContext (context);
+
+   const Element *element = problem.elements.c_ptr1();
+
+   for (c = 1 ; c <= lists -> size() ; c++) {
+      const cvector1u &list = (*lists) [c];
+
+      while ((i = next [c].fetch_add (1)) <= list.size())
+         task (element [list [i]], list [i], arg);
+
+      sync -> wait ( );
+   }
+}
+
+void
+ForEachElement(ElementTask task, void *arg, int colored)
+{
+   unsigned	i, t;
+   unsigned	nthreads;
+
+   const Element *element = problem.elements.c_ptr1();
+   const unsigned numelts = problem.elements.size();
+
+   nthreads = assembly_threads;
+   if (nthreads <= 1 || numelts < MinParallelElements) {
+      for (i = 1 ; i <= numelts ; i++)
+         task (element [i], i, arg);
+
+      return;
+   }
+
+   cvector1< cvector1u > lists;
+   if (colored)
+      ColorElements (lists);
+   else {
+      lists.resize (1);
+      lists [1].resize (numelts);
+      for (i = 1 ; i <= numelts ; i++)
+         lists [1][i] = i;
+   }
+
+   boost::scoped_array< boost::atomic<unsigned> > next (new boost::atomic<unsigned> [lists.size() + 1]);
+   for (i = 1 ; i <= lists.size() ; i++)
+      next [i].store (1);
+
+   boost::barrier sync (nthreads);
+   boost::thread_group pool;
+   for (t = 1 ; t < nthreads ; t++)
+      pool.create_thread (boost::bind (ElementWorker, task, arg, &lists, next.get(), &sync, current_context));
+
+   ElementWorker (task, arg, &lists, next.get(), &sync, current_context);
+   pool.join_all ( );
+}
+
+	/*
+	 * the setup pass only writes to the element itself.  Errors are
+	 * counted atomically; error() itself may be called from several
+	 * threads at once but each message goes out in one piece.
+	 */
+
+struct SetupPass {
+   char				mass_mode;
+   int				need_mass;
+   boost::atomic<int>		errors;
+   const unsigned		*share;
+   char				*failed;
+};
+
+static void
+SetupTask(Element element, unsigned i, void *arg)
+{
+   SetupPass	*pass = (SetupPass *) arg;
+   unsigned	ndofs,
+		nodes;
+   int		err;
+   int		count;
+
+	/*
+	 * an element that shares the matrices of an earlier element
+	 * gets them once that element has been set up
+	 */
+
+   if (pass -> share && pass -> share [i] != i)
+      return;
+
+   err = ElementSetup (element, pass -> mass_mode);
+   count = 0;
+
+   if (pass -> need_mass && !element -> M) {
+      error ("mass matrix not defined for element %d", element -> number);
+      count ++;
+   }
+
+   ndofs = element -> definition -> numdofs;
+   nodes = element -> definition -> numnodes;
+
+   if (err)
+      count += err;
+   else if (!pass -> need_mass) {
+      if (!element -> K || !IsSquare(element -> K) || 
+          Mrows(element -> K) > ndofs*nodes) {
+
+         error ("%s element %d has an invalid stiffness matrix",
+                element -> definition -> name.c_str(), element -> number);
+
+         count ++;
+      }
+   }
+   else if (!element -> K || !element -> M ||
+            !IsSquare(element -> K) || !IsSquare(element -> M) ||
+            Mrows(element -> K) != Mrows(element -> M) ||
+            Mrows(element -> K) > ndofs*nodes) {
+
+      error ("invalid element matrices setup for %s element %d",
+             element -> definition -> name.c_str(), element -> number);
+
+      count ++;
+   }
+
+   if (count) {
+      pass -> errors += count;
+      if (pass -> failed)
+         pass -> failed [i] = 1;
+   }
+}
+
+	/*
+	 * an element can take the matrices of another element if its
+	 * definition says that they depend only on the material and the
+	 * positions of the nodes relative to each other, and nothing
+	 * else (a distributed load or a hinge) goes into its setup
+	 */
+
+static int
+ShareableElement(const Element &element)
+{
+   unsigned	j, k;
+
+   if (!element -> definition -> shareK || element -> numdistributed)
+      return 0;
+
+   for (j = 1 ; j <= element -> definition -> numnodes ; j++) {
+      if (element -> node [j] == NULL)
+         return 0;
+
+      for (k = 1 ; k <= 6 ; k++)
+         if (element -> node [j] -> constraint -> constraint [k] == 'h')
+            return 0;
    }
 
-   return 0;
+   return 1;
 }
 
-Vector
-SolveForDisplacements(Vector &K, Vector &F)
+struct ElementKeys {
+   const Element	*element;
+   const unsigned	*first;
+   const long long	*key;
+};
+
+static int
+CompareElementKeys(const ElementKeys &keys, unsigned a, unsigned b)
 {
-   if (FactorStiffnessMatrix (K))
-       return Vector();
+   unsigned	k, len;
 
-   if (CroutBackSolveMatrix (K, F)) {
-      error ("could not back substitute for nodal displacements");
-      return Vector();
-   }
+   const Element &ea = keys.element [a];
+   const Element &eb = keys.element [b];
 
-   ApplyNodalDisplacements (F);
+   if (ea -> definition != eb -> definition)
+      return ea -> definition < eb -> definition ? -1 : 1;
+   if (ea -> material != eb -> material)
+      return ea -> material < eb -> material ? -1 : 1;
 
-   return F;
+   len = 3*(ea -> definition -> numnodes - 1);
+   for (k = 0 ; k < len ; k++)
+      if (keys.key [keys.first [a] + k] != keys.key [keys.first [b] + k])
+         return keys.key [keys.first [a] + k] < keys.key [keys.first [b] + k] ? -1 : 1;
+
+   return 0;
 }
- 
-Matrix
-SolveStaticLoadCases(Matrix &K, const Matrix &Fbase)
+
+struct ElementKeyLess {
+   const ElementKeys	*keys;
+   bool operator() (unsigned a, unsigned b) const {
+      int c = CompareElementKeys (*keys, a, b);
+      return c ? c < 0 : a < b;
+   }
+};
+
+	/*
+	 * share [i] is set to the first element that element i is
+	 * identical to (or i itself).  Node coordinates relative to the
+	 * first node are compared to within a millionth of the size of
+	 * the smallest element, which is finer than the precision that
+	 * coordinates are written to problem files with.  Returns the
+	 * number of elements that can share; lookups gets the number of
+	 * elements that were eligible.
+	 */
+
+static unsigned
+GroupIdenticalElements(cvector1u &share, unsigned *lookups)
 {
-   unsigned	 i,j,k;
-   Matrix	 dtable;
-   Matrix	 F;
-   LoadCase	 lc;
+   unsigned	i, j, n;
+   unsigned	numnodes;
+   unsigned	hits;
+   double	dx, size, smallest;
+   double	quantum;
+   ElementKeys	keys;
+   ElementKeyLess less;
 
-   if (FactorStiffnessMatrix (K))
-       return Matrix();
+   const unsigned numelts = problem.elements.size();
+   const Element *element = problem.elements.c_ptr1();
 
-   F = CreateColumnVector (Mrows(Fbase));
+   share.resize (numelts);
+   cvector1u first(numelts, 0);
+   std::vector<unsigned> order;
+   std::vector<long long> key;
 
-   cvector1i mask     = BuildConstraintMask ( );
+   smallest = 0.0;
+   for (i = 1 ; i <= numelts ; i++) {
+      share [i] = i;
+      if (!ShareableElement (element [i]))
+         continue;
 
-   dtable = CreateFullMatrix (problem.loadcases.size(), 
-                              analysis.nodes.size() * analysis.numdofs);
+      numnodes = element [i] -> definition -> numnodes;
+      size = 0.0;
+      for (j = 2 ; j <= numnodes ; j++) {
+         dx = fabs (element [i] -> node [j] -> x - element [i] -> node [1] -> x);
+         size = std::max (size, dx);
+         dx = fabs (element [i] -> node [j] -> y - element [i] -> node [1] -> y);
+         size = std::max (size, dx);
+         dx = fabs (element [i] -> node [j] -> z - element [i] -> node [1] -> z);
+         size = std::max (size, dx);
+      }
 
-   for (i = 1 ; i <= problem.loadcases.size() ; i++) {
-      lc = problem.loadcases [i];
+      if (size == 0.0)
+         continue;
 
-      ZeroMatrix (F);
-      AssembleLoadCaseForce (F, lc); 
+      if (smallest == 0.0 || size < smallest)
+         smallest = size;
 
-	/*
-	 * Fbase already contains everything we need to know
-	 * about displacment BC so all we need to do is to
- 	 * make sure that we add _nothing_ at all into the
- 	 * force vector at any constrained DOF
-	 */
+      order.push_back (i);
+   }
 
-      for (j = 1 ; j <= Mrows(F) ; j++)
-         sdata(F, j, 1) = (mask [j] ? 0.0 :  mdata(F,j,1));
+   *lookups = order.size();
+   if (order.size() < 2)
+      return 0;
 
-      AddMatrices (F, F, Fbase);
+   quantum = 1e-6*smallest;
 
-      if (CroutBackSolveMatrix (K, F)) {
-          error ("could not back substitute for displacements in loadcase %s",
-                 lc->name.c_str());
-          return Matrix();
+   for (n = 0 ; n < order.size() ; n++) {
+      i = order [n];
+      numnodes = element [i] -> definition -> numnodes;
+      first [i] = key.size();
+
+      for (j = 2 ; j <= numnodes ; j++) {
+         key.push_back (llround ((element [i] -> node [j] -> x - element [i] -> node [1] -> x)/quantum));
+         key.push_back (llround ((element [i] -> node [j] -> y - element [i] -> node [1] -> y)/quantum));
+         key.push_back (llround ((element [i] -> node [j] -> z - element [i] -> node [1] -> z)/quantum));
       }
+   }
 
-      for (k = 1 ; k <= analysis.nodes.size() ; k++) {
-         for (j = 1 ; j <= analysis.numdofs ; j++) {
-            sdata(dtable, i, (k-1)*analysis.numdofs + j) =
-              mdata(F, GlobalDOF (analysis.nodes [k] -> number, analysis.dofs[j]), 1);
-         }
+   keys.element = element;
+   keys.first = first.c_ptr1();
+   keys.key = &key [0];
+   less.keys = &keys;
+
+   std::sort (order.begin(), order.end(), less);
+
+   hits = 0;
+   for (n = 1, j = order [0] ; n < order.size() ; n++) {
+      i = order [n];
+      if (CompareElementKeys (keys, i, j) == 0) {
+         share [i] = j;
+         hits ++;
       }
+      else
+         j = i;
    }
 
-   return dtable;
+   return hits;
 }
 
-Matrix
-SolveStaticLoadRange(Matrix &K, const Matrix &Fbase)
+static int element_cache = 0;
+
+void
+SetElementCache(int flag)
 {
-   unsigned	 i,j,k;
-   Matrix	 dtable;
-   unsigned	 num_cases;
-   double	 force;
-   unsigned	 input_pos;
-   Matrix	 F;
+   element_cache = flag;
+}
 
-   if (FactorStiffnessMatrix (K))
-       return Matrix();
+int
+ElementCache(void)
+{
+   return element_cache;
+}
 
-   cvector1i mask     = BuildConstraintMask ( );
+int
+SetupElements(char mass_mode, int need_mass)
+{
+   SetupPass	pass;
+   unsigned	i, j;
+   unsigned	hits, lookups;
 
-   num_cases = (fabs(analysis.stop - analysis.start) + 0.5*fabs(analysis.step)) 
-               / fabs(analysis.step) + 1;
+   const unsigned numelts = problem.elements.size();
+   const Element *element = problem.elements.c_ptr1();
 
-   dtable = CreateFullMatrix (num_cases, analysis.nodes.size() * analysis.numdofs);
-   
-   input_pos = GlobalDOF (analysis.input_node -> number, analysis.input_dof);
+   PhaseTimer timer (SetupPhase);
 
-   F = CreateColumnVector (Mrows(Fbase));
+   pass.mass_mode = mass_mode;
+   pass.need_mass = need_mass;
+   pass.errors.store (0);
+   pass.share = NULL;
+   pass.failed = NULL;
 
-   for (i = 1 ; i <= num_cases ; i++) {
+   if (!element_cache) {
+      ForEachElement (SetupTask, &pass, 0);
+      return pass.errors.load ( );
+   }
 
-      force = analysis.start + (i - 1)*analysis.step;
+   cvector1u share;
+   cvector1c failed(numelts, 0);
 
-      CopyMatrix (F, Fbase);
-    
-      if (!mask [input_pos]) 
-         sdata(F, input_pos, 1) = mdata(F,input_pos,1) + force;
- 
-      if (CroutBackSolveMatrix (K, F)) {
-         error ("could not back substitute for displacements");
-         return Matrix();
-      }
+   hits = GroupIdenticalElements (share, &lookups);
 
-      for (k = 1 ; k <= analysis.nodes.size() ; k++) {
-         for (j = 1 ; j <= analysis.numdofs ; j++) {
-            sdata(dtable, i, (k-1)*analysis.numdofs + j) =
-              mdata(F, GlobalDOF (analysis.nodes [k] -> number, analysis.dofs[j]), 1);
-         }
+   pass.share = share.c_ptr1();
+   pass.failed = failed.c_ptr1();
+   ForEachElement (SetupTask, &pass, 0);
+
+	/*
+	 * now hand the matrices out.  If an element could not be set up
+	 * the elements that would have shared with it are set up on their
+	 * own so that each reports its own errors.
+	 */
+
+   pass.share = NULL;
+   for (i = 1 ; i <= numelts ; i++) {
+      j = share [i];
+      if (j == i)
+         continue;
+
+      if (failed [j]) {
+         SetupTask (element [i], i, &pass);
+         continue;
       }
+
+      element [i] -> K = element [j] -> K;
+      if (mass_mode)
+         element [i] -> M = element [j] -> M;
    }
 
-   return dtable;
+   detail ("element cache: %u of %u elements shared matrices (%.1f%% hit rate)",
+           hits, numelts, lookups ? 100.0*hits/lookups : 0.0);
+   ProfileSet (SharedCounter, hits);
+
+   return pass.errors.load ( );
 }
 
-void
-AssembleLoadCaseForce(Matrix F, LoadCase lc)
+	/*
+	 * the topology of a problem as far as assembly is concerned: the
+	 * active DOF and, for each element, its DOF and node numbers
+	 */
+
+static void
+TopologySignature(cvector1u &sig)
 {
-   unsigned	 active;
-   unsigned	*dofs;
-   unsigned	 i,j;
-   unsigned	 base_dof;
-   double	 force;
+   unsigned	i, j, l;
+   unsigned	code;
 
-   active   = problem.num_dofs;
-   dofs     = problem.dofs_num;
-   
-   for (i = 1 ; i <= lc->forces.size(); i++) {
-     
-      base_dof = active*(lc -> nodes [i] -> number - 1);
+   const Element *element = problem.elements.c_ptr1();
+   const unsigned numelts = problem.elements.size();
 
-      for (j = 1 ; j <= active ; j++) {
-         force = 0.0;
-         force += lc -> forces [i] -> force[dofs[j]].value;
-/*
-         if (node[i] -> eq_force != NULL) {
-            if (node[i] -> eq_force[dofs[j]])
-               force += node[i] -> eq_force[dofs[j]];
-         }
-*/
-         sdata(F, base_dof + j, 1) = force;
-      }
+   sig.clear();
+   sig.push_back (problem.num_dofs);
+   for (l = 1 ; l <= 6 ; l++)
+      sig.push_back (problem.dofs_pos [l]);
+
+   sig.push_back (numelts);
+   for (i = 1 ; i <= numelts ; i++) {
+      code = element [i] -> definition -> numdofs;
+      for (l = 1 ; l <= element [i] -> definition -> numdofs ; l++)
+         code = code*8 + element [i] -> definition -> dofs [l];
+
+      sig.push_back (code);
+      sig.push_back (element [i] -> definition -> numnodes);
+      for (j = 1 ; j <= element [i] -> definition -> numnodes ; j++)
+         sig.push_back (element [i] -> node [j] ? element [i] -> node [j] -> number : 0);
    }
+}
 
-   return;     
+static int
+SameVector(const cvector1u &a, const unsigned *b, unsigned n)
+{
+   return a.size() == n && (n == 0 || std::equal (a.c_ptr(), a.c_ptr() + n, b));
 }
 
-void
-ApplyNodalDisplacements(Matrix d)
+	/*
+	 * the element loops of the assembly passes, done once; entries
+	 * below the diagonal and outside the global storage are left out
+	 */
+
+template <class Address>
+static void
+BuildScatterMap(ScatterMap &map, Address &address)
 {
-   unsigned	i, j; 
-   unsigned	base_dof;
-   unsigned	prob_dof;
-   unsigned    *dofs;
-   unsigned	active;
+   unsigned	row,
+		col,
+		i,
+		j,
+		l,
+		k,
+		m;
+   unsigned	ndofs,
+		nodes,
+		size;
+   unsigned	base_row,
+		base_col;
+   unsigned	a;
 
-   active = problem.num_dofs;
-   dofs = problem.dofs_pos;
-   const Node *node = problem.nodes.c_ptr1();
-   const unsigned numnodes = problem.nodes.size();
+   const Element *element = problem.elements.c_ptr1();
+   const unsigned numelts = problem.elements.size();
+   const unsigned active = problem.num_dofs;
+   const unsigned *dofs = problem.dofs_pos;
+   const unsigned *eqn = problem.equations.c_ptr1();
 
-   for (i = 1 ; i <= numnodes ; i++) {
-      base_dof = active*(node[i] -> number - 1);
-      prob_dof = 1;
-      for (j = 1 ; j <= 6 ; j++) {
-         if (dofs [j]) {
-            node[i] -> dx[j] = mdata(d, base_dof + prob_dof, 1);
-            prob_dof++;
+   map.first.resize (numelts + 1);
+   map.rfirst.resize (numelts + 1);
+   map.entry.clear();
+   map.address.clear();
+   map.rentry.clear();
+   map.row.clear();
+
+   for (i = 1 ; i <= numelts ; i++) {
+      map.first [i] = map.entry.size() + 1;
+      map.rfirst [i] = map.rentry.size() + 1;
+
+      ndofs = element [i] -> definition -> numdofs;
+      nodes = element [i] -> definition -> numnodes;
+      size = ndofs*nodes;
+
+      for (j = 1 ; j <= nodes ; j++) {
+         if (element [i] -> node[j] == NULL) continue;
+         base_row = (element [i] -> node[j] -> number - 1)*active;
+
+         for (l = 1 ; l <= ndofs ; l++) {
+            row = eqn [base_row + dofs[element [i] -> definition -> dofs[l]]];
+            map.rentry.push_back ((j-1)*ndofs + l);
+            map.row.push_back (row);
+
+            for (k = 1 ; k <= nodes ; k++) {
+               if (element [i] -> node[k] == NULL) continue;
+               base_col = (element [i] -> node[k] -> number - 1)*active;
+
+               for (m = 1 ; m <= ndofs ; m++) {
+                  col = eqn [base_col + dofs[element [i] -> definition -> dofs[m]]];
+                  if (row > col)
+                     continue;
+
+                  a = address (row, col);
+                  if (a) {
+                     map.entry.push_back (((j-1)*ndofs + l - 1)*size + (k-1)*ndofs + m);
+                     map.address.push_back (a);
+                  }
+               }
+            }
          }
-         else
-            node[i] -> dx[j] = 0.0;
       }
    }
 
-   return;
+   map.first [numelts + 1] = map.entry.size() + 1;
+   map.rfirst [numelts + 1] = map.rentry.size() + 1;
 }
 
-cvector1<Reaction>
-SolveForReactions(Vector K, Vector d, unsigned int *old_numbers)
+struct CompactAddress {
+   const Matrix &K;
+   CompactAddress(const Matrix &K) : K(K) { }
+   unsigned operator() (unsigned row, unsigned col)
+      { return ConvertRowColumn (row, col, K); }
+};
+
+struct SparseStructureAddress {
+   const SparseMatrix &K;
+   SparseStructureAddress(const SparseMatrix &K) : K(K) { }
+   unsigned operator() (unsigned row, unsigned col)
+      { return SparseAddress (row, col, K); }
+};
+
+const ScatterMap &
+CompactScatterMap(const Matrix &K)
 {
-   unsigned	active,
-		*dofs;
-   unsigned	i,j,k,m,
-		affected_dof,
-		base_dof,
-		num_reactions;
-   unsigned	size;
-   unsigned	address;
-   double	sum;
+   static thread_local ScatterMap map;
+   cvector1u		topology;
 
-   const Node *node = problem.nodes.c_ptr1();
-   const unsigned numnodes = problem.nodes.size();
-   active = problem.num_dofs;
-   dofs = problem.dofs_num;
-
-   size = active * numnodes;
-
-	/*
-	 * find the number of reactions and allocate some space for them
-	 */
+   TopologySignature (topology);
 
-   num_reactions = 0; 
-   cvector1<Reaction> reac(0);
-   
-   for (i = 1 ; i <= numnodes ; i++) {
-      for (j = 1 ; j <= active ; j++) {
-         if (node[i] -> constraint -> constraint[dofs[j]] == 1) 
-            num_reactions++; 
-      }
-   }
+   if (SameVector (map.topology, topology.c_ptr1() + 1, topology.size()) &&
+       SameVector (map.structure, K -> diag.c_ptr1() + 1, K -> diag.size()))
+      return map;
 
-   if (num_reactions == 0) 
-      return reac;
+   CompactAddress address (K);
+   BuildScatterMap (map, address);
+   map.topology = topology;
+   map.structure = K -> diag;
 
-   reac.resize(num_reactions);
+   return map;
+}
 
-   m = 1;
-   for (i = 1 ; i <= numnodes ; i++) {
+const ScatterMap &
+SparseScatterMap(const SparseMatrix &K)
+{
+   static thread_local ScatterMap map;
+   cvector1u		topology;
+   unsigned		n;
 
-      base_dof = active*(node[i] -> number - 1);
+   const unsigned ncol = K -> colptr.size();
+   const unsigned nrow = K -> rowind.size();
 
-      for (j = 1 ; j <= active ; j++) {
-         if (node[i] -> constraint -> constraint[dofs[j]] == 1) {
-            sum = 0;
-            affected_dof = base_dof + j;
-
-            for (k = 1 ; k <= size ; k++) {
-               address = ConvertRowColumn (affected_dof, k, K);
-               if (address)
-                   sum += VectorData (K) [address]*VectorData (d) [k];
-            }
+   TopologySignature (topology);
 
-            if (old_numbers == NULL)
-                reac[m].node = node[i] -> number;
-            else
-                reac[m].node = old_numbers [i];
+	/*
+	 * the structure is kept as the column pointers followed by
+	 * the row indices
+	 */
 
-            reac[m].dof = dofs[j];
-            if (!node[i]->eq_force.empty())
-               sum -= node [i] -> eq_force [dofs[j]];
+   if (SameVector (map.topology, topology.c_ptr1() + 1, topology.size()) &&
+       map.structure.size() == ncol + nrow &&
+       std::equal (K -> colptr.c_ptr1() + 1, K -> colptr.c_ptr1() + 1 + ncol, map.structure.c_ptr1() + 1) &&
+       std::equal (K -> rowind.c_ptr1() + 1, K -> rowind.c_ptr1() + 1 + nrow, map.structure.c_ptr1() + 1 + ncol))
+      return map;
 
-            reac[m++].force = sum; 
-         }
-      }
-   }
+   SparseStructureAddress address (K);
+   BuildScatterMap (map, address);
+   map.topology = topology;
+   map.structure = K -> colptr;
+   for (n = 1 ; n <= nrow ; n++)
+      map.structure.push_back (K -> rowind [n]);
 
-   return reac;
+   return map;
 }
 
-int
-ElementSetup(Element element, char mass_mode)
+	/*
+	 * element stresses are also accumulated on the nodes, so they
+	 * are computed one color at a time
+	 */
+
+static void
+StressTask(Element element, unsigned, void *arg)
 {
-    int		status;
-  
-    status = element -> definition -> setup (element, mass_mode, 0);
+   boost::atomic<int>	*status = (boost::atomic<int> *) arg;
 
-    return status;
+   *status += element -> definition -> stress (element);
 }
 
 int
 ElementStresses(void)
 {
-    const Element *e = problem.elements.c_ptr1();
-    const unsigned ne = problem.elements.size();
     const Node *n = problem.nodes.c_ptr1();
     const unsigned nn = problem.nodes.size();
     
-    int status = 0;
+    boost::atomic<int> status (0);
+
+    PhaseTimer timer (StressPhase);
 
-    for (size_t i = 1 ; i <= ne ; i++)
-	status += e [i] -> definition -> stress (e [i]);
+    ForEachElement (StressTask, &status, 1);
 
 	/*
 	 * compute the nodally averaged stresses
@@ -872,7 +2704,7 @@ ElementStresses(void)
        }
     }
 
-    return status;
+    return status.load ( );
 }
 
 int
@@ -989,6 +2821,39 @@ CheckAnalysisParameters(AnalysisType mode)
          count++;
       }
 
+      if (analysis.error_tolerance < 0) {
+         error ("error tolerance cannot be negative for transient analysis");
+         count++;
+      }
+
+      break;
+
+   case TransientExplicit:
+      if (analysis.mass_mode != 'l') {
+         error ("mass-mode must be lumped for explicit transient analysis");
+         count++;
+      }
+
+      if (analysis.nodes.empty()) {
+          error ("need to specify a node list for transient analysis");
+          count++;
+      }
+
+      if (analysis.numdofs == 0) {
+         error ("need to specify a list of DOFs for transient analysis");
+         count++;
+      }
+
+      if (analysis.stop <= 0) {
+         error ("duration needs to be greater than zero for transient analysis");
+         count++;
+      }
+
+      if (analysis.step < 0) {
+         error ("time step cannot be negative for transient analysis");
+         count++;
+      }
+
       break;
 
    case Spectral:
@@ -1065,7 +2930,7 @@ GlobalDOF(unsigned int node, unsigned int dx)
    if (!problem.dofs_pos [dx]) 
       return 0;
 
-   return problem.num_dofs*(node - 1) + problem.dofs_pos [dx];
+   return problem.equations [problem.num_dofs*(node - 1) + problem.dofs_pos [dx]];
 }
 
 void 
@@ -1073,12 +2938,14 @@ LocalDOF(unsigned int global_dof, unsigned int *node, unsigned int *local_dof)
 {
    unsigned	i;
    unsigned	active;
+   unsigned	slot;
 
    active = problem.num_dofs;
-   i = (global_dof - 1) % active + 1;
+   slot = problem.eq_slots [global_dof];
+   i = (slot - 1) % active + 1;
 
    *local_dof = problem.dofs_num [i];
-   *node = (global_dof - i) / active + 1;
+   *node = (slot - i) / active + 1;
 
    return;
 }
@@ -1092,6 +2959,7 @@ FindForcedDOF()
    unsigned	n;
 
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    active   = problem.num_dofs;
    const unsigned numnodes = problem.nodes.size();
    dofs     = problem.dofs_num;
@@ -1104,7 +2972,7 @@ FindForcedDOF()
    n = 0;
    for (i = 1 ; i <= numnodes ; i++) {
       for (j = 1 ; j <= active ; j++) {
-         if (node [i] -> force != NULL)
+         if (node [i] -> force != NULL && eqn [active*(node [i] -> number - 1) + j])
             if (node [i] -> force -> force [dofs[j]].value || 
                 node [i] -> force -> force [dofs[j]].expr ||
                 node [i] -> force -> spectrum [dofs[j]].value ||
@@ -1121,7 +2989,7 @@ FindForcedDOF()
       n = 1;
       for (i = 1 ; i <= numnodes ; i++) {
          for (j = 1 ; j <= active ; j++) {
-            if (node [i] -> force != NULL) {
+            if (node [i] -> force != NULL && eqn [active*(node [i] -> number - 1) + j]) {
                if (node [i] -> force -> force [dofs[j]].value || 
                    node [i] -> force -> force [dofs[j]].expr ||
                    node [i] -> force -> spectrum [dofs[j]].value ||
@@ -1155,10 +3023,11 @@ RemoveConstrainedMatrixDOF(Matrix a)
 
    const unsigned numnodes = problem.nodes.size();
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    active   = problem.num_dofs;
    dofs     = problem.dofs_num;
    
-   orig_dofs = numnodes * active;
+   orig_dofs = problem.num_equations;
    j = 0;  /* gcc -Wall */
 
    cvector1c dof_map(orig_dofs, 1);
@@ -1175,8 +3044,8 @@ RemoveConstrainedMatrixDOF(Matrix a)
       base_dof = active*(node[i] -> number - 1);
       for (j = 1 ; j <= active ; j++) {
 
-         if (node [i] -> constraint -> constraint [dofs[j]]) {
-            affected_dof = base_dof + j;
+         if (node [i] -> constraint -> constraint [dofs[j]] && eqn [base_dof + j]) {
+            affected_dof = eqn [base_dof + j];
             dof_map [affected_dof] = 0; 
             new_dofs --;
 
@@ -1229,7 +3098,7 @@ RemoveConstrainedMatrixDOF(Matrix a)
                affected_dof = i - height  + 1 + (j - start);             
 
                if (dof_map [affected_dof]) {
-                  b -> data [m][1] = a -> data [j][1];
+                  CompactData (b) [m] = CompactData (a) [j];
                   m++; 
                }
             }
@@ -1285,24 +3154,34 @@ ZeroConstrainedMatrixDOF(Matrix &b, const Matrix &a)
    if (Mrows(a) != Mrows(b) || Mcols(a) != Mcols(b))
       return M_SIZEMISMATCH;
 
+   PhaseTimer timer (ConstraintPhase);
+
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    active = problem.num_dofs;
    dofs = problem.dofs_num;
 
    if (b != a)
       CopyMatrix (b, a);
 
+	/*
+	 * a compact matrix gets the single masked sweep in ApplyConstraints
+	 */
+
+   if (IsCompact(b)) {
+      ApplyConstraints (b, Matrix(), NULL);
+      return 0;
+   }
+
    for (i = 1 ; i <= problem.nodes.size(); i++) {
 
       base_dof = active*(node[i] -> number - 1);
 
       for (j = 1 ; j <= active ; j++) {
-         if (node[i] -> constraint -> constraint[dofs[j]]) {
-            affected_dof = base_dof + j;
+         if (node[i] -> constraint -> constraint[dofs[j]] && eqn [base_dof + j]) {
+            affected_dof = eqn [base_dof + j];
 
-            if (IsCompact(b))
-               b = ZeroCompactRowCol (b, affected_dof);
-            else if (IsColumnVector(b))
+            if (IsColumnVector(b))
                sdata(b, affected_dof, 1) = 0.0;
             else
                b = ZeroRowCol (b, affected_dof); 
@@ -80,15 +80,15 @@
 # define PrintNewline(fp) \
 	if (this_line) {fprintf (fp, "\n"); this_line = 0;}
 
-static int     printed_header;
-static int     this_line;
-static int     this_section;
-static int     last_section;
+static thread_local int     printed_header;
+static thread_local int     this_line;
+static thread_local int     this_section;
+static thread_local int     last_section;
 
-static char   *mark_flag;
-static FILE   *fp;
-static Node    prev_node;
-static Element prev_element;
+static thread_local char   *mark_flag;
+static thread_local FILE   *fp;
+static thread_local Node    prev_node;
+static thread_local Element prev_element;
 
 
 /************************************************************************
@@ -100,7 +100,7 @@ static Element prev_element;
 static const char*
 ConstraintSymbol(Constraint constraint, DOF dof)
 {
-    static char buffer [32];
+    static thread_local char buffer [32];
 
 
     if (constraint -> constraint [dof] == 0)
@@ -128,7 +128,7 @@ Quote(const char *s)
 {
     char	c;
     char       *ptr;
-    static char buffer [256];
+    static thread_local char buffer [256];
 
     if (s == NULL || strcmp (s, "") == 0) {
         strcpy(buffer, "\"\"");
@@ -518,6 +518,12 @@ WriteAnalysisParameters(void)
         fprintf (fp, "relaxation=%g\n", analysis.relaxation); 
     }
 
+    if (analysis.modes)
+        fprintf (fp, "modes=%d\n", analysis.modes);
+
+    if (analysis.error_tolerance)
+        fprintf (fp, "error-tolerance=%g\n", analysis.error_tolerance);
+
     if (analysis.input_dof || analysis.input_node) {
         fprintf (fp,"input-node=%d ", analysis.input_node -> number);
         fprintf (fp,"input-dof=%s\n", dof_symbols [(int) analysis.input_dof]);
@@ -528,6 +534,18 @@ WriteAnalysisParameters(void)
     else if (analysis.mass_mode == 'c')
 	fprintf (fp, "mass-mode=consistent\n");
 
+    if (analysis.solver == 's')
+	fprintf (fp, "solver=sparse\n");
+    else if (analysis.solver == 'c')
+	fprintf (fp, "solver=pcg\n");
+
+    if (analysis.preconditioner == 'j')
+	fprintf (fp, "preconditioner=jacobi\n");
+    else if (analysis.preconditioner == 's')
+	fprintf (fp, "preconditioner=ssor\n");
+    else if (analysis.preconditioner == 'i')
+	fprintf (fp, "preconditioner=incomplete-cholesky\n");
+
     if (!analysis.nodes.empty()) {
         fprintf (fp, "nodes=[");
         for (i = 1; i <= analysis.nodes.size(); i ++)
@@ -695,7 +713,8 @@ WriteFile(char *flag)
                                        "spectral","static-substitution",
                                        "static-incremental","static","static",
                                        "static-substitution",
-                                       "static-incremental"};
+                                       "static-incremental",
+                                       "transient-explicit"};
 
 
     /* Write the problem description section. */
@@ -31,7 +31,9 @@
 # include "fe.h"
 # include "error.h"
 # include "problem.h"
+# include "profile.h"
 # include "cvector1.hpp"
+# include "transient.hpp"
 
 /****************************************************************************
  *
@@ -78,6 +80,32 @@ ComputeEigenModes(const Matrix &K, const Matrix &M, Matrix &lambda_r, Matrix &x_
    Matrix	lambda;
    int		singular;
 
+   PhaseTimer timer (EigenPhase);
+
+	/*
+	 * when only the lowest few modes are wanted, Lanczos works on
+	 * the skyline matrices directly instead of the dense n by n
+	 * transformed problem
+	 */
+
+   if (analysis.modes && analysis.modes < Mrows(M) && IsCompact(K) && IsCompact(M)) {
+      lambda = CreateColumnVector (analysis.modes);
+      x_orig = CreateMatrix (Mrows(M), analysis.modes);
+
+      status = LanczosEigenModes (K, M, lambda, x_orig, analysis.tolerance, analysis.iterations);
+      if (status)
+         return status;
+
+      status = SqrtMatrix (lambda, lambda);
+      if (status)
+         return status;
+
+      x_r = x_orig;
+      lambda_r = lambda;
+
+      return 0;
+   }
+
    Q    = CreateMatrix (Mrows(M), Mcols(M));
    A    = CreateMatrix (Mrows(M), Mcols(M));
    p    = CreateColumnVector (Mrows(M));
@@ -144,18 +172,47 @@ ComputeEigenModes(const Matrix &K, const Matrix &M, Matrix &lambda_r, Matrix &x_
    return 0;
 }
 
+int
+ComputeEigenModes(const SparseMatrix &K, const SparseMatrix &M, Matrix &lambda_r, Matrix &x_r)
+{
+   int		status;
+   Matrix	lambda;
+   Matrix	x;
+
+   if (!analysis.modes || analysis.modes >= Mcols(M))
+      return ComputeEigenModes (MakeCompactFromSparse (K), MakeCompactFromSparse (M),
+                                lambda_r, x_r);
+
+   PhaseTimer timer (EigenPhase);
+
+   lambda = CreateColumnVector (analysis.modes);
+   x = CreateMatrix (Mcols(M), analysis.modes);
+
+   status = LanczosEigenModes (K, M, lambda, x, analysis.tolerance, analysis.iterations);
+   if (status)
+      return status;
+
+   status = SqrtMatrix (lambda, lambda);
+   if (status)
+      return status;
+
+   x_r = x;
+   lambda_r = lambda;
+
+   return 0;
+}
+
 Matrix
 ModalNodalDisplacements(Matrix x)
 {
    unsigned	*dofs;
    unsigned	numdofs;
    unsigned	i, m, n;
+   unsigned	eq;
    unsigned	nummodes;
    unsigned	count;
    unsigned	numtrans;
-   unsigned	numrot;
    unsigned	trans_dofs [4];
-   unsigned	rot_dofs [4];
    Matrix	d;
 
    const Node *node = problem.nodes.c_ptr1();
@@ -164,12 +221,9 @@ ModalNodalDisplacements(Matrix x)
    numdofs  = problem.num_dofs;
 
    numtrans = 0;
-   numrot = 0;
    for (i = 1 ; i <= 3 ; i++) {
       if (dofs [i]) 
          trans_dofs [++ numtrans] = i;
-      if (dofs [i+3])
-         rot_dofs [++numrot] = i+3;
    }
  
 
@@ -178,22 +232,29 @@ ModalNodalDisplacements(Matrix x)
 
    nummodes = Mcols(x);
 
+	/*
+	 * the rows of x are the equations that are left once the
+	 * constrained ones are removed
+	 */
+
+   cvector1i mask = BuildConstraintMask ( );
+   cvector1u row(problem.num_equations, 0);
+
+   count = 0;
+   for (i = 1 ; i <= problem.num_equations ; i++)
+      if (!mask [i])
+         row [i] = ++count;
+
    d = CreateMatrix (nummodes, numnodes*numtrans); 
 
    for (m = 1 ; m <= nummodes ; m++) {
-      count = 1;
       for (n = 1 ; n <= numnodes ; n++) {
          for (i = 1 ; i <= numtrans ; i++) {
-            if (node [n] -> constraint -> constraint [trans_dofs [i]])
+            eq = problem.equations [(node [n] -> number - 1)*numdofs + dofs [trans_dofs [i]]];
+            if (eq && row [eq])
+               sdata(d, m, (n-1)*numtrans+i) = mdata(x,row [eq],m);
+            else
                sdata(d, m, (n-1)*numtrans+i) = 0.0;
-            else {
-               sdata(d, m, (n-1)*numtrans+i) = mdata(x,count,m);
-               count ++;
-            }
-         }
-         for (i = 1 ; i <= numrot ; i++) {
-            if (!node [n] -> constraint -> constraint [rot_dofs [i]])
-               count++;
          }
       }
    }
@@ -205,27 +266,34 @@ static void
 MultiplyUTmU(Matrix M, Matrix u, Matrix m)
 {
    Matrix	temp;
+   Matrix	uj;
    double	result;
-   unsigned	i,j,k;
+   unsigned	i,j;
    unsigned	n;
 
    n = Mrows(u);
 
-   temp = CreateColumnVector (Mrows(m));
+   temp = CreateColumnVector (n);
+   uj = CreateColumnVector (n);
 
-   for (j = 1 ; j <= n ; j++) {
-      for (i = 1 ; i <= n ; i++) {
+	/*
+	 * one mode (column of u) at a time: temp = m*u_j, then u_j^T*temp
+	 */
 
-         sdata(temp, i, 1) = 0;
-         for (k = 1 ; k <= n ; k++) 
-            sdata(temp, i, 1) += mdata(m,k,i) * mdata(u,k,j);
-      }
+   for (j = 1 ; j <= Mcols(u) ; j++) {
+      for (i = 1 ; i <= n ; i++)
+         sdata(uj, i, 1) = mdata(u,i,j);
+
+      if (IsCompact(m))
+         MultiplyCompactMatrices (temp, 1.0, m, uj, 0.0, Matrix(), Matrix(), 0.0, Matrix(), Matrix());
+      else
+         MultiplyMatrices (temp, m, uj);
 
       result = 0;
       for (i = 1 ; i <= n ; i++) 
-         result += mdata(temp,i,1) * mdata(u,i,j);
+         result += mdata(temp,i,1) * mdata(uj,i,1);
 
-      M -> data [j][1] = result;
+      CompactData (M) [j] = result;
    }
 }
 
@@ -238,7 +306,7 @@ FormModalMatrices(Matrix &u, const Matrix &m, const Matrix &c, const Matrix &k,
    double	factor;
    Matrix	M, C, K;
 
-   n = Mrows(m);
+   n = Mcols(u);
 
    cvector1u diag(n);
 
@@ -254,12 +322,12 @@ FormModalMatrices(Matrix &u, const Matrix &m, const Matrix &c, const Matrix &k,
    if (ortho) {
       MultiplyUTmU (M, u, m);
       for (j = 1 ; j <= n ; j++) {
-         factor = M -> data [j][1];
+         factor = CompactData (M) [j];
 
-         for (i = 1 ; i <= n ; i++) 
+         for (i = 1 ; i <= Mrows(u) ; i++) 
             sdata(u, i, j) /= factor;
 
-         M -> data [j][1] = 1.0;
+         CompactData (M) [j] = 1.0;
       }
    }
    else {
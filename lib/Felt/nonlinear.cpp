@@ -32,6 +32,7 @@
 # include "fe.h"
 # include "error.h"
 # include "problem.h"
+# include "profile.h"
 
 Matrix
 CreateNonlinearStiffness(int *status)
@@ -57,21 +58,22 @@ CreateNonlinearStiffness(int *status)
 
    const Element *e = problem.elements.c_ptr1();
    const unsigned ne = problem.elements.size();
-   const unsigned nn = problem.nodes.size();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   const unsigned neqs = problem.num_equations;
    active = problem.num_dofs;
    dofs = problem.dofs_pos;
 
    err_count = 0;
 
+   PhaseTimer timer (AssemblyPhase);
+
 	/*	
 	 * make a pass over the elements to see how all the 
 	 * stiffnesses fit together
 	 */
 
-   size = nn*active;
-
-   cvector1u ht(size, 0);
-   cvector1u dg(size, 0);
+   cvector1u ht(neqs, 0);
+   cvector1u dg(neqs, 0);
 
    for (i = 1 ; i <= ne ; i++) {
       ndofs = e [i] -> definition -> numdofs;
@@ -79,19 +81,19 @@ CreateNonlinearStiffness(int *status)
 
       for (j = 1 ; j <= nodes ; j++) {
          if (e [i] -> node[j] == NULL) continue;
-         base_row = (e [i] -> node[j] -> number - 1)*active + 1;
+         base_row = (e [i] -> node[j] -> number - 1)*active;
 
          for (k = 1 ; k <= nodes ; k++) {
             if (e [i] -> node[k] == NULL) continue;
-            base_col = (e [i] -> node[k] -> number - 1)*active + 1;
+            base_col = (e [i] -> node[k] -> number - 1)*active;
 
             for (l = 1 ; l <= ndofs ; l++) {
                affected_row_dof = dofs [e [i] -> definition -> dofs[l]];
-               row = base_row + affected_row_dof - 1;
+               row = eqn [base_row + affected_row_dof];
 
                for (m = 1 ; m <= ndofs ; m++) {
                   affected_col_dof = dofs [e [i] -> definition -> dofs[m]];
-                  col = base_col + affected_col_dof - 1;
+                  col = eqn [base_col + affected_col_dof];
                   if (row <= col && col-(row-1) > ht [col])
                      ht [col] = col - (row - 1);
                }
@@ -115,7 +117,7 @@ CreateNonlinearStiffness(int *status)
    if (ht [1] == 0)
       ht [1] = 1;
 
-   for (i = 2 ; i <= nn*active ; i++) {
+   for (i = 2 ; i <= neqs ; i++) {
       if (ht[i] == 0)
          ht[i] = 1;
 
@@ -123,81 +125,92 @@ CreateNonlinearStiffness(int *status)
       dg [i] = ht [i] + dg [i-1];
    }
 
-   K = CreateCompactMatrix (nn*active, nn*active, size, &dg);
+   K = CreateCompactMatrix (neqs, neqs, size, &dg);
    ZeroMatrix (K);
+   ProfileSet (ProfileSizeCounter, size);
 
    *status = err_count;
 
    return K;
 }
 
-int
-AssembleCurrentState(Matrix K, Matrix F, int tangent)
+SparseMatrix
+CreateNonlinearSparseStiffness(int *status)
+{
+   SparseMatrix	K;
+
+   PhaseTimer timer (AssemblyPhase);
+
+	/*
+	 * the structure already covers every DOF of the nodes that share
+	 * an element, whatever the element matrices hold
+	 */
+
+   K = ConstructSparsePattern ( );
+   *status = 0;
+
+   return K;
+}
+
+	/*
+	 * the topology does not change from one iteration to the next,
+	 * so after the first one this is just a gather-add through the
+	 * cached scatter map into the (zeroed) coefficients k
+	 */
+
+static int
+AssembleState(double *k, const ScatterMap &map, Matrix F, int tangent)
 {
    Element	e;
-   unsigned	active;
-   unsigned	*dofs;
-   unsigned	row, col;
-   unsigned	i, j, l, k, m;
-   unsigned	ndofs, nodes;
-   unsigned	base_row, base_col;
-   unsigned	affected_row_dof, affected_col_dof;
-   unsigned	address;
-   double	value;
-   int	 	err;
+   unsigned	i, n;
+   const double	*ke;
+   const double	*fe;
+   double	*f;
 
    const Element *element = problem.elements.c_ptr1();
    const unsigned numelts = problem.elements.size();
-   active = problem.num_dofs;
-   dofs = problem.dofs_pos;
 
-   ZeroMatrix (K);
+   PhaseTimer timer (AssemblyPhase);
+
    if (F)
       ZeroMatrix (F);
 
+   f = (F ? VectorData (F) : NULL);
+
    for (i = 1 ; i <= numelts ; i++) {
       e = element [i];
-      err = e -> definition -> setup (e, 0, tangent);
-
-      ndofs = e -> definition -> numdofs;
-      nodes = e -> definition -> numnodes;
-      
-      for (j = 1 ; j <= nodes ; j++) {
-         if (e -> node[j] == NULL) continue;
-         base_row = (e -> node[j] -> number - 1)*active + 1;
-
-         for (k = 1 ; k <= nodes ; k++) {
-            if (e -> node[k] == NULL) continue;
-            base_col = (e -> node[k] -> number - 1)*active + 1;
-
-            for (l = 1 ; l <= ndofs ; l++) {
-               affected_row_dof = dofs[e -> definition -> dofs[l]];
-               row = base_row + affected_row_dof - 1;
-
-               if (F) {
-                  value = mdata(e -> f, (j - 1)*ndofs + l, 1);
-                  sdata(F, row, 1) += value;
-               }
- 
-               for (m = 1 ; m <= ndofs ; m++) {
-                  affected_col_dof = dofs[e -> definition -> dofs[m]];
-                  col = base_col + affected_col_dof - 1;
-                  value =  mdata(e -> K, (j-1)*ndofs + l, (k-1)*ndofs + m); 
-
-                  if (row <= col) {
-                     address = ConvertRowColumn (row, col, K);
-                     if (address) 
-                        VectorData (K) [address] += value;
-                  }
-               }
-            }
-         }
+      if (e -> K && e -> K.use_count() > 1)	/* from the element cache */
+         e -> K.reset();
+      e -> definition -> setup (e, 0, tangent);
+
+      ke = MatrixData (e -> K) [1];
+      for (n = map.first [i] ; n < map.first [i + 1] ; n++)
+         k [map.address [n]] += ke [map.entry [n]];
+
+      if (F) {
+         fe = VectorData (e -> f);
+         for (n = map.rfirst [i] ; n < map.rfirst [i + 1] ; n++)
+            f [map.row [n]] += fe [map.rentry [n]];
       }
    } 
 
    return 0;
 }
 
+int
+AssembleCurrentState(Matrix K, Matrix F, int tangent)
+{
+   ZeroMatrix (K);
+   return AssembleState (CompactData (K), CompactScatterMap (K), F, tangent);
+}
+
+int
+AssembleCurrentState(SparseMatrix K, Matrix F, int tangent)
+{
+   ZeroSparseMatrix (K);
+   return AssembleState (SparseData (K), SparseScatterMap (K), F, tangent);
+}
+
 int
 AssembleCurrentForce(Matrix F, Matrix Fnodal)
 {
@@ -208,6 +221,7 @@ AssembleCurrentForce(Matrix F, Matrix Fnodal)
    double	force;
 
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    active   = problem.num_dofs;
    dofs     = problem.dofs_num;
    const unsigned numnodes = problem.nodes.size();
@@ -217,18 +231,35 @@ AssembleCurrentForce(Matrix F, Matrix Fnodal)
       base_dof = active*(node[i] -> number - 1);
 
       for (j = 1 ; j <= active ; j++) {
-         force = mdata(Fnodal, base_dof + j, 1); 
+         if (!eqn [base_dof + j])
+            continue;
+
+         force = mdata(Fnodal, eqn [base_dof + j], 1); 
 
          if (!node[i]->eq_force.empty() && node[i] -> eq_force[dofs[j]]) 
             force += node[i] -> eq_force[dofs[j]];
          
-         sdata(F, base_dof + j, 1) = force;    
+         sdata(F, eqn [base_dof + j], 1) = force;    
       }
    }
 
    return 0;
 }
 
+	/*
+	 * the entry of d for a node DOF, zero for DOF that no element
+	 * at the node uses
+	 */
+
+static double
+NodalValue(const Matrix &d, unsigned slot)
+{
+   unsigned	n;
+
+   n = problem.equations [slot];
+   return n ? mdata(d, n, 1) : 0.0;
+}
+
 int
 RestoreCoordinates(Matrix d)
 {
@@ -252,18 +283,18 @@ RestoreCoordinates(Matrix d)
 	 */
 
       if (dofs [1]) {
-         node [i] -> x -= sdata(d, base_dof + prob_dof, 1);
-         node [i] -> dx [1] = sdata(d, base_dof + prob_dof, 1);
+         node [i] -> x -= NodalValue (d, base_dof + prob_dof);
+         node [i] -> dx [1] = NodalValue (d, base_dof + prob_dof);
          prob_dof++;
       }
       if (dofs [2]) {
-         node [i] -> y -= sdata(d, base_dof + prob_dof, 1);
-         node [i] -> dx [2] = sdata(d, base_dof + prob_dof, 1);
+         node [i] -> y -= NodalValue (d, base_dof + prob_dof);
+         node [i] -> dx [2] = NodalValue (d, base_dof + prob_dof);
          prob_dof++;
       }
       if (dofs [3]) {
-         node [i] -> z -= sdata(d, base_dof + prob_dof, 1);
-         node [i] -> dx [3] = sdata(d, base_dof + prob_dof, 1);
+         node [i] -> z -= NodalValue (d, base_dof + prob_dof);
+         node [i] -> dx [3] = NodalValue (d, base_dof + prob_dof);
          prob_dof++;
       }
 
@@ -274,7 +305,7 @@ RestoreCoordinates(Matrix d)
 
       for (size_t j = 4 ; j <= 6 ; j++) {
          if (dofs [j]) {
-            node [i] -> dx [j] = sdata(d, base_dof + prob_dof, 1);
+            node [i] -> dx [j] = NodalValue (d, base_dof + prob_dof);
             prob_dof++;
          }
       }
@@ -299,15 +330,15 @@ UpdateCoordinates(Matrix d)
       base_dof = active*(node[i] -> number - 1);
       prob_dof = 1;
       if (dofs [1]) {
-         node [i] -> x += sdata(d, base_dof + prob_dof, 1);
+         node [i] -> x += NodalValue (d, base_dof + prob_dof);
          prob_dof++;
       }
       if (dofs [2]) {
-         node [i] -> y += sdata(d, base_dof + prob_dof, 1);
+         node [i] -> y += NodalValue (d, base_dof + prob_dof);
          prob_dof++;
       }
       if (dofs [3]) {
-         node [i] -> z += sdata(d, base_dof + prob_dof, 1);
+         node [i] -> z += NodalValue (d, base_dof + prob_dof);
          prob_dof++;
       }
    }
@@ -315,8 +346,67 @@ UpdateCoordinates(Matrix d)
    return 0;
 }
 
-Matrix
-StaticNonlinearDisplacements(Matrix K, Matrix Fnodal, int tangent)
+	/*
+	 * factors K and solves it for the residual, timed and counted
+	 * as FactorSystemMatrix and SolveSystemMatrix would be
+	 */
+
+static void
+SolveResidual(Matrix K, Matrix residual)
+{
+   ProfileStart (FactorPhase);
+   ProfileCount (FactorizationsCounter, 1);
+   CroutFactorMatrix (K);
+   ProfileStop (FactorPhase);
+
+   ProfileStart (SolvePhase);
+   ProfileCount (BackSolvesCounter, 1);
+   CroutBackSolveMatrix (K, residual);
+   ProfileStop (SolvePhase);
+}
+
+	/*
+	 * one iteration of a load step: assembles K (the compact K, or
+	 * Ks if it is set) and the residual for the displacements d so
+	 * far, constrains both and leaves the correction in residual
+	 */
+
+static void
+SolveIteration(Matrix K, SparseMatrix Ks, Matrix F, Matrix Felement,
+               Matrix d, Matrix residual, int tangent)
+{
+   LinearSolver	S;
+
+   if (Ks)
+      AssembleCurrentState (Ks, Felement, tangent);
+   else
+      AssembleCurrentState (K, Felement, tangent);
+
+   if (!tangent) {
+      if (Ks)
+         MultiplySparseMatrix (residual, Ks, d);
+      else
+         MultiplyMatrices (residual, K, d);
+      SubtractMatrices (residual, F, residual);
+   }
+   else 
+      SubtractMatrices (residual, F, Felement);
+
+   ZeroConstrainedMatrixDOF (residual, residual);
+
+   if (Ks) {
+      ApplyConstraints (Ks, Matrix(), NULL);
+      FactorSystemMatrix (Ks, S);
+      SolveSystemMatrix (Matrix(), S, residual);
+   }
+   else {
+      ZeroConstrainedMatrixDOF (K, K);
+      SolveResidual (K, residual);
+   }
+}
+
+static Matrix
+NonlinearDisplacements(Matrix K, SparseMatrix Ks, Matrix Fnodal, int tangent)
 {
    Matrix	  residual;
    Matrix	  Felement;
@@ -327,7 +417,7 @@ StaticNonlinearDisplacements(Matrix K, Matrix Fnodal, int tangent)
    int		  n;
    double	  norm;
 
-   n = Mrows(K);
+   n = Ks ? Mcols(Ks) : Mrows(K);
 
    residual = CreateColumnVector (n);
    F        = CreateColumnVector (n);
@@ -352,20 +442,7 @@ StaticNonlinearDisplacements(Matrix K, Matrix Fnodal, int tangent)
       unsigned iter;
       for (iter = 1; iter <= analysis.iterations ; iter++) {
          AssembleCurrentForce (F, Fnodal);   
-         AssembleCurrentState (K, Felement, tangent);
-       
-         if (!tangent) {
-            MultiplyMatrices(residual, K, d);
-            SubtractMatrices(residual, F, residual);
-         }
-         else 
-            SubtractMatrices(residual, F, Felement);
-
-         ZeroConstrainedMatrixDOF(K, K);
-         ZeroConstrainedMatrixDOF(residual, residual);
-
-         CroutFactorMatrix(K);
-         CroutBackSolveMatrix(K, residual);
+         SolveIteration (K, Ks, F, Felement, d, residual, tangent);
 
          PNormVector (&norm, residual, "2");
          if (norm < analysis.tolerance) {
@@ -394,7 +471,19 @@ StaticNonlinearDisplacements(Matrix K, Matrix Fnodal, int tangent)
 }
 
 Matrix
-SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent)
+StaticNonlinearDisplacements(Matrix K, Matrix Fnodal, int tangent)
+{
+   return NonlinearDisplacements (K, SparseMatrix(), Fnodal, tangent);
+}
+
+Matrix
+StaticNonlinearDisplacements(SparseMatrix K, Matrix Fnodal, int tangent)
+{
+   return NonlinearDisplacements (Matrix(), K, Fnodal, tangent);
+}
+
+static Matrix
+NonlinearLoadRange(Matrix K, SparseMatrix Ks, Matrix Fnodal, int tangent)
 {
    unsigned	  num_cases;
    Matrix	  dtable;
@@ -408,13 +497,14 @@ SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent)
    int		  n;
    double	  norm;
    int		  idof;
+   int		  odof;
   
    num_cases = (fabs(analysis.stop - analysis.start) + 0.5*fabs(analysis.step))
                 / fabs(analysis.step) + 1;
 
    dtable = CreateFullMatrix (num_cases, analysis.numdofs * analysis.nodes.size());
 
-   n = Mrows(K);
+   n = Ks ? Mcols(Ks) : Mrows(K);
 
    residual = CreateColumnVector (n);
    F        = CreateColumnVector (n);
@@ -427,6 +517,11 @@ SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent)
        Felement.reset();
 
    idof = GlobalDOF (analysis.input_node -> number, analysis.input_dof);
+   if (!idof) {
+      error ("no element uses the input DOF of the load range");
+      return Matrix();
+   }
+
    Fidof = mdata(Fnodal, idof, 1);
 
 
@@ -446,20 +541,7 @@ SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent)
          unsigned iter;
          for (iter = 1; iter <= analysis.iterations ; iter++) {
             AssembleCurrentForce (F, Fnodal);
-            AssembleCurrentState (K, Felement, tangent);
-       
-            if (!tangent) {
-               MultiplyMatrices(residual, K, d);
-               SubtractMatrices(residual, F, residual);
-            }
-            else 
-               SubtractMatrices(residual, F, Felement);
-
-            ZeroConstrainedMatrixDOF(K, K);
-            ZeroConstrainedMatrixDOF(residual, residual);
-
-            CroutFactorMatrix(K);
-            CroutBackSolveMatrix(K, residual);
+            SolveIteration (K, Ks, F, Felement, d, residual, tangent);
 
             PNormVector (&norm, residual, "2");
             if (norm < analysis.tolerance) {
@@ -484,8 +566,9 @@ SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent)
 
       for (size_t k = 1 ; k <= analysis.nodes.size() ; k++) {
          for (size_t j = 1 ; j <= analysis.numdofs ; j++) {
+            odof = GlobalDOF (analysis.nodes [k] -> number, analysis.dofs[j]);
             sdata(dtable, ca, (k-1)*analysis.numdofs + j) =
-              mdata(d_cum, GlobalDOF (analysis.nodes [k] -> number, analysis.dofs[j]), 1);
+              (odof ? mdata(d_cum, odof, 1) : 0.0);
          }
       }
 
@@ -498,3 +581,15 @@ SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent)
 
    return dtable;
 }
+
+Matrix
+SolveNonlinearLoadRange(Matrix K, Matrix Fnodal, int tangent)
+{
+   return NonlinearLoadRange (K, SparseMatrix(), Fnodal, tangent);
+}
+
+Matrix
+SolveNonlinearLoadRange(SparseMatrix K, Matrix Fnodal, int tangent)
+{
+   return NonlinearLoadRange (Matrix(), K, Fnodal, tangent);
+}
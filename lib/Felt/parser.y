@@ -138,7 +138,8 @@ static FigInfo		 *figure;		/* current figure	   */
 
 %token	SIN COS TAN POW EXP LOG LOG10 SQRT HYPOT FLOOR CEIL FMOD FABS
 
-%token	ANALYSIS_TYPE DIRECTION CONSTRAINT HINGED NODE_DOF MASS_MODE
+%token	ANALYSIS_TYPE DIRECTION CONSTRAINT HINGED NODE_DOF MASS_MODE SOLVER_TYPE
+%token	PRECONDITIONER
 
 %token	PROBLEM ANALYSIS LOAD_CASES END
 %token  NODES ELEMENTS MATERIALS LOADS FORCES CONSTRAINTS
@@ -163,8 +164,9 @@ static FigInfo		 *figure;		/* current figure	   */
 
 %token	ALPHA_EQ BETA_EQ GAMMA_EQ DOFS_EQ MASS_MODE_EQ
 %token	START_EQ STOP_EQ STEP_EQ GRAVITY_EQ
-%token  ITERATIONS_EQ TOLERANCE_EQ LOAD_STEPS_EQ RELAXATION_EQ
-%token  INPUT_RANGE_EQ INPUT_DOF_EQ INPUT_NODE_EQ
+%token  ITERATIONS_EQ TOLERANCE_EQ LOAD_STEPS_EQ RELAXATION_EQ MODES_EQ
+%token  ERROR_TOLERANCE_EQ
+%token  INPUT_RANGE_EQ INPUT_DOF_EQ INPUT_NODE_EQ SOLVER_EQ PRECONDITIONER_EQ
 
 %token  NODE_FORCES_EQ ELEMENT_LOADS_EQ
 
@@ -175,7 +177,7 @@ static FigInfo		 *figure;		/* current figure	   */
 %token	TEXT_EQ POINTS_EQ FIGURE_TYPE
 
 %type	<i> INTEGER BOOLEAN ANALYSIS_TYPE DIRECTION CONSTRAINT HINGED NODE_DOF
-%type	<i> MASS_MODE FIGURE_TYPE
+%type	<i> MASS_MODE SOLVER_TYPE PRECONDITIONER FIGURE_TYPE
 %type	<p> value_pair 
 %type   <cp> loadcase_pair
 %type   <c> translation rotation 
@@ -1258,6 +1260,11 @@ analysis_parameter
 		analysis.load_steps = $2;
 	    }
 
+	| MODES_EQ INTEGER
+	    {
+		analysis.modes = $2;
+	    }
+
 	| RELAXATION_EQ constant_expression
 	    {
 		analysis.relaxation = $2;
@@ -1268,6 +1275,11 @@ analysis_parameter
 		analysis.tolerance = $2;
 	    }
 
+	| ERROR_TOLERANCE_EQ constant_expression
+	    {
+		analysis.error_tolerance = $2;
+	    }
+
         | INPUT_DOF_EQ NODE_DOF
             {
                 analysis.input_dof = $2;
@@ -1302,6 +1314,16 @@ analysis_parameter
 		analysis.mass_mode = $2;
 	    }
 
+	| SOLVER_EQ SOLVER_TYPE
+	    {
+		analysis.solver = $2;
+	    }
+
+	| PRECONDITIONER_EQ PRECONDITIONER
+	    {
+		analysis.preconditioner = $2;
+	    }
+
         | GRAVITY_EQ triple
             {
                 analysis.gravity [1] = triple_x;
@@ -28,10 +28,13 @@
 # include <stdio.h>
 # include <string.h>
 # include <unistd.h>
+# include <boost/thread/mutex.hpp>
+# include <boost/thread/locks.hpp>
 # include "setaux.hpp"
 # include "error.h"
 # include "problem.h"
 # include "definition.h"
+# include "profile.h"
 # include "config.h"
 
 # define streq(a,b)	!strcmp(a,b)
@@ -43,9 +46,9 @@
 
 int felt_yyparse (void);
 
-Problem    problem;
-ProblemSource psource;
-Analysis   analysis;
+ProblemContext default_context;
+thread_local ProblemContext *current_context = &default_context;
+thread_local ProblemSource psource;
 Appearance appearance;
 
 static material_t default_material("default_material");
@@ -53,6 +56,10 @@ static constraint_t default_constraint("default_constraint");
 
 static char *cpp;
 static char  cpp_command [2048];
+static int   cpp_macros;
+static int   cpp_skip;
+
+static boost::mutex parse_mutex;	/* the parser is not reentrant */
 
 Definition
 defnlookup(char *name)
@@ -73,6 +80,44 @@ defnlookup(char *name)
     return definition;
 }
 
+/************************************************************************
+ * Function:	NeedsPreprocessor					*
+ *									*
+ * Description:	Determines whether a file has to be sent through the	*
+ *		preprocessor.  Unless the skip has been asked for (felt	*
+ *		does so in batch mode, where it saves starting a	*
+ *		process for every file) every file goes through it.	*
+ *		Otherwise only a file with directives, // comments or	*
+ *		continued lines, which the lexer cannot handle, or one	*
+ *		read with macros defined on the command line needs it.	*
+ ************************************************************************/
+
+static int
+NeedsPreprocessor(const char *filename)
+{
+    FILE *fp;
+    char  line [2048];
+    char *ptr;
+    int   needed;
+
+
+    if (!cpp_skip || cpp_macros || strneq (cpp, CPP) || streq (filename, "-"))
+	return 1;
+
+    if (!(fp = fopen (filename, "r")))
+	return 1;
+
+    needed = 0;
+    while (!needed && fgets (line, sizeof (line), fp)) {
+	for (ptr = line; *ptr == ' ' || *ptr == '\t'; ptr ++);
+	needed = *ptr == '#' || strstr (ptr, "//") || strstr (ptr, "\\\n");
+    }
+
+    fclose (fp);
+    return needed;
+}
+
+
 /************************************************************************
  * Function:	resolve_node						*
  *									*
@@ -263,13 +308,15 @@ ReadFeltFile(const char *filename)
     char     buffer [2048];
     const char    *plural;
     FILE    *input;
+    int      piped;
 
 
     /* Open the file and send it through the preprocessor. */
 
+    piped = 0;
     if (filename) {
 
-	if (cpp != NULL) {
+	if (cpp != NULL && NeedsPreprocessor (filename)) {
 	    if (streq (filename, "-"))
 		sprintf (buffer, "%s", cpp_command);
 	    else {
@@ -284,6 +331,7 @@ ReadFeltFile(const char *filename)
 		error ("Unable to execute %s", cpp);
 		return 1;
 	    }
+	    piped = 1;
 
 	} else
 
@@ -298,12 +346,17 @@ ReadFeltFile(const char *filename)
     } else
 	input = NULL;
 
+    boost::lock_guard<boost::mutex> lock (parse_mutex);
+
 
     /* Initialize the problem instance. */
 
     problem.mode	     = Static;
     problem.title	     = strdup ("");
     problem.num_dofs	     = 0;
+    problem.num_equations    = 0;
+    problem.equations.clear();
+    problem.eq_slots.clear();
     problem.loadcases.clear();
     problem.num_errors	     = 0;
     psource.line	     = 1;
@@ -328,9 +381,14 @@ ReadFeltFile(const char *filename)
     analysis.Rm        = 0.0;
     analysis.iterations = 0;
     analysis.load_steps = 0;
+    analysis.modes = 0;
     analysis.tolerance = 0.0;
+    analysis.error_tolerance = 0.0;
     analysis.relaxation = 0.0;
     analysis.mass_mode = 0;
+    analysis.solver = 0;
+    analysis.preconditioner = 0;
+    analysis.tabulate = 0;
     analysis.nodes.clear();
     analysis.numdofs   = 0;
     analysis.input_node.reset();
@@ -348,17 +406,22 @@ ReadFeltFile(const char *filename)
     /* Parse the input and resolve the names. */
 
     if (filename) {
+	ProfileStart (ParsePhase);
 	init_felt_lexer (input);
 	felt_yyparse ( );
 	psource.line = 0;
 
-	if (cpp)
+	if (piped)
 	    pclose (input);
 	else if (input != stdin)
 	    fclose (input);
+	ProfileStop (ParsePhase);
 
-	if (!problem.num_errors)
+	if (!problem.num_errors) {
+	    ProfileStart (ResolvePhase);
 	    resolve_names ( );
+	    ProfileStop (ResolvePhase);
+	}
 
 
 	/* Report any errors. */
@@ -373,6 +436,18 @@ ReadFeltFile(const char *filename)
     return 0;
 }
 
+ProblemContext *
+SetProblemContext(ProblemContext *context)
+{
+    ProblemContext *previous;
+
+
+    previous = current_context;
+    current_context = context ? context : &default_context;
+
+    return previous;
+}
+
 AnalysisType
 SetAnalysisMode(void)
 {
@@ -414,6 +489,8 @@ ParseCppOptions(int *argc, char **argv)
 		return 1;
 	    cpp = argv [i];
 	} else if (arg [1] == 'D' || arg [1] == 'U' || arg [1] == 'I') {
+	    if (arg [1] != 'I')
+		cpp_macros = 1;
 	    strcat (cpp_args, " '");
 	    strcat (cpp_args, arg);
 	    strcat (cpp_args, "'");
@@ -427,6 +504,12 @@ ParseCppOptions(int *argc, char **argv)
     return 0;
 }
 
+void
+SetPreprocessorSkip(int flag)
+{
+    cpp_skip = flag;
+}
+
 int
 CompileCode(char *text)
 {
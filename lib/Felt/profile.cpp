@@ -0,0 +1,243 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/************************************************************************
+ * File:	profile.cpp						*
+ *									*
+ * Description:	This file contains the function definitions for the	*
+ *		phase timers and counters behind felt -profile.		*
+ ************************************************************************/
+
+# include <stdio.h>
+# include <string.h>
+# include <time.h>
+# include <sys/resource.h>
+# include "problem.h"
+# include "profile.h"
+# include "config.h"
+
+# define MaxDepth 32
+
+typedef struct {
+    double	wall;			/* wall clock seconds	   */
+    double	cpu;			/* processor seconds	   */
+    long	rss;			/* peak resident set (kB)  */
+} Sample;
+
+typedef struct {
+    unsigned long calls;		/* times the phase ran	   */
+    double	wall;			/* wall clock seconds	   */
+    double	cpu;			/* processor seconds	   */
+    long	peak;			/* peak resident set (kB)  */
+    long	growth;			/* rise in the peak (kB)   */
+} PhaseTimes;
+
+static const char *phase_names [ ] = {
+    "parse", "resolve_names", "find_dofs", "renumber", "element_setup",
+    "assembly", "constraints", "factorization", "solve", "eigenvalues",
+    "stresses", "reactions", "output"
+};
+
+static const char *counter_names [ ] = {
+    "nodes", "elements", "equations", "shared_elements", "profile_size",
+    "nonzeros", "factor_entries", "fill", "factorizations", "back_solves",
+    "cg_iterations", "reactions"
+};
+
+static thread_local int		  enabled = 0;
+static thread_local PhaseTimes	  times [NumProfilePhases];
+static thread_local unsigned long counters [NumProfileCounters];
+static thread_local unsigned	  active [NumProfilePhases];
+static thread_local ProfilePhase  stack [MaxDepth];
+static thread_local unsigned	  depth;
+static thread_local Sample	  start;
+static thread_local Sample	  mark;
+
+static void
+TakeSample(Sample *s)
+{
+    struct timespec	ts;
+    struct rusage	ru;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    s -> wall = ts.tv_sec + ts.tv_nsec*1e-9;
+
+    clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+    s -> cpu = ts.tv_sec + ts.tv_nsec*1e-9;
+
+    getrusage (RUSAGE_SELF, &ru);
+    s -> rss = ru.ru_maxrss;
+}
+
+	/*
+	 * the time since the last mark goes to the innermost running
+	 * phase (if any)
+	 */
+
+static void
+Charge(const Sample &now)
+{
+    PhaseTimes	*t;
+
+    if (depth > 0 && depth <= MaxDepth) {
+       t = &times [stack [depth - 1]];
+       t -> wall += now.wall - mark.wall;
+       t -> cpu += now.cpu - mark.cpu;
+       t -> growth += now.rss - mark.rss;
+       if (now.rss > t -> peak)
+          t -> peak = now.rss;
+    }
+
+    mark = now;
+}
+
+void
+EnableProfile(int flag)
+{
+    enabled = flag;
+    if (!flag)
+       return;
+
+    memset (times, 0, sizeof (times));
+    memset (counters, 0, sizeof (counters));
+    memset (active, 0, sizeof (active));
+    depth = 0;
+
+    TakeSample (&start);
+    mark = start;
+}
+
+int
+ProfileEnabled(void)
+{
+    return enabled;
+}
+
+void
+ProfileStart(ProfilePhase phase)
+{
+    Sample	now;
+
+    if (!enabled)
+       return;
+
+    TakeSample (&now);
+    Charge (now);
+
+    if (!active [phase] ++)
+       times [phase].calls ++;
+
+    if (depth < MaxDepth)
+       stack [depth] = phase;
+    depth ++;
+}
+
+void
+ProfileStop(ProfilePhase phase)
+{
+    Sample	now;
+
+    if (!enabled || depth == 0)
+       return;
+
+    TakeSample (&now);
+    Charge (now);
+
+    depth --;
+    if (depth < MaxDepth)
+       phase = stack [depth];
+    active [phase] --;
+}
+
+void
+ProfileCount(ProfileCounter counter, unsigned long amount)
+{
+    if (enabled)
+       counters [counter] += amount;
+}
+
+void
+ProfileSet(ProfileCounter counter, unsigned long value)
+{
+    if (enabled && value > counters [counter])
+       counters [counter] = value;
+}
+
+static void
+WriteString(FILE *fp, const char *s)
+{
+    putc ('"', fp);
+    for ( ; *s ; s++) {
+       if (*s == '"' || *s == '\\')
+          fprintf (fp, "\\%c", *s);
+       else if ((unsigned char) *s < ' ')
+          fprintf (fp, "\\u%04x", *s);
+       else
+          putc (*s, fp);
+    }
+    putc ('"', fp);
+}
+
+int
+WriteProfile(FILE *fp, const char *input)
+{
+    Sample	 now;
+    unsigned	 i;
+    const char	*solver;
+
+    TakeSample (&now);
+    if (enabled)
+       Charge (now);
+
+    switch (analysis.solver) {
+    case 's': solver = "sparse"; break;
+    case 'c': solver = "cg"; break;
+    default:  solver = "skyline"; break;
+    }
+
+    fprintf (fp, "{\n");
+    fprintf (fp, "  \"version\": \"%d.%d.%d\",\n",
+             FELT_VERSION_MAJOR, FELT_VERSION_MINOR, FELT_VERSION_MICRO);
+    fprintf (fp, "  \"input\": ");
+    WriteString (fp, input ? input : "");
+    fprintf (fp, ",\n");
+    fprintf (fp, "  \"solver\": \"%s\",\n", solver);
+    fprintf (fp, "  \"threads\": {\"assembly\": %u, \"factor\": %u},\n",
+             AssemblyThreads ( ), FactorThreads ( ));
+    fprintf (fp, "  \"total\": {\"wall\": %.6f, \"cpu\": %.6f, \"peak_rss_kb\": %ld},\n",
+             now.wall - start.wall, now.cpu - start.cpu, now.rss);
+
+    fprintf (fp, "  \"phases\": {\n");
+    for (i = 0 ; i < NumProfilePhases ; i++)
+       fprintf (fp, "    \"%s\": {\"calls\": %lu, \"wall\": %.6f, \"cpu\": %.6f, "
+                "\"peak_rss_kb\": %ld, \"rss_growth_kb\": %ld}%s\n",
+                phase_names [i], times [i].calls, times [i].wall, times [i].cpu,
+                times [i].peak, times [i].growth,
+                i + 1 < NumProfilePhases ? "," : "");
+    fprintf (fp, "  },\n");
+
+    fprintf (fp, "  \"counters\": {\n");
+    for (i = 0 ; i < NumProfileCounters ; i++)
+       fprintf (fp, "    \"%s\": %lu%s\n", counter_names [i], counters [i],
+                i + 1 < NumProfileCounters ? "," : "");
+    fprintf (fp, "  }\n");
+    fprintf (fp, "}\n");
+
+    return ferror (fp) ? 1 : 0;
+}
@@ -43,14 +43,20 @@
 # include <math.h>
 # include "problem.h"
 # include "renumber.hpp"
+# include "profile.h"
 # include "cvector1.hpp"
 
 using std::vector;
 
-static int idpth;
-static cvector1i nacum;
-static cvector1i nhigh;
-static cvector1i nlow;
+	/*
+	 * the level structure shared by the helpers below; per thread so
+	 * that problems can be renumbered on several threads at once
+	 */
+
+static thread_local int		  idpth;
+static thread_local cvector1i	  nacum;
+static thread_local cvector1i	  nhigh;
+static thread_local cvector1i	  nlow;
 
 static cvector1u Reduce (vector<cvector1u> &ndstk, const unsigned *nd_degrees, unsigned *old_numbers, unsigned int numnodes, unsigned int max_degree, unsigned int prof);
 static int      SortBySize (int *size, int *stpt, int xc);
@@ -92,6 +98,7 @@ void
 RestoreProblemNodeNumbers(const cvector1u &old)
 {
     RestoreNodeNumbers(problem.nodes.c_ptr1(), old.c_ptr1(), problem.nodes.size());
+    NumberEquations();
 }
 
 cvector1u
@@ -1083,8 +1090,10 @@ RenumberProblemNodes()
     Element *element = problem.elements.c_ptr1();
     unsigned numnodes = problem.nodes.size();
     unsigned numelts = problem.elements.size();
+    PhaseTimer timer(RenumberPhase);
     cvector1u ret = RenumberNodes(node, element, numnodes, numelts);
     assert(ret.size() == numnodes);
+    NumberEquations();
     return ret;
 }
 
@@ -33,6 +33,7 @@
 # include "problem.h"
 # include "fe.h"
 # include "error.h"
+# include "profile.h"
 
 extern "C" double ElementArea(Element e, unsigned int n);
 
@@ -52,6 +53,7 @@ extern "C" double ElementArea(Element e, unsigned int n);
 void
 WriteStructuralResults(FILE *output, char *title, const cvector1<Reaction> &R)
 {
+    PhaseTimer	timer (OutputPhase);
     FILE       *fd;
     unsigned	i,j,k;
     unsigned	count;
@@ -136,6 +138,7 @@ WriteStructuralResults(FILE *output, char *title, const cvector1<Reaction> &R)
 void
 WriteTemperatureResults(FILE *fp, char *title)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i;
 
    const Node *node = problem.nodes.c_ptr1();
@@ -166,11 +169,12 @@ WriteTemperatureResults(FILE *fp, char *title)
 void
 WriteEigenResults(Matrix lambda, Matrix x, char *title, FILE *output)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	n;
    unsigned	i,j;
    unsigned	start;
 
-   n = Mrows(lambda); 
+   n = Mrows(lambda);		/* the number of modes, perhaps < Mrows(x) */
    
    fprintf (output,"** %s **\n\n",title);
    fprintf (output,"Modal frequencies (rad/sec)\n");
@@ -192,7 +196,7 @@ WriteEigenResults(Matrix lambda, Matrix x, char *title, FILE *output)
 
       fprintf (output,"\n------------------------------------------------------------------------------\n");
 
-      for (j = 1 ; j <= n ; j++) {
+      for (j = 1 ; j <= Mrows(x) ; j++) {
          for (i = start ; i <= start+5 && i <= n ; i++) 
             fprintf (output,"%11.5g ", mdata(x,j,i));
 
@@ -217,6 +221,7 @@ WriteEigenResults(Matrix lambda, Matrix x, char *title, FILE *output)
 void
 PlotModeShapes(Matrix x, FILE *output)
 {
+   PhaseTimer	timer (OutputPhase);
    error ("mode shape plots are not implemented yet - sorry.");
    return;
 }
@@ -241,6 +246,7 @@ static const char *labels [] = {"","Tx","Ty","Tz","Rx","Ry","Rz"};
 void
 WriteTransientTable(const Matrix &dtable, const Matrix &ttable, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k,m,n;
    unsigned	table;
    unsigned	node, dof;
@@ -326,6 +332,7 @@ WriteTransientTable(const Matrix &dtable, const Matrix &ttable, FILE *fp)
 void
 PlotTransientTable(Matrix dtable, Matrix ttable, double dt, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k;
    unsigned	m,n;
    double	data;
@@ -459,6 +466,7 @@ static const char *spectra_labels [] = {"","S_Tx","S_Ty","S_Tz","S_Rx","S_Ry","S
 void
 WriteOutputSpectra(Matrix P, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k,m,n;
    unsigned	table;
    unsigned	node, dof;
@@ -536,6 +544,7 @@ WriteOutputSpectra(Matrix P, FILE *fp)
 void
 PlotOutputSpectra(Matrix P, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k;
    unsigned	m,n;
    double	data;
@@ -667,6 +676,7 @@ PlotOutputSpectra(Matrix P, FILE *fp)
 void
 WriteTransferFunctions(const cvector1<Matrix> &H, const cvector1<NodeDOF> &forced, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    double	w;
    unsigned	i,j,k,l,m,n;
    unsigned	table;
@@ -758,6 +768,7 @@ WriteTransferFunctions(const cvector1<Matrix> &H, const cvector1<NodeDOF> &force
 void
 PlotTransferFunctions(const cvector1<Matrix> &H, const cvector1<NodeDOF> &forced, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k,l;
    unsigned	m,n,o;
    double	data;
@@ -916,6 +927,7 @@ PlotTransferFunctions(const cvector1<Matrix> &H, const cvector1<NodeDOF> &forced
 int
 WriteMaterialStatistics(FILE *output)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,
  		num_materials,
 		number [50];
@@ -1043,6 +1055,7 @@ WriteMaterialStatistics(FILE *output)
 int
 WriteGraphicsFile(char *filename, double mag)
 {
+   PhaseTimer	timer (OutputPhase);
    FILE		*output;
    unsigned	i,j;
 
@@ -1078,6 +1091,7 @@ WriteGraphicsFile(char *filename, double mag)
 void
 PrintGlobalMatrices(FILE *fp, Matrix M, Matrix C, Matrix K)
 {
+   PhaseTimer	timer (OutputPhase);
 
    if (M) {
       if (!IsZeroMatrix (M)) {
@@ -1110,6 +1124,7 @@ PrintGlobalMatrices(FILE *fp, Matrix M, Matrix C, Matrix K)
 int
 MatlabGlobalMatrices(char *filename, Matrix M, Matrix C, Matrix K)
 {
+   PhaseTimer	timer (OutputPhase);
    FILE	    *fp;
 
    fp = fopen (filename, "w");
@@ -1134,6 +1149,7 @@ MatlabGlobalMatrices(char *filename, Matrix M, Matrix C, Matrix K)
 void
 WriteModalResults(FILE *fp, Matrix M, Matrix C, Matrix K, Matrix lambda)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i;
 
    if (!IsZeroMatrix (M)) {
@@ -1181,6 +1197,7 @@ WriteModalResults(FILE *fp, Matrix M, Matrix C, Matrix K, Matrix lambda)
 void
 WriteLoadCaseTable(Matrix dtable, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k,m,n;
    unsigned	table;
    unsigned	node, dof;
@@ -1256,6 +1273,7 @@ WriteLoadCaseTable(Matrix dtable, FILE *fp)
 void
 PlotLoadCaseTable(Matrix dtable, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k;
    unsigned	m,n;
    double	data;
@@ -1382,6 +1400,7 @@ PlotLoadCaseTable(Matrix dtable, FILE *fp)
 void
 WriteLoadRangeTable(Matrix dtable, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k,m,n;
    unsigned	table;
    unsigned	node, dof;
@@ -1446,6 +1465,74 @@ WriteLoadRangeTable(Matrix dtable, FILE *fp)
    return;
 }
 
+/******************************************************************************
+ *
+ * Function:	WriteReactionTable
+ *
+ * Parameters:	rtable		matrix of reaction forces, one row per loadcase
+ *				or force level
+ *		R		node and DOF of each column of rtable
+ *		fp		file pointer to output table to
+ *		range		non-zero if the rows are load range inputs
+ *
+ ******************************************************************************/
+
+static void
+WriteReactionTable(const Matrix &rtable, const cvector1<Reaction> &R, FILE *fp, int range)
+{
+   unsigned	i, j;
+   unsigned	first, last;
+   char		label [32];
+
+   fprintf (fp,"\nReaction Forces\n");
+
+	/*
+	 * four reactions to a table just like the displacements
+	 */
+
+   for (first = 1 ; first <= R.size() ; first += 4) {
+      last = (first + 3 < R.size() ? first + 3 : R.size());
+
+      fprintf (fp,"\n------------------------------------------------------------------\n");
+      fprintf (fp, range ? "       input" : "   loadcase");
+      for (j = first ; j <= last ; j++) {
+         snprintf (label, sizeof (label), "%s(%d)", labels [R [j].dof], R [j].node);
+         fprintf (fp,"  %11s", label);
+      }
+      fprintf (fp,"\n------------------------------------------------------------------\n");
+
+      for (i = 1 ; i <= MatrixRows (rtable) ; i++) {
+         if (range)
+            fprintf (fp,"%11.5g",analysis.start + (i-1)*analysis.step);
+         else
+            fprintf (fp,"%11s", problem.loadcases [i] -> name.c_str());
+
+         for (j = first ; j <= last ; j++)
+            fprintf (fp, "  %11.5g", MatrixData (rtable)[i][j]);
+         fprintf (fp,"\n");
+      }
+   }
+   fprintf (fp,"\n");
+
+   return;
+}
+
+void
+WriteLoadCaseReactions(const Matrix &rtable, const cvector1<Reaction> &R, FILE *fp)
+{
+   PhaseTimer	timer (OutputPhase);
+   if (rtable && R.size())
+      WriteReactionTable (rtable, R, fp, 0);
+}
+
+void
+WriteLoadRangeReactions(const Matrix &rtable, const cvector1<Reaction> &R, FILE *fp)
+{
+   PhaseTimer	timer (OutputPhase);
+   if (rtable && R.size())
+      WriteReactionTable (rtable, R, fp, 1);
+}
+
 /******************************************************************************
  *
  * Function:	PlotLoadRangeTable
@@ -1458,6 +1545,7 @@ WriteLoadRangeTable(Matrix dtable, FILE *fp)
 void
 PlotLoadRangeTable(Matrix dtable, FILE *fp)
 {
+   PhaseTimer	timer (OutputPhase);
    unsigned	i,j,k;
    unsigned	m,n;
    double	data;
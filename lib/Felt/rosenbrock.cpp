@@ -37,46 +37,30 @@
 # include "problem.h"
 # include "transient.hpp"
 
-/*--------------------------------------------*
- * called only from IntegrateHyperbolicDE2()  * 
- * numerical appr. of dp/dt                   * 
- *--------------------------------------------*/
-
+        /*
+         * y = alpha*A*a + beta*B*b with the compact A and B or, if As is
+         * set, the sparse As and Bs
+         */
 static void
-ConstructTFD(double t, double h, Vector dp)
+StageProduct(Vector y, double alpha, const Matrix &A, const SparseMatrix &As,
+             const Vector &a, double beta, const Matrix &B,
+             const SparseMatrix &Bs, const Vector &b)
 {
-  static Vector  temp;
-  static int     size;
-  int            i;
-    
-  if (!temp) {
-      size= problem.nodes.size() * problem.num_dofs; 
-     temp= CreateVector(size); 
-  }
-   
-  if(t == 0.0)
-    {
-    AssembleTransientForce(0.0, temp);
-    AssembleTransientForce(0.0+h/4, dp);
-    for(i= 1; i<= size; i++)
-      VectorData(dp)[i]= (VectorData(dp)[i] - VectorData(temp)[i])/(h/4);
-    }
+  if(As)
+    MultiplySparseMatrices(y, alpha, As, a, beta, Bs, b, 0.0, SparseMatrix(), Matrix());
   else
-    { 
-    AssembleTransientForce(t-h/4, temp); 
-    AssembleTransientForce(t+h/4, dp);
-    for(i= 1; i<= size; i++)
-      VectorData(dp)[i]= (VectorData(dp)[i] - VectorData(temp)[i])/(h/2);
-    }
-
-    return;
+    MultiplyCompactMatrices(y, alpha, A, a, beta, B, b, 0.0, Matrix(), Matrix());
+}
 
-  } /* eo ConstructTFD() */ 
-
-Matrix
-RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
+        /*
+         * the integration itself, for either the compact k0, m and c0
+         * or the sparse k0s, ms and c0s
+         */
+static Matrix
+RosenbrockIntegration(Matrix k0, Matrix m, Matrix c0, SparseMatrix k0s,
+                      SparseMatrix ms, SparseMatrix c0s, Matrix *ttable)
 {
-  unsigned      count, i,j;
+  unsigned      i,j, dof;
   Matrix        dtable;
   Vector        y0, v0, a_dummy, p0, p0d; 
   Vector        b0, bhalf, 
@@ -85,27 +69,31 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
                 d1, e1, d2, e2, d3, e3, /* three stages         */ 
                 vhalf, v1, err; 
   Vector        k0d1; 
-  double        r0_i, k0v0_i, rhalf_i, k0d1_i, k0vhalf_i, sum_i, 
-                k0v1_i, k0d2_i, me1_i, b1_i, me2_i, r1_i; 
+  Vector        ym, vm, e1m,            /* constrained DOF zeroed */
+                xk, xm,                 /* combined product operands */
+                kv, ke;                 /* matrix-vector products */
                 
-  Matrix        M0, M0_fact;
+  Matrix        M0;
+  SparseMatrix  M0s;
+  ConstrainedRows M0_rows;
+  TransientBC   bc;
+  LinearSolver  M0_solver;
   unsigned      size;
   double        gamma, e32, gh, h; 
   const double  beta1= 0.0, beta2= 1.0; 
   unsigned      step, nsteps;
-  int           address, build_a0;
+  int           build_a0;
+  int           status;
   double        t;
      
 
   const Node *node = problem.nodes.c_ptr1();
-  const unsigned numnodes = problem.nodes.size();
-  count = problem.num_dofs;
 
 
         /*
          * constants that we will need
          */
-  size=  numnodes*count;
+  size=  problem.num_equations;
   h=     analysis.step; 
   gamma= 1.0/(2.0+sqrt(2.0));
   e32=   6.0+sqrt(2.0);
@@ -126,6 +114,10 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
   vhalf= CreateVector(size);   v1= CreateVector(size);      
   k0d1= CreateVector(size);    bhalf= CreateVector(size);   
   err= CreateVector(size); 
+  ym= CreateVector(size);      vm= CreateVector(size); 
+  e1m= CreateVector(size);     xk= CreateVector(size); 
+  xm= CreateVector(size);      kv= CreateVector(size); 
+  ke= CreateVector(size); 
 
 
         /*
@@ -137,22 +129,44 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
   
 
         /*
-         * create the M0_fact matrix
+         * create the M0 matrix
          */
-  M0= CreateCopyMatrix(k0);
-  for(i= 1; i<= Msize(k0); i++)
-    VectorData(M0)[i]= VectorData(m)[i]       +
-                       VectorData(c0)[i]*gh   +
-                       VectorData(k0)[i]*gh*gh ; 
+  if(k0s)
+    {
+    M0s= CreateSparseMatrix(k0s->nrows, k0s->ncols, k0s->colptr, k0s->rowind, 1);
+    for(i= 1; i<= k0s->nnz; i++)
+      SparseData(M0s)[i]= SparseData(ms)[i]       +
+                          SparseData(c0s)[i]*gh   +
+                          SparseData(k0s)[i]*gh*gh ; 
+    }
+  else
+    {
+    M0= CreateCopyMatrix(k0);
+    for(i= 1; i<= Msize(k0); i++)
+      CompactData(M0)[i]= CompactData(m)[i]       +
+                          CompactData(c0)[i]*gh   +
+                          CompactData(k0)[i]*gh*gh ; 
+    }
 
 
         /*
-         * create a constrained copy of M0 and do a one-time
-         * factorization on it.  This is the matrix that we will
-         * use as the RHS of our implicit update equation
+         * constrain M0 in place (keeping its constrained rows for
+         * ResolveBC) and do a one-time factorization on it.  This is
+         * the matrix that we will use as the RHS of our implicit
+         * update equation
          */
-  ZeroConstrainedDOF(M0, Matrix(), &M0_fact, NULL);
-  if(CroutFactorMatrix(M0_fact))
+  if(M0s)
+    {
+    ApplyConstraints(M0s, Matrix(), &M0_rows);
+    status= FactorSystemMatrix(M0s, M0_solver);
+    }
+  else
+    {
+    ApplyConstraints(M0, Matrix(), &M0_rows);
+    status= FactorSystemMatrix(M0, M0_solver);
+    }
+
+  if(status)
     {
     error("singular M0 matrix in hyperbolic integration - cannot proceed");
     return Matrix();
@@ -165,6 +179,25 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
          */
   cvector1i constraint_mask = BuildConstraintMask();
   build_a0 = BuildHyperbolicIC(y0, v0, a_dummy);
+  BuildTransientBC(bc);
+
+        /*
+         * each step needs the load at its start, middle and end and
+         * the rate of the load at its start, so the loads go on a grid
+         * of half steps
+         */
+  if(analysis.tabulate)
+    {
+    TabulateTransientDOFs(bc.forced, 0.0, 0.5*h, 2*nsteps+1, 1);
+    TabulateTransientDOFs(bc.prescribed, 0.0, h, nsteps, 0);
+    }
+
+        /*
+         * otherwise the rate of the load is worked out at every step,
+         * so compile its expressions just once
+         */
+  else
+    CompileTransientDOFs(bc.forced);
 
 
 
@@ -175,8 +208,9 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
   for(i= 1; i<= analysis.nodes.size(); i++)
     for(j= 1; j<= analysis.numdofs; j++)
       {
+      dof= GlobalDOF(analysis.nodes [i] -> number, analysis.dofs[j]);
       MatrixData(dtable) [1][(i-1)*analysis.numdofs+ j] =
-        VectorData(y0)[GlobalDOF(analysis.nodes [i] -> number, analysis.dofs[j])];
+        (dof ? VectorData(y0)[dof] : 0.0);
       }
 
 
@@ -185,42 +219,49 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
          * iterate over every time step.  Fill up dtable with
          * the results
          */
-  AssembleTransientForce(t= 0.0, p0);
+  AssembleTransientForce(t= 0.0, bc, p0);
   for(step= 1; step<= nsteps; step++)
     {
      
 
 
         /*
-         * setup p'(i+1) and dp'(i+1).  
-         * The numerical integration here is only a temporary solution. 
+         * setup p'(i+1) and dp'(i+1).  The rate of the load comes
+         * straight from its expressions.
          */
     t = (step - 1.0)*analysis.step;
-    ConstructTFD(t, h, p0d); 
+    AssembleTransientForceRate(t, bc, p0d); 
 
 
       
         /*--------------------------------------*
          * do the stage 1                       *      
          *--------------------------------------*/
+
+    /* 
+     * every product below leaves out the constrained DOF, so work
+     * with copies of y0 and v0 that have them zeroed out
+     */
     for(i= 1; i<= size; i++)
       if(!constraint_mask[i])
         {
-        r0_i= k0v0_i= 0.0; 
-        for(j= 1; j<= size; j++)
-          if(!constraint_mask[j])
-            if((address= ConvertRowColumn(i, j, k0))) 
-              {
-              /* r0= k0* y0+ c0* v0; %  r(y0, v0); */ 
-              r0_i+=  VectorData(k0)[address]* VectorData(y0)[j]+ 
-                      VectorData(c0)[address]* VectorData(v0)[j]; 
-       
-              /* b0= -gh* k0* v0+ p0- r0;         %%%%%% t0 term */
-              k0v0_i+= VectorData(k0)[address]* VectorData(v0)[j];
-              } 
+        VectorData(ym)[i]= VectorData(y0)[i]; 
+        VectorData(vm)[i]= VectorData(v0)[i]; 
+        }
+      else
+        VectorData(ym)[i]= VectorData(vm)[i]= 0.0; 
+
+    /* r0= k0* y0+ c0* v0; %  r(y0, v0); */ 
+    StageProduct(r0, 1.0, k0, k0s, ym, 1.0, c0, c0s, vm);
+
+    /* k0v0= k0* v0; */
+    StageProduct(kv, 1.0, k0, k0s, vm, 0.0, Matrix(), SparseMatrix(), Matrix());
 
+    for(i= 1; i<= size; i++)
+      if(!constraint_mask[i])
+        {
         /* b0= -gh* k0* v0+ p0- r0;    %%% t0 term */
-        VectorData(b0)[i]= -gh*k0v0_i+ VectorData(p0)[i]- r0_i;    
+        VectorData(b0)[i]= -gh*VectorData(kv)[i]+ VectorData(p0)[i]- VectorData(r0)[i];    
 
         /* e1= h* (b0+ gh*p0d); */
         VectorData(e1)[i]= h*(VectorData(b0)[i]+ gh*VectorData(p0d)[i]);    
@@ -230,88 +271,69 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
 
 
     /* e1= U\(L\e1); */
-    ResolveBC(t, M0, e1);
-    if(CroutBackSolveMatrix(M0_fact, e1)) /* e1 := M0^(-1)*e1 */ 
+    ResolveBC(t, bc, M0_rows, e1);
+    if(SolveSystemMatrix(M0, M0_solver, e1)) /* e1 := M0^(-1)*e1 */ 
       {
       error("singular M0 matrix in hyperbolic integration - cannot proceed");
       return Matrix();
       }
 
     /* phalf= p(t0+0.5*h); */
-    AssembleTransientForce(t+0.5*h,  phalf);
+    AssembleTransientForce(t+0.5*h, bc,  phalf);
 
 
 
     for(i= 1; i<= size; i++)
       if(!constraint_mask[i])
+        {
         /* d1= h* (v0+gamma*e1); */
         VectorData(d1)[i]   = h*( VectorData(v0)[i]+ gamma*VectorData(e1)[i] ); 
-      else 
-        VectorData(d1)[i]= 0.0; 
-
-    for(i= 1; i<= size; i++)
-      if(!constraint_mask[i])
-        { 
-    
-
-        rhalf_i= k0d1_i= 0.0; 
-        for(j= 1; j<= size; j++)
-          if(!constraint_mask[j])
-            if((address= ConvertRowColumn(i, j, k0)))
-              { 
-              /* rhalf= k0* (y0+ 0.5*d1)+ c0* (v0+0.5*e1); */
-              rhalf_i+= VectorData(k0)[address] *
-                          (VectorData(y0)[j]+ 0.5*VectorData(d1)[j]) +
-                        VectorData(c0)[address] *
-                          (VectorData(v0)[j]+ 0.5*VectorData(e1)[j]);
-              /* k0d1=  k0*d1;  */
-              k0d1_i+=  VectorData(k0)[address] * VectorData(d1)[j]; 
-              }
 
         /* vhalf= v0+0.5*e1; */
         VectorData(vhalf)[i]= VectorData(v0)[i]+ 0.5*  VectorData(e1)[i]; 
-        VectorData(rhalf)[i]= rhalf_i;
-        VectorData(k0d1)[i]= k0d1_i;
-        } 
-      else
-        VectorData(vhalf)[i]= VectorData(rhalf)[i]= VectorData(k0d1)[i]= 0.0; 
+
+        VectorData(xk)[i]= VectorData(y0)[i]+ 0.5*VectorData(d1)[i]; 
+        VectorData(e1m)[i]= VectorData(e1)[i]; 
+        }
+      else 
+        VectorData(d1)[i]= VectorData(vhalf)[i]= 
+          VectorData(xk)[i]= VectorData(e1m)[i]= 0.0; 
+
+    /* rhalf= k0* (y0+ 0.5*d1)+ c0* (v0+0.5*e1); */
+    StageProduct(rhalf, 1.0, k0, k0s, xk, 1.0, c0, c0s, vhalf);
+
+    /* k0d1=  k0*d1;  */
+    StageProduct(k0d1, 1.0, k0, k0s, d1, 0.0, Matrix(), SparseMatrix(), Matrix());
 
 
 
         /*-----------------------------------*
          * do the stage 2                    *
          *-----------------------------------*/
-    for(i= 1; i<= size; i++)
-      if(!constraint_mask[i])
-        {
-        k0vhalf_i= sum_i= 0.0; 
-        for(j= 1; j<= size; j++)
-          if(!constraint_mask[j])
-            if((address= ConvertRowColumn(i, j, k0)))
-              {
 
-              /* bhalf = -gh*h*k0* vhalf+ h*(phalf- rhalf); %%  t0+0.5h term */
-              k0vhalf_i+= VectorData(k0)[address]* VectorData(vhalf)[j];  
+    /* k0vhalf= k0* vhalf; */
+    StageProduct(kv, 1.0, k0, k0s, vhalf, 0.0, Matrix(), SparseMatrix(), Matrix());
 
-              /* e2= bhalf+  gh*k0d1+  gh* c0 *e1+  gh*gh* k0* e1; */
-              sum_i+= ( gh* VectorData(c0)[address]+ 
-                        gh*gh* VectorData(k0)[address])* VectorData(e1)[j] ; 
-              } 
+    /* gh* c0 *e1+  gh*gh* k0* e1 */
+    StageProduct(ke, gh, c0, c0s, e1m, gh*gh, k0, k0s, e1m);
 
+    for(i= 1; i<= size; i++)
+      if(!constraint_mask[i])
+        {
         /* bhalf = -gh*h*k0* vhalf+ h*(phalf- rhalf); %%  t0+0.5h term */
-        VectorData(bhalf)[i]= -gh*h* k0vhalf_i+ 
+        VectorData(bhalf)[i]= -gh*h* VectorData(kv)[i]+ 
                               h*( VectorData(phalf)[i]- VectorData(rhalf)[i]); 
 
         /* e2= bhalf+  gh*k0d1+  gh* c0 *e1+  gh*gh* k0* e1; */
         VectorData(e2)[i]= VectorData(bhalf)[i]+ 
-                           gh*VectorData(k0d1)[i]+ sum_i; 
+                           gh*VectorData(k0d1)[i]+ VectorData(ke)[i]; 
         } 
       else
         { VectorData(bhalf)[i]= VectorData(e2)[i]= 0.0; }  
 
     /* e2= U\(L\e2);   */
-    ResolveBC(t, M0, e2);
-    if(CroutBackSolveMatrix(M0_fact, e2)) /* e2 := M0^(-1)*e2 */
+    ResolveBC(t, bc, M0_rows, e2);
+    if(SolveSystemMatrix(M0, M0_solver, e2)) /* e2 := M0^(-1)*e2 */
       {
       error("singular M0 matrix in hyperbolic integration- cannot proceed");
       return Matrix();
@@ -319,7 +341,7 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
 
 
     /* p1= p(t0+h); */
-    AssembleTransientForce(t+h, p1);
+    AssembleTransientForce(t+h, bc, p1);
  
     for(i= 1; i<= size; i++)
       if(!constraint_mask[i])
@@ -332,24 +354,13 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
         /* v1= v0+e2;   */
         VectorData(v1)[i]= VectorData(v0)[i]+ VectorData(e2)[i]; 
 
-        r1_i= 0.0; 
-        for(j= 1; j<= size; j++)
-          if(!constraint_mask[j])
-            if((address= ConvertRowColumn(i, j, k0)))
-              {
-      
-              /* r1= k0* (y0+ d2)+ c0* (v0+e2); % r(y0+ d2, v0+e2); */
-              r1_i+= VectorData(k0)[address]* 
-                       (VectorData(y0)[j]+ VectorData(d2)[j])+ 
-                     VectorData(c0)[address]* 
-                       (VectorData(v0)[j]+ VectorData(e2)[j]); 
-  
-              }  
+        VectorData(xk)[i]= VectorData(y0)[i]+ VectorData(d2)[i]; 
+        }
+      else
+        VectorData(d2)[i]= VectorData(v1)[i]= VectorData(xk)[i]= 0.0; 
 
-         VectorData(r1)[i]=  r1_i;   
-         }
-       else
-         VectorData(r1)[i]= 0;
+    /* r1= k0* (y0+ d2)+ c0* (v0+e2); % r(y0+ d2, v0+e2); */
+    StageProduct(r1, 1.0, k0, k0s, xk, 1.0, c0, c0s, v1);
 
 
 
@@ -357,34 +368,32 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
         /*------------------------------*
          * do the stage 3               *
          *------------------------------*/
+
+    /*
+     * the k0 and m products of e3 are gathered into
+     * k0* (e32*gh* d2- gh*h* v1)+ m* (-e32* e2- 2* e1)
+     */
     for(i= 1; i<= size; i++)
       if(!constraint_mask[i])
         {
-        k0v1_i= k0d2_i= me1_i= me2_i= 0.0;  
-        for(j= 1; j<= size; j++)
-          if(!constraint_mask[j])
-            if((address= ConvertRowColumn(i, j, k0)))
-              {
-              /* b1= -gh* k0* v1+ p1- r1;      %%   t0+h term */
-              k0v1_i+=  VectorData(k0)[address]* VectorData(v1)[j]; 
-
-              /* e3 = h* b1+ e32*gh* k0* d2 -e32* m* e2+ 
-                      e32*h *bhalf- 2*gh*k0d1 -2* m* e1; */
-              k0d2_i+=  VectorData(k0)[address]* VectorData(d2)[j]; 
-              me1_i+=  VectorData(m)[address]* VectorData(e1)[j]; 
-              me2_i+=  VectorData(m)[address]* VectorData(e2)[j]; 
-
-              } 
-
+        VectorData(xk)[i]= e32*gh*VectorData(d2)[i]- gh*h*VectorData(v1)[i]; 
+        VectorData(xm)[i]= -e32*VectorData(e2)[i]- 2*VectorData(e1)[i]; 
+        }
+      else
+        VectorData(xk)[i]= VectorData(xm)[i]= 0.0; 
 
-        /* b1= -gh* k0* v1+ p1- r1;      %%   t0+h term */
-        b1_i= -gh* k0v1_i + VectorData(p1)[i]- VectorData(r1)[i]; 
+    StageProduct(ke, 1.0, k0, k0s, xk, 1.0, m, ms, xm);
 
+    for(i= 1; i<= size; i++)
+      if(!constraint_mask[i])
+        {
         /* e3= h* b1+ e32*gh* k0* d2 -e32* m* e2+ 
-               e32*h *bhalf- 2*gh*k0d1 -2* m* e1; */
-        VectorData(e3)[i]=  h* b1_i+ e32*gh* k0d2_i -e32* me2_i 
+               e32*h *bhalf- 2*gh*k0d1 -2* m* e1; 
+           with b1= -gh* k0* v1+ p1- r1;      %%   t0+h term */
+        VectorData(e3)[i]=  h*( VectorData(p1)[i]- VectorData(r1)[i])+ 
+                            VectorData(ke)[i] 
                            +e32*h* VectorData(bhalf)[i]
-                           -2*gh* VectorData(k0d1)[i]- 2* me1_i; 
+                           -2*gh* VectorData(k0d1)[i]; 
 
 
         /* e3 = e3+ 2*h* b0+ gh*h* p0d; */
@@ -398,8 +407,8 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
 
 
     /* e3= U\L\e3; */
-    ResolveBC(t, M0, e3); 
-    if(CroutBackSolveMatrix(M0_fact, e3)) /* e3 := M0^(-1)*e3 */
+    ResolveBC(t, bc, M0_rows, e3); 
+    if(SolveSystemMatrix(M0, M0_solver, e3)) /* e3 := M0^(-1)*e3 */
       {
       error("singular M0 matrix in hyperbolic integration- cannot proceed");
       return Matrix();
@@ -438,11 +447,27 @@ RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
          */
       for(i= 1; i<= analysis.nodes.size(); i++)
         for(j= 1; j<= analysis.numdofs; j++)
+          {
+          dof= GlobalDOF(analysis.nodes [i] -> number, analysis.dofs[j]);
           MatrixData(dtable)[step][(i-1)*analysis.numdofs+ j] =
-               VectorData(y0)[GlobalDOF(analysis.nodes [i] -> number, analysis.dofs[j])];
+               (dof ? VectorData(y0)[dof] : 0.0);
+          }
       VectorData(*ttable)[step]= t; /* CHANGE: pn */ 
 
     } /* eo for steps */
 
   return(dtable);
 } /* eo IntegrateHyperbolicDE2() */
+
+Matrix
+RosenbrockHyperbolicDE(Matrix k0, Matrix m, Matrix c0, Matrix *ttable)
+{
+  return RosenbrockIntegration(k0, m, c0, SparseMatrix(), SparseMatrix(),
+                               SparseMatrix(), ttable);
+}
+
+Matrix
+RosenbrockHyperbolicDE(SparseMatrix k0, SparseMatrix m, SparseMatrix c0, Matrix *ttable)
+{
+  return RosenbrockIntegration(Matrix(), Matrix(), Matrix(), k0, m, c0, ttable);
+}
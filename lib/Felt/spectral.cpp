@@ -369,7 +369,7 @@ ComputeOutputSpectraFFT(Matrix dtable, Matrix *Pr, Vector *Fr, int nfft)
          Spectrum(x, &P, NULL, analysis.step, nfft);
 
       for (j = 1 ; j <= Mrows(P) ; j++)
-         sdata(Pm, j, i) = mdata(P, j, i);         
+         sdata(Pm, j, i) = mdata(P, j, 1);
    }
 
    *Pr = Pm;
@@ -384,6 +384,7 @@ ComputeTransferFunctions(Matrix M, Matrix C, Matrix K, const cvector1<NodeDOF> &
    ComplexMatrix	Ht;
    double		w;
    unsigned		i,j,k;
+   unsigned		dof;
    unsigned		input;
    unsigned		n;
    unsigned		size;
@@ -393,7 +394,6 @@ ComputeTransferFunctions(Matrix M, Matrix C, Matrix K, const cvector1<NodeDOF> &
    size = Msize(M);
  
    Z = CreateCompactComplexMatrix (n, n, size, &M -> diag);
-   Ht = CreateComplexColumnVector(n);
 
    nsteps = (analysis.stop - analysis.start + analysis.step/2.0) / 
             analysis.step + 1.0;
@@ -401,29 +401,39 @@ ComputeTransferFunctions(Matrix M, Matrix C, Matrix K, const cvector1<NodeDOF> &
    const size_t numforced = forced.size();
    cvector1<Matrix> H(numforced);
 
+   if (numforced == 0)
+      return H;
+
+	/*
+	 * the columns of inv(Z) for every forced DOF come out of one
+	 * block solve per frequency
+	 */
+
+   cvector1u inputs(numforced);
+   for (input = 1 ; input <= numforced ; input++)
+      inputs [input] = GlobalDOF(forced [input].node -> number, forced [input].dof);
+
+   Ht = CreateFullComplexMatrix (n, numforced);
+
    for (i = 1 ; i <= numforced ; i++)
       H [i] = CreateFullMatrix(nsteps, analysis.numdofs * analysis.nodes.size());
 
    w = analysis.start;
    for (j = 1 ; j <= nsteps ; j++) {
       for (i = 1 ; i <= size ; i++) {
-         rdata(Z, i, 1) = K -> data [i][1] - w*w*M -> data [i][1];
-         idata(Z, i, 1) = w*C -> data [i][1];
+         CompactData (Z) [i].r = CompactData (K) [i] - w*w*CompactData (M) [i];
+         CompactData (Z) [i].i = w*CompactData (C) [i];
       }
       
       CroutFactorComplexMatrix (Z);
+      InvertCroutComplexMatrix (Ht, Z, inputs);
 
       for (input = 1 ; input <= numforced ; input++) {
-
-         InvertCroutComplexMatrix (Ht, Z, 
-                    GlobalDOF(forced [input].node -> number, 
-                              forced [input].dof));
-
          for (i = 1 ; i <= analysis.nodes.size() ; i++) {
             for (k = 1 ; k <= analysis.numdofs ; k++) {
+               dof = GlobalDOF(analysis.nodes [i] -> number, analysis.dofs [k]);
                sdata(H [input], j, (i-1)*analysis.numdofs + k) = 
-                  modulus(cmdata(Ht, GlobalDOF(analysis.nodes [i] -> number,
-                                               analysis.dofs [k]), 1));
+                  (dof ? modulus(cmdata(Ht, dof, input)) : 0.0);
             }
          }
       }
@@ -501,6 +511,14 @@ ComputeOutputSpectra(const cvector1<Matrix> &H, const cvector1<NodeDOF> &forced)
 
    ZeroMatrix (So);
 
+	/*
+	 * the frequencies, for evaluating a spectrum all at once
+	 */
+
+   cvector1d freq (nsteps);
+   for (w = start, j = 1 ; j <= nsteps ; w += inc, j++)
+      freq [j] = w;
+
    for (i = 1 ; i <= forced.size() ; i++) {
 
       inode = forced [i].node;
@@ -508,10 +526,9 @@ ComputeOutputSpectra(const cvector1<Matrix> &H, const cvector1<NodeDOF> &forced)
 
       f = inode -> force;
 
-      if (f -> spectrum [idof].expr) {
-         for (w = start, j = 1 ; j <= nsteps ; w += inc, j++) 
-            sdata(Si, j, 1) = EvalCode (f -> spectrum [idof].expr, w);
-      }
+      if (f -> spectrum [idof].expr)
+         EvalCodeArray (f -> spectrum [idof].expr, freq.c_ptr1() + 1,
+                        &sdata(Si, 1, 1), nsteps);
       else if (f -> spectrum [idof].value) {
          for (w = start, j = 1 ; j <= nsteps ; w += inc, j++)
             sdata(Si, j, 1) = f -> spectrum [idof].value;
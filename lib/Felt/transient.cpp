@@ -38,114 +38,149 @@
 # include "fe.h"
 # include "error.h"
 # include "problem.h"
+# include "profile.h"
 # include "transient.hpp"
 
-int
-ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr)
+	/*
+	 * the profile and assembly passes scatter into the columns of the
+	 * element's nodes and are run one color at a time, just as in
+	 * ConstructStiffness.  K, M and C share one scatter map.
+	 */
+
+struct DynamicPass {
+   unsigned		*ht;
+   Matrix		K, M, C;
+   SparseMatrix		Ks, Ms, Cs;
+   const ScatterMap	*map;
+};
+
+static void
+DynamicProfileTask(Element element, unsigned, void *arg)
 {
-   unsigned	active;
-   unsigned	*dofs;
-   Vector	M, K, C;
+   DynamicPass	*pass = (DynamicPass *) arg;
+   unsigned	*ht = pass -> ht;
    unsigned	row,
 		col,
-		i,
 		j,
 		l,
 		k,
 		m;
-   unsigned	size,
-		ndofs,
+   unsigned	ndofs,
 		nodes;
    unsigned	base_row,
 		base_col,
 		affected_row_dof,
 		affected_col_dof;
-   unsigned	address;
    double	mvalue;
    double	kvalue;
-   int	 	err,
-		err_count;
-
-   active   = problem.num_dofs;
-   const Node *node = problem.nodes.c_ptr1();
-   const Element *element = problem.elements.c_ptr1();
-   const unsigned numelts  = problem.elements.size();
-   const unsigned numnodes = problem.nodes.size();
-   dofs     = problem.dofs_pos;
 
-   err_count = 0;
+   const unsigned active = problem.num_dofs;
+   const unsigned *dofs = problem.dofs_pos;
+   const unsigned *eqn = problem.equations.c_ptr1();
 
-	/*	
-	 * first we make a pass over the elements to see how all the 
-	 * stiffnesses fit together so we can set up our compact column
-	 * storage sceme.  Inefficient as hell I concede.
-	 */
+   ndofs = element -> definition -> numdofs;
+   nodes = element -> definition -> numnodes;
+     
+   for (j = 1 ; j <= nodes ; j++) {
+      if (element -> node[j] == NULL) continue;
+      base_row = (element -> node[j] -> number - 1)*active;
+
+      for (k = 1 ; k <= nodes ; k++) {
+         if (element -> node[k] == NULL) continue;
+         base_col = (element -> node[k] -> number - 1)*active;
+
+         for (l = 1 ; l <= ndofs ; l++) {
+            affected_row_dof = dofs[element -> definition -> dofs[l]];
+            row = eqn [base_row + affected_row_dof];
+
+            for (m = 1 ; m <= ndofs ; m++) {
+               affected_col_dof = dofs[element -> definition -> dofs[m]];
+               col = eqn [base_col + affected_col_dof];
+               kvalue =  MatrixData (element -> K) [(j-1)*ndofs + l]
+                                                   [(k-1)*ndofs + m]; 
+               mvalue =  MatrixData (element -> M) [(j-1)*ndofs + l]
+                                                   [(k-1)*ndofs + m]; 
+               if ((kvalue != 0.0 || mvalue != 0.0) && row <= col) { 
+                  if (col-(row-1) > ht [col])
+                     ht [col] = col - (row - 1);
+               }
+            }
+         }
+      }
+   }
+}
 
-   size = numnodes*active;
+static void
+DynamicAssemblyTask(Element element, unsigned i, void *arg)
+{
+   DynamicPass	*pass = (DynamicPass *) arg;
+   unsigned	n;
+   double	kvalue;
+   double	mvalue;
 
-   cvector1u ht(size, 0);
-   cvector1u dg(size, 0);
+   const ScatterMap &map = *pass -> map;
+   const double *ke = MatrixData (element -> K) [1];
+   const double *me = MatrixData (element -> M) [1];
+   const double Rk = element -> material -> Rk;
+   const double Rm = element -> material -> Rm;
+   double *k = CompactData (pass -> K);
+   double *m = CompactData (pass -> M);
+   double *c = CompactData (pass -> C);
+
+   for (n = map.first [i] ; n < map.first [i + 1] ; n++) {
+      kvalue = ke [map.entry [n]];
+      mvalue = me [map.entry [n]];
+      k [map.address [n]] += kvalue;
+      m [map.address [n]] += mvalue;
+      c [map.address [n]] += Rk * kvalue + Rm * mvalue;
+   }
 
-   for (i = 1 ; i <= numelts ; i++) {
-      err = ElementSetup (element [i], analysis.mass_mode);
+   if (!element -> definition -> retainK)
+       element -> K.reset();
 
-      if (!element [i] -> M) {
-         error("mass matrix not defined for element %d", element [i] -> number);
-         err_count ++;
-      } 
+   element -> M.reset();
+}
 
-      if (err) {
-         err_count += err;
-         continue;
-      } 
-         
-      ndofs = element[i] -> definition -> numdofs;
-      nodes = element[i] -> definition -> numnodes;
-     
-      if (!element[i] -> K || !element[i] -> M ||
-          !IsSquare(element[i] -> K) || !IsSquare(element[i] -> M) ||
-          Mrows(element[i] -> K) != Mrows(element[i] -> M) ||
-          Mrows(element[i] -> K) > ndofs*nodes) {
+int
+ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr)
+{
+   unsigned	active;
+   unsigned	*dofs;
+   Vector	M, K, C;
+   unsigned	i,
+		j;
+   unsigned	size;
+   unsigned	neqs;
+   unsigned	base_row;
+   unsigned	row;
+   DynamicPass	pass;
+   int	 	err_count;
 
-          error ("invalid element matrices setup for %s element %d",
-                 element[i] -> definition -> name.c_str(), element[i] -> number);
+   active   = problem.num_dofs;
+   const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   const unsigned numnodes = problem.nodes.size();
+   dofs     = problem.dofs_pos;
+   neqs     = problem.num_equations;
 
-          err_count ++;
-          continue;
-      }
-         
-      for (j = 1 ; j <= nodes ; j++) {
-         if (element [i] -> node[j] == NULL) continue;
-         base_row = (element[i] -> node[j] -> number - 1)*active;
-
-         for (k = 1 ; k <= nodes ; k++) {
-            if (element [i] -> node[k] == NULL) continue;
-            base_col = (element[i] -> node[k] -> number - 1)*active;
-
-            for (l = 1 ; l <= ndofs ; l++) {
-               affected_row_dof = dofs[element[i] -> definition -> dofs[l]];
-               row = base_row + affected_row_dof;
-
-               for (m = 1 ; m <= ndofs ; m++) {
-                  affected_col_dof = dofs[element[i] -> definition -> dofs[m]];
-                  col = base_col + affected_col_dof;
-                  kvalue =  MatrixData (element[i] -> K) [(j-1)*ndofs + l]
-                                                         [(k-1)*ndofs + m]; 
-                  mvalue =  MatrixData (element[i] -> M) [(j-1)*ndofs + l]
-                                                         [(k-1)*ndofs + m]; 
-                  if ((kvalue != 0.0 || mvalue != 0.0) && row <= col) { 
-                     if (col-(row-1) > ht [col])
-                        ht [col] = col - (row - 1);
-                  }
-               }
-            }
-         }
-      }
-   } /* end first loop over elements */
+	/*	
+	 * set up every element and then make a pass over the elements
+	 * to see how all the stiffnesses fit together so we can set up
+	 * our compact column storage sceme.
+	 */
 
+   err_count = SetupElements (analysis.mass_mode, 1);
    if (err_count) 
       return err_count;
 
+   PhaseTimer timer (AssemblyPhase);
+
+   cvector1u ht(neqs, 0);
+   cvector1u dg(neqs, 0);
+
+   pass.ht = ht.c_ptr1();
+   ForEachElement (DynamicProfileTask, &pass, 1);
+
 	/*
 	 * setup the diagonal address array and figure out how big
 	 * we need to make the compact column vector
@@ -156,7 +191,7 @@ ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr)
    if (ht [1] == 0)
       ht [1] = 1;
 
-   for (i = 2 ; i <= numnodes*active ; i++) {
+   for (i = 2 ; i <= neqs ; i++) {
       if (ht[i] == 0)
          ht[i] = 1;
 
@@ -164,66 +199,27 @@ ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr)
       dg [i] = ht [i] + dg [i-1];
    }
 
-   K = CreateCompactMatrix (numnodes*active, numnodes*active, size, &dg);
-   M = CreateCompactMatrix (numnodes*active, numnodes*active, size, &dg);
-   C = CreateCompactMatrix (numnodes*active, numnodes*active, size, &dg);
+   K = CreateCompactMatrix (neqs, neqs, size, &dg);
+   M = CreateCompactMatrix (neqs, neqs, size, &dg);
+   C = CreateCompactMatrix (neqs, neqs, size, &dg);
+   ProfileSet (ProfileSizeCounter, size);
 
    ZeroMatrix (K);
    ZeroMatrix (M);
    ZeroMatrix (C);
 
 	/*
-	 * now we make just about the identical passes over the elements,
+	 * now we make just about the identical pass over the elements,
 	 * the result of this pass however will be that we actually
 	 * start sticking stuff into the vector which is the compact
 	 * column representation of the global stiffness matrix
 	 */
 
-   for (i = 1 ; i <= numelts ; i++) {
-      ndofs = element[i] -> definition -> numdofs;
-      nodes = element[i] -> definition -> numnodes;
-      
-      for (j = 1 ; j <= nodes ; j++) {
-         if (element [i] -> node[j] == NULL) continue;
-         base_row = (element[i] -> node[j] -> number - 1)*active;
-
-         for (k = 1 ; k <= nodes ; k++) {
-            if (element [i] -> node[k] == NULL) continue;
-            base_col = (element[i] -> node[k] -> number - 1)*active;
-
-            for (l = 1 ; l <= ndofs ; l++) {
-               affected_row_dof = dofs[element[i] -> definition -> dofs[l]];
-               row = base_row + affected_row_dof;
-
-               for (m = 1 ; m <= ndofs ; m++) {
-                  affected_col_dof = dofs[element[i] -> definition -> dofs[m]];
-                  col = base_col + affected_col_dof;
-                  kvalue =  MatrixData (element[i] -> K) [(j-1)*ndofs + l]
-                                                         [(k-1)*ndofs + m]; 
-                  mvalue =  MatrixData (element[i] -> M) [(j-1)*ndofs + l]
-                                                         [(k-1)*ndofs + m]; 
-
-                  if (row <= col) {
-                     address = ConvertRowColumn (row, col, K);
-                     if (address) {
-                        VectorData (K) [address] += kvalue;
-                        VectorData (M) [address] += mvalue;
-                        VectorData (C) [address] += 
-                                   element[i] -> material -> Rk * kvalue +
-                                   element[i] -> material -> Rm * mvalue;
-                     }
-                  }
-               }
-            }
-         }
-      }
-
-      if (!element[i] -> definition -> retainK)
-          element[i] -> K.reset();
-
-      element[i] -> M.reset();
-
-   } /* end second loop over elements */
+   pass.K = K;
+   pass.M = M;
+   pass.C = C;
+   pass.map = &CompactScatterMap (K);
+   ForEachElement (DynamicAssemblyTask, &pass, 1);
 
 	/*
 	 * now we need to make one quick pass over the _nodes_
@@ -235,8 +231,8 @@ ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr)
       base_row = active*(node[i] -> number - 1);
 
       for (j = 1 ; j <= 3 ; j++) {
-         if (dofs [j]) 
-            MatrixData (M) [dg[base_row + dofs[j]]][1] += node[i] -> m;
+         if (dofs [j] && (row = eqn [base_row + dofs[j]]))
+            CompactData (M) [dg[row]] += node[i] -> m;
       }
    }
       
@@ -248,8 +244,8 @@ ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr)
 
    if (analysis.Rk || analysis.Rm) {
       for (i = 1 ; i <= Msize(M) ; i++) 
-         C -> data [i][1] = M -> data[i][1] * analysis.Rm +
-                            K -> data[i][1] * analysis.Rk;
+         CompactData (C) [i] = CompactData (M) [i] * analysis.Rm +
+                               CompactData (K) [i] * analysis.Rk;
    } 
 
 	/*
@@ -263,89 +259,748 @@ ConstructDynamic(Vector *Kr, Vector *Mr, Vector *Cr)
    return 0;
 }
 
+static void
+SparseDynamicAssemblyTask(Element element, unsigned i, void *arg)
+{
+   DynamicPass	*pass = (DynamicPass *) arg;
+   unsigned	n;
+   double	kvalue;
+   double	mvalue;
+
+   const ScatterMap &map = *pass -> map;
+   const double *ke = MatrixData (element -> K) [1];
+   const double *me = MatrixData (element -> M) [1];
+   const double Rk = element -> material -> Rk;
+   const double Rm = element -> material -> Rm;
+   double *k = SparseData (pass -> Ks);
+   double *m = SparseData (pass -> Ms);
+   double *c = SparseData (pass -> Cs);
+
+   for (n = map.first [i] ; n < map.first [i + 1] ; n++) {
+      kvalue = ke [map.entry [n]];
+      mvalue = me [map.entry [n]];
+      k [map.address [n]] += kvalue;
+      m [map.address [n]] += mvalue;
+      c [map.address [n]] += Rk * kvalue + Rm * mvalue;
+   }
+
+   if (!element -> definition -> retainK)
+       element -> K.reset();
+
+   element -> M.reset();
+}
+
+int
+ConstructSparseDynamic(SparseMatrix *Kr, SparseMatrix *Mr, SparseMatrix *Cr)
+{
+   unsigned	active;
+   unsigned	*dofs;
+   SparseMatrix	M, K, C;
+   unsigned	i,
+		j;
+   unsigned	base_row;
+   unsigned	row;
+   DynamicPass	pass;
+   int	 	err_count;
+
+   active   = problem.num_dofs;
+   const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
+   const unsigned numnodes = problem.nodes.size();
+   dofs     = problem.dofs_pos;
+
+   err_count = SetupElements (analysis.mass_mode, 1);
+   if (err_count) 
+      return err_count;
+
+   PhaseTimer timer (AssemblyPhase);
+
+	/*
+	 * all three matrices share the structure that comes out of
+	 * the element connectivity
+	 */
+
+   K = ConstructSparsePattern ( );
+   M = CreateSparseMatrix (K -> nrows, K -> ncols, K -> colptr, K -> rowind, 1);
+   C = CreateSparseMatrix (K -> nrows, K -> ncols, K -> colptr, K -> rowind, 1);
+
+   pass.Ks = K;
+   pass.Ms = M;
+   pass.Cs = C;
+   pass.map = &SparseScatterMap (K);
+   ForEachElement (SparseDynamicAssemblyTask, &pass, 1);
+
+	/*
+	 * nodally lumped masses and global Rayleigh damping are
+	 * handled just as in ConstructDynamic
+	 */
+
+   for (i = 1 ; i <= numnodes ; i++) {
+
+      base_row = active*(node[i] -> number - 1);
+
+      for (j = 1 ; j <= 3 ; j++) {
+         if (dofs [j] && (row = eqn [base_row + dofs[j]]))
+            SparseData (M) [SparseAddress (row, row, M)] += node[i] -> m;
+      }
+   }
+
+   if (analysis.Rk || analysis.Rm) {
+      for (i = 1 ; i <= K -> nnz ; i++) 
+         SparseData (C) [i] = SparseData (M) [i] * analysis.Rm +
+                              SparseData (K) [i] * analysis.Rk;
+   } 
+
+   *Kr = K;
+   *Mr = M;
+   *Cr = C;
+
+   return 0;
+}
+
+	/*
+	 * an expression replaces the value of a force or displacement,
+	 * as it does when the force vector is assembled for a static
+	 * problem, so a DOF with one keeps only its equivalent force as
+	 * its constant part
+	 */
+
 void
-AssembleTransientForce(double t, Vector F)
+BuildTransientBC(TransientBC &bc)
 {
    unsigned	active;
    unsigned	*dofs;
    unsigned	i,j,
 		base_dof;
-   unsigned	size;
-   double	force;
-   double	factor;
+   unsigned	n;
+   double	value;
+   Code		expr;
 
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    const unsigned numnodes = problem.nodes.size();
    active = problem.num_dofs;
    dofs = problem.dofs_num;
 
-   size = numnodes*active;
-
-   for (i = 1 ; i <= size ; i++) 
-      VectorData (F) [i] = 0;
+   bc.forced = TransientDOFs ( );
+   bc.prescribed = TransientDOFs ( );
 
    for (i = 1 ; i <= numnodes ; i++) {
 
       base_dof = active*(node[i] -> number - 1);
 
       for (j = 1 ; j <= active ; j++) {
-         force = 0.0;
+         if (!(n = eqn [base_dof + j]))
+            continue;
+
+         if (node[i] -> constraint -> constraint[dofs[j]]) {
+            expr = node[i] -> constraint -> dx [dofs[j]].expr;
+            bc.prescribed.dofs.push_back (n);
+            bc.prescribed.value.push_back (expr ? 0.0 : node[i] -> constraint -> dx [dofs[j]].value);
+            bc.prescribed.expr.push_back (expr);
+         }
+
+         value = 0.0;
+         expr = NULL;
          if (node[i] -> force != NULL) {
-            if (node[i] -> force -> force [dofs[j]].expr != NULL) {
-               factor = EvalCode (node[i] -> force -> force [dofs[j]].expr, t);
-               force += factor;
-            }
-            else if (node[i] -> force -> force[dofs[j]].value) 
-               force += node[i] -> force -> force[dofs[j]].value;
+            expr = node[i] -> force -> force [dofs[j]].expr;
+            if (expr == NULL)
+               value = node[i] -> force -> force [dofs[j]].value;
          }
-         if (!node[i]->eq_force.empty()) {
-            if (node[i] -> eq_force[j])
-               force += node[i] -> eq_force[dofs[j]];
+         if (!node[i] -> eq_force.empty())
+            value += node[i] -> eq_force[dofs[j]];
+
+         if (expr != NULL || value) {
+            bc.forced.dofs.push_back (n);
+            bc.forced.value.push_back (value);
+            bc.forced.expr.push_back (expr);
          }
-         VectorData (F) [base_dof + j] += force;
       }
    }
 
    return;
 }
 
-Matrix
-IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C)
+void
+TabulateTransientDOFs(TransientDOFs &d, double start, double step,
+                      unsigned count, int slopes)
+{
+   unsigned	i, k;
+   unsigned	rows;
+
+   d.row = cvector1u (d.dofs.size(), 0);
+   d.series.reset ( );
+   d.slope.reset ( );
+   d.start = start;
+   d.step = step;
+
+   rows = 0;
+   for (i = 1 ; i <= d.dofs.size() ; i++)
+      if (d.expr [i] != NULL)
+         d.row [i] = ++ rows;
+
+   if (!rows || !count)
+      return;
+
+	/*
+	 * the times are worked out just as the integrators work out
+	 * theirs so that a lookup finds exactly the same time
+	 */
+
+   cvector1d time (count);
+   for (k = 1 ; k <= count ; k++)
+      time [k] = (k - 1.0)*step + start;
+
+   d.series = CreateFullMatrix (rows, count);
+   if (slopes)
+      d.slope = CreateFullMatrix (rows, count);
+
+   for (i = 1 ; i <= d.dofs.size() ; i++) {
+      if (!d.row [i])
+         continue;
+
+      if (slopes && !d.tree.empty())
+         EvalCodeTreeSlope (d.tree [i].get(), time.c_ptr1() + 1,
+                            &sdata(d.series, d.row [i], 1),
+                            &sdata(d.slope, d.row [i], 1), count);
+      else if (slopes)
+         EvalCodeSlopeArray (d.expr [i], time.c_ptr1() + 1,
+                             &sdata(d.series, d.row [i], 1),
+                             &sdata(d.slope, d.row [i], 1), count);
+      else if (!d.tree.empty())
+         EvalCodeTree (d.tree [i].get(), time.c_ptr1() + 1,
+                       &sdata(d.series, d.row [i], 1), count);
+      else
+         EvalCodeArray (d.expr [i], time.c_ptr1() + 1,
+                        &sdata(d.series, d.row [i], 1), count);
+   }
+
+   return;
+}
+
+void
+CompileTransientDOFs(TransientDOFs &d)
+{
+   unsigned	i;
+
+   d.tree = cvector1<CodeTree> (d.dofs.size());
+   for (i = 1 ; i <= d.dofs.size() ; i++)
+      if (d.expr [i] != NULL)
+         d.tree [i] = CodeTree (CompileCodeTree (d.expr [i]), FreeCodeTree);
+
+   return;
+}
+
+	/*
+	 * the column of the tabulated expressions at time t, or zero if
+	 * they weren't tabulated at t
+	 */
+
+static unsigned
+SeriesColumn(const TransientDOFs &d, double t)
+{
+   double	x;
+   unsigned	k;
+
+   if (!d.series)
+      return 0;
+
+   x = (t - d.start)/d.step;
+   if (x < -0.5)
+      return 0;
+
+   k = x + 0.5;
+   if (k >= Mcols(d.series) || fabs (x - k) > 1e-6)
+      return 0;
+
+   return k + 1;
+}
+
+	/*
+	 * the value of DOF i of a list at time t (taken from column col
+	 * of the tabulated expressions if there is one)
+	 */
+
+static inline double
+DOFValue(const TransientDOFs &d, unsigned i, double t, unsigned col)
+{
+   if (d.expr [i] == NULL)
+      return d.value [i];
+   else if (col)
+      return d.value [i] + mdata(d.series, d.row [i], col);
+   else
+      return d.value [i] + EvalCode (d.expr [i], t);
+}
+
+void
+AssembleTransientForce(double t, const TransientBC &bc, Vector F)
+{
+   unsigned	i;
+   unsigned	size;
+   unsigned	col;
+
+   size = problem.num_equations;
+
+   for (i = 1 ; i <= size ; i++) 
+      VectorData (F) [i] = 0;
+
+   col = SeriesColumn (bc.forced, t);
+
+   for (i = 1 ; i <= bc.forced.dofs.size() ; i++)
+      VectorData (F) [bc.forced.dofs [i]] += DOFValue (bc.forced, i, t, col);
+
+   return;
+}
+
+void
+AssembleTransientForceRate(double t, const TransientBC &bc, Vector dF)
+{
+   unsigned	i;
+   unsigned	size;
+   unsigned	col;
+   double	value;
+   double	rate;
+
+   size = problem.num_equations;
+
+   for (i = 1 ; i <= size ; i++) 
+      VectorData (dF) [i] = 0;
+
+   col = bc.forced.slope ? SeriesColumn (bc.forced, t) : 0;
+
+   for (i = 1 ; i <= bc.forced.dofs.size() ; i++) {
+      if (bc.forced.expr [i] == NULL)
+         continue;
+
+      if (col)
+         rate = mdata(bc.forced.slope, bc.forced.row [i], col);
+      else if (!bc.forced.tree.empty())
+         EvalCodeTreeSlope (bc.forced.tree [i].get(), &t, &value, &rate, 1);
+      else
+         EvalCodeSlopeArray (bc.forced.expr [i], &t, &value, &rate, 1);
+
+      VectorData (dF) [bc.forced.dofs [i]] += rate;
+   }
+
+   return;
+}
+
+void
+AssignPrescribedDisplacement(double t, const TransientBC &bc, Vector d)
+{
+   unsigned	i;
+   unsigned	col;
+
+   col = SeriesColumn (bc.prescribed, t);
+
+   for (i = 1 ; i <= bc.prescribed.dofs.size() ; i++)
+      VectorData (d) [bc.prescribed.dofs [i]] = DOFValue (bc.prescribed, i, t, col);
+
+   return;
+}
+
+	/*
+	 * the pieces of Newmark's method that stay put from step to step
+	 * and the constants that go with the current step dt.  Either the
+	 * compact K, M and C are set or the sparse Ks, Ms and Cs are, and
+	 * K' (Kp or Kps) is stored the same way.
+	 */
+
+struct NewmarkSystem {
+   Vector		K, M, C;
+   SparseMatrix		Ks, Ms, Cs;
+   Matrix		Kp;
+   SparseMatrix		Kps;
+   ConstrainedRows	Kp_rows;
+   LinearSolver		Kp_solver;
+   TransientBC		bc;
+   cvector1i		mask;
+   Vector		F;
+   Vector		xm, xc, xk;
+   Vector		y;
+   double		dt;
+   double		c1, c2, c3, c4, c5, c6;
+};
+
+	/*
+	 * forms K' = M/c3 + C*c4/c3 + K*c5 for a step of dt, constrains
+	 * it in place (keeping the constrained rows for the time varying
+	 * BC) and factors it.  This is the matrix that we will use as the
+	 * RHS of our implicit update equation.
+	 */
+
+static int
+FactorEffectiveStiffness(NewmarkSystem &s, double dt)
+{
+   unsigned	i;
+   int		status;
+
+   s.dt = dt;
+   s.c1 = (1.0 - 2.0*analysis.beta) * (dt*dt)/2.0;
+   s.c2 = dt * (1.0 - analysis.gamma);
+   s.c3 = dt * dt * analysis.beta;
+   s.c4 = dt * analysis.gamma;
+   s.c5 = (1.0 + analysis.alpha);
+   s.c6 = analysis.alpha * dt;
+
+   if (s.Ks) {
+      if (!s.Kps)
+         s.Kps = CreateSparseMatrix (s.Ks -> nrows, s.Ks -> ncols,
+                                     s.Ks -> colptr, s.Ks -> rowind, 1);
+
+      for (i = 1 ; i <= s.Ks -> nnz ; i++)
+         SparseData (s.Kps) [i] = SparseData (s.Ms) [i]/s.c3 +
+                                  SparseData (s.Cs) [i]*s.c4/s.c3 +
+                                  SparseData (s.Ks) [i]*s.c5;
+
+      ApplyConstraints (s.Kps, Matrix(), &s.Kp_rows);
+      status = FactorSystemMatrix (s.Kps, s.Kp_solver);
+   }
+   else {
+      if (!s.Kp)
+         s.Kp = CreateCopyMatrix (s.K);
+
+      for (i = 1 ; i <= Msize (s.K) ; i++)
+         CompactData (s.Kp) [i] = CompactData (s.M) [i]/s.c3 +
+                                  CompactData (s.C) [i]*s.c4/s.c3 +
+                                  CompactData (s.K) [i]*s.c5;
+
+      ApplyConstraints (s.Kp, Matrix(), &s.Kp_rows);
+      status = FactorSystemMatrix (s.Kp, s.Kp_solver);
+   }
+
+   if (status) {
+      error ("singular K' matrix in hyperbolic integration - cannot proceed");
+      return 1;
+   }
+
+   return 0;
+}
+
+	/*
+	 * takes d, v and a at time t - dt to d1, v1 and a1 at time t (d1
+	 * may be d, and so on, to step in place).  Every DOF, constrained
+	 * or not, goes into the products on the right hand side; once
+	 * ResolveBC moves the constrained columns of K' across, what is
+	 * left of a constrained DOF's predictor is exactly its share of
+	 * the inertia and damping of the free DOF around it.
+	 */
+
+static void
+NewmarkStep(NewmarkSystem &s, double t, const Vector &d, const Vector &v,
+            const Vector &a, Vector d1, Vector v1, Vector a1)
+{
+   unsigned	i;
+   unsigned	size;
+   double	dpred, vpred;
+
+   size = Mrows (s.F);
+
+	/*
+	 * setup F'(i+1).  First find F(i+1) = F(t + dt), then
+	 * adjust it by tacking on the rest of the stuff on the RHS
+	 * of our implicit update equation.
+	 */
+
+   AssembleTransientForce (t + s.c6, s.bc, s.F);
+
+	/*
+	 * form the left hand side vector (F'(i+1)) as
+	 * M*dpred/c3 + C*(dpred*c4/c3 - vpred*c5 + alpha*v) + alpha*K*d.
+	 * All three products come out of a single sweep of the profile.
+	 */
+
+   for (i = 1 ; i <= size ; i++) {
+      dpred = VectorData (d) [i] +
+              s.dt*VectorData (v) [i] + s.c1*VectorData (a) [i];
+      vpred = VectorData (v) [i] + s.c2*VectorData (a) [i];
+
+      VectorData (s.xm) [i] = dpred;
+      VectorData (s.xc) [i] = dpred*s.c4/s.c3 - vpred*s.c5 +
+                              analysis.alpha*VectorData (v) [i];
+      VectorData (s.xk) [i] = VectorData (d) [i];
+   }
+
+   if (s.Ks)
+      MultiplySparseMatrices (s.y, 1.0/s.c3, s.Ms, s.xm, 1.0, s.Cs, s.xc,
+                              analysis.alpha, s.Ks, s.xk);
+   else
+      MultiplyCompactMatrices (s.y, 1.0/s.c3, s.M, s.xm, 1.0, s.C, s.xc,
+                               analysis.alpha, s.K, s.xk);
+
+   for (i = 1 ; i <= size ; i++) {
+      if (!s.mask [i])
+         VectorData (s.F) [i] += VectorData (s.y) [i];
+      else
+         VectorData (s.F) [i] = 0;
+   }
+
+   ResolveBC (t, s.bc, s.Kp_rows, s.F);
+
+	/*
+	 * solve for K'd(i+1) = F'(i+1) ... the result will go into F
+	 */
+
+   SolveSystemMatrix (s.Kp, s.Kp_solver, s.F);
+
+	/*
+	 * from here we'll solve for a(i+1) and v(i+1)
+	 */
+
+   for (i = 1 ; i <= size ; i++) {
+      dpred = VectorData (d) [i] +
+              s.dt*VectorData (v) [i] + s.c1*VectorData (a) [i];
+      vpred = VectorData (v) [i] + s.c2*VectorData (a) [i];
+
+      VectorData (d1) [i] = VectorData (s.F) [i];
+      VectorData (a1) [i] = (VectorData (d1) [i] - dpred) / s.c3;
+      VectorData (v1) [i] = vpred + s.c4*VectorData (a1) [i];
+   }
+}
+
+	/*
+	 * the local error of a step over the free DOF, relative to the
+	 * largest displacement seen so far.  Expanding the exact solution
+	 * about t and writing da = a1 - a, the leading terms of the errors
+	 * in d1 and in dt*v1 are
+	 *
+	 *	dt^2 [(beta - 1/6) da + D2/24]
+	 *	dt^2 [(gamma - 1/2) da + D2/12]
+	 *
+	 * where D2 = dt^2 a'' comes from the divided difference through
+	 * the acceleration ap at the start of the previous step, of length
+	 * hp, and is left out on the first step.  Both hold for any beta
+	 * and gamma.
+	 */
+
+static double
+NewmarkError(const NewmarkSystem &s, const Vector &ap, double hp,
+             const Vector &a, const Vector &a1, const Vector &d1,
+             double *dmax)
+{
+   unsigned	i;
+   double	cd, cv;
+   double	da, D2;
+   double	ed, ev;
+   double	h2, enorm, dnorm;
+
+   cd = analysis.beta - 1.0/6.0;
+   cv = analysis.gamma - 0.5;
+   h2 = s.dt*s.dt;
+
+   enorm = dnorm = 0.0;
+   for (i = 1 ; i <= Mrows (a) ; i++) {
+      if (s.mask [i])
+         continue;
+
+      da = VectorData (a1) [i] - VectorData (a) [i];
+      if (hp > 0.0)
+         D2 = 2.0*s.dt*(da - s.dt/hp*(VectorData (a) [i] -
+                                      VectorData (ap) [i]))/(hp + s.dt);
+      else
+         D2 = 0.0;
+
+      ed = h2*(cd*da + D2/24.0);
+      ev = h2*(cv*da + D2/12.0);
+      enorm += ed*ed + ev*ev;
+      dnorm += VectorData (d1) [i]*VectorData (d1) [i];
+   }
+
+   if (sqrt (dnorm) > *dmax)
+      *dmax = sqrt (dnorm);
+
+   if (enorm == 0.0)
+      return 0.0;
+   else if (*dmax == 0.0)
+      return HUGE_VAL;
+
+   return sqrt (enorm) / *dmax;
+}
+
+	/*
+	 * the displacements of the output DOF at tau, between t and t +
+	 * dt, from the cubic through d, v at t and d1, v1 at t + dt
+	 */
+
+static void
+InterpolateRow(Matrix dtable, unsigned row, const cvector1u &column,
+               double t, double dt, double tau, const Vector &d,
+               const Vector &v, const Vector &d1, const Vector &v1)
+{
+   unsigned	i, k;
+   double	x;
+   double	h00, h10, h01, h11;
+
+   x = (tau - t)/dt;
+   h00 = (1.0 + 2.0*x)*(1.0 - x)*(1.0 - x);
+   h10 = x*(1.0 - x)*(1.0 - x);
+   h01 = x*x*(3.0 - 2.0*x);
+   h11 = x*x*(x - 1.0);
+
+   for (i = 1 ; i <= column.size() ; i++) {
+      if (!(k = column [i]))
+         MatrixData (dtable) [row][i] = 0.0;
+      else
+         MatrixData (dtable) [row][i] =
+            h00*VectorData (d) [k] + h10*dt*VectorData (v) [k] +
+            h01*VectorData (d1) [k] + h11*dt*VectorData (v1) [k];
+   }
+}
+
+	/*
+	 * error controlled stepping: a step whose error estimate is
+	 * over the tolerance is taken again with a shorter step.  K' has
+	 * to be formed and factored again whenever the step changes, and
+	 * the estimate swings from step to step as the response
+	 * oscillates, so the step only grows after GrowSteps good steps
+	 * in a row, by what the worst of them allows, and only if that
+	 * is more than RefactorRatio.  The step stays within MinStepRatio
+	 * and MaxStepRatio of analysis.step, which sets the output times.
+	 */
+
+# define StepSafety	0.9
+# define ShrinkLimit	0.2
+# define GrowLimit	2.0
+# define RefactorRatio	1.25
+# define GrowSteps	4
+# define MinStepRatio	1e-6
+# define MaxStepRatio	10.0
+
+static int
+AdaptiveHyperbolicDE(NewmarkSystem &s, Vector d, Vector v, Vector a,
+                     Matrix dtable, const cvector1u &column)
+{
+   unsigned	row;
+   unsigned	nsteps;
+   unsigned	steps, rejected, factored;
+   unsigned	good;
+   double	t, tau;
+   double	eta, worst, ratio;
+   double	dt;
+   double	dmax;
+   double	hp;
+   Vector	d1, v1, a1;
+   Vector	ap;
+   Vector	tmp;
+
+   const double tol = analysis.error_tolerance;
+   const double dtmin = MinStepRatio*analysis.step;
+   const double dtmax = MaxStepRatio*analysis.step;
+
+   d1 = CreateVector (Mrows (d));
+   v1 = CreateVector (Mrows (d));
+   a1 = CreateVector (Mrows (d));
+   ap = CreateVector (Mrows (d));
+
+   nsteps = Mrows (dtable);
+   steps = rejected = 0;
+   factored = 1;
+   dmax = 0.0;
+   hp = 0.0;
+   t = 0.0;
+   row = 2;
+   good = 0;
+   worst = 0.0;
+
+   while (row <= nsteps) {
+      NewmarkStep (s, t + s.dt, d, v, a, d1, v1, a1);
+      eta = NewmarkError (s, ap, hp, a, a1, d1, &dmax);
+
+      if (eta > tol) {
+         ratio = StepSafety*cbrt (tol/eta);
+         if (ratio < ShrinkLimit)
+            ratio = ShrinkLimit;
+
+         dt = s.dt*ratio;
+         if (dt < dtmin) {
+            error ("time step underflow at t = %g in adaptive integration", t);
+            return 1;
+         }
+
+         rejected ++;
+         factored ++;
+         good = 0;
+         worst = 0.0;
+         if (FactorEffectiveStiffness (s, dt))
+            return 1;
+
+         continue;
+      }
+
+	/*
+	 * the step is good: fill in the output times it went past
+	 */
+
+      steps ++;
+      tau = (row - 1)*analysis.step;
+      while (row <= nsteps && tau <= t + s.dt*(1.0 + 1e-9)) {
+         InterpolateRow (dtable, row, column, t, s.dt, tau, d, v, d1, v1);
+         tau = (++ row - 1)*analysis.step;
+      }
+
+      t += s.dt;
+      hp = s.dt;
+      tmp = d; d = d1; d1 = tmp;
+      tmp = v; v = v1; v1 = tmp;
+      tmp = ap; ap = a; a = a1; a1 = tmp;
+
+      if (eta > worst)
+         worst = eta;
+      if (++ good < GrowSteps)
+         continue;
+
+      ratio = worst > 0.0 ? StepSafety*cbrt (tol/worst) : GrowLimit;
+      if (ratio > GrowLimit)
+         ratio = GrowLimit;
+
+      good = 0;
+      worst = 0.0;
+
+      dt = s.dt*ratio;
+      if (dt > dtmax)
+         dt = dtmax;
+
+      if (dt > RefactorRatio*s.dt) {
+         factored ++;
+         if (FactorEffectiveStiffness (s, dt))
+            return 1;
+      }
+   }
+
+   detail ("adaptive integration: %u steps, %u rejected, %u factorizations",
+           steps, rejected, factored);
+
+   return 0;
+}
+
+	/*
+	 * the integration itself, for the compact or the sparse matrices
+	 * already stored in s
+	 */
+
+static Matrix
+IntegrateNewmark(NewmarkSystem &s, unsigned size)
 {
-   unsigned	count;
    unsigned	i,j;
    Matrix	dtable;
    Vector	d;
    Vector	a;
    Vector	v;
-   Vector	F;
-   Matrix	Kp;
-   Matrix	Kp_fact;
    Matrix	Mt;
-   double	vpred, dpred, value;
-   unsigned	size;
-   double	c1,c2, c3, c4, c5, c6;
+   SparseMatrix	Mts;
+   LinearSolver	Mt_solver;
    unsigned	step;
    unsigned	nsteps;
-   int		address;
-   int		build_a0; 
+   int		build_a0;
+   int		adaptive;
+   int		status;
    double	t;
 
-   const Node *node = problem.nodes.c_ptr1();
-   const unsigned numnodes = problem.nodes.size();
-   count = problem.num_dofs;
-
 	/*
 	 * a few constants that we will need
 	 */
 
-   size = numnodes*count;
-   c1 = (1.0 - 2.0*analysis.beta) * (analysis.step*analysis.step)/2.0;
-   c2 = analysis.step * (1.0 - analysis.gamma);
-   c3 = analysis.step * analysis.step * analysis.beta;
-   c4 = analysis.step * analysis.gamma;
-   c5 = (1.0 + analysis.alpha);
-   c6 = analysis.alpha * analysis.step;
+   adaptive = analysis.error_tolerance > 0.0;
 
 	/*
 	 * create vectors to hold the conditions at timesteps i and i+1
@@ -354,51 +1009,60 @@ IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C)
    d  = CreateVector (size);
    a  = CreateVector (size);
    v  = CreateVector (size);
-   F  = CreateVector (size);   
+
+   s.F  = CreateVector (size);
+   s.xm = CreateVector (size);
+   s.xc = CreateVector (size);
+   s.xk = CreateVector (size);
+   s.y  = CreateVector (size);
 
 	/*
-	 * create the table of nodal time displacements
+	 * create the table of nodal time displacements, and find the
+	 * equation of each of its columns
 	 */
 
    nsteps = (analysis.stop + analysis.step/2.0) / analysis.step + 1.0;
    dtable = CreateMatrix (nsteps, analysis.nodes.size()*analysis.numdofs);
 
-	/*
-	 * create the K' matrix
-	 */
-
-   Kp = CreateCopyMatrix (K);
-   for (i = 1 ; i <= Msize (K) ; i++)
-      VectorData (Kp) [i] = VectorData (M) [i]/c3 + 
-                            VectorData (C) [i]*c4/c3 + 
-                            VectorData (K) [i]*c5;
+   cvector1u column(analysis.nodes.size()*analysis.numdofs);
+   for (i = 1 ; i <= analysis.nodes.size() ; i++)
+      for (j = 1 ; j <= analysis.numdofs ; j++)
+         column [(i-1)*analysis.numdofs + j] =
+            GlobalDOF(analysis.nodes [i] -> number,analysis.dofs[j]);
 
 	/*
-	 * create a constrained copy of K' and do a one-time
-	 * factorization on it.  This is the matrix that we will
-	 * use as the RHS of our implicit update equation
+	 * create the K' matrix and do a one-time factorization on it
+	 * (adaptive stepping starts with a step of analysis.step)
 	 */
 
-   ZeroConstrainedDOF (Kp, Matrix(), &Kp_fact, NULL);
-   if (CroutFactorMatrix (Kp_fact)) {
-      error ("singular K' matrix in hyperbolic integration - cannot proceed");
+   if (FactorEffectiveStiffness (s, analysis.step))
       return Matrix();
-   }
-   
-	/* 
+
+	/*
 	 * build the initial displacement and velocity vectors from the
-	 * initial conditions	
+	 * initial conditions
  	 */
 
-   cvector1i constraint_mask = BuildConstraintMask ( );
+   s.mask = BuildConstraintMask ( );
    build_a0 = BuildHyperbolicIC (d, v, a);
+   BuildTransientBC (s.bc);
+
+	/*
+	 * the forcing can only be tabulated ahead of time on a fixed
+	 * grid of steps
+	 */
+
+   if (analysis.tabulate && !adaptive) {
+      TabulateTransientDOFs (s.bc.forced, s.c6, analysis.step, nsteps, 0);
+      TabulateTransientDOFs (s.bc.prescribed, 0.0, analysis.step, nsteps, 0);
+   }
 
 	/*
 	 * build the F(0) vector, we only need this to get a(0),
 	 * after this, we really will use F as F(i+1)
 	 */
 
-   AssembleTransientForce (0.0, F);
+   AssembleTransientForce (0.0, s.bc, s.F);
 
 	/*
 	 * solve for the initial acceleration vector.  First we factorize
@@ -407,25 +1071,47 @@ IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C)
 	 */
 
    if (build_a0) {
-       ZeroConstrainedDOF (M, Matrix(), &Mt, NULL);
+      if (s.Ks) {
+         ZeroConstrainedDOF (s.Ms, Matrix(), &Mts, NULL);
+         status = FactorSystemMatrix (Mts, Mt_solver);
+      }
+      else {
+         ZeroConstrainedDOF (s.M, Matrix(), &Mt, NULL);
+         status = FactorSystemMatrix (Mt, Mt_solver);
+      }
 
-      if (CroutFactorMatrix (Mt)) {
+      if (status) {
          error ("singular M matrix in hyperbolic integration - cannot proceed");
          return Matrix();
       }
 
-      MultiplyMatrices (a, K, d);
-      SubtractMatrices (a, F, a);
-      MultiplyMatrices (F, C, v);
-      SubtractMatrices (a, a, F);
+      if (s.Ks)
+         MultiplySparseMatrices (s.y, 1.0, s.Ks, d, 1.0, s.Cs, v,
+                                 0.0, SparseMatrix(), Matrix());
+      else
+         MultiplyCompactMatrices (s.y, 1.0, s.K, d, 1.0, s.C, v,
+                                  0.0, Matrix(), Matrix());
+
+      SubtractMatrices (a, s.F, s.y);
 
-      if (CroutBackSolveMatrix (Mt, a)) {
+      if (SolveSystemMatrix (Mt, Mt_solver, a)) {
          error ("singular M matrix in hyperbolic integration - cannot proceed");
          return Matrix();
       }
+
+      Mt.reset();
+      Mts.reset();
+      Mt_solver = LinearSolver();
+
+	/*
+	 * the solve leaves the reactions in the constrained rows; a
+	 * constrained DOF starts out with no acceleration
+	 */
+
+      for (i = 1 ; i <= size ; i++)
+         if (s.mask [i])
+            VectorData (a) [i] = 0.0;
    }
-   else
-       Mt.reset();
 
 
 	/*
@@ -433,11 +1119,14 @@ IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C)
 	 * This is basically a copy of the code at the end of the loop.
 	 */
 
-   for (i = 1 ; i <= analysis.nodes.size() ; i++) {
-      for (j = 1 ; j <= analysis.numdofs ; j++) {
-         MatrixData (dtable) [1][(i-1)*analysis.numdofs + j] = 
-           sdata(d, GlobalDOF(analysis.nodes [i] -> number,analysis.dofs[j]),1);
-      }
+   for (i = 1 ; i <= column.size() ; i++)
+      MatrixData (dtable) [1][i] = (column [i] ? sdata(d, column [i], 1) : 0.0);
+
+   if (adaptive) {
+      if (AdaptiveHyperbolicDE (s, d, v, a, dtable, column))
+         return Matrix();
+
+      return dtable;
    }
 
 	/*
@@ -446,110 +1135,79 @@ IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C)
 	 */
 
    for (step = 2 ; step <= nsteps ; step++) {
-      
-	/*
-	 * setup F'(i+1).  First find F(i+1) = F(t + dt), then
-	 * adjust it by tacking on the rest of the stuff on the RHS
-	 * of our implicit update equation.
-	 */
-
-      t = (step - 1.0)*analysis.step;	
-      AssembleTransientForce (t+c6, F);      
+      t = (step - 1.0)*analysis.step;
+      NewmarkStep (s, t, d, v, a, d, v, a);
 
 	/*
-	 * form the left hand side vector (F'(i+1))
+	 * copy the relevant parts of the displacement vector
+	 * into the displacement table
 	 */
 
-      for (i = 1 ; i <= size ; i++) {
-         if (!constraint_mask [i]) {
-
-            value = 0.0;
-            for (j = 1 ; j <= size ; j++) {
-               if (!constraint_mask [j]) {
-                  address = ConvertRowColumn (i, j, K);
-                  if (address) {
-                     dpred = VectorData (d) [j] + 
-                             analysis.step*VectorData (v) [j] +
-                             c1*VectorData (a) [j];
-                     vpred = VectorData (v) [j] + c2*VectorData (a) [j];
-   
-                     value += VectorData (M) [address]*dpred/c3 +
-                              VectorData (C) [address]*(dpred*c4/c3 - vpred*c5 +
-                                             analysis.alpha*VectorData (v) [j]) +
-                              VectorData (K) [address]*VectorData (d) [j]*analysis.alpha;
-                  }
-               }
-            }
-            VectorData (F) [i] += value;
-         }
-         else
-            VectorData (F) [i] = 0;
-      }
+      for (i = 1 ; i <= column.size() ; i++)
+         MatrixData (dtable) [step][i] = (column [i] ? sdata(d, column [i], 1) : 0.0);
+   }
 
-      ResolveBC (t, Kp, F);
+   return dtable;
+}
 
-	/*
-	 * solve for K'd(i+1) = F'(i+1) ... the result will go into F 
-	 */
+Matrix
+IntegrateHyperbolicDE(const Vector &K, const Vector &M, const Vector &C)
+{
+   NewmarkSystem s;
 
-      CroutBackSolveMatrix (Kp_fact, F);
-   
-	/*
-	 * from here we'll solve for a(i+1) and v(i+1)
-	 */
-      
-      for (i = 1 ; i <= size ; i++) {
-         dpred = VectorData (d) [i] + 
-                 analysis.step*VectorData (v) [i] + c1*VectorData (a) [i];
-         vpred = VectorData (v) [i] + c2*VectorData (a) [i];
+   s.K = K;
+   s.M = M;
+   s.C = C;
 
-         VectorData (d) [i] = VectorData (F) [i];
-         VectorData (a) [i] = (VectorData (d) [i] - dpred) / c3;
-         VectorData (v) [i] = vpred + c4*VectorData (a) [i];
-      }
+   return IntegrateNewmark (s, Mrows(K));
+}
 
-	/*
-	 * copy the relevant parts of the displacement vector
-	 * into the displacement table
-	 */
+Matrix
+IntegrateHyperbolicDE(const SparseMatrix &K, const SparseMatrix &M, const SparseMatrix &C)
+{
+   NewmarkSystem s;
 
-      for (i = 1 ; i <= analysis.nodes.size() ; i++) {
-         for (j = 1 ; j <= analysis.numdofs ; j++) {
-            MatrixData (dtable) [step][(i-1)*analysis.numdofs + j] = 
-               sdata(d, GlobalDOF(analysis.nodes [i] -> number,analysis.dofs[j]),1);
-         }
-      }
-   }    
+   s.Ks = K;
+   s.Ms = M;
+   s.Cs = C;
 
-   return dtable;
+   return IntegrateNewmark (s, Mcols(K));
 }
 
-Matrix
-IntegrateParabolicDE(const Vector &K, const Vector &M)
+	/*
+	 * the trapezoidal integration for either the compact K and M or
+	 * the sparse Ks and Ms; the other pair is null
+	 */
+
+static Matrix
+IntegrateTrapezoidal(const Vector &K, const Vector &M,
+                     const SparseMatrix &Ks, const SparseMatrix &Ms)
 {
-   unsigned	count;
    unsigned	i, j;
+   unsigned	dof;
    Matrix	dtable;
    Vector	d;
    Vector	F, F1;
-   Matrix	Kp, Kp_fact;
-   double	value;
+   Vector	y;
+   Matrix	Kp;
+   SparseMatrix	Kps;
+   int		status;
+   ConstrainedRows Kp_rows;
+   TransientBC	bc;
+   LinearSolver	Kp_solver;
    unsigned	size;
    double	c1,c2;
    unsigned	step;
    unsigned	nsteps;
-   int		address;
    double	curr_time;
 
-   count = problem.num_dofs;
    const Node *node = problem.nodes.c_ptr1();
-   const unsigned numnodes = problem.nodes.size();
 
 	/*
 	 * a few constants that we will need
 	 */
 
-   size = numnodes*count;
+   size = Ks ? Mcols(Ks) : Mrows(K);
    c1 = analysis.step * analysis.alpha;
    c2 = (1.0 - analysis.alpha) * analysis.step;
 
@@ -560,6 +1218,7 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
    d  = CreateVector (size);
    F  = CreateVector (size);   
    F1 = CreateVector (size);   
+   y  = CreateVector (size);
 
 	/*
 	 * create the table of nodal time displacements
@@ -569,20 +1228,32 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
    dtable = CreateMatrix (nsteps, analysis.nodes.size()*analysis.numdofs);
 
 	/*
-	 * create the K' matrices and do a one time factorization.  We
-	 * knock out the constrained rows and columns in the matrix that
-	 * we will factor but we don't bother with adjusting the force
+	 * create the K' matrix and do a one time factorization.  We
+	 * knock out the constrained rows and columns in place (saving
+	 * them for ResolveBC) but we don't bother with adjusting the force
 	 * vector since it will change with transient forces and transient
  	 * adjustments due to time varying boundary conditions.
 	 */
 
-   Kp = CreateCopyMatrix (K);
-   for (i = 1 ; i <= Msize (K) ; i++) 
-      VectorData (Kp) [i] = VectorData (M) [i] + 
-                            VectorData (Kp) [i]*c1;
+   if (Ks) {
+      Kps = CreateSparseMatrix (Ks -> nrows, Ks -> ncols, Ks -> colptr, Ks -> rowind, 1);
+      for (i = 1 ; i <= Ks -> nnz ; i++)
+         SparseData (Kps) [i] = SparseData (Ms) [i] + SparseData (Ks) [i]*c1;
 
-   ZeroConstrainedDOF (Kp, Matrix(), &Kp_fact, NULL);
-   if (CroutFactorMatrix (Kp_fact)) {
+      ApplyConstraints (Kps, Matrix(), &Kp_rows);
+      status = FactorSystemMatrix (Kps, Kp_solver);
+   }
+   else {
+      Kp = CreateCopyMatrix (K);
+      for (i = 1 ; i <= Msize (K) ; i++) 
+         CompactData (Kp) [i] = CompactData (M) [i] + 
+                                CompactData (Kp) [i]*c1;
+
+      ApplyConstraints (Kp, Matrix(), &Kp_rows);
+      status = FactorSystemMatrix (Kp, Kp_solver);
+   }
+
+   if (status) {
       error ("error in parabolic integration - K' matrix is singular.");
       return Matrix();
    }
@@ -594,6 +1265,12 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
 
    cvector1i constraint_mask = BuildConstraintMask ( );
    BuildParabolicIC (d);
+   BuildTransientBC (bc);
+
+   if (analysis.tabulate) {
+      TabulateTransientDOFs (bc.forced, 0.0, analysis.step, nsteps, 0);
+      TabulateTransientDOFs (bc.prescribed, 0.0, analysis.step, nsteps, 0);
+   }
 
 	/*
 	 * Copy the initial displacement vector into the table.
@@ -601,8 +1278,9 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
 
    for (i = 1 ; i <= analysis.nodes.size() ; i++) {
       for (j = 1 ; j <= analysis.numdofs ; j++) {
+         dof = GlobalDOF (analysis.nodes [i] -> number,  analysis.dofs[j]);
          MatrixData (dtable) [1][(i-1)*analysis.numdofs + j] = 
-           VectorData (d)[GlobalDOF (analysis.nodes [i] -> number,  analysis.dofs[j])];
+           (dof ? VectorData (d)[dof] : 0.0);
       }
    }
 
@@ -610,7 +1288,7 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
 	 * construct the force vector at time t = 0
 	 */
 
-   AssembleTransientForce (0.0, F);      
+   AssembleTransientForce (0.0, bc, F);      
 
 	/*
 	 * iterate over every time step.  Fill up dtable with
@@ -624,29 +1302,26 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
 	 * setup the adjusted force vector at time t(i+1)
 	 */
 
-      AssembleTransientForce (curr_time, F1);      
+      AssembleTransientForce (curr_time, bc, F1);      
 
 	/*
 	 * form the RHS of the update equation
 	 */
 
+      if (Ks)
+         MultiplySparseMatrices (y, 1.0, Ms, d, -c2, Ks, d, 0.0, SparseMatrix(), Matrix());
+      else
+         MultiplyCompactMatrices (y, 1.0, M, d, -c2, K, d, 0.0, Matrix(), Matrix());
+
       for (i = 1 ; i <= size ; i++) {
-         if (!constraint_mask [i]) {
-            value = 0.0;
-            for (j = 1 ; j <= size ; j++) {
-               address = ConvertRowColumn (i, j, K);
-               if (address) 
-                  value += (VectorData(M) [address] - 
-                            c2*VectorData(K) [address])*VectorData(d) [j];
-            }
-            VectorData (F) [i] = value +
+         if (!constraint_mask [i]) 
+            VectorData (F) [i] = VectorData (y) [i] +
                            (c2*VectorData(F) [i] + c1*VectorData(F1) [i]);
-         }
          else
             VectorData (F) [i] = 0.0;
       }
      
-      ResolveBC (curr_time, Kp, F);
+      ResolveBC (curr_time, bc, Kp_rows, F);
 
 	/*
 	 * solve K'd(i+1) = (M - c2*K)d(i) + c1*F(i+1) + c2*F(i) ...
@@ -654,7 +1329,7 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
 	 * the result will go as well
 	 */
 
-      CroutBackSolveMatrix (Kp_fact, F);
+      SolveSystemMatrix (Kp, Kp_solver, F);
  
 	/*
 	 * copy the relevant parts of the displacement vector
@@ -665,8 +1340,9 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
 
       for (i = 1 ; i <= analysis.nodes.size() ; i++) {
          for (j = 1 ; j <= analysis.numdofs ; j++) {
+            dof = GlobalDOF (analysis.nodes [i] -> number,  analysis.dofs[j]);
             MatrixData (dtable) [step][(i-1)*analysis.numdofs + j] = 
-              VectorData (d)[GlobalDOF (analysis.nodes [i] -> number,  analysis.dofs[j])];
+              (dof ? VectorData (d)[dof] : 0.0);
          }
       }
 
@@ -676,12 +1352,24 @@ IntegrateParabolicDE(const Vector &K, const Vector &M)
    return dtable;
 }
 
+Matrix
+IntegrateParabolicDE(const Vector &K, const Vector &M)
+{
+   return IntegrateTrapezoidal (K, M, SparseMatrix(), SparseMatrix());
+}
+
+Matrix
+IntegrateParabolicDE(const SparseMatrix &K, const SparseMatrix &M)
+{
+   return IntegrateTrapezoidal (Matrix(), Matrix(), K, M);
+}
+
 int
 BuildHyperbolicIC(Vector d, Vector v, Vector a)
 {
    unsigned	active;
    unsigned	*dofs;
-   unsigned	i,j,
+   unsigned	i,j,n,
 		base_dof;
    unsigned	size;
    int		build_a0;
@@ -689,9 +1377,10 @@ BuildHyperbolicIC(Vector d, Vector v, Vector a)
    const unsigned numnodes = problem.nodes.size();
    active  = problem.num_dofs;
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    dofs = problem.dofs_num;
 
-   size = numnodes*active;
+   size = problem.num_equations;
 
    for (i = 1 ; i <= size ; i++) {
       VectorData (d) [i] = 0.0;
@@ -706,18 +1395,21 @@ BuildHyperbolicIC(Vector d, Vector v, Vector a)
       base_dof = active*(node[i] -> number - 1);
 
       for (j = 1 ; j <= active ; j++) {
-         VectorData (d) [base_dof+j] = node[i] -> constraint -> ix[dofs[j]];
+         if (!(n = eqn [base_dof + j]))
+            continue;
+
+         VectorData (d) [n] = node[i] -> constraint -> ix[dofs[j]];
          if (dofs[j] <= 3) {
-            VectorData (v) [base_dof+j] = node[i] -> constraint -> vx[dofs[j]];
+            VectorData (v) [n] = node[i] -> constraint -> vx[dofs[j]];
             if (node [i] -> constraint -> ax[dofs[j]] != UnspecifiedValue) {
                build_a0 = 0;
-               VectorData (a) [base_dof+j] = 
+               VectorData (a) [n] = 
                                  node[i] -> constraint -> ax[dofs[j]];
             }
          }
          else {
-            VectorData (v) [base_dof+j] = 0.0;
-            VectorData (a) [base_dof+j] = 0.0;
+            VectorData (v) [n] = 0.0;
+            VectorData (a) [n] = 0.0;
          }
       }
    }
@@ -734,9 +1426,10 @@ BuildParabolicIC(Vector d)
    unsigned	size;
 
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    dofs = problem.dofs_num;
 
-   size = problem.nodes.size()*problem.num_dofs;
+   size = problem.num_equations;
 
    for (i = 1 ; i <= size ; i++) 
       VectorData (d) [i] = 0.0;
@@ -746,7 +1439,8 @@ BuildParabolicIC(Vector d)
       base_dof = problem.num_dofs*(node[i] -> number - 1);
 
       for (j = 1 ; j <= problem.num_dofs ; j++) 
-         VectorData (d) [base_dof + j] = node[i] -> constraint -> ix[dofs[j]];
+         if (eqn [base_dof + j])
+            VectorData (d) [eqn [base_dof + j]] = node[i] -> constraint -> ix[dofs[j]];
    }
 
    return;
@@ -762,11 +1456,12 @@ BuildConstraintMask(void)
    int		numdofs;
 
    const Node *node = problem.nodes.c_ptr1();
+   const unsigned *eqn = problem.equations.c_ptr1();
    const unsigned numnodes = problem.nodes.size();
    active = problem.num_dofs;
    dofs = problem.dofs_num;
 
-   numdofs = numnodes * active;
+   numdofs = problem.num_equations;
    
    cvector1i mask(numdofs, 0);
 
@@ -774,50 +1469,37 @@ BuildConstraintMask(void)
       base_dof = active*(node[i] -> number - 1);
       for (j = 1 ; j <= active ; j++) {
 
-         if (node[i] -> constraint -> constraint[dofs[j]]) 
-            mask [base_dof + j] = 1;
+         if (node[i] -> constraint -> constraint[dofs[j]] && eqn [base_dof + j]) 
+            mask [eqn [base_dof + j]] = 1;
       }
    }
 
    return mask;
 }
 
+	/*
+	 * only a displacement that is not zero has to be carried over to
+	 * the rest of the force vector
+	 */
+
 void
-ResolveBC(double t, Vector K, Vector F)
+ResolveBC(double t, const TransientBC &bc, const ConstrainedRows &saved, Vector F)
 {
-   unsigned	*dofs;
-   unsigned	active;
-   unsigned	i,j;
-   unsigned	curr_dof,
-		base_dof;
-   unsigned	numdofs;
+   unsigned	i;
+   unsigned	curr_dof;
+   unsigned	col;
    double	dx;
 
-   const Node *node = problem.nodes.c_ptr1();
-   active = problem.num_dofs;
-   dofs = problem.dofs_num;
+   col = SeriesColumn (bc.prescribed, t);
 
-   numdofs = active*problem.nodes.size();
+   for (i = 1 ; i <= bc.prescribed.dofs.size() ; i++) {
+      curr_dof = bc.prescribed.dofs [i];
+      dx = DOFValue (bc.prescribed, i, t, col);
 
-   for (i = 1 ; i <= problem.nodes.size() ; i++) {
-      base_dof = active*(node[i] -> number - 1);
-
-      for (j = 1 ; j <= active ; j++) {
-         curr_dof = base_dof + j;
-
-         if (node[i] -> constraint -> constraint[dofs[j]]) {
-
-            if (node[i] -> constraint -> dx [dofs[j]].expr != NULL)
-               dx = EvalCode (node[i] -> constraint -> dx [dofs[j]].expr, t);
-            else
-               dx = node[i] -> constraint -> dx [dofs[j]].value;
-
-            AdjustForceVector (F, K, curr_dof, dx);
-            VectorData (F) [curr_dof] = dx;
-
-         } /* end nodal DOF constrained check */
-      }	/* end DOF loop */
-   } /* end node loop */
+      if (dx)
+         AdjustConstrainedForce (F, saved, curr_dof, dx);
+      VectorData (F) [curr_dof] = dx;
+   }
 
    return;
 }
@@ -31,7 +31,7 @@ int ZeroMatrix (Matrix &a)
 
    if (IsCompact(a)) 
       for (i = 1 ; i <= Msize(a) ; i++)
-         sdata(a, i, 1) = 0.0;
+         CompactData (a) [i] = 0.0;
    else {
       for (i = 1 ; i <= Mrows(a) ; i++)
          for (j = 1 ; j <= Mcols(a) ; j++)
@@ -66,10 +66,13 @@ int CopyMatrix (Matrix &b, const Matrix &a)
       return M_SIZEMISMATCH;
 
    if (IsCompact(b)) {
-      for (i = 1 ; i <= Msize(a) ; i++) {
-         b -> data [i][1] = a -> data [i][1];
-         b -> diag [i] = a -> diag [i];
-      }
+      if (Msize(a) != Msize(b))
+         return M_SIZEMISMATCH;
+
+      for (i = 1 ; i <= Msize(a) ; i++)
+         CompactData (b) [i] = CompactData (a) [i];
+
+      b -> diag = a -> diag;
    }
    else {
       for (i = 1 ; i <= Mrows(a) ; i++)
@@ -250,6 +253,129 @@ int Gaxpy (Matrix &c, const Matrix &a, const Matrix &b, const Matrix &A)
       for (j = 1 ; j <= Mrows(A) ; j++)
          sdata(c,j,1) += mdata(a, i, 1) * mdata(A, j, i); 
 
+   return 0;
+}
+
+	/*
+	 * accumulate y += sum_m s[m] * K[m] * x[m] for N symmetric compact
+	 * matrices that share one profile (diag).  Each column is walked
+	 * once; the stored (upper) entry k(i,j) contributes both to row j
+	 * and, by symmetry, to row i.
+	 */
+
+template <unsigned N>
+static void
+CompactProduct (double *y, unsigned n, const unsigned *diag,
+                const double *const *K, const double *const *x, const double *s)
+{
+   unsigned	i, j, k, m;
+   unsigned	start;
+   double	xj [N];
+   double	sum [N];
+   double	kij;
+
+   start = 1;
+   for (j = 1 ; j <= n ; j++) {
+      i = j - (diag [j] - start);
+
+      for (m = 0 ; m < N ; m++) {
+         xj [m] = x [m][j];
+         sum [m] = 0.0;
+      }
+
+      for (k = start ; k < diag [j] ; k++, i++) {
+         for (m = 0 ; m < N ; m++) {
+            kij = K [m][k];
+            sum [m] += kij * x [m][i];
+            y [i] += s [m] * kij * xj [m];
+         }
+      }
+
+      for (m = 0 ; m < N ; m++)
+         y [j] += s [m] * (sum [m] + K [m][diag [j]] * xj [m]);
+
+      start = diag [j] + 1;
+   }
+}
+
+int MultiplyCompactMatrices (Matrix &y, double alpha, const Matrix &A, const Matrix &a,
+                             double beta, const Matrix &B, const Matrix &b,
+                             double gamma, const Matrix &C, const Matrix &c)
+{
+   unsigned	i, n;
+   unsigned	count;
+   double	*yv;
+   const double	*K [3];
+   const double	*x [3];
+   double	s [3];
+
+   if (IsCompact(y))
+      return M_COMPACT;
+
+   if (IsFull(A))
+      return M_NOTCOMPACT;
+
+   if (!IsColumnVector(y) || !IsColumnVector(a))
+      return M_NOTCOLUMN;
+
+   n = Mrows(A);
+   if (Mrows(y) != n || Mrows(a) != n)
+      return M_SIZEMISMATCH;
+
+   if (y == a)
+      return M_NOOVERWRITE;
+
+   count = 0;
+   K [count] = CompactData (A);
+   x [count] = VectorData (a);
+   s [count ++] = alpha;
+
+   if (B) {
+      if (IsFull(B))
+         return M_NOTCOMPACT;
+      if (!IsColumnVector(b))
+         return M_NOTCOLUMN;
+      if (Mrows(B) != n || Msize(B) != Msize(A) || Mrows(b) != n)
+         return M_SIZEMISMATCH;
+      if (y == b)
+         return M_NOOVERWRITE;
+
+      K [count] = CompactData (B);
+      x [count] = VectorData (b);
+      s [count ++] = beta;
+   }
+
+   if (C) {
+      if (IsFull(C))
+         return M_NOTCOMPACT;
+      if (!IsColumnVector(c))
+         return M_NOTCOLUMN;
+      if (Mrows(C) != n || Msize(C) != Msize(A) || Mrows(c) != n)
+         return M_SIZEMISMATCH;
+      if (y == c)
+         return M_NOOVERWRITE;
+
+      K [count] = CompactData (C);
+      x [count] = VectorData (c);
+      s [count ++] = gamma;
+   }
+
+   yv = VectorData (y);
+   for (i = 1 ; i <= n ; i++)
+      yv [i] = 0.0;
+
+   switch (count) {
+   case 1:
+      CompactProduct <1> (yv, n, A -> diag.c_ptr1(), K, x, s);
+      break;
+   case 2:
+      CompactProduct <2> (yv, n, A -> diag.c_ptr1(), K, x, s);
+      break;
+   default:
+      CompactProduct <3> (yv, n, A -> diag.c_ptr1(), K, x, s);
+      break;
+   }
+
    return 0;
 }
 
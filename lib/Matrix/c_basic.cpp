@@ -32,8 +32,8 @@ int ZeroComplexMatrix (ComplexMatrix &a)
 
    if (IsCompact(a)) 
       for (i = 1 ; i <= Msize(a) ; i++) {
-         rdata(a, i, 1) = 0.0;
-         idata(a, i, 1) = 0.0;
+         CompactData (a) [i].r = 0.0;
+         CompactData (a) [i].i = 0.0;
       }
    else {
       for (i = 1 ; i <= Mrows(a) ; i++) {
@@ -75,12 +75,13 @@ int CopyComplexMatrix (ComplexMatrix &b, const ComplexMatrix &a)
       return M_SIZEMISMATCH;
 
    if (IsCompact(b)) {
-      for (i = 1 ; i <= Msize(a) ; i++) {
-         b -> data [i][1].r = a -> data [i][1].r;
-         b -> diag [i] = a -> diag [i];
-         b -> data [i][1].i = a -> data [i][1].i;
-         b -> diag [i] = a -> diag [i];
-      }
+      if (Msize(a) != Msize(b))
+         return M_SIZEMISMATCH;
+
+      for (i = 1 ; i <= Msize(a) ; i++)
+         CompactData (b) [i] = CompactData (a) [i];
+
+      b -> diag = a -> diag;
    }
    else {
       for (i = 1 ; i <= Mrows(a) ; i++) {
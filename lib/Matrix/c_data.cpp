@@ -44,7 +44,7 @@ complex cmdata (const ComplexMatrix &A, unsigned int row, unsigned int col)
          height = A -> diag [col] - A -> diag [col - 1];
 
       if (row > col - height)
-         return A -> data [A -> diag [col] + row - col][1]; 
+         return CompactData (A) [A -> diag [col] + row - col]; 
       else
          return zero();
    }
@@ -99,9 +99,22 @@ complex_matrix::~complex_matrix()
 ComplexMatrix CreateCompactComplexMatrix (unsigned int rows, unsigned int cols,
                                           unsigned int size, const cvector1<unsigned> *diag)
 {
-   ComplexMatrix	A;
+   ComplexMatrix A(new struct complex_matrix);
 
-   A = CreateFullComplexMatrix (size, 1);
+	/*
+	 * one row pointer to a single flat coefficient array, just
+	 * like the real compact matrices
+	 */
+
+   A -> data = (complex **) malloc (sizeof (complex *));
+   if (A -> data == NULL)
+	Fatal ("unable to allocate compact matrix");
+   A -> data --;
+
+   A -> data [1] = (complex *) malloc (sizeof (complex) * (size ? size : 1));
+   if (A -> data [1] == NULL)
+	Fatal ("unable to allocate compact matrix");
+   A -> data [1] --;
 
    A -> nrows = rows; 
    A -> ncols = cols;
@@ -207,14 +220,14 @@ ComplexMatrix MakeCompactFromFullComplex (const ComplexMatrix &A)
    compA = CreateCompactComplexMatrix (rows, cols, size, NULL);
 
    diag [1] = 1;
-   compA -> data [1][1] = cmdata (A, 1, 1);
+   CompactData (compA) [1] = cmdata (A, 1, 1);
   
    for (i = 2 ; i <= cols ; i++) {
       height = diag [i];
       diag [i] += diag [i-1];
       curr_row = i - height + 1 ;
       for (k = diag [i] - height + 1 ; k <= diag [i] ; k++) 
-         compA -> data [k][1] = cmdata (A, curr_row++, i);
+         CompactData (compA) [k] = cmdata (A, curr_row++, i);
    }
 
    compA -> diag = diag;
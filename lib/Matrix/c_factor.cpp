@@ -263,7 +263,8 @@ int CroutFactorComplexMatrix (ComplexMatrix &A)
           	icolht,iilast,
           	length,jtemp,jlngth;
    complex	dot, temp;
-   unsigned	n, k;
+   unsigned	n;
+   complex	*a;
 
    if (IsFull(A))
       return M_NOTCOMPACT;
@@ -272,6 +273,7 @@ int CroutFactorComplexMatrix (ComplexMatrix &A)
       return M_NOTSQUARE;
   
    n = Mrows(A);
+   a = CompactData (A);
 
    jj = 0;
    for (j = 1; j <= n; j++) {
@@ -298,12 +300,8 @@ int CroutFactorComplexMatrix (ComplexMatrix &A)
                length = jlngth;
             
             if (length > 0) {
-               dot.r = 0.0;
-               dot.i = 0.0;
-               for (k = 0 ; k < length ; k++)
-                  dot = add(dot, mult(A -> data [ii-length+k][1],A -> data[ij-length+k][1]));
-
-               A -> data [ij][1] = sub(A -> data [ij][1],dot);
+               dot = ComplexDotKernel (&a [ii-length], &a [ij-length], length);
+               a [ij] = sub(a [ij],dot);
             }
 
             ij++;
@@ -317,10 +315,10 @@ int CroutFactorComplexMatrix (ComplexMatrix &A)
 
             ii = A -> diag [jtemp + ij];
            
-            if (re(A -> data [ii][1]) != 0.0 || im(A -> data [ii][1]) != 0) {
-               temp = A -> data [ij][1];
-               A -> data [ij][1] = cdiv(temp,A -> data [ii][1]);
-               A -> data [jj][1] = sub(A -> data [jj][1], mult(temp,A -> data [ij][1]));
+            if (re(a [ii]) != 0.0 || im(a [ii]) != 0) {
+               temp = a [ij];
+               a [ij] = cdiv(temp,a [ii]);
+               a [jj] = sub(a [jj], mult(temp,a [ij]));
             }
          }
       }
@@ -333,10 +331,12 @@ int CroutBackSolveComplexMatrix (const ComplexMatrix &A, ComplexMatrix &b)
 {
    unsigned	 jj,j,jjlast,
 		 jcolht,jjnext,
-          	 istart,jtemp,i;
+          	 istart,jtemp;
    complex	 Ajj; 
-   unsigned	 n, k;
+   unsigned	 n;
    complex	 dot;
+   const complex *a;
+   complex	*x;
 
    if (IsFull(A))
       return M_NOTCOMPACT;
@@ -348,6 +348,8 @@ int CroutBackSolveComplexMatrix (const ComplexMatrix &A, ComplexMatrix &b)
       return M_SIZEMISMATCH;
 
    n = Mrows(A);
+   a = CompactData (A);
+   x = VectorData (b);
 
    jj = 0;
    for (j = 1 ; j <= n ; j++) {
@@ -357,19 +359,15 @@ int CroutBackSolveComplexMatrix (const ComplexMatrix &A, ComplexMatrix &b)
       jcolht = jj - jjlast;
 
       if (jcolht > 1) {
-         dot.r = 0;
-         dot.i = 0;
-         for (k = 0 ; k < jcolht-1 ; k++)
-            dot = add(dot, mult(A -> data [jjlast+1+k][1],b -> data [j-jcolht+1+k][1]));
-
-         b -> data [j][1] = sub(b -> data [j][1],dot);
+         dot = ComplexDotKernel (&a [jjlast+1], &x [j-jcolht+1], jcolht-1);
+         x [j] = sub(x [j],dot);
       }
    }
 
    for (j = 1 ; j <= n ; j++) {
-      Ajj = A -> data [A -> diag[j]][1];
+      Ajj = a [A -> diag[j]];
       if (re(Ajj) != 0.0 || im(Ajj) != 0)
-         b -> data [j][1] = cdiv(b -> data [j][1], Ajj);
+         x [j] = cdiv(x [j], Ajj);
    }
 
    if (n == 1)
@@ -387,11 +385,166 @@ int CroutBackSolveComplexMatrix (const ComplexMatrix &A, ComplexMatrix &b)
           istart = j - jcolht + 1;
           jtemp = jjnext - istart + 1;
 
-          for (i = istart ; i <= j-1 ; i++) 
-             b -> data [i][1] = sub(b -> data [i][1], 
-                                    mult(A -> data [jtemp + i][1],b -> data[j][1]));
+          ComplexAxpyKernel (&x [istart], negate(x [j]), &a [jtemp + istart], j - istart);
+      }
+   }
+
+   return 0;
+}
+
+	/*
+	 * the complex analogue of CroutBackSolveBlock (see factor.cpp)
+	 */
+
+# define BackSolveBlock		16
+
+	/*
+	 * a block row of w complex values is handled as 2w doubles so that
+	 * the loops vectorize: the products with the real and imaginary
+	 * parts of a coefficient are accumulated separately (in p and q)
+	 * and only recombined once per row
+	 */
+
+template <unsigned W>
+static void CroutComplexBlockPass (const unsigned *diag, const complex *a, complex **x,
+                                   unsigned n, unsigned c0)
+{
+   unsigned	jj, j, jjlast, jjnext;
+   unsigned	i, k, c;
+   double	p [2*BackSolveBlock], q [2*BackSolveBlock];
+   double	ar, ai;
+   double	*xi, *xj;
+   complex	*zj;
+   complex	Ajj;
+
+   jj = 0;
+   for (j = 1 ; j <= n ; j++) {
+      jjlast = jj;
+      jj = diag [j];
+      xj = (double *) (x [j] + c0);
+
+      for (c = 0 ; c < 2*W ; c++) {
+         p [c] = xj [c];
+         q [c] = 0.0;
+      }
+
+      for (k = jjlast + 1, i = j - (jj - jjlast) + 1 ; k < jj ; k++, i++) {
+         ar = a [k].r;
+         ai = a [k].i;
+         xi = (double *) (x [i] + c0);
+         for (c = 0 ; c < 2*W ; c++) {
+            p [c] -= ar * xi [c];
+            q [c] += ai * xi [c];
+         }
+      }
+
+      for (c = 0 ; c < W ; c++) {
+         xj [2*c]   = p [2*c] + q [2*c+1];
+         xj [2*c+1] = p [2*c+1] - q [2*c];
+      }
+   }
+
+   for (j = 1 ; j <= n ; j++) {
+      Ajj = a [diag [j]];
+      if (re(Ajj) != 0.0 || im(Ajj) != 0.0) {
+         zj = x [j] + c0;
+         for (c = 0 ; c < W ; c++)
+            zj [c] = cdiv (zj [c], Ajj);
+      }
+   }
+
+   for (j = n ; j >= 2 ; j--) {
+      jj = diag [j];
+      jjnext = diag [j-1];
+      xj = (double *) (x [j] + c0);
+
+      for (c = 0 ; c < W ; c++) {
+         p [2*c]   = xj [2*c];
+         p [2*c+1] = xj [2*c+1];
+         q [2*c]   = -xj [2*c+1];
+         q [2*c+1] = xj [2*c];
       }
+
+      for (k = jjnext + 1, i = j - (jj - jjnext) + 1 ; k < jj ; k++, i++) {
+         ar = a [k].r;
+         ai = a [k].i;
+         xi = (double *) (x [i] + c0);
+         for (c = 0 ; c < 2*W ; c++)
+            xi [c] -= ar * p [c] + ai * q [c];
+      }
+   }
+}
+
+int CroutBackSolveComplexBlock (const ComplexMatrix &A, ComplexMatrix &B)
+{
+   unsigned	n, m;
+   unsigned	c0, i;
+   ComplexMatrix b;
+   int		status;
+
+   if (IsFull(A))
+      return M_NOTCOMPACT;
+
+   if (IsCompact(B))
+      return M_COMPACT;
+
+   if (Mrows(A) != Mcols(A))
+      return M_NOTSQUARE;
+
+   if (Mrows(A) != Mrows(B))
+      return M_SIZEMISMATCH;
+
+   n = Mrows(A);
+   m = Mcols(B);
+
+   for (c0 = 1 ; c0 + BackSolveBlock - 1 <= m ; c0 += BackSolveBlock)
+      CroutComplexBlockPass<BackSolveBlock> (A -> diag.c_ptr1(), CompactData (A), MatrixData (B), n, c0);
+
+   if (c0 + 7 <= m) {
+      CroutComplexBlockPass<8> (A -> diag.c_ptr1(), CompactData (A), MatrixData (B), n, c0);
+      c0 += 8;
+   }
+
+   if (c0 + 3 <= m) {
+      CroutComplexBlockPass<4> (A -> diag.c_ptr1(), CompactData (A), MatrixData (B), n, c0);
+      c0 += 4;
+   }
+
+   if (c0 <= m)
+      b = CreateComplexColumnVector (n);
+
+   for ( ; c0 <= m ; c0++) {
+      for (i = 1 ; i <= n ; i++)
+         sdata(b, i, 1) = cmdata(B,i,c0);
+
+      status = CroutBackSolveComplexMatrix (A, b);
+      if (status)
+         return status;
+
+      for (i = 1 ; i <= n ; i++)
+         sdata(B, i, c0) = cmdata(b,i,1);
    }
 
    return 0;
 }
+
+int InvertCroutComplexMatrix (ComplexMatrix &b, const ComplexMatrix &a, const cvector1<unsigned> &cols)
+{
+   static complex	one = {1.0, 0.0};
+   unsigned		k;
+
+   if (IsCompact(b))
+      return M_COMPACT;
+
+   if (Mrows(a) != Mcols(a))
+      return M_NOTSQUARE;
+
+   if (Mrows(a) != Mrows(b) || Mcols(b) != cols.size())
+      return M_SIZEMISMATCH; 
+
+   ZeroComplexMatrix (b);
+   for (k = 1 ; k <= cols.size() ; k++)
+      sdata(b, cols [k], k) = one;
+
+   return CroutBackSolveComplexBlock (a, b);
+}
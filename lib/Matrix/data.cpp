@@ -43,7 +43,7 @@ double mdata (const Matrix &A, unsigned int row, unsigned int col)
          height = A -> diag [col] - A -> diag [col - 1];
 
       if (row > col - height)
-         return A -> data [A -> diag [col] + row - col][1]; 
+         return CompactData (A) [A -> diag [col] + row - col]; 
       else
          return 0;
    }
@@ -103,9 +103,24 @@ matrix::~matrix()
 
 Matrix CreateCompactMatrix (unsigned int rows, unsigned int cols, unsigned int size, const cvector1<unsigned> *diag)
 {
-   Matrix	A;
+   Matrix A(new struct matrix);
 
-   A = CreateFullMatrix (size, 1);
+	/*
+	 * a single row pointer to one flat coefficient array - we don't
+	 * want to pay for a row pointer per stored coefficient
+	 */
+
+   A -> data = (double **) malloc (sizeof (double *));
+   if (A -> data == NULL)
+      Fatal ("unable to allocate compact matrix");
+
+   A -> data --;
+
+   A -> data [1] = (double *) malloc (sizeof (double) * (size ? size : 1));
+   if (A -> data [1] == NULL)
+      Fatal ("unable to allocate compact matrix");
+
+   A -> data [1] --;
 
    A -> nrows = rows; 
    A -> ncols = cols;
@@ -209,14 +224,14 @@ Matrix MakeCompactFromFull (const Matrix &A)
    compA = CreateCompactMatrix (rows, cols, size, NULL);
 
    diag [1] = 1;
-   compA -> data [1][1] = mdata (A, 1, 1);
+   CompactData (compA) [1] = mdata (A, 1, 1);
   
    for (i = 2 ; i <= cols ; i++) {
       height = diag [i];
       diag [i] += diag [i-1];
       curr_row = i - height + 1 ;
       for (k = diag [i] - height + 1 ; k <= diag [i] ; k++) 
-         compA -> data [k][1] = mdata (A, curr_row++, i);
+         CompactData (compA) [k] = mdata (A, curr_row++, i);
    }
 
    compA -> diag = diag;
@@ -20,6 +20,8 @@
 # include <stdio.h>
 # include <math.h>
 # include <stdlib.h>
+# include <string.h>
+# include <vector>
 # include "cvector1.hpp"
 # include "matrix.h"
 # include "error.h"
@@ -437,6 +439,430 @@ int TridiagSymmMatrixEigenModes (const Matrix &diag, const Matrix &sub_diag, con
          sdata(lambda, i, 1) = mdata(diag,i,1);
    }
 
+   return 0;
+}
+
+	/*
+	 * a deterministic, well mixed starting vector for the Lanczos
+	 * recurrence (xorshift); the state carries over between calls
+	 */
+
+static void StartVector (double *v, unsigned n, unsigned *state)
+{
+   unsigned	i;
+
+   for (i = 1 ; i <= n ; i++) {
+      *state ^= *state << 13;
+      *state ^= *state >> 17;
+      *state ^= *state << 5;
+      v [i] = 0.5 + (double) (*state % 10007) / 10007.0;
+   }
+}
+
+	/*
+	 * r -= Q*(P^T*r) twice over; with P = M*Q this makes r
+	 * M-orthogonal to every stored Lanczos vector
+	 */
+
+static void Reorthogonalize (double *r, const std::vector<double> &Q,
+                             const std::vector<double> &P, unsigned n, unsigned m)
+{
+   unsigned	i, pass;
+   double	c;
+
+   for (pass = 1 ; pass <= 2 ; pass++)
+      for (i = 0 ; i < m ; i++) {
+         c = DotKernel (&P [i*n], r + 1, n);
+         AxpyKernel (r + 1, -c, &Q [i*n], n);
+      }
+}
+
+	/*
+	 * how many times the Lanczos basis may be restarted before the
+	 * modes are given up on
+	 */
+
+# define MAX_RESTARTS 200
+
+	/*
+	 * the two things Lanczos needs of the pencil: products with M and
+	 * solves with the factored K - sigma*M.  Either the compact pair
+	 * (M, A) is set or the sparse pair (Ms, F) is.
+	 */
+
+struct LanczosOperator {
+   Matrix	M;
+   Matrix	A;
+   SparseMatrix	Ms;
+   SparseFactor	F;
+};
+
+static void MassProduct (const LanczosOperator &op, Matrix &p, const Matrix &r)
+{
+   if (op.Ms)
+      MultiplySparseMatrix (p, op.Ms, r);
+   else
+      MultiplyCompactMatrices (p, 1.0, op.M, r, 0.0, Matrix(), Matrix(), 0.0, Matrix(), Matrix());
+}
+
+static void ShiftedSolve (const LanczosOperator &op, Matrix &r)
+{
+   if (op.F)
+      SolveSparseMatrix (op.F, r);
+   else
+      CroutBackSolveMatrix (op.A, r);
+}
+
+static int LanczosIterate (const LanczosOperator &op, unsigned n, double sigma,
+                           const Matrix &lambda, Matrix &x, double tol, unsigned int maxit);
+
+int LanczosEigenModes (const Matrix &K, const Matrix &M, const Matrix &lambda, Matrix &x, double tol, unsigned int maxit)
+{
+   unsigned	i, j;
+   unsigned	n, k;
+   double	sigma;
+   double	b, c;
+   double	*a;
+   const double	*kv, *mv;
+   Matrix	A;
+   LanczosOperator op;
+   int		status;
+
+   if (IsFull(K) || IsFull(M))
+      return M_NOTCOMPACT;
+
+   if (IsCompact(x))
+      return M_COMPACT;
+
+   if (!IsColumnVector(lambda))
+      return M_NOTCOLUMN;
+
+   n = Mrows(K);
+   k = Mrows(lambda);
+
+   if (Mcols(K) != n || Mrows(M) != n || Msize(M) != Msize(K))
+      return M_SIZEMISMATCH;
+
+   if (Mrows(x) != n || Mcols(x) != k || k == 0 || k > n)
+      return M_SIZEMISMATCH;
+
+	/*
+	 * factor K - sigma*M once; sigma = 0 unless K is singular (a
+	 * free structure), in which case a shift just below zero keeps
+	 * the rigid body modes finite.  K and M share one profile.
+	 */
+
+   kv = CompactData (K);
+   mv = CompactData (M);
+
+   sigma = 0.0;
+   A = CreateCopyMatrix (K);
+   status = CroutFactorMatrix (A);
+   if (status)
+      return status;
+
+   a = CompactData (A);
+   for (j = 1 ; j <= n ; j++)
+      if (a [A -> diag [j]] <= 1.0e-12 * fabs (kv [K -> diag [j]]))
+         break;
+
+   if (j <= n) {
+      b = c = 0.0;
+      for (j = 1 ; j <= n ; j++) {
+         b += fabs (kv [K -> diag [j]]);
+         c += fabs (mv [M -> diag [j]]);
+      }
+
+      sigma = c > 0.0 ? -1.0e-4 * b / c : -1.0;
+      for (i = 1 ; i <= Msize(K) ; i++)
+         a [i] = kv [i] - sigma*mv [i];
+
+      status = CroutFactorMatrix (A);
+      if (status)
+         return status;
+   }
+
+   op.M = M;
+   op.A = A;
+
+   return LanczosIterate (op, n, sigma, lambda, x, tol, maxit);
+}
+
+int LanczosEigenModes (const SparseMatrix &K, const SparseMatrix &M, const Matrix &lambda, Matrix &x, double tol, unsigned int maxit)
+{
+   unsigned	i, j;
+   unsigned	n, k;
+   unsigned	last;
+   double	sigma;
+   double	b, c;
+   const double	*kv, *mv;
+   SparseMatrix	A;
+   LanczosOperator op;
+   int		status;
+
+   if (IsCompact(x))
+      return M_COMPACT;
+
+   if (!IsColumnVector(lambda))
+      return M_NOTCOLUMN;
+
+   n = Mcols(K);
+   k = Mrows(lambda);
+
+   if (Mrows(K) != n || Mcols(M) != n || M -> nnz != K -> nnz)
+      return M_SIZEMISMATCH;
+
+   if (Mrows(x) != n || Mcols(x) != k || k == 0 || k > n)
+      return M_SIZEMISMATCH;
+
+	/*
+	 * the same shift as for the compact matrices, with the sparse
+	 * LDL^T factor in place of Crout's; the diagonal of a column is
+	 * its last stored coefficient
+	 */
+
+   kv = SparseData (K);
+   mv = SparseData (M);
+
+   sigma = 0.0;
+   op.F = AnalyzeSparseMatrix (K);
+   if (!op.F)
+      return M_NOTSQUARE;
+
+   status = FactorSparseMatrix (op.F, K);
+   if (status && status != M_SINGULAR)
+      return status;
+
+   j = 1;
+   if (!status)
+      for (j = 1 ; j <= n ; j++) {
+         last = K -> colptr [op.F -> perm [j] + 1] - 1;
+         if (op.F -> D [j] <= 1.0e-12 * fabs (kv [last]))
+            break;
+      }
+
+   if (j <= n) {
+      b = c = 0.0;
+      for (j = 1 ; j <= n ; j++) {
+         last = K -> colptr [j + 1] - 1;
+         b += fabs (kv [last]);
+         c += fabs (mv [last]);
+      }
+
+      sigma = c > 0.0 ? -1.0e-4 * b / c : -1.0;
+      A = CreateSparseMatrix (n, n, K -> colptr, K -> rowind, 1);
+      for (i = 1 ; i <= K -> nnz ; i++)
+         SparseData (A) [i] = kv [i] - sigma*mv [i];
+
+      status = FactorSparseMatrix (op.F, A);
+      if (status)
+         return status;
+   }
+
+   op.Ms = M;
+
+   return LanczosIterate (op, n, sigma, lambda, x, tol, maxit);
+}
+
+static int LanczosIterate (const LanczosOperator &op, unsigned n, double sigma,
+                           const Matrix &lambda, Matrix &x, double tol, unsigned int maxit)
+{
+   unsigned	i, j, l, m;
+   unsigned	k, idx;
+   unsigned	keep, locked;
+   unsigned	state;
+   unsigned	converged;
+   unsigned	restarts;
+   int		exhausted;
+   double	b, c;
+   double	*rv, *pv;
+   Matrix	r, p;
+   Matrix	T, Tj;
+   Matrix	d, S;
+   int		status;
+
+   k = Mrows(lambda);
+
+   if (tol <= 0.0)
+      tol = 1.0e-10;
+
+   if (maxit == 0)
+      maxit = DEFAULT_MAXIT;
+
+	/*
+	 * Lanczos on (K - sigma*M)^-1 M in the M inner product, with full
+	 * reorthogonalization.  The largest Ritz values theta = 1/(lambda
+	 * - sigma) converge first, and those are the lowest modes.  The
+	 * basis holds at most m vectors, about twice the number of modes
+	 * asked for; when it fills up before they converge, the best keep
+	 * Ritz vectors become the start of the next basis (a thick
+	 * restart).  The projected matrix T is then no longer
+	 * tridiagonal: the kept Ritz values sit on its diagonal and the
+	 * residual couples each of them to the next Lanczos vector.
+	 */
+
+   r = CreateColumnVector (n);
+   p = CreateColumnVector (n);
+   rv = VectorData (r);
+   pv = VectorData (p);
+
+   m = k + 8 > 2*k ? k + 8 : 2*k;
+   if (m > n)
+      m = n;
+
+   keep = k + (m - k)/2;
+
+   std::vector<double> Q (n*m), P (n*m), Y (n*keep);
+   T = CreateMatrix (m, m);
+   ZeroMatrix (T);
+
+   state = 2463534242u;
+   restarts = 0;
+   exhausted = 0;
+   locked = 0;
+   b = 0.0;
+   j = 0;
+
+   for (;;) {
+      while (j < m) {
+
+	/*
+	 * a new starting vector at the first step or when the Krylov
+	 * space has become invariant; one solve removes any component
+	 * in the null space of M
+	 */
+
+         if (b == 0.0) {
+            StartVector (rv, n, &state);
+            MassProduct (op, p, r);
+            memcpy (rv + 1, pv + 1, n*sizeof(double));
+            ShiftedSolve (op, r);
+            Reorthogonalize (rv, Q, P, n, j);
+            MassProduct (op, p, r);
+            b = DotKernel (rv + 1, pv + 1, n);
+            b = b > 0.0 ? sqrt (b) : 0.0;
+            if (b == 0.0) {
+               exhausted = 1;
+               break;
+            }
+         }
+
+         j ++;
+         for (i = 1 ; i <= n ; i++) {
+            Q [(j-1)*n + i-1] = rv [i] / b;
+            P [(j-1)*n + i-1] = pv [i] / b;
+         }
+
+         memcpy (rv + 1, &P [(j-1)*n], n*sizeof(double));
+         ShiftedSolve (op, r);
+
+         if (j > locked + 1)
+            AxpyKernel (rv + 1, -mdata(T,j-1,j), &Q [(j-2)*n], n);
+         else
+            for (l = 1 ; l <= locked ; l++)
+               AxpyKernel (rv + 1, -mdata(T,l,j), &Q [(l-1)*n], n);
+
+         c = DotKernel (rv + 1, &P [(j-1)*n], n);
+         sdata(T, j, j) = c;
+         AxpyKernel (rv + 1, -c, &Q [(j-1)*n], n);
+         Reorthogonalize (rv, Q, P, n, j);
+
+         MassProduct (op, p, r);
+         b = DotKernel (rv + 1, pv + 1, n);
+         b = b > 0.0 ? sqrt (b) : 0.0;
+
+         if (b <= 1.0e-14 * fabs (c))
+            b = 0.0;
+
+         if (j < m) {
+            sdata(T, j, j+1) = b;
+            sdata(T, j+1, j) = b;
+         }
+      }
+
+      if (j < k)
+         return M_NOTCONVERGED;
+
+	/*
+	 * the Ritz pairs of T come back in ascending order; a pair has
+	 * converged when the residual b times the last component of its
+	 * vector is small against theta
+	 */
+
+      d = CreateColumnVector (j);
+      S = CreateMatrix (j, j);
+      Tj = CreateMatrix (j, j);
+
+      for (i = 1 ; i <= j ; i++)
+         for (l = 1 ; l <= j ; l++)
+            sdata(Tj, i, l) = mdata(T,i,l);
+
+      status = SymmetricMatrixEigenModes (Tj, d, S, maxit);
+      if (status)
+         return status;
+
+      converged = 0;
+      for (l = 1 ; l <= k ; l++) {
+         idx = j - l + 1;
+         if (b * fabs (mdata(S,j,idx)) <= tol * fabs (mdata(d,idx,1)))
+            converged ++;
+      }
+
+      if (converged == k || exhausted || j == n)
+         break;
+
+      if (++ restarts > MAX_RESTARTS)
+         return M_NOTCONVERGED;
+
+	/*
+	 * restart from the best keep Ritz vectors; r and p still hold
+	 * the residual, which becomes the next Lanczos vector
+	 */
+
+      for (l = 1 ; l <= keep ; l++) {
+         idx = j - l + 1;
+         memset (&Y [(l-1)*n], 0, n*sizeof(double));
+         for (i = 1 ; i <= j ; i++)
+            AxpyKernel (&Y [(l-1)*n], mdata(S,i,idx), &Q [(i-1)*n], n);
+      }
+      memcpy (&Q [0], &Y [0], n*keep*sizeof(double));
+
+      for (l = 1 ; l <= keep ; l++) {
+         idx = j - l + 1;
+         memset (&Y [(l-1)*n], 0, n*sizeof(double));
+         for (i = 1 ; i <= j ; i++)
+            AxpyKernel (&Y [(l-1)*n], mdata(S,i,idx), &P [(i-1)*n], n);
+      }
+      memcpy (&P [0], &Y [0], n*keep*sizeof(double));
+
+      ZeroMatrix (T);
+      for (l = 1 ; l <= keep ; l++) {
+         idx = j - l + 1;
+         sdata(T, l, l) = mdata(d,idx,1);
+         sdata(T, l, keep+1) = b * mdata(S,j,idx);
+         sdata(T, keep+1, l) = b * mdata(S,j,idx);
+      }
+
+      locked = keep;
+      j = keep;
+   }
+
+	/*
+	 * lambda = sigma + 1/theta, lowest first, and x = Q*s
+	 */
+
+   for (l = 1 ; l <= k ; l++) {
+      idx = j - l + 1;
+      sdata(lambda, l, 1) = sigma + 1.0 / mdata(d,idx,1);
+
+      for (i = 1 ; i <= n ; i++) {
+         c = 0.0;
+         for (m = 1 ; m <= j ; m++)
+            c += mdata(S,m,idx) * Q [(m-1)*n + i-1];
+         sdata(x, i, l) = c;
+      }
+   }
+
    return 0;
 }
 
@@ -509,20 +935,18 @@ int NormalizeByLength (Matrix &b, const Matrix &a)
 {
    double	div;
    unsigned	i, j;
-   unsigned	n;
+   unsigned	n, modes;
 
    if (IsCompact(b))
       return M_COMPACT;
 
-   if (!IsSquare(a))
-      return M_NOTSQUARE;
-
    if (Mrows(a) != Mrows(b) || Mcols(a) != Mcols(b))
       return M_SIZEMISMATCH;
 
    n = Mrows(a);
+   modes = Mcols(a);
 
-   for (j = 1 ; j <= n ; j++) {		/* loop over each mode (column) */
+   for (j = 1 ; j <= modes ; j++) {	/* loop over each mode (column) */
 
       div = 0.0;
  
@@ -542,20 +966,18 @@ int NormalizeByFirst (Matrix &b, const Matrix &a)
 {
    double	div;
    unsigned	i, j;
-   unsigned	n;
+   unsigned	n, modes;
 
    if (IsCompact(b))
       return M_COMPACT;
 
-   if (!IsSquare(a))
-      return M_NOTSQUARE;
-
    if (Mrows(a) != Mrows(b) || Mcols(a) != Mcols(b))
       return M_SIZEMISMATCH;
 
    n = Mrows(a);
+   modes = Mcols(a);
 
-   for (j = 1 ; j <= n ; j++) {		/* loop over each mode (column) */
+   for (j = 1 ; j <= modes ; j++) {	/* loop over each mode (column) */
       div = mdata(a,1,j);
  
       if (div != 0)
@@ -571,20 +993,18 @@ int NormalizeByMaximum (Matrix &b, const Matrix &a, unsigned int keep_sign)
    double	max;
    double	div;
    unsigned	i, j;
-   unsigned	n;
+   unsigned	n, modes;
 
    if (IsCompact(b))
       return M_COMPACT;
 
-   if (!IsSquare(a))
-      return M_NOTSQUARE;
-
    if (Mrows(a) != Mrows(b) || Mcols(a) != Mcols(b))
       return M_SIZEMISMATCH;
 
    n = Mrows(a);
+   modes = Mcols(a);
 
-   for (i = 1 ; i <= n ; i++) {
+   for (i = 1 ; i <= modes ; i++) {
 
       div = mdata(a,1,i);      
       max = fabs (div);
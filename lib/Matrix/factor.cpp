@@ -20,6 +20,11 @@
 # include <stdio.h>
 # include <math.h>
 # include <stdlib.h>
+# include <boost/atomic.hpp>
+# include <boost/scoped_array.hpp>
+# include <boost/thread/thread.hpp>
+# include <boost/thread/mutex.hpp>
+# include <boost/thread/condition_variable.hpp>
 # include "cvector1.hpp"
 # include "matrix.h"
 # include "error.h"
@@ -480,14 +485,171 @@ int LUBackSolveMatrix (Matrix &c, const Matrix &a, const Matrix &b, const Matrix
    return 0;
 }
 
-int CroutFactorMatrix (Matrix &A)
+	/*
+	 * the parallel factorization is only worth starting threads for
+	 * when the average column is long enough to keep them busy
+	 */
+
+# define MinParallelColumn	64
+
+static unsigned factor_threads = 1;
+
+void SetFactorThreads (unsigned int n)
 {
-   unsigned     j,jj,jjlast,jcolht,
+   factor_threads = (n ? n : 1);
+}
+
+unsigned FactorThreads (void)
+{
+   return factor_threads;
+}
+
+	/*
+	 * reduce column j of a skyline matrix.  Every entry of the column
+	 * is a dot product with an earlier column (and every pivot of the
+	 * earlier rows is used in the scaling), so in the parallel case we
+	 * wait for column i to be finished before touching row i.
+	 */
+
+template <bool Wait>
+static void CroutColumn (const unsigned *diag, double *a, unsigned j,
+                         const boost::atomic<char> *done)
+{
+   unsigned     jj,jjlast,jcolht,
           	istart,ij,ii,i,
           	icolht,iilast,
           	length,jtemp,jlngth;
-   double 	temp, dot;
-   unsigned	n, k;
+   double 	temp;
+
+   jjlast = (j > 1 ? diag [j-1] : 0);
+   jj = diag [j];
+   jcolht = jj - jjlast;
+
+   if (jcolht > 2) {
+         
+      istart = j - jcolht + 2;
+      ij = jjlast + 2;
+      ii = diag [istart-1];
+
+      for (i = istart; i <= j - 1 ; i++) {
+
+         if (Wait)
+            while (!done [i].load (boost::memory_order_acquire))
+               boost::this_thread::yield ( );
+
+         iilast = ii;
+         ii = diag [i];
+         icolht = ii - iilast;
+         jlngth = i - istart + 1;
+         if (icolht - 1  < jlngth) 
+            length = icolht - 1;
+         else
+            length = jlngth;
+            
+         if (length > 0)
+            a [ij] -= DotKernel (&a [ii-length], &a [ij-length], length);
+
+         ij++;
+      }
+   }
+
+   if (jcolht >= 2) {
+
+      if (Wait)
+         while (!done [j-jcolht+1].load (boost::memory_order_acquire))
+            boost::this_thread::yield ( );
+
+      jtemp = j - jj;
+      for (ij = jjlast+1 ; ij <= jj-1 ; ij++) {
+
+         ii = diag [jtemp + ij];
+           
+         if (a [ii] != 0.0) {
+            temp = a [ij];
+            a [ij] = temp / a [ii];
+            a [jj] -= temp*a [ij];
+         }
+      }
+   }
+}
+
+	/*
+	 * the columns are handed out in order from a shared counter, so
+	 * any column a thread waits on has already been claimed by a
+	 * running thread and the pipeline cannot deadlock
+	 */
+
+static void CroutWorker (const unsigned *diag, double *a, unsigned n,
+                         boost::atomic<unsigned> *next, boost::atomic<char> *done)
+{
+   unsigned	j;
+
+   while ((j = next -> fetch_add (1)) <= n) {
+      CroutColumn<true> (diag, a, j, done);
+      done [j].store (1, boost::memory_order_release);
+   }
+}
+
+	/*
+	 * the helper threads of the parallel factorization are started
+	 * on first use and kept for the rest of the run, since starting a
+	 * thread group costs more than it saves on a modest matrix that
+	 * is factored over and over (a transient analysis whose step
+	 * changes, say).  Helper t takes part in a factorization when t
+	 * < nthreads.  One factorization has the pool at a time; a caller
+	 * that finds it busy, such as another batch job, factors on its
+	 * own thread.  The pool is never freed, so helpers still waiting
+	 * at exit have nothing taken away from under them.
+	 */
+
+struct CroutPool {
+   boost::mutex			use;
+   boost::mutex			lock;
+   boost::condition_variable	start;
+   boost::condition_variable	finish;
+   unsigned long		generation;
+   unsigned			size;
+   unsigned			wanted;
+   unsigned			running;
+   const unsigned		*diag;
+   double			*a;
+   unsigned			n;
+   boost::atomic<unsigned>	*next;
+   boost::atomic<char>		*done;
+};
+
+static void CroutHelper (CroutPool *pool, unsigned t, unsigned long seen)
+{
+   for (;;) {
+      boost::unique_lock<boost::mutex> lock (pool -> lock);
+      while (pool -> generation == seen)
+         pool -> start.wait (lock);
+
+      seen = pool -> generation;
+      if (t > pool -> wanted)
+         continue;
+
+      const unsigned *diag = pool -> diag;
+      double *a = pool -> a;
+      unsigned n = pool -> n;
+      boost::atomic<unsigned> *next = pool -> next;
+      boost::atomic<char> *done = pool -> done;
+
+      lock.unlock ( );
+      CroutWorker (diag, a, n, next, done);
+      lock.lock ( );
+
+      if (-- pool -> running == 0)
+         pool -> finish.notify_one ( );
+   }
+}
+
+int ParallelCroutFactorMatrix (Matrix &A, unsigned int nthreads)
+{
+   unsigned	n, j;
+   double	*a;
+
+   static CroutPool *pool = new CroutPool ( );
 
    if (IsFull(A))
       return M_NOTCOMPACT;
@@ -496,58 +658,72 @@ int CroutFactorMatrix (Matrix &A)
       return M_NOTSQUARE;
   
    n = Mrows(A);
+   a = CompactData (A);
 
-   jj = 0;
-   for (j = 1; j <= n; j++) {
+	/*
+	 * every entry is computed by the same operations in the same order
+	 * as the sequential code no matter which thread owns its column,
+	 * so the factors are bitwise identical for any number of threads
+	 */
 
-      jjlast = jj;
-      jj = A -> diag [j];
-      jcolht = jj - jjlast;
+   boost::scoped_array< boost::atomic<char> > done (new boost::atomic<char> [n + 1]);
+   boost::atomic<unsigned> next (1);
 
-      if (jcolht > 2) {
-         
-         istart = j - jcolht + 2;
-         ij = jjlast + 2;
-         ii = A -> diag [istart-1];
-
-         for (i = istart; i <= j - 1 ; i++) {
-
-            iilast = ii;
-            ii = A -> diag [i];
-            icolht = ii - iilast;
-            jlngth = i - istart + 1;
-            if (icolht - 1  < jlngth) 
-               length = icolht - 1;
-            else
-               length = jlngth;
-            
-            if (length > 0) {
-               dot = 0;
-               for (k = 0 ; k < length ; k++)
-                  dot += A -> data [ii-length+k][1] * A -> data[ij-length+k][1];
+   done [0].store (1);
+   for (j = 1 ; j <= n ; j++)
+      done [j].store (0);
 
-               A -> data [ij][1] -= dot;
-            }
+   boost::unique_lock<boost::mutex> use (pool -> use, boost::try_to_lock);
+   if (!use.owns_lock ( ) || nthreads < 2) {
+      CroutWorker (A -> diag.c_ptr1(), a, n, &next, done.get());
+      return 0;
+   }
 
-            ij++;
-         }
-      }
+   boost::unique_lock<boost::mutex> lock (pool -> lock);
+   while (pool -> size < nthreads - 1) {
+      boost::thread helper (CroutHelper, pool, ++ pool -> size, pool -> generation);
+      helper.detach ( );
+   }
 
-      if (jcolht >= 2) {
+   pool -> diag = A -> diag.c_ptr1();
+   pool -> a = a;
+   pool -> n = n;
+   pool -> next = &next;
+   pool -> done = done.get();
+   pool -> wanted = nthreads - 1;
+   pool -> running = nthreads - 1;
+   pool -> generation ++;
+   pool -> start.notify_all ( );
+   lock.unlock ( );
 
-         jtemp = j - jj;
-         for (ij = jjlast+1 ; ij <= jj-1 ; ij++) {
+   CroutWorker (A -> diag.c_ptr1(), a, n, &next, done.get());
 
-            ii = A -> diag [jtemp + ij];
-           
-            if (A -> data [ii][1] != 0.0) {
-               temp = A -> data [ij][1];
-               A -> data [ij][1] = temp / A -> data [ii][1];
-               A -> data [jj][1] -= temp*A -> data [ij][1];
-            }
-         }
-      }
-   }
+   lock.lock ( );
+   while (pool -> running)
+      pool -> finish.wait (lock);
+
+   return 0;
+}
+
+int CroutFactorMatrix (Matrix &A)
+{
+   unsigned	n, j;
+   double	*a;
+
+   if (IsFull(A))
+      return M_NOTCOMPACT;
+ 
+   if (Mrows(A) != Mcols(A))
+      return M_NOTSQUARE;
+  
+   n = Mrows(A);
+
+   if (factor_threads > 1 && Msize(A) >= (unsigned long) MinParallelColumn*n)
+      return ParallelCroutFactorMatrix (A, factor_threads);
+
+   a = CompactData (A);
+   for (j = 1; j <= n; j++)
+      CroutColumn<false> (A -> diag.c_ptr1(), a, j, NULL);
 
    return 0;
 }
@@ -556,10 +732,11 @@ int CroutBackSolveMatrix (const Matrix &A, Matrix &b)
 {
    unsigned	 jj,j,jjlast,
 		 jcolht,jjnext,
-          	 istart,jtemp,i;
+          	 istart,jtemp;
    double 	 Ajj;
-   unsigned	 n, k;
-   double	 dot;
+   unsigned	 n;
+   const double	*a;
+   double	*x;
 
    if (IsFull(A))
       return M_NOTCOMPACT;
@@ -571,6 +748,8 @@ int CroutBackSolveMatrix (const Matrix &A, Matrix &b)
       return M_SIZEMISMATCH;
 
    n = Mrows(A);
+   a = CompactData (A);
+   x = VectorData (b);
 
    jj = 0;
    for (j = 1 ; j <= n ; j++) {
@@ -579,19 +758,14 @@ int CroutBackSolveMatrix (const Matrix &A, Matrix &b)
       jj = A -> diag [j];
       jcolht = jj - jjlast;
 
-      if (jcolht > 1) {
-         dot = 0;
-         for (k = 0 ; k < jcolht-1 ; k++)
-            dot += A -> data [jjlast+1+k][1] * b -> data [j-jcolht+1+k][1];
-
-         b -> data [j][1] -= dot;
-      }
+      if (jcolht > 1)
+         x [j] -= DotKernel (&a [jjlast+1], &x [j-jcolht+1], jcolht-1);
    }
 
    for (j = 1 ; j <= n ; j++) {
-      Ajj = A -> data [A -> diag[j]][1];
+      Ajj = a [A -> diag[j]];
       if (Ajj != 0.0)
-         b -> data [j][1] /= Ajj;
+         x [j] /= Ajj;
    }
 
    if (n == 1)
@@ -609,10 +783,145 @@ int CroutBackSolveMatrix (const Matrix &A, Matrix &b)
           istart = j - jcolht + 1;
           jtemp = jjnext - istart + 1;
 
-          for (i = istart ; i <= j-1 ; i++) 
-             b -> data [i][1] -= A -> data [jtemp + i][1] * b -> data[j][1];
+          AxpyKernel (&x [istart], -x [j], &a [jtemp + istart], j - istart);
+      }
+   }
+
+   return 0;
+}
+
+	/*
+	 * the block solve carries this many right hand sides through
+	 * each pass over the factor; a row of the block is two cache lines
+	 */
+
+# define BackSolveBlock		16
+
+	/*
+	 * one pass of the block solve over the factor for the W columns
+	 * of x starting at c0.  The width is fixed at compile time so that
+	 * the row updates are kept in registers and vectorized.
+	 */
+
+template <unsigned W>
+static void CroutBlockPass (const unsigned *diag, const double *a, double **x,
+                            unsigned n, unsigned c0)
+{
+   unsigned	jj, j, jjlast, jjnext;
+   unsigned	i, k, c;
+   double	acc [BackSolveBlock];
+   double	*xi, *xj;
+   double	Ajj, coef;
+
+	/*
+	 * forward substitution: row j of the block less the rows above
+	 * it, accumulated a coefficient of column j at a time
+	 */
+
+   jj = 0;
+   for (j = 1 ; j <= n ; j++) {
+      jjlast = jj;
+      jj = diag [j];
+      xj = x [j] + c0;
+
+      for (c = 0 ; c < W ; c++)
+         acc [c] = xj [c];
+
+      for (k = jjlast + 1, i = j - (jj - jjlast) + 1 ; k < jj ; k++, i++) {
+         coef = a [k];
+         xi = x [i] + c0;
+         for (c = 0 ; c < W ; c++)
+            acc [c] -= coef * xi [c];
+      }
+
+      for (c = 0 ; c < W ; c++)
+         xj [c] = acc [c];
+   }
+
+   for (j = 1 ; j <= n ; j++) {
+      Ajj = a [diag [j]];
+      if (Ajj != 0.0) {
+         xj = x [j] + c0;
+         for (c = 0 ; c < W ; c++)
+            xj [c] /= Ajj;
+      }
+   }
+
+	/*
+	 * back substitution: row j of the block is subtracted from
+	 * each row in the skyline of column j
+	 */
+
+   for (j = n ; j >= 2 ; j--) {
+      jj = diag [j];
+      jjnext = diag [j-1];
+      xj = x [j] + c0;
+
+      for (c = 0 ; c < W ; c++)
+         acc [c] = xj [c];
+
+      for (k = jjnext + 1, i = j - (jj - jjnext) + 1 ; k < jj ; k++, i++) {
+         coef = a [k];
+         xi = x [i] + c0;
+         for (c = 0 ; c < W ; c++)
+            xi [c] -= coef * acc [c];
       }
    }
+}
+
+int CroutBackSolveBlock (const Matrix &A, Matrix &B)
+{
+   unsigned	n, m;
+   unsigned	c0, i;
+   Matrix	b;
+   int		status;
+
+   if (IsFull(A))
+      return M_NOTCOMPACT;
+
+   if (IsCompact(B))
+      return M_COMPACT;
+
+   if (Mrows(A) != Mcols(A))
+      return M_NOTSQUARE;
+
+   if (Mrows(A) != Mrows(B))
+      return M_SIZEMISMATCH;
+
+   n = Mrows(A);
+   m = Mcols(B);
+
+   for (c0 = 1 ; c0 + BackSolveBlock - 1 <= m ; c0 += BackSolveBlock)
+      CroutBlockPass<BackSolveBlock> (A -> diag.c_ptr1(), CompactData (A), MatrixData (B), n, c0);
+
+   if (c0 + 7 <= m) {
+      CroutBlockPass<8> (A -> diag.c_ptr1(), CompactData (A), MatrixData (B), n, c0);
+      c0 += 8;
+   }
+
+   if (c0 + 3 <= m) {
+      CroutBlockPass<4> (A -> diag.c_ptr1(), CompactData (A), MatrixData (B), n, c0);
+      c0 += 4;
+   }
+
+	/*
+	 * the last few columns gain nothing from blocking
+	 */
+
+   if (c0 <= m)
+      b = CreateColumnVector (n);
+
+   for ( ; c0 <= m ; c0++) {
+      for (i = 1 ; i <= n ; i++)
+         sdata(b, i, 1) = mdata(B,i,c0);
+
+      status = CroutBackSolveMatrix (A, b);
+      if (status)
+         return status;
+
+      for (i = 1 ; i <= n ; i++)
+         sdata(B, i, c0) = mdata(b,i,1);
+   }
 
    return 0;
 }
@@ -0,0 +1,682 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/****************************************************************************
+ *
+ * File:	kernels.cpp
+ *
+ * Description:	Contains the dot product and axpy kernels used by the
+ *		skyline solvers and the block update used by the sparse
+ *		factorization, with vectorized versions for the x86
+ *		instruction sets that are chosen at run time.
+ *
+ ***************************************************************************/
+
+# include <stdio.h>
+# include <string.h>
+# include "matrix.h"
+# include "cmatrix.h"
+
+# if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define X86_KERNELS
+# include <immintrin.h>
+# endif
+
+typedef double (*DotFunction) (const double *, const double *, unsigned);
+typedef void (*AxpyFunction) (double *, double, const double *, unsigned);
+typedef void (*UpdateFunction) (double *, unsigned, const double *, unsigned,
+                                const double *, unsigned, unsigned);
+typedef complex (*ComplexDotFunction) (const complex *, const complex *, unsigned);
+typedef void (*ComplexAxpyFunction) (complex *, complex, const complex *, unsigned);
+
+typedef struct {
+   const char		*name;
+   DotFunction		 dot;
+   AxpyFunction		 axpy;
+   UpdateFunction	 update;
+   ComplexDotFunction	 cdot;
+   ComplexAxpyFunction	 caxpy;
+} KernelSet;
+
+	/*
+	 * the portable versions, which also finish off the tails of
+	 * the vectorized ones
+	 */
+
+static double
+ScalarDot (const double *x, const double *y, unsigned n)
+{
+   unsigned	k;
+   double	dot;
+
+   dot = 0.0;
+   for (k = 0 ; k < n ; k++)
+      dot += x [k] * y [k];
+
+   return dot;
+}
+
+static void
+ScalarAxpy (double *y, double alpha, const double *x, unsigned n)
+{
+   unsigned	k;
+
+   for (k = 0 ; k < n ; k++)
+      y [k] += alpha * x [k];
+}
+
+	/*
+	 * c (m x 4, columns ldc apart) -= a (m x k, columns lda apart)
+	 * times b (k x 4, stored by rows).  Each element of c is summed
+	 * over all k in a register before it is stored, which is what
+	 * makes this cheaper than k axpys.
+	 */
+
+static void
+ScalarUpdate (double *c, unsigned ldc, const double *a, unsigned lda,
+              const double *b, unsigned m, unsigned k)
+{
+   unsigned	i, q;
+   double	s0, s1, s2, s3;
+   double	aq;
+
+   for (i = 0 ; i < m ; i++) {
+      s0 = s1 = s2 = s3 = 0.0;
+      for (q = 0 ; q < k ; q++) {
+         aq = a [i + (unsigned long) q*lda];
+         s0 += aq * b [4*q];
+         s1 += aq * b [4*q + 1];
+         s2 += aq * b [4*q + 2];
+         s3 += aq * b [4*q + 3];
+      }
+
+      c [i] -= s0;
+      c [i + ldc] -= s1;
+      c [i + 2*ldc] -= s2;
+      c [i + 3*ldc] -= s3;
+   }
+}
+
+static complex
+ScalarComplexDot (const complex *x, const complex *y, unsigned n)
+{
+   unsigned	k;
+   complex	dot;
+
+   dot.r = dot.i = 0.0;
+   for (k = 0 ; k < n ; k++) {
+      dot.r += x [k].r*y [k].r - x [k].i*y [k].i;
+      dot.i += x [k].r*y [k].i + x [k].i*y [k].r;
+   }
+
+   return dot;
+}
+
+static void
+ScalarComplexAxpy (complex *y, complex alpha, const complex *x, unsigned n)
+{
+   unsigned	k;
+
+   for (k = 0 ; k < n ; k++) {
+      y [k].r += alpha.r*x [k].r - alpha.i*x [k].i;
+      y [k].i += alpha.r*x [k].i + alpha.i*x [k].r;
+   }
+}
+
+# ifdef X86_KERNELS
+
+	/*
+	 * a complex array is just an array of (re, im) pairs.  For the
+	 * dot product we accumulate x*y (re*re, im*im) and x*swap(y)
+	 * (re*im, im*re) lane by lane and combine the lanes at the end;
+	 * for the axpy y += re(alpha)*x + (-im(alpha), im(alpha))*swap(x).
+	 * The AVX versions clear the upper register halves before handing
+	 * the tail to the (SSE encoded) scalar code to avoid the penalty
+	 * for mixing the two.
+	 */
+
+__attribute__ ((target ("sse2"))) static double
+SSE2Dot (const double *x, const double *y, unsigned n)
+{
+   unsigned	k;
+   __m128d	s0, s1;
+   double	s [2];
+
+   s0 = s1 = _mm_setzero_pd ( );
+   for (k = 0 ; k + 4 <= n ; k += 4) {
+      s0 = _mm_add_pd (s0, _mm_mul_pd (_mm_loadu_pd (x + k), _mm_loadu_pd (y + k)));
+      s1 = _mm_add_pd (s1, _mm_mul_pd (_mm_loadu_pd (x + k + 2), _mm_loadu_pd (y + k + 2)));
+   }
+
+   _mm_storeu_pd (s, _mm_add_pd (s0, s1));
+   return s [0] + s [1] + ScalarDot (x + k, y + k, n - k);
+}
+
+__attribute__ ((target ("sse2"))) static void
+SSE2Axpy (double *y, double alpha, const double *x, unsigned n)
+{
+   unsigned	k;
+   __m128d	a;
+
+   a = _mm_set1_pd (alpha);
+   for (k = 0 ; k + 2 <= n ; k += 2)
+      _mm_storeu_pd (y + k, _mm_add_pd (_mm_loadu_pd (y + k),
+                                        _mm_mul_pd (a, _mm_loadu_pd (x + k))));
+
+   ScalarAxpy (y + k, alpha, x + k, n - k);
+}
+
+__attribute__ ((target ("sse2"))) static void
+SSE2Update (double *c, unsigned ldc, const double *a, unsigned lda,
+            const double *b, unsigned m, unsigned k)
+{
+   unsigned	i, q;
+   const double	*aq;
+   __m128d	a0, a1, bq;
+   __m128d	s00, s01, s10, s11, s20, s21, s30, s31;
+
+   for (i = 0 ; i + 4 <= m ; i += 4) {
+      s00 = s01 = s10 = s11 = _mm_setzero_pd ( );
+      s20 = s21 = s30 = s31 = _mm_setzero_pd ( );
+      for (q = 0 ; q < k ; q++) {
+         aq = a + i + (unsigned long) q*lda;
+         a0 = _mm_loadu_pd (aq);
+         a1 = _mm_loadu_pd (aq + 2);
+         bq = _mm_load1_pd (b + 4*q);
+         s00 = _mm_add_pd (s00, _mm_mul_pd (a0, bq));
+         s01 = _mm_add_pd (s01, _mm_mul_pd (a1, bq));
+         bq = _mm_load1_pd (b + 4*q + 1);
+         s10 = _mm_add_pd (s10, _mm_mul_pd (a0, bq));
+         s11 = _mm_add_pd (s11, _mm_mul_pd (a1, bq));
+         bq = _mm_load1_pd (b + 4*q + 2);
+         s20 = _mm_add_pd (s20, _mm_mul_pd (a0, bq));
+         s21 = _mm_add_pd (s21, _mm_mul_pd (a1, bq));
+         bq = _mm_load1_pd (b + 4*q + 3);
+         s30 = _mm_add_pd (s30, _mm_mul_pd (a0, bq));
+         s31 = _mm_add_pd (s31, _mm_mul_pd (a1, bq));
+      }
+
+      _mm_storeu_pd (c + i, _mm_sub_pd (_mm_loadu_pd (c + i), s00));
+      _mm_storeu_pd (c + i + 2, _mm_sub_pd (_mm_loadu_pd (c + i + 2), s01));
+      _mm_storeu_pd (c + i + ldc, _mm_sub_pd (_mm_loadu_pd (c + i + ldc), s10));
+      _mm_storeu_pd (c + i + ldc + 2, _mm_sub_pd (_mm_loadu_pd (c + i + ldc + 2), s11));
+      _mm_storeu_pd (c + i + 2*ldc, _mm_sub_pd (_mm_loadu_pd (c + i + 2*ldc), s20));
+      _mm_storeu_pd (c + i + 2*ldc + 2, _mm_sub_pd (_mm_loadu_pd (c + i + 2*ldc + 2), s21));
+      _mm_storeu_pd (c + i + 3*ldc, _mm_sub_pd (_mm_loadu_pd (c + i + 3*ldc), s30));
+      _mm_storeu_pd (c + i + 3*ldc + 2, _mm_sub_pd (_mm_loadu_pd (c + i + 3*ldc + 2), s31));
+   }
+
+   ScalarUpdate (c + i, ldc, a + i, lda, b, m - i, k);
+}
+
+__attribute__ ((target ("sse2"))) static complex
+SSE2ComplexDot (const complex *x, const complex *y, unsigned n)
+{
+   unsigned	k;
+   __m128d	xk, yk;
+   __m128d	sr, si;
+   double	r [2], i [2];
+   complex	dot;
+
+   sr = si = _mm_setzero_pd ( );
+   for (k = 0 ; k < n ; k++) {
+      xk = _mm_loadu_pd (&x [k].r);
+      yk = _mm_loadu_pd (&y [k].r);
+      sr = _mm_add_pd (sr, _mm_mul_pd (xk, yk));
+      si = _mm_add_pd (si, _mm_mul_pd (xk, _mm_shuffle_pd (yk, yk, 1)));
+   }
+
+   _mm_storeu_pd (r, sr);
+   _mm_storeu_pd (i, si);
+   dot.r = r [0] - r [1];
+   dot.i = i [0] + i [1];
+   return dot;
+}
+
+__attribute__ ((target ("sse2"))) static void
+SSE2ComplexAxpy (complex *y, complex alpha, const complex *x, unsigned n)
+{
+   unsigned	k;
+   __m128d	ar, ai, xk;
+
+   ar = _mm_set1_pd (alpha.r);
+   ai = _mm_set_pd (alpha.i, -alpha.i);
+   for (k = 0 ; k < n ; k++) {
+      xk = _mm_loadu_pd (&x [k].r);
+      _mm_storeu_pd (&y [k].r,
+         _mm_add_pd (_mm_loadu_pd (&y [k].r),
+            _mm_add_pd (_mm_mul_pd (ar, xk),
+                        _mm_mul_pd (ai, _mm_shuffle_pd (xk, xk, 1)))));
+   }
+}
+
+__attribute__ ((target ("avx2,fma"))) static double
+AVX2Dot (const double *x, const double *y, unsigned n)
+{
+   unsigned	k;
+   __m256d	s0, s1, s2, s3;
+   __m128d	s;
+
+   s0 = s1 = s2 = s3 = _mm256_setzero_pd ( );
+   for (k = 0 ; k + 16 <= n ; k += 16) {
+      s0 = _mm256_fmadd_pd (_mm256_loadu_pd (x + k), _mm256_loadu_pd (y + k), s0);
+      s1 = _mm256_fmadd_pd (_mm256_loadu_pd (x + k + 4), _mm256_loadu_pd (y + k + 4), s1);
+      s2 = _mm256_fmadd_pd (_mm256_loadu_pd (x + k + 8), _mm256_loadu_pd (y + k + 8), s2);
+      s3 = _mm256_fmadd_pd (_mm256_loadu_pd (x + k + 12), _mm256_loadu_pd (y + k + 12), s3);
+   }
+   for ( ; k + 4 <= n ; k += 4)
+      s0 = _mm256_fmadd_pd (_mm256_loadu_pd (x + k), _mm256_loadu_pd (y + k), s0);
+
+   s0 = _mm256_add_pd (_mm256_add_pd (s0, s1), _mm256_add_pd (s2, s3));
+   s = _mm_add_pd (_mm256_castpd256_pd128 (s0), _mm256_extractf128_pd (s0, 1));
+   s = _mm_add_sd (s, _mm_unpackhi_pd (s, s));
+   _mm256_zeroupper ( );
+
+   return _mm_cvtsd_f64 (s) + ScalarDot (x + k, y + k, n - k);
+}
+
+__attribute__ ((target ("avx2,fma"))) static void
+AVX2Axpy (double *y, double alpha, const double *x, unsigned n)
+{
+   unsigned	k;
+   __m256d	a;
+
+   a = _mm256_set1_pd (alpha);
+   for (k = 0 ; k + 8 <= n ; k += 8) {
+      _mm256_storeu_pd (y + k, _mm256_fmadd_pd (a, _mm256_loadu_pd (x + k),
+                                                _mm256_loadu_pd (y + k)));
+      _mm256_storeu_pd (y + k + 4, _mm256_fmadd_pd (a, _mm256_loadu_pd (x + k + 4),
+                                                    _mm256_loadu_pd (y + k + 4)));
+   }
+
+   _mm256_zeroupper ( );
+   ScalarAxpy (y + k, alpha, x + k, n - k);
+}
+
+__attribute__ ((target ("avx2,fma"))) static void
+AVX2Update (double *c, unsigned ldc, const double *a, unsigned lda,
+            const double *b, unsigned m, unsigned k)
+{
+   unsigned	i, q;
+   const double	*aq;
+   __m256d	a0, a1, bq;
+   __m256d	s00, s01, s10, s11, s20, s21, s30, s31;
+
+   for (i = 0 ; i + 8 <= m ; i += 8) {
+      s00 = s01 = s10 = s11 = _mm256_setzero_pd ( );
+      s20 = s21 = s30 = s31 = _mm256_setzero_pd ( );
+      for (q = 0 ; q < k ; q++) {
+         aq = a + i + (unsigned long) q*lda;
+         a0 = _mm256_loadu_pd (aq);
+         a1 = _mm256_loadu_pd (aq + 4);
+         bq = _mm256_broadcast_sd (b + 4*q);
+         s00 = _mm256_fmadd_pd (a0, bq, s00);
+         s01 = _mm256_fmadd_pd (a1, bq, s01);
+         bq = _mm256_broadcast_sd (b + 4*q + 1);
+         s10 = _mm256_fmadd_pd (a0, bq, s10);
+         s11 = _mm256_fmadd_pd (a1, bq, s11);
+         bq = _mm256_broadcast_sd (b + 4*q + 2);
+         s20 = _mm256_fmadd_pd (a0, bq, s20);
+         s21 = _mm256_fmadd_pd (a1, bq, s21);
+         bq = _mm256_broadcast_sd (b + 4*q + 3);
+         s30 = _mm256_fmadd_pd (a0, bq, s30);
+         s31 = _mm256_fmadd_pd (a1, bq, s31);
+      }
+
+      _mm256_storeu_pd (c + i, _mm256_sub_pd (_mm256_loadu_pd (c + i), s00));
+      _mm256_storeu_pd (c + i + 4, _mm256_sub_pd (_mm256_loadu_pd (c + i + 4), s01));
+      _mm256_storeu_pd (c + i + ldc, _mm256_sub_pd (_mm256_loadu_pd (c + i + ldc), s10));
+      _mm256_storeu_pd (c + i + ldc + 4, _mm256_sub_pd (_mm256_loadu_pd (c + i + ldc + 4), s11));
+      _mm256_storeu_pd (c + i + 2*ldc, _mm256_sub_pd (_mm256_loadu_pd (c + i + 2*ldc), s20));
+      _mm256_storeu_pd (c + i + 2*ldc + 4, _mm256_sub_pd (_mm256_loadu_pd (c + i + 2*ldc + 4), s21));
+      _mm256_storeu_pd (c + i + 3*ldc, _mm256_sub_pd (_mm256_loadu_pd (c + i + 3*ldc), s30));
+      _mm256_storeu_pd (c + i + 3*ldc + 4, _mm256_sub_pd (_mm256_loadu_pd (c + i + 3*ldc + 4), s31));
+   }
+
+   _mm256_zeroupper ( );
+   ScalarUpdate (c + i, ldc, a + i, lda, b, m - i, k);
+}
+
+__attribute__ ((target ("avx2,fma"))) static complex
+AVX2ComplexDot (const complex *x, const complex *y, unsigned n)
+{
+   unsigned	k;
+   __m256d	xk, yk;
+   __m256d	sr, si;
+   double	r [4], i [4];
+   complex	dot, tail;
+
+   sr = si = _mm256_setzero_pd ( );
+   for (k = 0 ; k + 2 <= n ; k += 2) {
+      xk = _mm256_loadu_pd (&x [k].r);
+      yk = _mm256_loadu_pd (&y [k].r);
+      sr = _mm256_fmadd_pd (xk, yk, sr);
+      si = _mm256_fmadd_pd (xk, _mm256_permute_pd (yk, 0x5), si);
+   }
+
+   _mm256_storeu_pd (r, sr);
+   _mm256_storeu_pd (i, si);
+   _mm256_zeroupper ( );
+   tail = ScalarComplexDot (x + k, y + k, n - k);
+   dot.r = (r [0] - r [1]) + (r [2] - r [3]) + tail.r;
+   dot.i = (i [0] + i [1]) + (i [2] + i [3]) + tail.i;
+   return dot;
+}
+
+__attribute__ ((target ("avx2,fma"))) static void
+AVX2ComplexAxpy (complex *y, complex alpha, const complex *x, unsigned n)
+{
+   unsigned	k;
+   __m256d	ar, ai, xk;
+
+   ar = _mm256_set1_pd (alpha.r);
+   ai = _mm256_set_pd (alpha.i, -alpha.i, alpha.i, -alpha.i);
+   for (k = 0 ; k + 2 <= n ; k += 2) {
+      xk = _mm256_loadu_pd (&x [k].r);
+      _mm256_storeu_pd (&y [k].r,
+         _mm256_fmadd_pd (ai, _mm256_permute_pd (xk, 0x5),
+            _mm256_fmadd_pd (ar, xk, _mm256_loadu_pd (&y [k].r))));
+   }
+
+   _mm256_zeroupper ( );
+   ScalarComplexAxpy (y + k, alpha, x + k, n - k);
+}
+
+__attribute__ ((target ("avx512f"))) static double
+AVX512Dot (const double *x, const double *y, unsigned n)
+{
+   unsigned	k;
+   __m512d	s0, s1;
+   __mmask8	mask;
+   double	dot;
+
+   s0 = s1 = _mm512_setzero_pd ( );
+   for (k = 0 ; k + 16 <= n ; k += 16) {
+      s0 = _mm512_fmadd_pd (_mm512_loadu_pd (x + k), _mm512_loadu_pd (y + k), s0);
+      s1 = _mm512_fmadd_pd (_mm512_loadu_pd (x + k + 8), _mm512_loadu_pd (y + k + 8), s1);
+   }
+   for ( ; k + 8 <= n ; k += 8)
+      s0 = _mm512_fmadd_pd (_mm512_loadu_pd (x + k), _mm512_loadu_pd (y + k), s0);
+
+   if (k < n) {
+      mask = (__mmask8) ((1u << (n - k)) - 1);
+      s1 = _mm512_fmadd_pd (_mm512_maskz_loadu_pd (mask, x + k),
+                            _mm512_maskz_loadu_pd (mask, y + k), s1);
+   }
+
+   dot = _mm512_reduce_add_pd (_mm512_add_pd (s0, s1));
+   _mm256_zeroupper ( );
+
+   return dot;
+}
+
+__attribute__ ((target ("avx512f"))) static void
+AVX512Axpy (double *y, double alpha, const double *x, unsigned n)
+{
+   unsigned	k;
+   __m512d	a;
+   __mmask8	mask;
+
+   a = _mm512_set1_pd (alpha);
+   for (k = 0 ; k + 8 <= n ; k += 8)
+      _mm512_storeu_pd (y + k, _mm512_fmadd_pd (a, _mm512_loadu_pd (x + k),
+                                                _mm512_loadu_pd (y + k)));
+
+   if (k < n) {
+      mask = (__mmask8) ((1u << (n - k)) - 1);
+      _mm512_mask_storeu_pd (y + k, mask,
+         _mm512_fmadd_pd (a, _mm512_maskz_loadu_pd (mask, x + k),
+                          _mm512_maskz_loadu_pd (mask, y + k)));
+   }
+
+   _mm256_zeroupper ( );
+}
+
+__attribute__ ((target ("avx512f"))) static void
+AVX512Update (double *c, unsigned ldc, const double *a, unsigned lda,
+              const double *b, unsigned m, unsigned k)
+{
+   unsigned	i, q;
+   const double	*aq;
+   __m512d	a0, a1, bq;
+   __m512d	s00, s01, s10, s11, s20, s21, s30, s31;
+   __mmask8	mask;
+
+   for (i = 0 ; i + 16 <= m ; i += 16) {
+      s00 = s01 = s10 = s11 = _mm512_setzero_pd ( );
+      s20 = s21 = s30 = s31 = _mm512_setzero_pd ( );
+      for (q = 0 ; q < k ; q++) {
+         aq = a + i + (unsigned long) q*lda;
+         a0 = _mm512_loadu_pd (aq);
+         a1 = _mm512_loadu_pd (aq + 8);
+         bq = _mm512_set1_pd (b [4*q]);
+         s00 = _mm512_fmadd_pd (a0, bq, s00);
+         s01 = _mm512_fmadd_pd (a1, bq, s01);
+         bq = _mm512_set1_pd (b [4*q + 1]);
+         s10 = _mm512_fmadd_pd (a0, bq, s10);
+         s11 = _mm512_fmadd_pd (a1, bq, s11);
+         bq = _mm512_set1_pd (b [4*q + 2]);
+         s20 = _mm512_fmadd_pd (a0, bq, s20);
+         s21 = _mm512_fmadd_pd (a1, bq, s21);
+         bq = _mm512_set1_pd (b [4*q + 3]);
+         s30 = _mm512_fmadd_pd (a0, bq, s30);
+         s31 = _mm512_fmadd_pd (a1, bq, s31);
+      }
+
+      _mm512_storeu_pd (c + i, _mm512_sub_pd (_mm512_loadu_pd (c + i), s00));
+      _mm512_storeu_pd (c + i + 8, _mm512_sub_pd (_mm512_loadu_pd (c + i + 8), s01));
+      _mm512_storeu_pd (c + i + ldc, _mm512_sub_pd (_mm512_loadu_pd (c + i + ldc), s10));
+      _mm512_storeu_pd (c + i + ldc + 8, _mm512_sub_pd (_mm512_loadu_pd (c + i + ldc + 8), s11));
+      _mm512_storeu_pd (c + i + 2*ldc, _mm512_sub_pd (_mm512_loadu_pd (c + i + 2*ldc), s20));
+      _mm512_storeu_pd (c + i + 2*ldc + 8, _mm512_sub_pd (_mm512_loadu_pd (c + i + 2*ldc + 8), s21));
+      _mm512_storeu_pd (c + i + 3*ldc, _mm512_sub_pd (_mm512_loadu_pd (c + i + 3*ldc), s30));
+      _mm512_storeu_pd (c + i + 3*ldc + 8, _mm512_sub_pd (_mm512_loadu_pd (c + i + 3*ldc + 8), s31));
+   }
+
+	/*
+	 * the last rows eight (or fewer, masked) at a time
+	 */
+
+   for ( ; i < m ; i += 8) {
+      mask = m - i >= 8 ? (__mmask8) 0xff : (__mmask8) ((1u << (m - i)) - 1);
+      s00 = s10 = s20 = s30 = _mm512_setzero_pd ( );
+      for (q = 0 ; q < k ; q++) {
+         a0 = _mm512_maskz_loadu_pd (mask, a + i + (unsigned long) q*lda);
+         s00 = _mm512_fmadd_pd (a0, _mm512_set1_pd (b [4*q]), s00);
+         s10 = _mm512_fmadd_pd (a0, _mm512_set1_pd (b [4*q + 1]), s10);
+         s20 = _mm512_fmadd_pd (a0, _mm512_set1_pd (b [4*q + 2]), s20);
+         s30 = _mm512_fmadd_pd (a0, _mm512_set1_pd (b [4*q + 3]), s30);
+      }
+
+      _mm512_mask_storeu_pd (c + i, mask,
+         _mm512_sub_pd (_mm512_maskz_loadu_pd (mask, c + i), s00));
+      _mm512_mask_storeu_pd (c + i + ldc, mask,
+         _mm512_sub_pd (_mm512_maskz_loadu_pd (mask, c + i + ldc), s10));
+      _mm512_mask_storeu_pd (c + i + 2*ldc, mask,
+         _mm512_sub_pd (_mm512_maskz_loadu_pd (mask, c + i + 2*ldc), s20));
+      _mm512_mask_storeu_pd (c + i + 3*ldc, mask,
+         _mm512_sub_pd (_mm512_maskz_loadu_pd (mask, c + i + 3*ldc), s30));
+   }
+
+   _mm256_zeroupper ( );
+}
+
+__attribute__ ((target ("avx512f"))) static complex
+AVX512ComplexDot (const complex *x, const complex *y, unsigned n)
+{
+   unsigned	k;
+   __m512d	xk, yk;
+   __m512d	sr, si;
+   __m512d	odd;
+   complex	dot, tail;
+
+   sr = si = _mm512_setzero_pd ( );
+   for (k = 0 ; k + 4 <= n ; k += 4) {
+      xk = _mm512_loadu_pd (&x [k].r);
+      yk = _mm512_loadu_pd (&y [k].r);
+      sr = _mm512_fmadd_pd (xk, yk, sr);
+      si = _mm512_fmadd_pd (xk, _mm512_permute_pd (yk, 0x55), si);
+   }
+
+	/*
+	 * negate the imaginary products before the real part is summed
+	 */
+
+   odd = _mm512_set_pd (-1.0, 1.0, -1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+   dot.r = _mm512_reduce_add_pd (_mm512_mul_pd (sr, odd));
+   dot.i = _mm512_reduce_add_pd (si);
+   _mm256_zeroupper ( );
+
+   tail = ScalarComplexDot (x + k, y + k, n - k);
+   dot.r += tail.r;
+   dot.i += tail.i;
+   return dot;
+}
+
+__attribute__ ((target ("avx512f"))) static void
+AVX512ComplexAxpy (complex *y, complex alpha, const complex *x, unsigned n)
+{
+   unsigned	k;
+   __m512d	ar, ai, xk;
+
+   ar = _mm512_set1_pd (alpha.r);
+   ai = _mm512_set_pd (alpha.i, -alpha.i, alpha.i, -alpha.i,
+                       alpha.i, -alpha.i, alpha.i, -alpha.i);
+   for (k = 0 ; k + 4 <= n ; k += 4) {
+      xk = _mm512_loadu_pd (&x [k].r);
+      _mm512_storeu_pd (&y [k].r,
+         _mm512_fmadd_pd (ai, _mm512_permute_pd (xk, 0x55),
+            _mm512_fmadd_pd (ar, xk, _mm512_loadu_pd (&y [k].r))));
+   }
+
+   _mm256_zeroupper ( );
+   ScalarComplexAxpy (y + k, alpha, x + k, n - k);
+}
+
+# endif
+
+static const KernelSet kernel_sets [ ] = {
+# ifdef X86_KERNELS
+   {"avx512", AVX512Dot, AVX512Axpy, AVX512Update, AVX512ComplexDot, AVX512ComplexAxpy},
+   {"avx2", AVX2Dot, AVX2Axpy, AVX2Update, AVX2ComplexDot, AVX2ComplexAxpy},
+   {"sse2", SSE2Dot, SSE2Axpy, SSE2Update, SSE2ComplexDot, SSE2ComplexAxpy},
+# endif
+   {"scalar", ScalarDot, ScalarAxpy, ScalarUpdate, ScalarComplexDot, ScalarComplexAxpy}
+};
+
+# define NumKernelSets	(sizeof (kernel_sets) / sizeof (kernel_sets [0]))
+
+static int
+KernelSupported (const char *name)
+{
+# ifdef X86_KERNELS
+   __builtin_cpu_init ( );
+
+   if (!strcmp (name, "avx512"))
+      return __builtin_cpu_supports ("avx512f");
+   if (!strcmp (name, "avx2"))
+      return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+   if (!strcmp (name, "sse2"))
+      return __builtin_cpu_supports ("sse2");
+# endif
+
+   return !strcmp (name, "scalar");
+}
+
+	/*
+	 * the sets are listed best first, so the first one the processor
+	 * supports is the default.  It is found the first time a kernel
+	 * is called (the initialization of a local static is thread
+	 * safe), so code run from another file's static initializers
+	 * can use the kernels too; SelectKernels overrides it.
+	 */
+
+static const KernelSet *
+BestKernelSet (void)
+{
+   unsigned	i;
+
+   for (i = 0 ; i < NumKernelSets ; i++)
+      if (KernelSupported (kernel_sets [i].name))
+         return &kernel_sets [i];
+
+   return &kernel_sets [NumKernelSets - 1];
+}
+
+static const KernelSet *selected = NULL;
+
+static inline const KernelSet *
+Kernels (void)
+{
+   static const KernelSet *best = BestKernelSet ( );
+
+   return selected ? selected : best;
+}
+
+int SelectKernels (const char *name)
+{
+   unsigned	i;
+
+   if (name == NULL) {
+      selected = NULL;
+      return 0;
+   }
+
+   for (i = 0 ; i < NumKernelSets ; i++)
+      if (!strcmp (name, kernel_sets [i].name)) {
+         if (!KernelSupported (name))
+            return 1;
+
+         selected = &kernel_sets [i];
+         return 0;
+      }
+
+   return 1;
+}
+
+const char *KernelName (void)
+{
+   return Kernels ( ) -> name;
+}
+
+double DotKernel (const double *x, const double *y, unsigned int n)
+{
+   return Kernels ( ) -> dot (x, y, n);
+}
+
+void AxpyKernel (double *y, double alpha, const double *x, unsigned int n)
+{
+   Kernels ( ) -> axpy (y, alpha, x, n);
+}
+
+void UpdateKernel (double *c, unsigned int ldc, const double *a, unsigned int lda,
+                   const double *b, unsigned int m, unsigned int k)
+{
+   Kernels ( ) -> update (c, ldc, a, lda, b, m, k);
+}
+
+complex ComplexDotKernel (const complex *x, const complex *y, unsigned int n)
+{
+   return Kernels ( ) -> cdot (x, y, n);
+}
+
+void ComplexAxpyKernel (complex *y, complex alpha, const complex *x, unsigned int n)
+{
+   Kernels ( ) -> caxpy (y, alpha, x, n);
+}
@@ -0,0 +1,384 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/****************************************************************************
+ *
+ * File:	ordering.cpp
+ *
+ * Description:	Contains code to compute fill reducing orderings of
+ *		symmetric sparse matrices.
+ *
+ ***************************************************************************/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <algorithm>
+# include <vector>
+# include "matrix.h"
+
+	/*
+	 * variables with identical closed adjacency are sorted together
+	 * so that they can be merged into one supervariable
+	 */
+
+struct SupervariableKey {
+   const unsigned *len;
+   const unsigned *hash;
+
+   bool operator() (unsigned a, unsigned b) const
+   {
+      if (len [a] != len [b])
+         return len [a] < len [b];
+      if (hash [a] != hash [b])
+         return hash [a] < hash [b];
+      return a < b;
+   }
+};
+
+	/*
+	 * degree lists; head [d] is the first variable of (approximate)
+	 * external degree d
+	 */
+
+static void
+InsertDegree (std::vector<unsigned> &head, std::vector<unsigned> &next,
+              std::vector<unsigned> &prev, unsigned i, unsigned d)
+{
+   next [i] = head [d];
+   prev [i] = 0;
+   if (head [d])
+      prev [head [d]] = i;
+   head [d] = i;
+}
+
+static void
+RemoveDegree (std::vector<unsigned> &head, std::vector<unsigned> &next,
+              std::vector<unsigned> &prev, unsigned i, unsigned d)
+{
+   if (prev [i])
+      next [prev [i]] = next [i];
+   else
+      head [d] = next [i];
+
+   if (next [i])
+      prev [next [i]] = prev [i];
+}
+
+int MinimumDegreeOrdering (const SparseMatrix &A, cvector1<unsigned> &perm)
+{
+   unsigned	i, j, k, e, v, p, s;
+   unsigned	n, m;
+   unsigned	d, mindeg;
+   unsigned	nleft;
+   unsigned	tag, wtag;
+   unsigned	count;
+
+   if (A -> nrows != A -> ncols)
+      return M_NOTSQUARE;
+
+   if (!A -> symmetric)
+      return M_NOTSYMMETRIC;
+
+   n = A -> ncols;
+   perm.resize (n);
+   if (n == 0)
+      return 0;
+
+	/*
+	 * the full (both triangles) adjacency structure of the graph
+	 */
+
+   std::vector<unsigned> xadj (n + 2, 0);
+   for (j = 1 ; j <= n ; j++)
+      for (k = A -> colptr [j] ; k < A -> colptr [j + 1] ; k++)
+         if ((i = A -> rowind [k]) != j) {
+            xadj [i + 1] ++;
+            xadj [j + 1] ++;
+         }
+
+   xadj [1] = 0;
+   for (j = 1 ; j <= n ; j++)
+      xadj [j + 1] += xadj [j];
+
+   std::vector<unsigned> adj (xadj [n + 1]);
+   std::vector<unsigned> fill (xadj.begin(), xadj.end() - 1);
+   for (j = 1 ; j <= n ; j++)
+      for (k = A -> colptr [j] ; k < A -> colptr [j + 1] ; k++)
+         if ((i = A -> rowind [k]) != j) {
+            adj [fill [i] ++] = j;
+            adj [fill [j] ++] = i;
+         }
+
+	/*
+	 * find the indistinguishable variables (the DOF of a node, for
+	 * instance) up front and order the compressed graph instead
+	 */
+
+   std::vector<unsigned> len (n + 1), hash (n + 1);
+   std::vector<unsigned> sorted (n);
+   for (i = 1 ; i <= n ; i++) {
+      len [i] = xadj [i + 1] - xadj [i] + 1;
+      hash [i] = i;
+      for (k = xadj [i] ; k < xadj [i + 1] ; k++)
+         hash [i] += adj [k];
+      sorted [i - 1] = i;
+   }
+
+   SupervariableKey key;
+   key.len = &len [0];
+   key.hash = &hash [0];
+   std::sort (sorted.begin(), sorted.end(), key);
+
+   std::vector<unsigned> sv (n + 1, 0);
+   std::vector<unsigned> mark (n + 1, 0);
+   m = 0;
+   tag = 0;
+   for (k = 0 ; k < n ; k++) {
+      i = sorted [k];
+      if (sv [i])
+         continue;
+
+      sv [i] = ++ m;
+      tag ++;
+      mark [i] = tag;
+      for (e = xadj [i] ; e < xadj [i + 1] ; e++)
+         mark [adj [e]] = tag;
+
+      for (s = k + 1 ; s < n ; s++) {
+         j = sorted [s];
+         if (len [j] != len [i] || hash [j] != hash [i])
+            break;
+         if (sv [j] || mark [j] != tag)
+            continue;
+
+         for (e = xadj [j] ; e < xadj [j + 1] ; e++)
+            if (mark [adj [e]] != tag)
+               break;
+
+         if (e == xadj [j + 1])
+            sv [j] = m;
+      }
+   }
+
+	/*
+	 * the compressed (quotient) graph: each supervariable carries
+	 * its weight nv and starts out adjacent only to other variables
+	 */
+
+   std::vector<unsigned> nv (m + 1, 0);
+   std::vector<unsigned> rep (m + 1, 0);
+   for (i = 1 ; i <= n ; i++) {
+      nv [sv [i]] ++;
+      if (!rep [sv [i]])
+         rep [sv [i]] = i;
+   }
+
+   std::vector< std::vector<unsigned> > vadj (m + 1);
+   std::vector< std::vector<unsigned> > eadj (m + 1);
+   std::vector< std::vector<unsigned> > evars (m + 1);
+   std::vector<unsigned> esize (m + 1, 0);
+   std::vector<unsigned> degree (m + 1, 0);
+   std::vector<char> status (m + 1, 0);	/* 0 variable, 1 element, 2 absorbed */
+
+   std::fill (mark.begin(), mark.end(), 0);
+   tag = 0;
+   for (s = 1 ; s <= m ; s++) {
+      tag ++;
+      mark [s] = tag;
+      i = rep [s];
+      for (k = xadj [i] ; k < xadj [i + 1] ; k++) {
+         v = sv [adj [k]];
+         if (mark [v] != tag) {
+            mark [v] = tag;
+            vadj [s].push_back (v);
+            degree [s] += nv [v];
+         }
+      }
+   }
+
+   std::vector<unsigned>().swap (adj);
+
+   std::vector<unsigned> head (n + 1, 0), next (m + 1, 0), prev (m + 1, 0);
+   for (s = 1 ; s <= m ; s++)
+      InsertDegree (head, next, prev, s, degree [s]);
+
+   std::vector<unsigned> w (m + 1, 0), wstamp (m + 1, 0);
+   std::vector<unsigned> order;
+   std::vector<unsigned> Lp;
+
+   mark.assign (m + 1, 0);
+   tag = wtag = 0;
+   mindeg = 0;
+   nleft = n;
+
+	/*
+	 * eliminate a variable of minimum approximate degree at a time.
+	 * The pivot becomes an element whose variables are the union of
+	 * its neighbors and those of the elements it absorbs.  Degrees are
+	 * only updated for those variables, using the bound of Amestoy,
+	 * Davis and Duff: |A_i| + |L_p \ i| + sum over the other elements
+	 * of |L_e \ L_p|.
+	 */
+
+   while (order.size() < m) {
+      while (!head [mindeg])
+         mindeg ++;
+
+      p = head [mindeg];
+      RemoveDegree (head, next, prev, p, mindeg);
+      order.push_back (p);
+
+      tag ++;
+      mark [p] = tag;
+      Lp.clear();
+
+      for (k = 0 ; k < vadj [p].size() ; k++) {
+         v = vadj [p][k];
+         if (status [v] == 0 && mark [v] != tag) {
+            mark [v] = tag;
+            Lp.push_back (v);
+         }
+      }
+
+      for (k = 0 ; k < eadj [p].size() ; k++) {
+         e = eadj [p][k];
+         if (status [e] != 1)
+            continue;
+
+         for (j = 0 ; j < evars [e].size() ; j++) {
+            v = evars [e][j];
+            if (status [v] == 0 && mark [v] != tag) {
+               mark [v] = tag;
+               Lp.push_back (v);
+            }
+         }
+
+         status [e] = 2;
+         std::vector<unsigned>().swap (evars [e]);
+      }
+
+      status [p] = 1;
+      evars [p] = Lp;
+      esize [p] = 0;
+      for (k = 0 ; k < Lp.size() ; k++)
+         esize [p] += nv [Lp [k]];
+
+      std::vector<unsigned>().swap (vadj [p]);
+      std::vector<unsigned>().swap (eadj [p]);
+      nleft -= nv [p];
+
+	/*
+	 * prune the lists of the variables in L_p: absorbed elements
+	 * go, p comes in, and variable neighbors already reachable
+	 * through p are dropped
+	 */
+
+      for (k = 0 ; k < Lp.size() ; k++) {
+         i = Lp [k];
+         RemoveDegree (head, next, prev, i, degree [i]);
+
+         count = 0;
+         for (j = 0 ; j < eadj [i].size() ; j++)
+            if (status [eadj [i][j]] == 1)
+               eadj [i][count ++] = eadj [i][j];
+         eadj [i].resize (count);
+         eadj [i].push_back (p);
+
+         count = 0;
+         for (j = 0 ; j < vadj [i].size() ; j++) {
+            v = vadj [i][j];
+            if (status [v] == 0 && mark [v] != tag)
+               vadj [i][count ++] = v;
+         }
+         vadj [i].resize (count);
+      }
+
+	/*
+	 * w [e] = |L_e \ L_p| for every element touching L_p
+	 */
+
+      wtag ++;
+      for (k = 0 ; k < Lp.size() ; k++) {
+         i = Lp [k];
+         for (j = 0 ; j < eadj [i].size() ; j++) {
+            e = eadj [i][j];
+            if (e == p)
+               continue;
+
+            if (wstamp [e] != wtag) {
+               wstamp [e] = wtag;
+               w [e] = esize [e] - nv [i];
+            }
+            else
+               w [e] -= nv [i];
+         }
+      }
+
+      for (k = 0 ; k < Lp.size() ; k++) {
+         i = Lp [k];
+         d = esize [p] - nv [i];
+
+         for (j = 0 ; j < eadj [i].size() ; j++) {
+            e = eadj [i][j];
+            if (e == p || status [e] != 1)
+               continue;
+
+            if (w [e] == 0)
+               status [e] = 2;		/* L_e is inside L_p */
+            else
+               d += w [e];
+         }
+
+         for (j = 0 ; j < vadj [i].size() ; j++)
+            d += nv [vadj [i][j]];
+
+         d = std::min (d, degree [i] + esize [p] - nv [i]);
+         d = std::min (d, nleft - nv [i]);
+
+         degree [i] = d;
+         InsertDegree (head, next, prev, i, d);
+         if (d < mindeg)
+            mindeg = d;
+      }
+   }
+
+	/*
+	 * expand the supervariables back into the original indices
+	 */
+
+   std::vector<unsigned> first (m + 2, 0);
+   std::vector<unsigned> member (n);
+   for (i = 1 ; i <= n ; i++)
+      first [sv [i] + 1] ++;
+   for (s = 1 ; s <= m ; s++)
+      first [s + 1] += first [s];
+   for (i = 1 ; i <= n ; i++)
+      member [first [sv [i]] ++] = i;
+   for (s = m ; s >= 1 ; s--)
+      first [s] = first [s - 1];
+
+   count = 0;
+   for (k = 0 ; k < m ; k++) {
+      s = order [k];
+      for (j = first [s] ; j < first [s] + nv [s] ; j++)
+         perm [++ count] = member [j];
+   }
+
+   return 0;
+}
@@ -83,3 +83,318 @@ int GaussSeidel(Matrix &x, const Matrix &A, const Matrix &b)
 
    return 0;
 }
+
+	/*
+	 * incomplete Cholesky A ~ U^T U keeping only the entries of U that
+	 * are in the pattern of A, a column at a time.  Column j is
+	 * scattered into w, its rows are reduced in increasing order
+	 * against the finished columns, and gathered back.  The diagonal
+	 * is scaled by (1 + shift) to get past a breakdown.
+	 */
+
+static int
+IncompleteCholesky (const SparseMatrix &A, SparseMatrix &U, double shift)
+{
+   unsigned	i, j, k, m;
+   unsigned	start, end;
+   unsigned	n;
+   double	s;
+   double	*u;
+   const unsigned *colptr;
+   const unsigned *row;
+
+   n = Mcols(A);
+   colptr = A -> colptr.c_ptr1();
+   row = A -> rowind.c_ptr1();
+
+   U -> values = A -> values;
+   u = SparseData (U);
+
+   cvector1<double> w(n);
+   for (j = 1 ; j <= n ; j++)
+      w [j] = 0.0;
+
+   for (j = 1 ; j <= n ; j++) {
+      start = colptr [j];
+      end = colptr [j + 1] - 1;		/* the diagonal */
+
+      u [end] *= 1.0 + shift;
+      for (k = start ; k <= end ; k++)
+         w [row [k]] = u [k];
+
+      for (k = start ; k < end ; k++) {
+         i = row [k];
+         s = w [i];
+         for (m = colptr [i] ; m < colptr [i + 1] - 1 ; m++)
+            s -= u [m] * w [row [m]];
+
+         w [i] = s / u [colptr [i + 1] - 1];
+      }
+
+      s = w [j];
+      for (k = start ; k < end ; k++) {
+         s -= w [row [k]] * w [row [k]];
+         u [k] = w [row [k]];
+         w [row [k]] = 0.0;
+      }
+      w [j] = 0.0;
+
+      if (s <= 0.0)
+         return M_NOTPOSITIVEDEFINITE;
+
+      u [end] = sqrt (s);
+   }
+
+   return 0;
+}
+
+Preconditioner CreatePreconditioner (const SparseMatrix &A, int type)
+{
+   unsigned	j;
+   unsigned	n;
+   unsigned	last;
+   unsigned	tries;
+   double	shift;
+
+   if (!A -> symmetric || Mrows(A) != Mcols(A))
+      return Preconditioner();
+
+   if (type != 'j' && type != 's' && type != 'i')
+      return Preconditioner();
+
+	/*
+	 * every column of the upper triangle ends in its diagonal,
+	 * which has to be positive
+	 */
+
+   n = Mcols(A);
+   Preconditioner M(new struct preconditioner);
+   M -> type = type;
+   M -> omega = 1.0;
+   M -> A = A;
+   M -> diag.resize (n);
+
+   for (j = 1 ; j <= n ; j++) {
+      last = A -> colptr [j + 1] - 1;
+      if (last < A -> colptr [j] || A -> rowind [last] != j ||
+          A -> values [last] <= 0.0)
+         return Preconditioner();
+
+      M -> diag [j] = (type == 'j' ? 1.0/A -> values [last] : A -> values [last]);
+   }
+
+   if (type != 'i')
+      return M;
+
+	/*
+	 * IC(0) can break down even for a positive definite A; when it
+	 * does we try again with a growing diagonal shift (Manteuffel)
+	 */
+
+   M -> U = CreateSparseMatrix (Mrows(A), Mcols(A), A -> colptr, A -> rowind, 1);
+
+   shift = 0.0;
+   for (tries = 0 ; tries < 20 ; tries++) {
+      if (!IncompleteCholesky (A, M -> U, shift))
+         return M;
+
+      shift = (shift == 0.0 ? 1e-3 : 2.0*shift);
+   }
+
+   return Preconditioner();
+}
+
+int ApplyPreconditioner (const Preconditioner &M, Matrix &z, const Matrix &r)
+{
+   unsigned	j, k;
+   unsigned	n;
+   unsigned	start, end;
+   double	*x;
+   const double	*b;
+   const double	*a;
+   const unsigned *colptr;
+   const unsigned *row;
+   double	omega;
+   double	s;
+
+   if (!IsColumnVector(z) || !IsColumnVector(r))
+      return M_NOTCOLUMN;
+
+   n = M -> diag.size();
+   if (Mrows(z) != n || Mrows(r) != n)
+      return M_SIZEMISMATCH;
+
+   x = VectorData (z);
+   b = VectorData (r);
+
+   if (M -> type == 'j') {
+      for (j = 1 ; j <= n ; j++)
+         x [j] = b [j] * M -> diag [j];
+
+      return 0;
+   }
+
+	/*
+	 * both SSOR and IC(0) are a forward solve with the transpose of
+	 * an upper triangle stored by columns (a dot product per column)
+	 * followed by a backward solve with the upper triangle itself
+	 * (an axpy per column).  For SSOR the triangle is A, giving
+	 * omega(2-omega) (D + omega U)^-1 D (D + omega U^T)^-1 r.
+	 */
+
+   if (M -> type == 'i') {
+      a = SparseData (M -> U);
+      omega = 1.0;
+   }
+   else {
+      a = SparseData (M -> A);
+      omega = M -> omega;
+   }
+
+   colptr = M -> A -> colptr.c_ptr1();
+   row = M -> A -> rowind.c_ptr1();
+
+   for (j = 1 ; j <= n ; j++) {
+      start = colptr [j];
+      end = colptr [j + 1] - 1;
+
+      s = 0.0;
+      for (k = start ; k < end ; k++)
+         s += a [k] * x [row [k]];
+
+      x [j] = (b [j] - omega*s) / a [end];
+   }
+
+   if (M -> type == 's')
+      for (j = 1 ; j <= n ; j++)
+         x [j] *= M -> diag [j];
+
+   for (j = n ; j >= 1 ; j--) {
+      start = colptr [j];
+      end = colptr [j + 1] - 1;
+
+      x [j] /= a [end];
+      for (k = start ; k < end ; k++)
+         x [row [k]] -= omega * a [k] * x [j];
+   }
+
+   if (M -> type == 's')
+      for (j = 1 ; j <= n ; j++)
+         x [j] *= omega*(2.0 - omega);
+
+   return 0;
+}
+
+int ConjugateGradient (Matrix &x, const SparseMatrix &A, const Matrix &b,
+                       const Preconditioner &M, double tol, unsigned maxits,
+                       unsigned *its)
+{
+   unsigned	n;
+   unsigned	iter;
+   double	alpha, beta;
+   double	rz, rz_old;
+   double	bnorm, rnorm;
+   int		status;
+   double	*xv, *rv, *zv, *pv, *qv;
+
+   if (!IsColumnVector(x) || !IsColumnVector(b))
+      return M_NOTCOLUMN;
+
+   n = Mrows(A);
+   if (Mcols(A) != n || Mrows(x) != n || Mrows(b) != n)
+      return M_SIZEMISMATCH;
+
+   if (its)
+      *its = 0;
+
+   Matrix r = CreateColumnVector (n);
+   Matrix z = CreateColumnVector (n);
+   Matrix p = CreateColumnVector (n);
+   Matrix q = CreateColumnVector (n);
+
+   xv = VectorData (x) + 1;
+   rv = VectorData (r) + 1;
+   zv = VectorData (z) + 1;
+   pv = VectorData (p) + 1;
+   qv = VectorData (q) + 1;
+
+   bnorm = sqrt (DotKernel (VectorData (b) + 1, VectorData (b) + 1, n));
+   if (bnorm == 0.0) {
+      ZeroMatrix (x);
+      return 0;
+   }
+
+	/*
+	 * r = b - Ax for the starting guess we were given
+	 */
+
+   status = MultiplySparseMatrix (r, A, x);
+   if (status)
+      return status;
+
+   ScaleMatrix (r, r, -1.0, 0.0);
+   AxpyKernel (rv, 1.0, VectorData (b) + 1, n);
+
+   if (M)
+      ApplyPreconditioner (M, z, r);
+   else
+      CopyMatrix (z, r);
+
+   CopyMatrix (p, z);
+   rz = DotKernel (rv, zv, n);
+
+   for (iter = 0 ; ; iter++) {
+      rnorm = sqrt (DotKernel (rv, rv, n));
+      if (rnorm <= tol*bnorm)
+         break;
+
+      if (iter == maxits) {
+         if (its)
+            *its = iter;
+         return M_NOTCONVERGED;
+      }
+
+      MultiplySparseMatrix (q, A, p);
+      alpha = rz / DotKernel (pv, qv, n);
+
+      AxpyKernel (xv, alpha, pv, n);
+      AxpyKernel (rv, -alpha, qv, n);
+
+      if (M)
+         ApplyPreconditioner (M, z, r);
+      else
+         CopyMatrix (z, r);
+
+      rz_old = rz;
+      rz = DotKernel (rv, zv, n);
+      beta = rz / rz_old;
+
+      ScaleMatrix (p, p, beta, 0.0);
+      AxpyKernel (pv, 1.0, zv, n);
+   }
+
+   if (its)
+      *its = iter;
+
+   return 0;
+}
+
+int ConjugateGradient (Matrix &x, const Matrix &A, const Matrix &b,
+                       double tol, unsigned maxits, unsigned *its)
+{
+   SparseMatrix		S;
+   Preconditioner	M;
+
+   if (IsFull(A))
+      return M_NOTCOMPACT;
+
+   S = MakeSparseFromCompact (A);
+   if (!S)
+      return M_NOTSQUARE;
+
+   M = CreatePreconditioner (S, 'i');
+   if (!M)
+      return M_NOTPOSITIVEDEFINITE;
+
+   return ConjugateGradient (x, S, b, M, tol, maxits, its);
+}
@@ -0,0 +1,349 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include "matrix.h"
+# include "error.h"
+
+SparseMatrix CreateSparseMatrix (unsigned int rows, unsigned int cols,
+                                 const cvector1<unsigned> &colptr,
+                                 const cvector1<unsigned> &rowind, int symmetric)
+{
+   unsigned	i;
+
+   if (colptr.size() != cols + 1 || colptr [cols + 1] != rowind.size() + 1)
+      Fatal ("inconsistent sparse matrix structure");
+
+   SparseMatrix A(new struct sparse_matrix);
+
+   A -> nrows = rows;
+   A -> ncols = cols;
+   A -> nnz = rowind.size();
+   A -> symmetric = symmetric;
+   A -> colptr = colptr;
+   A -> rowind = rowind;
+   A -> values.resize (A -> nnz ? A -> nnz : 1);
+
+   for (i = 1 ; i <= A -> values.size() ; i++)
+      A -> values [i] = 0.0;
+
+   return A;
+}
+
+unsigned SparseAddress (unsigned int row, unsigned int col, const SparseMatrix &A)
+{
+   unsigned	lo, hi, mid;
+   unsigned	temp;
+
+   if (A -> symmetric && row > col) {
+      temp = col;
+      col = row;
+      row = temp;
+   }
+
+	/*
+	 * the rows within a column are sorted, so a binary search
+	 * finds the entry (or tells us it isn't stored)
+	 */
+
+   lo = A -> colptr [col];
+   hi = A -> colptr [col + 1];
+
+   while (lo < hi) {
+      mid = lo + (hi - lo)/2;
+      if (A -> rowind [mid] < row)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   if (lo < A -> colptr [col + 1] && A -> rowind [lo] == row)
+      return lo;
+
+   return 0;
+}
+
+double smdata (const SparseMatrix &A, unsigned int row, unsigned int col)
+{
+   unsigned	address;
+
+   address = SparseAddress (row, col, A);
+   if (address)
+      return A -> values [address];
+
+   return 0.0;
+}
+
+int ZeroSparseMatrix (SparseMatrix &A)
+{
+   unsigned	i;
+
+   for (i = 1 ; i <= A -> values.size() ; i++)
+      A -> values [i] = 0.0;
+
+   return 0;
+}
+
+int MultiplySparseMatrix (Matrix &y, const SparseMatrix &A, const Matrix &x)
+{
+   unsigned	i, j, k;
+   unsigned	end;
+   double	*yv;
+   const double	*xv;
+   const double	*a;
+   const unsigned *row;
+   double	xj, sum;
+
+   if (IsCompact(y))
+      return M_COMPACT;
+
+   if (!IsColumnVector(y) || !IsColumnVector(x))
+      return M_NOTCOLUMN;
+
+   if (Mrows(x) != Mcols(A) || Mrows(y) != Mrows(A))
+      return M_SIZEMISMATCH;
+
+   if (y == x)
+      return M_NOOVERWRITE;
+
+   yv = VectorData (y);
+   xv = VectorData (x);
+   a = SparseData (A);
+   row = A -> rowind.c_ptr1();
+
+   for (i = 1 ; i <= Mrows(A) ; i++)
+      yv [i] = 0.0;
+
+   if (!A -> symmetric) {
+      for (j = 1 ; j <= Mcols(A) ; j++) {
+         xj = xv [j];
+         end = A -> colptr [j + 1];
+         for (k = A -> colptr [j] ; k < end ; k++)
+            yv [row [k]] += a [k] * xj;
+      }
+
+      return 0;
+   }
+
+	/*
+	 * for the symmetric case the stored (upper) entry a(i,j)
+	 * contributes to row j as a dot product and to row i as
+	 * an axpy, the diagonal only to the former
+	 */
+
+   for (j = 1 ; j <= Mcols(A) ; j++) {
+      xj = xv [j];
+      sum = 0.0;
+      end = A -> colptr [j + 1];
+      for (k = A -> colptr [j] ; k < end ; k++) {
+         i = row [k];
+         sum += a [k] * xv [i];
+         if (i != j)
+            yv [i] += a [k] * xj;
+      }
+      yv [j] += sum;
+   }
+
+   return 0;
+}
+
+int MultiplySparseMatrices (Matrix &y, double alpha, const SparseMatrix &A, const Matrix &a,
+                            double beta, const SparseMatrix &B, const Matrix &b,
+                            double gamma, const SparseMatrix &C, const Matrix &c)
+{
+   unsigned	i, j, k, m;
+   unsigned	n, end;
+   unsigned	count;
+   double	*yv;
+   const double	*K [3];
+   const double	*x [3];
+   double	s [3];
+   double	kij, sum;
+   const unsigned *row;
+
+   if (IsCompact(y))
+      return M_COMPACT;
+
+   if (!A -> symmetric)
+      return M_NOTSQUARE;
+
+   if (!IsColumnVector(y) || !IsColumnVector(a))
+      return M_NOTCOLUMN;
+
+   n = Mcols(A);
+   if (Mrows(y) != n || Mrows(a) != n)
+      return M_SIZEMISMATCH;
+
+   if (y == a)
+      return M_NOOVERWRITE;
+
+   count = 0;
+   K [count] = SparseData (A);
+   x [count] = VectorData (a);
+   s [count ++] = alpha;
+
+   if (B) {
+      if (!IsColumnVector(b))
+         return M_NOTCOLUMN;
+      if (Mcols(B) != n || B -> nnz != A -> nnz || Mrows(b) != n)
+         return M_SIZEMISMATCH;
+      if (y == b)
+         return M_NOOVERWRITE;
+
+      K [count] = SparseData (B);
+      x [count] = VectorData (b);
+      s [count ++] = beta;
+   }
+
+   if (C) {
+      if (!IsColumnVector(c))
+         return M_NOTCOLUMN;
+      if (Mcols(C) != n || C -> nnz != A -> nnz || Mrows(c) != n)
+         return M_SIZEMISMATCH;
+      if (y == c)
+         return M_NOOVERWRITE;
+
+      K [count] = SparseData (C);
+      x [count] = VectorData (c);
+      s [count ++] = gamma;
+   }
+
+   yv = VectorData (y);
+   row = A -> rowind.c_ptr1();
+
+   for (i = 1 ; i <= n ; i++)
+      yv [i] = 0.0;
+
+	/*
+	 * the same dot product and axpy for each stored entry as in
+	 * MultiplySparseMatrix, once for every matrix
+	 */
+
+   for (j = 1 ; j <= n ; j++) {
+      end = A -> colptr [j + 1];
+      for (m = 0 ; m < count ; m++) {
+         sum = 0.0;
+         for (k = A -> colptr [j] ; k < end ; k++) {
+            i = row [k];
+            kij = K [m][k];
+            sum += kij * x [m][i];
+            if (i != j)
+               yv [i] += s [m] * kij * x [m][j];
+         }
+         yv [j] += s [m] * sum;
+      }
+   }
+
+   return 0;
+}
+
+SparseMatrix MakeSparseFromCompact (const Matrix &A)
+{
+   unsigned	i, j, k;
+   unsigned	start;
+   unsigned	nnz;
+   const double	*a;
+
+   if (IsFull(A) || !IsSquare(A))
+      return SparseMatrix();
+
+   a = CompactData (A);
+
+	/*
+	 * count the coefficients we will keep - anything nonzero
+	 * in the profile plus every diagonal
+	 */
+
+   nnz = 0;
+   start = 1;
+   for (j = 1 ; j <= Mcols(A) ; j++) {
+      for (k = start ; k < A -> diag [j] ; k++)
+         if (a [k] != 0.0)
+            nnz ++;
+
+      nnz ++;
+      start = A -> diag [j] + 1;
+   }
+
+   cvector1<unsigned> colptr(Mcols(A) + 1);
+   cvector1<unsigned> rowind(nnz);
+   cvector1<double> values(nnz);
+
+   nnz = 0;
+   start = 1;
+   for (j = 1 ; j <= Mcols(A) ; j++) {
+      colptr [j] = nnz + 1;
+      i = j - (A -> diag [j] - start);
+      for (k = start ; k <= A -> diag [j] ; k++, i++) {
+         if (a [k] != 0.0 || i == j) {
+            nnz ++;
+            rowind [nnz] = i;
+            values [nnz] = a [k];
+         }
+      }
+      start = A -> diag [j] + 1;
+   }
+   colptr [Mcols(A) + 1] = nnz + 1;
+
+   SparseMatrix B = CreateSparseMatrix (Mrows(A), Mcols(A), colptr, rowind, 1);
+   B -> values = values;
+
+   return B;
+}
+
+Matrix MakeCompactFromSparse (const SparseMatrix &A)
+{
+   unsigned	i, j, k;
+   unsigned	size;
+   unsigned	height;
+   Matrix	B;
+
+   if (!A -> symmetric || A -> nrows != A -> ncols)
+      return Matrix();
+
+	/*
+	 * the first stored row of each column sets its skyline height;
+	 * every column has at least its diagonal
+	 */
+
+   cvector1<unsigned> diag(A -> ncols);
+
+   size = 0;
+   for (j = 1 ; j <= A -> ncols ; j++) {
+      height = 1;
+      if (A -> colptr [j] < A -> colptr [j + 1])
+         height = j - A -> rowind [A -> colptr [j]] + 1;
+
+      size += height;
+      diag [j] = size;
+   }
+
+   B = CreateCompactMatrix (A -> nrows, A -> ncols, size, &diag);
+   ZeroMatrix (B);
+
+   for (j = 1 ; j <= A -> ncols ; j++) {
+      for (k = A -> colptr [j] ; k < A -> colptr [j + 1] ; k++) {
+         i = A -> rowind [k];
+         CompactData (B) [diag [j] - (j - i)] = A -> values [k];
+      }
+   }
+
+   return B;
+}
@@ -0,0 +1,648 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/****************************************************************************
+ *
+ * File:	supernodal.cpp
+ *
+ * Description:	Contains code for the sparse LDL^T direct solver: the
+ *		symbolic analysis (ordering, elimination tree, supernodes
+ *		and the structure of L), a multifrontal numeric
+ *		factorization with dense supernode kernels, and the
+ *		triangular solves.
+ *
+ ***************************************************************************/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <algorithm>
+# include <vector>
+# include "matrix.h"
+# include "error.h"
+
+	/*
+	 * amalgamation always merges supernodes into ones of up to
+	 * RelaxSmall columns; up to RelaxMedium, up to RelaxLarge and
+	 * beyond it allows 80%, 10% and 5% explicit zeros
+	 */
+
+# define RelaxSmall	4
+# define RelaxMedium	16
+# define RelaxLarge	48
+
+	/*
+	 * Builds the structure of the lower triangle (diagonal included)
+	 * of P A P^T by column.  For every entry we also remember where
+	 * its coefficient lives in A so that the numeric factorization
+	 * can gather it without searching.
+	 */
+
+static void
+PermutedLowerStructure (const SparseMatrix &A, const cvector1<unsigned> &iperm,
+                        cvector1<unsigned> &colptr, cvector1<unsigned> &row,
+                        cvector1<unsigned> &addr)
+{
+   unsigned	i, j, k;
+   unsigned	a, b;
+   unsigned	n;
+
+   n = A -> ncols;
+
+   colptr.resize (n + 1);
+   for (j = 1 ; j <= n + 1 ; j++)
+      colptr [j] = 0;
+
+   for (j = 1 ; j <= n ; j++)
+      for (k = A -> colptr [j] ; k < A -> colptr [j + 1] ; k++) {
+         a = iperm [A -> rowind [k]];
+         b = iperm [j];
+         colptr [std::min (a, b)] ++;
+      }
+
+   std::vector<unsigned> next (n + 1);
+   a = 1;
+   for (j = 1 ; j <= n ; j++) {
+      next [j] = a;
+      a += colptr [j];
+      colptr [j] = next [j];
+   }
+   colptr [n + 1] = a;
+
+   row.resize (a > 1 ? a - 1 : 1);
+   addr.resize (a > 1 ? a - 1 : 1);
+
+   for (j = 1 ; j <= n ; j++)
+      for (k = A -> colptr [j] ; k < A -> colptr [j + 1] ; k++) {
+         a = iperm [A -> rowind [k]];
+         b = iperm [j];
+         i = next [std::min (a, b)] ++;
+         row [i] = std::max (a, b);
+         addr [i] = k;
+      }
+}
+
+	/*
+	 * the same structure transposed: for each k the pivots i < k
+	 * with a(k,i) != 0, i.e., row k of the lower triangle
+	 */
+
+static void
+UpperStructure (unsigned n, const cvector1<unsigned> &colptr, const cvector1<unsigned> &row,
+                std::vector<unsigned> &upptr, std::vector<unsigned> &uprow)
+{
+   unsigned	j, k;
+
+   upptr.assign (n + 2, 0);
+   for (j = 1 ; j <= n ; j++)
+      for (k = colptr [j] ; k < colptr [j + 1] ; k++)
+         if (row [k] != j)
+            upptr [row [k] + 1] ++;
+
+   upptr [1] = 0;
+   for (j = 1 ; j <= n ; j++)
+      upptr [j + 1] += upptr [j];
+
+   uprow.resize (upptr [n + 1]);
+   std::vector<unsigned> fill (upptr.begin(), upptr.end() - 1);
+   for (j = 1 ; j <= n ; j++)
+      for (k = colptr [j] ; k < colptr [j + 1] ; k++)
+         if (row [k] != j)
+            uprow [fill [row [k]] ++] = j;
+}
+
+	/*
+	 * Liu's algorithm: the parent of i in the elimination tree is the
+	 * first pivot k > i whose row of L reaches i.  Path compression
+	 * through ancestor keeps it nearly linear.
+	 */
+
+static void
+EliminationTree (unsigned n, const std::vector<unsigned> &upptr,
+                 const std::vector<unsigned> &uprow, cvector1<unsigned> &parent)
+{
+   unsigned	i, j, k;
+   unsigned	next;
+
+   std::vector<unsigned> ancestor (n + 1, 0);
+   parent.resize (n);
+
+   for (k = 1 ; k <= n ; k++) {
+      parent [k] = 0;
+      for (j = upptr [k] ; j < upptr [k + 1] ; j++) {
+         i = uprow [j];
+         while (i && i < k) {
+            next = ancestor [i];
+            ancestor [i] = k;
+            if (!next) {
+               parent [i] = k;
+               break;
+            }
+            i = next;
+         }
+      }
+   }
+}
+
+SparseFactor AnalyzeSparseMatrix (const SparseMatrix &A)
+{
+   unsigned	i, j, k, s, c;
+   unsigned	n;
+   unsigned	f, l;
+   unsigned	m, nc;
+   unsigned	count;
+   unsigned	ns;
+   unsigned long nnz;
+   double	z, size;
+
+   if (A -> nrows != A -> ncols || !A -> symmetric)
+      return SparseFactor();
+
+   n = A -> ncols;
+
+   cvector1<unsigned> order;
+   if (MinimumDegreeOrdering (A, order))
+      return SparseFactor();
+
+   SparseFactor F(new struct sparse_factor);
+   F -> n = n;
+
+   cvector1<unsigned> iperm(n);
+   for (k = 1 ; k <= n ; k++)
+      iperm [order [k]] = k;
+
+   cvector1<unsigned> colptr, row, addr;
+   cvector1<unsigned> parent;
+   std::vector<unsigned> upptr, uprow;
+
+   PermutedLowerStructure (A, iperm, colptr, row, addr);
+   UpperStructure (n, colptr, row, upptr, uprow);
+   EliminationTree (n, upptr, uprow, parent);
+
+	/*
+	 * postorder the elimination tree so that every supernode is a
+	 * contiguous range of pivots and every subtree precedes its root
+	 */
+
+   std::vector<unsigned> child (n + 1, 0), sibling (n + 1, 0);
+   for (j = n ; j >= 1 ; j--)
+      if (parent [j]) {
+         sibling [j] = child [parent [j]];
+         child [parent [j]] = j;
+      }
+
+   std::vector<unsigned> post;
+   std::vector<unsigned> stack;
+   post.reserve (n);
+   for (j = 1 ; j <= n ; j++) {
+      if (parent [j])
+         continue;
+
+      stack.push_back (j);
+      while (!stack.empty()) {
+         i = stack.back();
+         if (child [i]) {
+            c = child [i];
+            child [i] = sibling [c];
+            stack.push_back (c);
+         }
+         else {
+            post.push_back (i);
+            stack.pop_back();
+         }
+      }
+   }
+
+   F -> perm.resize (n);
+   F -> iperm.resize (n);
+   for (k = 1 ; k <= n ; k++) {
+      F -> perm [k] = order [post [k - 1]];
+      F -> iperm [F -> perm [k]] = k;
+   }
+
+   PermutedLowerStructure (A, F -> iperm, F -> Acolptr, F -> Arow, F -> Aaddr);
+   UpperStructure (n, F -> Acolptr, F -> Arow, upptr, uprow);
+   EliminationTree (n, upptr, uprow, parent);
+
+	/*
+	 * column counts of L from the row subtrees: row k of L is the
+	 * union of the tree paths from each i with a(k,i) != 0 up to k
+	 */
+
+   std::vector<unsigned> colcount (n + 1, 1);
+   std::vector<unsigned> mark (n + 1, 0);
+   std::vector<unsigned> nchild (n + 1, 0);
+
+   for (j = 1 ; j <= n ; j++)
+      if (parent [j])
+         nchild [parent [j]] ++;
+
+   for (k = 1 ; k <= n ; k++) {
+      mark [k] = k;
+      for (s = upptr [k] ; s < upptr [k + 1] ; s++)
+         for (j = uprow [s] ; mark [j] != k ; j = parent [j]) {
+            colcount [j] ++;
+            mark [j] = k;
+         }
+   }
+
+   std::vector<unsigned>().swap (uprow);
+
+	/*
+	 * fundamental supernodes: j joins the supernode of j - 1 when
+	 * j - 1 is its only child and their columns nest exactly
+	 */
+
+   std::vector<unsigned> first;
+   first.push_back (1);
+   for (j = 2 ; j <= n ; j++)
+      if (!(parent [j - 1] == j && colcount [j - 1] == colcount [j] + 1 && nchild [j] == 1))
+         first.push_back (j);
+
+   ns = first.size();
+   first.push_back (n + 1);
+
+	/*
+	 * relaxed amalgamation: a supernode whose last pivot is the child
+	 * of the first pivot of the next one (in postorder, the last
+	 * child of its parent) is merged into it if the explicit zeros
+	 * that adds are few for the size of the result.  Small dense
+	 * fronts cost far more in bookkeeping than in arithmetic.
+	 */
+
+   std::vector<unsigned> ncols (ns), nrows (ns);
+   std::vector<double> zeros (ns, 0.0);
+   std::vector<bool> merged (ns, false);
+
+   for (s = 0 ; s < ns ; s++) {
+      ncols [s] = first [s + 1] - first [s];
+      nrows [s] = colcount [first [s]];
+   }
+
+   for (s = 0 ; s + 1 < ns ; s++) {
+      if (parent [first [s + 1] - 1] != first [s + 1])
+         continue;
+
+      nc = ncols [s] + ncols [s + 1];
+      m = ncols [s] + nrows [s + 1];
+      size = (double) nc * m - (double) nc * (nc - 1) / 2;
+      z = zeros [s] + zeros [s + 1] + (double) ncols [s] * (m - nrows [s]);
+
+      if (nc <= RelaxSmall || (nc <= RelaxMedium && z < 0.8*size) ||
+          (nc <= RelaxLarge && z < 0.1*size) || z < 0.05*size) {
+         zeros [s + 1] = z;
+         ncols [s + 1] = nc;
+         nrows [s + 1] = m;
+         first [s + 1] = first [s];
+         merged [s] = true;
+      }
+   }
+
+   std::vector<unsigned> super;
+   for (s = 0 ; s < ns ; s++)
+      if (!merged [s])
+         super.push_back (first [s]);
+
+   F -> nsuper = super.size();
+   super.push_back (n + 1);
+
+   F -> super.resize (F -> nsuper + 1);
+   for (s = 1 ; s <= F -> nsuper + 1 ; s++)
+      F -> super [s] = super [s - 1];
+
+   std::vector<unsigned> snode (n + 1);
+   for (s = 1 ; s <= F -> nsuper ; s++)
+      for (j = F -> super [s] ; j < F -> super [s + 1] ; j++)
+         snode [j] = s;
+
+	/*
+	 * the supernodal elimination tree and the row structure of each
+	 * supernode: its own pivots, the entries of A below them, and
+	 * whatever its children pass up
+	 */
+
+   std::vector<unsigned> shead (F -> nsuper + 1, 0), snext (F -> nsuper + 1, 0);
+   F -> nchild.resize (F -> nsuper);
+   for (s = 1 ; s <= F -> nsuper ; s++)
+      F -> nchild [s] = 0;
+
+   for (s = F -> nsuper ; s >= 1 ; s--) {
+      l = F -> super [s + 1] - 1;
+      if (parent [l]) {
+         c = snode [parent [l]];
+         snext [s] = shead [c];
+         shead [c] = s;
+         F -> nchild [c] ++;
+      }
+   }
+
+   F -> rowptr.resize (F -> nsuper + 1);
+   F -> Lptr.resize (F -> nsuper + 1);
+   F -> rows.clear();
+
+   std::fill (mark.begin(), mark.end(), 0);
+   F -> maxfront = 0;
+   nnz = 1;
+   for (s = 1 ; s <= F -> nsuper ; s++) {
+      f = F -> super [s];
+      l = F -> super [s + 1] - 1;
+      nc = l - f + 1;
+
+      F -> rowptr [s] = F -> rows.size() + 1;
+      for (j = f ; j <= l ; j++) {
+         F -> rows.push_back (j);
+         mark [j] = s;
+      }
+
+      count = F -> rows.size();
+      for (j = f ; j <= l ; j++)
+         for (k = F -> Acolptr [j] ; k < F -> Acolptr [j + 1] ; k++) {
+            i = F -> Arow [k];
+            if (i > l && mark [i] != s) {
+               mark [i] = s;
+               F -> rows.push_back (i);
+            }
+         }
+
+      for (c = shead [s] ; c ; c = snext [c]) {
+         m = F -> super [c + 1] - F -> super [c];
+         for (k = F -> rowptr [c] + m ; k < F -> rowptr [c + 1] ; k++) {
+            i = F -> rows [k];
+            if (i > l && mark [i] != s) {
+               mark [i] = s;
+               F -> rows.push_back (i);
+            }
+         }
+      }
+
+      std::sort (F -> rows.c_ptr() + count, F -> rows.c_ptr() + F -> rows.size());
+
+      m = F -> rows.size() + 1 - F -> rowptr [s];
+      F -> Lptr [s] = nnz;
+      nnz += (unsigned long) m * nc;
+      if (m > F -> maxfront)
+         F -> maxfront = m;
+   }
+
+   F -> rowptr [F -> nsuper + 1] = F -> rows.size() + 1;
+   F -> Lptr [F -> nsuper + 1] = nnz;
+
+   return F;
+}
+
+	/*
+	 * the dense kernel for one frontal matrix (column major, m x m,
+	 * only the lower triangle referenced).  The first nc columns are
+	 * factored in place as L D L^T, FrontBlock columns at a time;
+	 * after each block everything to its right, the rest of those
+	 * columns and the update matrix alike, gets one rank-nb update
+	 * from UpdateKernel, four columns by FrontRows rows at a time so
+	 * that the rows of the block being applied stay in cache.  W
+	 * must hold FrontBlock*m values.
+	 */
+
+# define FrontBlock	48
+# define FrontRows	256
+
+static int
+FactorFront (double *front, unsigned m, unsigned nc, double *D, double *W)
+{
+   unsigned	i, j, k, q, t;
+   unsigned	kb, nb, r;
+   unsigned	ib, iend;
+   double	d;
+   double	*Lk;
+
+   for (kb = 0 ; kb < nc ; kb += nb) {
+      nb = std::min (nc - kb, (unsigned) FrontBlock);
+      r = kb + nb;
+
+      for (k = kb ; k < r ; k++) {
+         Lk = front + (unsigned long) k*m;
+         d = Lk [k];
+         if (d == 0.0)
+            return M_SINGULAR;
+
+         D [k] = d;
+         for (i = k + 1 ; i < m ; i++)
+            Lk [i] /= d;
+
+         for (j = k + 1 ; j < r ; j++)
+            AxpyKernel (front + j + (unsigned long) j*m, -Lk [j] * d, Lk + j, m - j);
+      }
+
+	/*
+	 * W = (L D)^T for the rows below the block, packed by groups
+	 * of four rows in the order UpdateKernel reads them
+	 */
+
+      for (j = r ; j < m ; j++)
+         for (q = 0 ; q < nb ; q++)
+            W [(unsigned long) (j - r)/4*4*nb + 4*q + (j - r)%4] =
+               front [j + (unsigned long) (kb + q)*m] * D [kb + q];
+
+      for (ib = r ; ib < m ; ib += FrontRows) {
+         iend = std::min (ib + FrontRows, m);
+         for (j = r ; j < iend ; j += 4) {
+            if (j + 4 <= m) {
+               i = std::max (j, ib);
+               UpdateKernel (front + i + (unsigned long) j*m, m,
+                             front + i + (unsigned long) kb*m, m,
+                             W + (unsigned long) (j - r)*nb, iend - i, nb);
+               continue;
+            }
+
+            for (t = j ; t < m ; t++) {
+               i = std::max (t, ib);
+               for (q = 0 ; q < nb ; q++)
+                  AxpyKernel (front + i + (unsigned long) t*m,
+                              -W [(unsigned long) (j - r)*nb + 4*q + t - j],
+                              front + i + (unsigned long) (kb + q)*m, iend - i);
+            }
+         }
+      }
+   }
+
+   return 0;
+}
+
+int FactorSparseMatrix (SparseFactor &F, const SparseMatrix &A)
+{
+   unsigned	i, j, k, s, c, q;
+   unsigned	f, l, m, nc, mu, cm, cnc;
+   unsigned	pi, pj;
+   unsigned	n;
+   int		status;
+   double	*front;
+   double	*U;
+   const unsigned *rows;
+   const unsigned *crows;
+   const double	*a;
+
+   n = F -> n;
+   if (A -> ncols != n || A -> nrows != n)
+      return M_SIZEMISMATCH;
+
+   F -> L.resize (F -> Lptr [F -> nsuper + 1] - 1);
+   F -> D.resize (n);
+
+   a = SparseData (A);
+
+   std::vector<double> frontal ((unsigned long) F -> maxfront * F -> maxfront);
+   std::vector<double> work ((unsigned long) F -> maxfront * FrontBlock);
+   std::vector<unsigned> pos (n + 1);
+   std::vector<double> stack;
+   std::vector<unsigned long> stack_off;
+   std::vector<unsigned> stack_snode;
+
+	/*
+	 * supernodes come in postorder, so the update matrices of the
+	 * children of s are the top nchild [s] entries on the stack
+	 */
+
+   for (s = 1 ; s <= F -> nsuper ; s++) {
+      f = F -> super [s];
+      l = F -> super [s + 1] - 1;
+      nc = l - f + 1;
+      m = F -> rowptr [s + 1] - F -> rowptr [s];
+      rows = F -> rows.c_ptr1() + F -> rowptr [s];	/* rows [0 .. m-1] */
+
+      front = &frontal [0];
+      for (k = 0 ; k < (unsigned long) m * m ; k++)
+         front [k] = 0.0;
+
+      for (k = 0 ; k < m ; k++)
+         pos [rows [k]] = k;
+
+      for (j = f ; j <= l ; j++)
+         for (k = F -> Acolptr [j] ; k < F -> Acolptr [j + 1] ; k++)
+            front [pos [F -> Arow [k]] + (unsigned long) (j - f)*m] += a [F -> Aaddr [k]];
+
+      for (q = 0 ; q < F -> nchild [s] ; q++) {
+         c = stack_snode.back();
+         cnc = F -> super [c + 1] - F -> super [c];
+         cm = F -> rowptr [c + 1] - F -> rowptr [c];
+         crows = F -> rows.c_ptr1() + F -> rowptr [c] + cnc;
+         mu = cm - cnc;
+         U = &stack [stack_off.back()];
+
+         for (j = 0 ; j < mu ; j++) {
+            pj = pos [crows [j]];
+            for (i = j ; i < mu ; i++) {
+               pi = pos [crows [i]];
+               front [pi + (unsigned long) pj*m] += U [i + (unsigned long) j*mu];
+            }
+         }
+
+         stack.resize (stack_off.back());
+         stack_off.pop_back();
+         stack_snode.pop_back();
+      }
+
+      status = FactorFront (front, m, nc, F -> D.c_ptr1() + f, &work [0]);
+      if (status)
+         return status;
+
+      for (k = 0 ; k < (unsigned long) m * nc ; k++)
+         F -> L [F -> Lptr [s] + k] = front [k];
+
+      mu = m - nc;
+      if (mu) {
+         stack_off.push_back (stack.size());
+         stack_snode.push_back (s);
+         stack.resize (stack.size() + (unsigned long) mu*mu);
+         U = &stack [stack_off.back()];
+         for (j = 0 ; j < mu ; j++)
+            for (i = j ; i < mu ; i++)
+               U [i + (unsigned long) j*mu] = front [nc + i + (unsigned long) (nc + j)*m];
+      }
+   }
+
+   return 0;
+}
+
+int SolveSparseMatrix (const SparseFactor &F, Matrix &b)
+{
+   unsigned	i, k, s;
+   unsigned	f, m, nc;
+   unsigned	n;
+   double	xj, sum;
+   const double	*Lk;
+   const unsigned *rows;
+   double	*bv;
+
+   n = F -> n;
+
+   if (IsCompact(b))
+      return M_COMPACT;
+
+   if (!IsColumnVector(b))
+      return M_NOTCOLUMN;
+
+   if (Mrows(b) != n)
+      return M_SIZEMISMATCH;
+
+   bv = VectorData (b);
+   std::vector<double> x (n + 1);
+
+   for (k = 1 ; k <= n ; k++)
+      x [k] = bv [F -> perm [k]];
+
+	/*
+	 * forward solve with L, then the diagonal, then back solve
+	 * with L^T, one supernode block at a time
+	 */
+
+   for (s = 1 ; s <= F -> nsuper ; s++) {
+      f = F -> super [s];
+      nc = F -> super [s + 1] - f;
+      m = F -> rowptr [s + 1] - F -> rowptr [s];
+      rows = F -> rows.c_ptr1() + F -> rowptr [s];
+
+      for (k = 0 ; k < nc ; k++) {
+         Lk = F -> L.c_ptr1() + F -> Lptr [s] + (unsigned long) k*m;
+         xj = x [f + k];
+         if (xj != 0.0)
+            for (i = k + 1 ; i < m ; i++)
+               x [rows [i]] -= Lk [i] * xj;
+      }
+   }
+
+   for (k = 1 ; k <= n ; k++)
+      x [k] /= F -> D [k];
+
+   for (s = F -> nsuper ; s >= 1 ; s--) {
+      f = F -> super [s];
+      nc = F -> super [s + 1] - f;
+      m = F -> rowptr [s + 1] - F -> rowptr [s];
+      rows = F -> rows.c_ptr1() + F -> rowptr [s];
+
+      for (k = nc ; k-- > 0 ; ) {
+         Lk = F -> L.c_ptr1() + F -> Lptr [s] + (unsigned long) k*m;
+         sum = x [f + k];
+         for (i = k + 1 ; i < m ; i++)
+            sum -= Lk [i] * x [rows [i]];
+         x [f + k] = sum;
+      }
+   }
+
+   for (k = 1 ; k <= n ; k++)
+      bv [F -> perm [k]] = x [k];
+
+   return 0;
+}
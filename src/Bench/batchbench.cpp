@@ -0,0 +1,287 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/****************************************************************************
+ *
+ * File:         batchbench.cpp
+ *
+ * Description:  Measures the throughput, in files per second, of solving
+ *		 a set of input files with one felt process per file
+ *		 (one at a time and several at a time) and with a single
+ *		 felt -batch process, and checks that both ways produce
+ *		 the same results.
+ *
+ *****************************************************************************/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <fcntl.h>
+# include <spawn.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include <sys/time.h>
+# include <sys/wait.h>
+# include <string>
+# include <vector>
+
+# define streq(a,b)	!strcmp(a,b)
+
+extern char **environ;
+
+static const char *usage = "\
+usage: batchbench [options] filename ...\n\
+       -felt path          felt executable to run (default felt)\n\
+       -jobs n             files solved at once (default: all processors)\n\
+       -output directory   where results are written (default batchbench.d)\n\
+";
+
+static double
+Seconds (void)
+{
+   struct timeval	tv;
+
+   gettimeofday (&tv, NULL);
+   return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+	/*
+	 * results go to the output directory under the input's name
+	 * with its extension replaced, as felt -batch -output names them
+	 */
+
+static std::string
+ResultName (const char *dir, const std::string &input, const char *suffix)
+{
+   std::string::size_type	slash, dot;
+   std::string			name;
+
+   slash = input.rfind ('/');
+   name = slash == std::string::npos ? input : input.substr (slash + 1);
+   dot = name.rfind ('.');
+   if (dot != std::string::npos)
+      name = name.substr (0, dot);
+
+   return std::string (dir) + "/" + name + suffix;
+}
+
+static pid_t
+Spawn (const char *const *args, const char *output)
+{
+   posix_spawn_file_actions_t	actions;
+   pid_t			pid;
+
+   posix_spawn_file_actions_init (&actions);
+   posix_spawn_file_actions_addopen (&actions, 1, output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+   posix_spawn_file_actions_addopen (&actions, 2, "/dev/null", O_WRONLY, 0);
+
+   if (posix_spawnp (&pid, args [0], &actions, NULL, (char *const *) args, environ))
+      pid = -1;
+
+   posix_spawn_file_actions_destroy (&actions);
+   return pid;
+}
+
+	/*
+	 * runs felt once per file with at most jobs processes alive at
+	 * a time and returns the elapsed time
+	 */
+
+static double
+ProcessPerFile (const char *felt, const std::vector<std::string> &inputs,
+                const char *dir, unsigned jobs, unsigned *failed)
+{
+   unsigned	next, running;
+   int		status;
+   pid_t	pid;
+   double	start;
+
+   *failed = 0;
+   next = running = 0;
+   start = Seconds ( );
+
+   while (next < inputs.size ( ) || running) {
+      while (running < jobs && next < inputs.size ( )) {
+         const std::string output = ResultName (dir, inputs [next], ".single");
+         const char *args [ ] = {felt, inputs [next].c_str ( ), NULL};
+
+         if (Spawn (args, output.c_str ( )) < 0)
+            ++ *failed;
+         else
+            running ++;
+         next ++;
+      }
+
+      if (running) {
+         if ((pid = wait (&status)) < 0)
+            break;
+         running --;
+         if (!WIFEXITED (status) || WEXITSTATUS (status))
+            ++ *failed;
+      }
+   }
+
+   return Seconds ( ) - start;
+}
+
+static double
+Batch (const char *felt, const std::vector<std::string> &inputs,
+       const char *dir, unsigned jobs, unsigned *failed)
+{
+   FILE		*fp;
+   unsigned	i;
+   int		status;
+   pid_t	pid;
+   double	start;
+   char		count [32];
+
+   const std::string manifest = std::string (dir) + "/manifest";
+   const std::string log = std::string (dir) + "/batch.log";
+
+   if (!(fp = fopen (manifest.c_str ( ), "w"))) {
+      fprintf (stderr, "batchbench: unable to write %s\n", manifest.c_str ( ));
+      exit (1);
+   }
+
+   for (i = 0 ; i < inputs.size ( ) ; i++)
+      fprintf (fp, "%s\n", inputs [i].c_str ( ));
+   fclose (fp);
+
+   sprintf (count, "%u", jobs);
+   const char *args [ ] = {felt, "-manifest", manifest.c_str ( ), "-jobs", count,
+                           "-output", dir, NULL};
+
+   *failed = 0;
+   start = Seconds ( );
+
+   if ((pid = Spawn (args, log.c_str ( ))) < 0 || waitpid (pid, &status, 0) < 0)
+      *failed = inputs.size ( );
+   else if (!WIFEXITED (status) || WEXITSTATUS (status))
+      *failed = 1;
+
+   return Seconds ( ) - start;
+}
+
+	/*
+	 * each batch result is compared with the result of running felt
+	 * on the file by itself
+	 */
+
+static unsigned
+CompareResults (const std::vector<std::string> &inputs, const char *dir)
+{
+   FILE		*a, *b;
+   unsigned	i, differ;
+   int		ca, cb;
+
+   differ = 0;
+   for (i = 0 ; i < inputs.size ( ) ; i++) {
+      a = fopen (ResultName (dir, inputs [i], ".single").c_str ( ), "r");
+      b = fopen (ResultName (dir, inputs [i], ".out").c_str ( ), "r");
+
+      ca = cb = 0;
+      if (a && b) {
+         do {
+            ca = getc (a);
+            cb = getc (b);
+         } while (ca == cb && ca != EOF);
+      }
+
+      if (!a || !b || ca != cb)
+         differ ++;
+
+      if (a) fclose (a);
+      if (b) fclose (b);
+   }
+
+   return differ;
+}
+
+static void
+Report (const char *method, const char *how, unsigned n, double elapsed,
+        unsigned failed, double baseline)
+{
+   printf ("%-18s %-14s %9.3f %12.1f %9.2f", method, how, elapsed,
+           n / elapsed, baseline / elapsed);
+   if (failed)
+      printf ("   (%u failed)", failed);
+   printf ("\n");
+}
+
+int main (int argc, char *argv[])
+{
+   std::vector<std::string>	inputs;
+   const char			*felt, *dir;
+   unsigned			jobs, failed;
+   double			serial, elapsed;
+   char				how [32];
+   int				k;
+
+   felt = "felt";
+   dir = "batchbench.d";
+   jobs = sysconf (_SC_NPROCESSORS_ONLN);
+
+   for (k = 1 ; k < argc ; k++) {
+      if (streq (argv [k], "-felt") && k + 1 < argc)
+         felt = argv [++ k];
+      else if (streq (argv [k], "-jobs") && k + 1 < argc)
+         jobs = atoi (argv [++ k]);
+      else if (streq (argv [k], "-output") && k + 1 < argc)
+         dir = argv [++ k];
+      else if (argv [k][0] == '-') {
+         fputs (usage, stderr);
+         exit (streq (argv [k], "-help") ? 0 : 1);
+      }
+      else
+         inputs.push_back (argv [k]);
+   }
+
+   if (inputs.empty ( ) || jobs < 1) {
+      fputs (usage, stderr);
+      exit (1);
+   }
+
+   mkdir (dir, 0777);
+
+   printf ("%u files\n\n", (unsigned) inputs.size ( ));
+   printf ("%-18s %-14s %9s %12s %9s\n", "method", "concurrency", "seconds", "files/s", "speedup");
+
+   serial = ProcessPerFile (felt, inputs, dir, 1, &failed);
+   Report ("process per file", "1 at a time", inputs.size ( ), serial, failed, serial);
+
+   if (jobs > 1) {
+      elapsed = ProcessPerFile (felt, inputs, dir, jobs, &failed);
+      sprintf (how, "%u at a time", jobs);
+      Report ("process per file", how, inputs.size ( ), elapsed, failed, serial);
+   }
+
+   elapsed = Batch (felt, inputs, dir, 1, &failed);
+   Report ("felt -batch", "1 job", inputs.size ( ), elapsed, failed, serial);
+
+   if (jobs > 1) {
+      elapsed = Batch (felt, inputs, dir, jobs, &failed);
+      sprintf (how, "%u jobs", jobs);
+      Report ("felt -batch", how, inputs.size ( ), elapsed, failed, serial);
+   }
+
+   printf ("\n%u of %u batch results differ from felt run on the file alone\n",
+           CompareResults (inputs, dir), (unsigned) inputs.size ( ));
+
+   return 0;
+}
@@ -0,0 +1,939 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/****************************************************************************
+ *
+ * File:         feltbench.cpp
+ *
+ * Description:  Times the stages of a solution (assembly, factorization,
+ *		 solve, load ranges, transient stepping, eigenvalues and
+ *		 FFT) on a fixed set of synthetic models that are
+ *		 generated in memory: brick blocks, long truss and frame
+ *		 lattices, and CST plates meshed with GenerateTriMesh,
+ *		 with load range, transient and modal variants.  Every size can be scaled.  The results
+ *		 are printed one stage per line so that the output of one
+ *		 run can be given back as the baseline of the next.
+ *
+ *****************************************************************************/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <math.h>
+# include <sys/time.h>
+# include <algorithm>
+# include <map>
+# include <string>
+# include "problem.h"
+# include "fe.h"
+# include "definition.h"
+# include "mesh.h"
+# include "meshgen.hpp"
+# include "transient.hpp"
+# include "error.h"
+# include "config.h"
+
+# define streq(a,b)	!strcmp(a,b)
+
+const char *progname = "felt-bench";
+
+static const char *usage = "\
+usage: felt-bench [options]\n\
+       -scale s            multiply the size of every model by s (default 1)\n\
+       -repeat n           run each case n times, keeping the fastest (default 3)\n\
+       -case name          only run the cases whose names start with name\n\
+       -solver name        use the skyline, sparse or pcg equation solver\n\
+       -threads n          use n threads to assemble and factor matrices\n\
+       -baseline filename  compare with the output of an earlier run\n\
+";
+
+typedef enum {
+   StaticCase, RangeCase, TransientCase, ModalCase
+} CaseKind;
+
+typedef enum {
+   AssemblyStage, FactorStage, SolveStage, RangeStage, TransientStage,
+   FFTStage, EigenStage, NumStages
+} Stage;
+
+static const char *stage_names [ ] = {
+   "assembly", "factor", "solve", "range", "transient", "fft", "eigen"
+};
+
+	/*
+	 * the cases, with their sizes at scale 1: the number of bricks
+	 * along each axis, the number of lattice bays or the target
+	 * number of plate triangles, then the number of time steps or
+	 * modes.  A load range always takes RangeSteps steps.
+	 */
+
+typedef struct {
+   const char	*model;
+   CaseKind	 kind;
+   unsigned	 size [3];
+} BenchCase;
+
+static const BenchCase cases [ ] = {
+   {"brick", StaticCase,    {12, 12, 16}},
+   {"truss", StaticCase,    {4000}},
+   {"frame", StaticCase,    {4000}},
+   {"plate", StaticCase,    {8000}},
+   {"brick", RangeCase,     {10, 10, 10}},
+   {"truss", TransientCase, {500, 1000}},
+   {"plate", TransientCase, {1000, 200}},
+   {"frame", ModalCase,     {1000, 10}},
+   {"plate", ModalCase,     {2000, 10}},
+};
+
+# define NumCases (sizeof (cases) / sizeof (cases [0]))
+
+typedef struct {
+   double	seconds;
+   double	check;
+   int		has_check;
+} Result;
+
+static double
+Seconds (void)
+{
+   struct timeval	tv;
+
+   gettimeofday (&tv, NULL);
+   return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+static Constraint
+MakeConstraint (const char *name, const char *dofs)
+{
+   Constraint	constraint (new constraint_t (name));
+
+   for ( ; *dofs ; dofs ++)
+      constraint -> constraint [*dofs - '0'] = 1;
+
+   return constraint;
+}
+
+static Force
+MakeForce (const char *name, unsigned dof, double value)
+{
+   Force	force (new force_t (name));
+
+   force -> force [dof].value = value;
+   return force;
+}
+
+	/*
+	 * every model is made of one steel-like material
+	 */
+
+static Material
+MakeMaterial (void)
+{
+   Material	material (new material_t ("steel"));
+
+   material -> E = 2.0e11;
+   material -> nu = 0.3;
+   material -> rho = 7850.0;
+   material -> A = 0.01;
+   material -> Ix = 1.0e-4;
+   material -> t = 0.01;
+
+   return material;
+}
+
+	/*
+	 * hands the generated nodes and elements to the problem with
+	 * every node free and unloaded to begin with
+	 */
+
+static void
+UseModel (cvector1<Node> &node, cvector1<Element> &element, Constraint free)
+{
+   unsigned	i;
+   Material	material;
+
+   material = MakeMaterial ( );
+
+   for (i = 1 ; i <= node.size() ; i++)
+      node [i] -> constraint = free;
+
+   for (i = 1 ; i <= element.size() ; i++)
+      element [i] -> material = material;
+
+   problem.nodes = node;
+   problem.elements = element;
+}
+
+	/*
+	 * an nx by ny by nz block of unit bricks clamped at z = 0 with
+	 * its top face pushed down
+	 */
+
+static int
+BrickBlock (unsigned nx, unsigned ny, unsigned nz)
+{
+   struct _grid		grid;
+   cvector1<Node>	node;
+   cvector1<Element>	element;
+   Constraint		fixed;
+   Force		load;
+   unsigned		i;
+
+   grid.definition = LookupDefinition ("brick");
+   grid.xs = grid.ys = grid.zs = 0.0;
+   grid.xe = nx;
+   grid.ye = ny;
+   grid.ze = nz;
+   grid.xnumber = nx;
+   grid.ynumber = ny;
+   grid.znumber = nz;
+   grid.xrule = grid.yrule = grid.zrule = LinearRule;
+
+   if (GenerateBrickGrid (&grid, element, node, 0, 0))
+      return 1;
+
+   UseModel (node, element, MakeConstraint ("free", ""));
+
+   fixed = MakeConstraint ("fixed", "123");
+   load = MakeForce ("load", Tz, -1000.0);
+
+   for (i = 1 ; i <= node.size() ; i++) {
+      if (node [i] -> z == 0.0)
+         node [i] -> constraint = fixed;
+      else if (node [i] -> z == nz)
+         node [i] -> force = load;
+   }
+
+   return 0;
+}
+
+	/*
+	 * a simply supported lattice of n unit bays with a bottom and a
+	 * top chord, verticals and alternating diagonals, loaded along
+	 * the top chord.  Nodes 2i+1 and 2i+2 are the bottom and top of
+	 * the i-th vertical, which keeps the profile narrow.  A truss
+	 * lattice is held in its plane.
+	 */
+
+static int
+Lattice (const char *type, unsigned n)
+{
+   cvector1<Node>	node;
+   cvector1<Element>	element;
+   Definition		definition;
+   Constraint		pinned;
+   Constraint		roller;
+   Force		load;
+   const char		*plane;
+   unsigned		i, e;
+   char			dofs [8];
+
+   definition = LookupDefinition (type);
+   if (!definition) {
+      error ("%s elements are not defined", type);
+      return 1;
+   }
+
+   plane = streq (type, "truss") ? "3" : "";
+
+   node.resize (2*(n + 1));
+   for (i = 0 ; i <= n ; i++) {
+      node [2*i + 1].reset (new node_t (2*i + 1));
+      node [2*i + 1] -> x = i;
+      node [2*i + 1] -> y = 0.0;
+      node [2*i + 1] -> z = 0.0;
+
+      node [2*i + 2].reset (new node_t (2*i + 2));
+      node [2*i + 2] -> x = i;
+      node [2*i + 2] -> y = 1.0;
+      node [2*i + 2] -> z = 0.0;
+   }
+
+   element.resize (4*n + 1);
+   for (e = 1 ; e <= element.size() ; e++)
+      element [e].reset (new element_t (e, definition));
+
+   e = 0;
+   for (i = 0 ; i <= n ; i++) {
+      e ++;
+      element [e] -> node [1] = node [2*i + 1];
+      element [e] -> node [2] = node [2*i + 2];
+
+      if (i == n)
+         break;
+
+      e ++;
+      element [e] -> node [1] = node [2*i + 1];
+      element [e] -> node [2] = node [2*i + 3];
+
+      e ++;
+      element [e] -> node [1] = node [2*i + 2];
+      element [e] -> node [2] = node [2*i + 4];
+
+      e ++;
+      element [e] -> node [1] = node [2*i + 1 + i % 2];
+      element [e] -> node [2] = node [2*i + 4 - i % 2];
+   }
+
+   UseModel (node, element, MakeConstraint ("free", plane));
+
+   sprintf (dofs, "12%s", plane);
+   pinned = MakeConstraint ("pinned", dofs);
+   sprintf (dofs, "2%s", plane);
+   roller = MakeConstraint ("roller", dofs);
+   load = MakeForce ("load", Ty, -1000.0);
+
+   node [1] -> constraint = pinned;
+   node [2*n + 1] -> constraint = roller;
+   for (i = 0 ; i <= n ; i++)
+      node [2*i + 2] -> force = load;
+
+   return 0;
+}
+
+static bool
+LeftOf (const Node &a, const Node &b)
+{
+   return a -> x < b -> x || (a -> x == b -> x && a -> y < b -> y);
+}
+
+	/*
+	 * a 10 by 1 cantilever plate of about target CST elements,
+	 * clamped at x = 0 and loaded at the free end.  The nodes that
+	 * Triangle generates are renumbered from left to right.
+	 */
+
+static int
+Plate (unsigned target)
+{
+   struct _trimesh	trimesh;
+   struct _curve	boundary;
+   Curve		curves [1];
+   double		vcl [4][2] = {{0.0, 0.0}, {10.0, 0.0}, {10.0, 1.0}, {0.0, 1.0}};
+   cvector1<Node>	node;
+   cvector1<Element>	element;
+   Constraint		fixed;
+   Force		load;
+   unsigned		i;
+
+   boundary.numvc = 4;
+   boundary.vcl = vcl;
+   curves [0] = &boundary;
+
+   trimesh.definition = LookupDefinition ("CSTPlaneStress");
+   trimesh.target = target;
+   trimesh.alpha = 2.0;
+   trimesh.numcurves = 1;
+   trimesh.curves = curves;
+
+   if (GenerateTriMesh (&trimesh, element, node, 0, 0))
+      return 1;
+
+   std::sort (node.c_ptr1() + 1, node.c_ptr1() + node.size() + 1, LeftOf);
+   for (i = 1 ; i <= node.size() ; i++)
+      node [i] -> number = i;
+
+   UseModel (node, element, MakeConstraint ("free", ""));
+
+   fixed = MakeConstraint ("fixed", "12");
+   load = MakeForce ("load", Ty, -1000.0);
+
+   for (i = 1 ; i <= node.size() ; i++) {
+      if (node [i] -> x == 0.0)
+         node [i] -> constraint = fixed;
+      else if (node [i] -> x == 10.0)
+         node [i] -> force = load;
+   }
+
+   return 0;
+}
+
+	/*
+	 * the sizes of a case at the given scale and the name that they
+	 * give it
+	 */
+
+static void
+ScaleCase (const BenchCase &bc, double scale, unsigned *size, std::string &name)
+{
+   char		buffer [128];
+   double	factor;
+   unsigned	i;
+
+   factor = streq (bc.model, "brick") ? cbrt (scale) : scale;
+   for (i = 0 ; i < 3 ; i++)
+      size [i] = bc.size [i];
+
+   if (streq (bc.model, "brick")) {
+      for (i = 0 ; i < 3 ; i++)
+         size [i] = std::max (1.0, floor (bc.size [i]*factor + 0.5));
+      sprintf (buffer, "brick-%ux%ux%u", size [0], size [1], size [2]);
+   }
+   else {
+      size [0] = std::max (1.0, floor (bc.size [0]*factor + 0.5));
+      sprintf (buffer, "%s-%u", bc.model, size [0]);
+   }
+
+   name = buffer;
+   if (bc.kind == RangeCase)
+      name += "-range";
+   else if (bc.kind == TransientCase) {
+      sprintf (buffer, "-transient-%u", size [1]);
+      name += buffer;
+   }
+   else if (bc.kind == ModalCase) {
+      sprintf (buffer, "-modal-%u", size [1]);
+      name += buffer;
+   }
+}
+
+static int
+BuildModel (const BenchCase &bc, const unsigned *size)
+{
+   if (streq (bc.model, "brick"))
+      return BrickBlock (size [0], size [1], size [2]);
+   else if (streq (bc.model, "plate"))
+      return Plate (size [0]);
+   else
+      return Lattice (streq (bc.model, "frame") ? "beam" : bc.model, size [0]);
+}
+
+static double
+VectorNorm (const Matrix &x)
+{
+   unsigned	i;
+   double	sum;
+
+   sum = 0.0;
+   for (i = 1 ; i <= Mrows(x) ; i++)
+      sum += mdata(x,i,1)*mdata(x,i,1);
+
+   return sqrt (sum);
+}
+
+	/*
+	 * the norm of all the entries of a table
+	 */
+
+static double
+TableNorm (const Matrix &x)
+{
+   unsigned	i, j;
+   double	sum;
+
+   sum = 0.0;
+   for (i = 1 ; i <= Mrows(x) ; i++)
+      for (j = 1 ; j <= Mcols(x) ; j++)
+         sum += mdata(x,i,j)*mdata(x,i,j);
+
+   return sqrt (sum);
+}
+
+	/*
+	 * a superposed load range table has to match the one solved
+	 * step by step to within what the pcg solver can promise
+	 */
+
+static int
+CompareTables (const Matrix &a, const Matrix &b, const char *what)
+{
+   unsigned	i, j;
+   double	diff, size;
+
+   if (!a && !b)
+      return 0;
+
+   if (!a || !b || Mrows(a) != Mrows(b) || Mcols(a) != Mcols(b)) {
+      error ("the superposed and direct load range %s differ in size", what);
+      return 1;
+   }
+
+   diff = size = 0.0;
+   for (i = 1 ; i <= Mrows(a) ; i++)
+      for (j = 1 ; j <= Mcols(a) ; j++) {
+         diff = std::max (diff, fabs (mdata(a,i,j) - mdata(b,i,j)));
+         size = std::max (size, fabs (mdata(b,i,j)));
+      }
+
+   if (diff > 1.0e-6*size) {
+      error ("the superposed load range %s differ from the direct solve by %g", what, diff);
+      return 1;
+   }
+
+   return 0;
+}
+
+	/*
+	 * assembles the stiffness matrix and force vector of a static
+	 * case with the constraints applied; as in felt, the sparse
+	 * solvers assemble into sparse storage
+	 */
+
+static int
+AssembleStatic (char solver, Matrix &K, SparseMatrix &Ks, Matrix &F, ConstrainedRows *saved)
+{
+   int		status;
+
+   K = Matrix ( );
+   Ks = SparseMatrix ( );
+
+   if (solver == 's' || solver == 'c')
+      Ks = ConstructSparseStiffness (&status);
+   else
+      K = ConstructStiffness (&status);
+   if (status)
+      return status;
+
+   F = ConstructForceVector ( );
+   if (Ks)
+      ApplyConstraints (Ks, F, saved);
+   else
+      ApplyConstraints (K, F, saved);
+
+   return 0;
+}
+
+	/*
+	 * a load range case pushes down on the middle of the top face
+	 * of a brick block, on top of its base load, and reports that
+	 * node and two corners of the top face
+	 */
+
+# define RangeSteps	40
+
+static Node
+TopNode (double x, double y, double z)
+{
+   unsigned	i;
+
+   for (i = 1 ; i <= problem.nodes.size() ; i++)
+      if (problem.nodes [i] -> x == x && problem.nodes [i] -> y == y &&
+          problem.nodes [i] -> z == z)
+         return problem.nodes [i];
+
+   return Node ( );
+}
+
+static void
+RangeParameters (const unsigned *size)
+{
+   double	top;
+
+   top = size [2];
+
+   analysis.input_node = TopNode (size [0]/2, size [1]/2, top);
+   analysis.input_dof = Tz;
+   analysis.start = 0.0;
+   analysis.step = -1000.0;
+   analysis.stop = analysis.step*(RangeSteps - 1);
+
+   analysis.nodes.push_back (analysis.input_node);
+   analysis.nodes.push_back (TopNode (0.0, 0.0, top));
+   analysis.nodes.push_back (TopNode (size [0], size [1], top));
+
+   analysis.numdofs = 3;
+   analysis.dofs [1] = Tx;
+   analysis.dofs [2] = Ty;
+   analysis.dofs [3] = Tz;
+}
+
+	/*
+	 * the loaded nodes are the output nodes of a transient case,
+	 * with one output DOF (Ty) each
+	 */
+
+static void
+TransientParameters (unsigned steps)
+{
+   unsigned	i;
+
+   analysis.mass_mode = 'l';
+   analysis.beta = 0.25;
+   analysis.gamma = 0.5;
+   analysis.alpha = 0.0;
+   analysis.step = 1.0e-4;
+   analysis.stop = steps*analysis.step;
+
+   for (i = 1 ; i <= problem.nodes.size() ; i++)
+      if (problem.nodes [i] -> force)
+         analysis.nodes.push_back (problem.nodes [i]);
+
+   analysis.numdofs = 1;
+   analysis.dofs [1] = Ty;
+}
+
+	/*
+	 * runs the stages of one case in a problem context of its own;
+	 * a stage that is not part of the case is left with a negative
+	 * time
+	 */
+
+# define Time(stage)	result [stage].seconds = Seconds ( ) - start
+# define Check(stage,x)	(result [stage].check = (x), result [stage].has_check = 1)
+
+static int
+RunCase (const BenchCase &bc, const unsigned *size, char solver,
+         Result *result, unsigned *neqs)
+{
+   ProblemContext	context;
+   Matrix		K, M, C;
+   SparseMatrix		Ks, Ms, Cs;
+   Matrix		F;
+   Matrix		dtable, rtable;
+   Matrix		direct, rdirect;
+   ConstrainedRows	saved;
+   Matrix		Pr;
+   Vector		Fr;
+   Matrix		lambda, x;
+   LinearSolver		S;
+   double		start;
+   unsigned		nfft;
+   int			status;
+   unsigned		s;
+
+   for (s = 0 ; s < NumStages ; s++) {
+      result [s].seconds = -1.0;
+      result [s].has_check = 0;
+   }
+
+   SetProblemContext (&context);
+   ReadFeltFile (NULL);
+
+   status = BuildModel (bc, size);
+   if (status) {
+      SetProblemContext (NULL);
+      return status;
+   }
+
+   analysis.solver = solver;
+   FindDOFS ( );
+   *neqs = problem.num_equations;
+
+   switch (bc.kind) {
+   case StaticCase:
+
+      start = Seconds ( );
+      status = AssembleStatic (solver, K, Ks, F, NULL);
+      Time (AssemblyStage);
+      if (status)
+         break;
+
+      start = Seconds ( );
+      if (Ks)
+         status = FactorStiffnessMatrix (Ks, S);
+      else
+         status = FactorStiffnessMatrix (K, S);
+      Time (FactorStage);
+      if (status)
+         break;
+
+      start = Seconds ( );
+      status = SolveSystemMatrix (K, S, F);
+      Time (SolveStage);
+
+      Check (SolveStage, VectorNorm (F));
+      break;
+
+   case RangeCase:
+      RangeParameters (size);
+
+      start = Seconds ( );
+      status = AssembleStatic (solver, K, Ks, F, &saved);
+      Time (AssemblyStage);
+      if (status)
+         break;
+
+      start = Seconds ( );
+      if (Ks)
+         dtable = SolveStaticLoadRange (Ks, F, &saved, &rtable);
+      else
+         dtable = SolveStaticLoadRange (K, F, &saved, &rtable);
+      Time (RangeStage);
+      if (!dtable) {
+         status = 1;
+         break;
+      }
+
+	/*
+	 * the factor has replaced K, so the direct solve that checks
+	 * the superposed tables starts over from assembly
+	 */
+
+      status = AssembleStatic (solver, K, Ks, F, &saved);
+      if (status)
+         break;
+
+      if (Ks)
+         direct = SolveStaticLoadRangeDirect (Ks, F, &saved, &rdirect);
+      else
+         direct = SolveStaticLoadRangeDirect (K, F, &saved, &rdirect);
+
+      if (!direct || CompareTables (dtable, direct, "displacements") ||
+          CompareTables (rtable, rdirect, "reactions")) {
+         status = 1;
+         break;
+      }
+
+      Check (RangeStage, TableNorm (dtable));
+      break;
+
+   case TransientCase:
+      TransientParameters (size [1]);
+
+      start = Seconds ( );
+      if (solver == 's' || solver == 'c')
+         status = ConstructSparseDynamic (&Ks, &Ms, &Cs);
+      else
+         status = ConstructDynamic (&K, &M, &C);
+      Time (AssemblyStage);
+      if (status)
+         break;
+
+      start = Seconds ( );
+      if (Ks)
+         dtable = IntegrateHyperbolicDE (Ks, Ms, Cs);
+      else
+         dtable = IntegrateHyperbolicDE (K, M, C);
+      Time (TransientStage);
+      if (!dtable) {
+         status = 1;
+         break;
+      }
+
+      Check (TransientStage, fabs (mdata(dtable, Mrows(dtable), 1)));
+
+      for (nfft = 16 ; 2*nfft <= Mrows(dtable)/4 ; nfft *= 2);
+
+      start = Seconds ( );
+      ComputeOutputSpectraFFT (dtable, &Pr, &Fr, nfft);
+      Time (FFTStage);
+
+      Check (FFTStage, mdata(Pr, 1, 1));
+      break;
+
+   case ModalCase:
+      analysis.mass_mode = 'l';
+      analysis.modes = size [1];
+
+      start = Seconds ( );
+      if (solver == 's' || solver == 'c') {
+         status = ConstructSparseDynamic (&Ks, &Ms, &Cs);
+         if (!status)
+            CondenseConstrainedDOF (Ks, Ms, Cs);
+      }
+      else {
+         status = ConstructDynamic (&K, &M, &C);
+         if (!status)
+            CondenseConstrainedDOF (K, M, C);
+      }
+      Time (AssemblyStage);
+      if (status)
+         break;
+
+      start = Seconds ( );
+      if (Ks)
+         status = ComputeEigenModes (Ks, Ms, lambda, x);
+      else
+         status = ComputeEigenModes (K, M, lambda, x);
+      Time (EigenStage);
+
+      if (!status)
+         Check (EigenStage, mdata(lambda, 1, 1));
+      break;
+   }
+
+   SetProblemContext (NULL);
+   return status;
+}
+
+	/*
+	 * a baseline is the output of an earlier run; each line that is
+	 * not a comment or the heading gives a case, a stage, its time
+	 * and its check value (or -)
+	 */
+
+static int
+ReadBaseline (const char *filename, std::map<std::string, Result> &baseline)
+{
+   FILE		*fp;
+   char		line [1024];
+   char		name [256], stage [64], check [64];
+   Result	r;
+
+   if (!(fp = fopen (filename, "r"))) {
+      error ("unable to open baseline %s", filename);
+      return 1;
+   }
+
+   while (fgets (line, sizeof (line), fp)) {
+      if (line [0] == '#')
+         continue;
+
+      if (sscanf (line, "%255s %63s %lf %*s %*s %63s", name, stage, &r.seconds, check) != 4)
+         continue;
+
+      r.has_check = sscanf (check, "%lf", &r.check) == 1;
+      baseline [std::string (name) + " " + stage] = r;
+   }
+
+   fclose (fp);
+   return 0;
+}
+
+static void
+Report (const std::string &name, Stage stage, const Result &r,
+        const std::map<std::string, Result> &baseline)
+{
+   std::map<std::string, Result>::const_iterator	it;
+   const Result						*b;
+
+   it = baseline.find (name + " " + stage_names [stage]);
+   b = it == baseline.end ( ) ? NULL : &it -> second;
+
+   printf ("%-28s %-10s %12.6f", name.c_str ( ), stage_names [stage], r.seconds);
+
+   if (b)
+      printf (" %12.6f %8.3f", b -> seconds, b -> seconds > 0.0 ? r.seconds / b -> seconds : 0.0);
+   else
+      printf (" %12s %8s", "-", "-");
+
+   if (r.has_check)
+      printf (" %14.6e", r.check);
+   else
+      printf (" %14s", "-");
+
+   if (b && r.has_check && b -> has_check &&
+       fabs (r.check - b -> check) > 1e-6*std::max (fabs (r.check), fabs (b -> check)))
+      printf ("   (check differs)");
+
+   printf ("\n");
+}
+
+int main (int argc, char *argv[])
+{
+   std::map<std::string, Result>	baseline;
+   std::string				name;
+   const char				*only;
+   const char				*solver_name;
+   unsigned				size [3];
+   unsigned				repeat;
+   unsigned				i, r, s;
+   unsigned				neqs;
+   unsigned				threads;
+   double				scale;
+   Result				result [NumStages];
+   Result				best [NumStages];
+   char					solver;
+   int					failed;
+   int					k;
+
+   scale = 1.0;
+   repeat = 3;
+   only = NULL;
+   solver = 0;
+   solver_name = "skyline";
+   threads = 1;
+   neqs = 0;
+   failed = 0;
+
+   for (k = 1 ; k < argc ; k++) {
+      if (streq (argv [k], "-scale") && k + 1 < argc)
+         scale = atof (argv [++ k]);
+      else if (streq (argv [k], "-repeat") && k + 1 < argc)
+         repeat = atoi (argv [++ k]);
+      else if (streq (argv [k], "-case") && k + 1 < argc)
+         only = argv [++ k];
+      else if (streq (argv [k], "-threads") && k + 1 < argc)
+         threads = atoi (argv [++ k]);
+      else if (streq (argv [k], "-solver") && k + 1 < argc) {
+         solver_name = argv [++ k];
+         if (streq (solver_name, "sparse"))
+            solver = 's';
+         else if (streq (solver_name, "pcg"))
+            solver = 'c';
+         else if (!streq (solver_name, "skyline")) {
+            error ("unknown solver %s", solver_name);
+            exit (1);
+         }
+      }
+      else if (streq (argv [k], "-baseline") && k + 1 < argc) {
+         if (ReadBaseline (argv [++ k], baseline))
+            exit (1);
+      }
+      else {
+         fputs (usage, stderr);
+         exit (streq (argv [k], "-help") ? 0 : 1);
+      }
+   }
+
+   if (scale <= 0.0 || repeat < 1 || threads < 1) {
+      fputs (usage, stderr);
+      exit (1);
+   }
+
+   add_all_definitions ( );
+   SetAssemblyThreads (threads);
+   SetFactorThreads (threads);
+
+   printf ("# felt-bench %d.%d.%d, solver %s, %u thread%s, scale %g, best of %u\n",
+           FELT_VERSION_MAJOR, FELT_VERSION_MINOR, FELT_VERSION_MICRO,
+           solver_name, threads, threads == 1 ? "" : "s", scale, repeat);
+   printf ("%-28s %-10s %12s %12s %8s %14s\n", "case", "stage", "seconds",
+           "baseline", "ratio", "check");
+
+   for (i = 0 ; i < NumCases ; i++) {
+      ScaleCase (cases [i], scale, size, name);
+      if (only && name.compare (0, strlen (only), only))
+         continue;
+
+      for (s = 0 ; s < NumStages ; s++) {
+         best [s].seconds = -1.0;
+         best [s].has_check = 0;
+      }
+
+      for (r = 0 ; r < repeat ; r++) {
+         if (RunCase (cases [i], size, solver, result, &neqs)) {
+            error ("%s failed", name.c_str ( ));
+            failed = 1;
+            break;
+         }
+
+         for (s = 0 ; s < NumStages ; s++) {
+            if (result [s].seconds < 0.0)
+               continue;
+
+            if (best [s].seconds < 0.0 || result [s].seconds < best [s].seconds)
+               best [s].seconds = result [s].seconds;
+
+            best [s].check = result [s].check;
+            best [s].has_check = result [s].has_check;
+         }
+      }
+
+      fflush (stderr);
+      printf ("# %s: %u equations\n", name.c_str ( ), neqs);
+      for (s = 0 ; s < NumStages ; s++)
+         if (best [s].seconds >= 0.0)
+            Report (name, (Stage) s, best [s], baseline);
+
+      fflush (stdout);
+   }
+
+   return failed;
+}
@@ -0,0 +1,167 @@
+/*
+    This file is part of the FElt finite element analysis package.
+    Copyright (C) 1993-2000 Jason I. Gobat and Darren C. Atkinson
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/****************************************************************************
+ *
+ * File:         kernelbench.cpp
+ *
+ * Description:  A micro-benchmark of the dot product and axpy kernels
+ *		 used by the skyline solvers.  Every instruction set that
+ *		 the processor supports is timed and reported in GFLOP/s.
+ *
+ *****************************************************************************/
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <sys/time.h>
+# include "matrix.h"
+# include "cmatrix.h"
+
+# define streq(a,b)	!strcmp(a,b)
+
+const char *progname = "kernelbench";
+
+static const char *usage = "\
+usage: kernelbench [options]\n\
+       -length n           coefficients per kernel call (default 500)\n\
+       -time seconds       minimum time per measurement (default 0.5)\n\
+";
+
+static const char *sets [ ] = {"scalar", "sse2", "avx2", "avx512"};
+
+static double
+Seconds (void)
+{
+   struct timeval	tv;
+
+   gettimeofday (&tv, NULL);
+   return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+	/*
+	 * calls to the kernel are repeated until the minimum time has
+	 * passed; the sums are kept so the calls cannot be optimized away
+	 */
+
+static double
+TimeKernel (int kernel, unsigned n, double mintime, double *x, double *y,
+            complex *cx, complex *cy, double *sink)
+{
+   unsigned	calls, i;
+   double	start, elapsed;
+   double	flops;
+   complex	alpha, c;
+
+   alpha.r = 1e-9;
+   alpha.i = -1e-9;
+
+   calls = 0;
+   start = Seconds ( );
+   do {
+      for (i = 0 ; i < 1000 ; i++) {
+         switch (kernel) {
+         case 0:
+            *sink += DotKernel (x, y, n);
+            break;
+         case 1:
+            AxpyKernel (y, 1e-9, x, n);
+            break;
+         case 2:
+            c = ComplexDotKernel (cx, cy, n);
+            *sink += c.r + c.i;
+            break;
+         case 3:
+            ComplexAxpyKernel (cy, alpha, cx, n);
+            break;
+         }
+      }
+      calls += 1000;
+      elapsed = Seconds ( ) - start;
+   } while (elapsed < mintime);
+
+   flops = (kernel < 2 ? 2.0 : 8.0) * n * calls;
+   return flops / elapsed * 1e-9;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned	n, i, s;
+   double	mintime;
+   double	sink;
+   int		k;
+
+   n = 500;
+   mintime = 0.5;
+
+   for (k = 1 ; k < argc ; k++) {
+      if (streq (argv [k], "-length") && k + 1 < argc)
+         n = atoi (argv [++ k]);
+      else if (streq (argv [k], "-time") && k + 1 < argc)
+         mintime = atof (argv [++ k]);
+      else {
+         fputs (usage, stderr);
+         exit (streq (argv [k], "-help") ? 0 : 1);
+      }
+   }
+
+   if (n == 0) {
+      fputs (usage, stderr);
+      exit (1);
+   }
+
+   double  *x  = new double [n];
+   double  *y  = new double [n];
+   complex *cx = new complex [n];
+   complex *cy = new complex [n];
+
+   for (i = 0 ; i < n ; i++) {
+      x [i] = 1.0 + i % 7;
+      y [i] = 1.0 - i % 5;
+      cx [i].r = x [i];
+      cx [i].i = y [i];
+      cy [i].r = y [i];
+      cy [i].i = x [i];
+   }
+
+   printf ("kernel GFLOP/s, %u coefficients per call (default: %s)\n\n", n, KernelName ( ));
+   printf ("%-8s %10s %10s %10s %10s\n", "set", "dot", "axpy", "cdot", "caxpy");
+
+   sink = 0.0;
+   for (s = 0 ; s < sizeof (sets) / sizeof (sets [0]) ; s++) {
+      if (SelectKernels (sets [s])) {
+         printf ("%-8s %10s\n", sets [s], "unsupported");
+         continue;
+      }
+
+      printf ("%-8s", sets [s]);
+      for (k = 0 ; k < 4 ; k++)
+         printf (" %10.2f", TimeKernel (k, n, mintime, x, y, cx, cy, &sink));
+      printf ("\n");
+   }
+
+   SelectKernels (NULL);
+
+   delete [] x;
+   delete [] y;
+   delete [] cx;
+   delete [] cy;
+
+   return sink == 12345.0;
+}
@@ -27,7 +27,15 @@
  *****************************************************************************/
 
 # include <stdio.h>
+# include <stdlib.h>
+# include <stdarg.h>
 # include <string.h>
+# include <sys/time.h>
+# include <string>
+# include <vector>
+# include <boost/atomic.hpp>
+# include <boost/bind/bind.hpp>
+# include <boost/thread.hpp>
 # include "problem.h"
 # include "fe.h"
 # include "error.h"
@@ -36,12 +44,14 @@
 # include "draw.hpp"
 # include "renumber.hpp"
 # include "transient.hpp"
+# include "profile.h"
 # include "config.h"
 
 # define streq(a,b)	!strcmp(a,b)
 
 static const char *usage = "\
 usage: felt [options] [filename]\n\
+       felt -batch [options] filename ...\n\
        -debug              write debugging output\n\
        -preview            write a simple ASCII rendering of the problem\n\
        +table              do not print tabular dynamic results\n\
@@ -53,8 +63,17 @@ usage: felt [options] [filename]\n\
        -summary            include material summary statistics\n\
        -matrices           print the global matrices\n\
        -details            print ancillary analysis details\n\
+       -solver name        use the skyline, sparse or pcg equation solver\n\
+       -threads n          use n threads to assemble and factor matrices\n\
+       -cache              set up identical elements only once\n\
+       -tabulate           evaluate transient loads before time stepping\n\
+       -batch              solve each file named on the command line\n\
+       -manifest filename  solve each file listed in a manifest (batch)\n\
+       -jobs n             solve n files at once in batch mode\n\
+       -output directory   write batch results to a directory\n\
        -matlab filename    write the global matrices to a file\n\
        -graphics filename  create file for structure visualization\n\
+       -profile filename   write phase timings and counters as JSON\n\
        -version            print version information and exit\n\
        -nocpp              do not use a preprocessor\n\
        -cpp filename       preprocessor to use\n\
@@ -76,6 +95,13 @@ static int   renumber = 0;
 static int   details = 0;
 static char *graphics = NULL;
 static char *matlab = NULL;
+static char *solver = NULL;
+static int   tabulate = 0;
+static int   batch = 0;
+static int   jobs = 0;
+static char *manifest = NULL;
+static char *outdir = NULL;
+static char *profile = NULL;
 
 
 /************************************************************************
@@ -126,18 +152,62 @@ static int ParseFeltOptions (int *argc, char *argv[])
             renumber = 1;
         } else if (streq (arg, "-details")) {
             details = 1;
+        } else if (streq (arg, "-cache")) {
+            SetElementCache (1);
+        } else if (streq (arg, "-tabulate")) {
+            tabulate = 1;
 	} else if (streq (arg, "-matlab")) {
 	    if (++ i == *argc) {
 		fputs (usage, stderr);
 		return 1;
 	    }
 	    matlab = argv [i];
+	} else if (streq (arg, "-solver")) {
+	    if (++ i == *argc) {
+		fputs (usage, stderr);
+		return 1;
+	    }
+	    solver = argv [i];
+	} else if (streq (arg, "-threads")) {
+	    if (++ i == *argc || atoi (argv [i]) < 1) {
+		fputs (usage, stderr);
+		return 1;
+	    }
+	    SetFactorThreads (atoi (argv [i]));
+	    SetAssemblyThreads (atoi (argv [i]));
+	} else if (streq (arg, "-batch")) {
+	    batch = 1;
+	} else if (streq (arg, "-manifest")) {
+	    if (++ i == *argc) {
+		fputs (usage, stderr);
+		return 1;
+	    }
+	    manifest = argv [i];
+	    batch = 1;
+	} else if (streq (arg, "-jobs")) {
+	    if (++ i == *argc || atoi (argv [i]) < 1) {
+		fputs (usage, stderr);
+		return 1;
+	    }
+	    jobs = atoi (argv [i]);
+	} else if (streq (arg, "-output")) {
+	    if (++ i == *argc) {
+		fputs (usage, stderr);
+		return 1;
+	    }
+	    outdir = argv [i];
 	} else if (streq (arg, "-graphics")) {
 	    if (++ i == *argc) {
 		fputs (usage, stderr);
 		return 1;
 	    }
 	    graphics = argv [i];
+	} else if (streq (arg, "-profile")) {
+	    if (++ i == *argc) {
+		fputs (usage, stderr);
+		return 1;
+	    }
+	    profile = argv [i];
 	} else
 	    argv [j ++] = arg;
 
@@ -146,70 +216,100 @@ static int ParseFeltOptions (int *argc, char *argv[])
 }
 
 /************************************************************************
- * Function:	 main							*
+ * Function:	Failure							*
  *									*
- * Description:	 Main is the driver function for the felt package.	*
+ * Description:	Prints an error message like Fatal but returns instead	*
+ *		of exiting so that one bad file does not stop a batch.	*
+ *		In batch mode the message names the file.		*
  ************************************************************************/
 
-int main (int argc, char *argv[])
+static int Failure (const char *format, ...)
+{
+    va_list ap;
+    char    message [1024];
+
+
+    va_start (ap, format);
+    vsnprintf (message, sizeof (message), format, ap);
+    va_end (ap);
+
+    if (batch)
+	fprintf (stderr, "felt: %s: %s\n", psource.filename, message);
+    else
+	fprintf (stderr, "felt: %s\n", message);
+
+    return 1;
+}
+
+/************************************************************************
+ * Function:	SolveProblem						*
+ *									*
+ * Description:	Reads a problem into the current problem context,	*
+ *		solves it and writes the results to output.  Returns	*
+ *		non-zero if the problem could not be solved.		*
+ ************************************************************************/
+
+static int SolveProblem (const char *filename, FILE *output)
 {
     char	 *title;		/* title of problem		*/
     Matrix	  M, K, C;		/* global matrices		*/
-    Matrix	  Mcond, Ccond, Kcond;	/* condensed matrices		*/
+    SparseMatrix  Ks, Ms, Cs;		/* sparse global matrices	*/
+    ConstrainedRows saved;		/* constrained rows of K	*/
     Matrix	  Mm, Km, Cm;		/* modal matrices		*/
     cvector1<Matrix> H;			/* transfer function matrices   */
     Matrix	  S;			/* output spectra		*/
-    Vector	  F,			/* force vector			*/
-		  Fcond;		/* condensed force vector	*/
+    Vector	  F;			/* force vector			*/
     Vector	  d;			/* displacement vectors		*/
     Matrix	  x;			/* eigenvectors			*/
     Vector	  lambda;		/* eigenvalues			*/
     int		  status;		/* return status		*/
     cvector1<Reaction>	 R;			/* reaction force vector	*/
     Matrix	  dtable;		/* time-displacement table	*/
+    Matrix	  rtable;		/* reaction force table		*/
     Matrix	  ttable;		/* time step table		*/
     cvector1u old_numbers;		/* original node numbering	*/
     AnalysisType  mode;			/* current analysis type	*/
 
-        /*
-         * Do everything to setup the problem
-         */
-
-    if (ParseCppOptions (&argc, argv)) {
-	fputs (usage, stderr);
-	exit (1);
-    }
-
-    if (ParseFeltOptions (&argc, argv)) {
-	fputs (usage, stderr);
-	exit (1);
-    }
 
-    if (argc > 2) {
-	fputs (usage, stderr);
-	exit (1);
-    }
+    if (ReadFeltFile (filename))
+	return 1;
 
-    add_all_definitions ( );
+    title    = problem.title;
 
-    if (ReadFeltFile (argc == 2 ? argv [1] : "-"))
-	exit (1);
+	/*
+	 * a solver given on the command line overrides the one in
+	 * the analysis parameters; -tabulate belongs to them too, so
+	 * each file (and each batch job) carries its own
+	 */
 
-    title    = problem.title;
+    analysis.tabulate = tabulate;
+
+    if (solver) {
+	if (streq (solver, "sparse"))
+	    analysis.solver = 's';
+	else if (streq (solver, "skyline"))
+	    analysis.solver = 0;
+	else if (streq (solver, "pcg"))
+	    analysis.solver = 'c';
+	else {
+	    error ("unknown solver %s", solver);
+	    return 1;
+	}
+    }
 
 
 	/*
-	 * If debugging write the problem as we understand it to stdout
+	 * If debugging write the problem as we understand it
 	 */
 
     if (debug) 
-	WriteFeltFile ("-");
+	fWriteFeltFile (output);
 
     if (problem.nodes.empty() || problem.elements.empty()) 
-        Fatal ("nothing to do");
+        return Failure ("nothing to do");
 
     if (preview)
-       DrawStructureASCII (stdout, 78, 22);
+       DrawStructureASCII (output, 78, 22);
 
 	/*
 	 * Write a graphics file if necessary
@@ -218,7 +318,7 @@ int main (int argc, char *argv[])
     if (graphics != NULL) {
        status = WriteGraphicsFile (graphics, 0.0);
        if (status)
-          Fatal ("could not open graphics file for output");
+          return Failure ("could not open graphics file for output");
     }
 
 	/*
@@ -227,7 +327,7 @@ int main (int argc, char *argv[])
 	 */
 
     if (details)
-        SetDetailStream (stdout);
+        SetDetailStream (output);
 
 	/*
 	 * find all the active DOFs in this problem	
@@ -254,35 +354,80 @@ int main (int argc, char *argv[])
           status = CheckAnalysisParameters (Transient);
 
           if (status) 
-             Fatal ("%d Errors found in analysis parameters.", status);
+             return Failure ("%d Errors found in analysis parameters.", status);
+
+	/*
+	 * as for a static problem, the sparse and iterative solvers get
+	 * K, M and C in sparse storage
+	 */
+
+          if (analysis.solver == 's' || analysis.solver == 'c') {
+             status = ConstructSparseDynamic (&Ks, &Ms, &Cs);
+             if (!status && (matrices || matlab)) {
+                K = MakeCompactFromSparse (Ks);
+                M = MakeCompactFromSparse (Ms);
+                C = MakeCompactFromSparse (Cs);
+             }
+          }
+          else
+             status = ConstructDynamic (&K, &M, &C);
 
-          status = ConstructDynamic (&K, &M, &C);
           if (matrices)
-             PrintGlobalMatrices (stdout, M, C, K);
+             PrintGlobalMatrices (output, M, C, K);
 
           if (matlab) 
              MatlabGlobalMatrices (matlab, M, C, K);
  
           if (status)
-             Fatal ("%d fatal errors in stiffness and mass definitions",status);
+             return Failure ("%d fatal errors in stiffness and mass definitions",status);
 
           if (analysis.step > 0.0) {
-             dtable = IntegrateHyperbolicDE (K, M, C);
+             if (Ks)
+                dtable = IntegrateHyperbolicDE (Ks, Ms, Cs);
+             else
+                dtable = IntegrateHyperbolicDE (K, M, C);
              ttable.reset();
           }
+          else if (Ks)
+             dtable = RosenbrockHyperbolicDE (Ks, Ms, Cs, &ttable);
           else
              dtable = RosenbrockHyperbolicDE (K, M, C, &ttable);
 
           RestoreProblemNodeNumbers(old_numbers);
 
           if (!dtable)
-             Fatal ("fatal error in integration (probably a singularity).");
+             return Failure ("fatal error in integration (probably a singularity).");
 
           if (dotable)
-             WriteTransientTable (dtable, ttable, stdout);
+             WriteTransientTable (dtable, ttable, output);
     
           if (doplot)
-             PlotTransientTable (dtable, ttable, analysis.step, stdout);
+             PlotTransientTable (dtable, ttable, analysis.step, output);
+
+          break;
+
+       case TransientExplicit:
+          status = CheckAnalysisParameters (TransientExplicit);
+
+          if (status) 
+             return Failure ("%d Errors found in analysis parameters.", status);
+
+          status = ConstructLumpedMass (&M);
+          if (status)
+             return Failure ("%d fatal errors in stiffness and mass definitions",status);
+
+          dtable = IntegrateExplicitDE (M);
+
+          RestoreProblemNodeNumbers(old_numbers);
+
+          if (!dtable)
+             return Failure ("fatal error in integration (no mass or no stable step).");
+
+          if (dotable)
+             WriteTransientTable (dtable, Matrix(), output);
+    
+          if (doplot)
+             PlotTransientTable (dtable, Matrix(), analysis.step, output);
 
           break;
        
@@ -292,63 +437,91 @@ int main (int argc, char *argv[])
           status = CheckAnalysisParameters (TransientThermal);
 
           if (status) 
-             Fatal ("%d Errors found in analysis parameters.", status);
-
-          status = ConstructDynamic (&K, &M, &C);
+             return Failure ("%d Errors found in analysis parameters.", status);
+
+          if (analysis.solver == 's' || analysis.solver == 'c') {
+             status = ConstructSparseDynamic (&Ks, &Ms, &Cs);
+             if (!status && (matrices || matlab)) {
+                K = MakeCompactFromSparse (Ks);
+                M = MakeCompactFromSparse (Ms);
+             }
+          }
+          else
+             status = ConstructDynamic (&K, &M, &C);
           
           if (matrices) 
-              PrintGlobalMatrices (stdout, M, Matrix(), K);
+              PrintGlobalMatrices (output, M, Matrix(), K);
 
           if (matlab) 
               MatlabGlobalMatrices (matlab, M, Matrix(), K);
  
           if (status)
-             Fatal ("%d fatal errors in stiffness and mass definitions",status);
+             return Failure ("%d fatal errors in stiffness and mass definitions",status);
 
-          dtable = IntegrateParabolicDE (K, M);
+          if (Ks)
+             dtable = IntegrateParabolicDE (Ks, Ms);
+          else
+             dtable = IntegrateParabolicDE (K, M);
 
           if (!dtable)
-             Fatal ("fatal error in integration (probably a singularity).");
+             return Failure ("fatal error in integration (probably a singularity).");
 
           RestoreProblemNodeNumbers(old_numbers);
 
           if (dotable)
-              WriteTransientTable (dtable, Matrix(), stdout);
+              WriteTransientTable (dtable, Matrix(), output);
     
           if (doplot)
-              PlotTransientTable (dtable, Matrix(), analysis.step, stdout);
+              PlotTransientTable (dtable, Matrix(), analysis.step, output);
 
           break;
 
        case Static:
 
-          K = ConstructStiffness(&status);
+	/*
+	 * the sparse and iterative solvers get their stiffness matrix
+	 * assembled straight into sparse storage; a skyline copy is only
+	 * made if the matrices are to be written out
+	 */
+
+          if (analysis.solver == 's' || analysis.solver == 'c')
+             Ks = ConstructSparseStiffness(&status);
+          else
+             K = ConstructStiffness(&status);
           if (status)
-             Fatal ("%d Fatal errors in element stiffness definitions", status);
+             return Failure ("%d Fatal errors in element stiffness definitions", status);
+
+          if (Ks && (matrices || matlab))
+             K = MakeCompactFromSparse (Ks);
 
           if (matrices)
-             PrintGlobalMatrices (stdout, Matrix(), Matrix(), K);
+             PrintGlobalMatrices (output, Matrix(), Matrix(), K);
 
           if (matlab) 
              MatlabGlobalMatrices (matlab, Matrix(), Matrix(), K);
 
           F = ConstructForceVector ( );
 
-          ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
-
-          d = SolveForDisplacements (Kcond, Fcond);
+          if (Ks) {
+             ApplyConstraints (Ks, F, &saved);
+             d = SolveForDisplacements (Ks, F);
+          }
+          else {
+             ApplyConstraints (K, F, &saved);
+             d = SolveForDisplacements (K, F);
+          }
           if (!d)
-             Fatal ("could not solve for global displacements");
+             return Failure ("could not solve for global displacements");
 
           status = ElementStresses ( );
           if (status) 
-             Fatal ("%d Fatal errors found computing element stresses", status);
+             return Failure ("%d Fatal errors found computing element stresses", status);
     
-          R = SolveForReactions (K, d, old_numbers.c_ptr1());
+          R = SolveForReactions (saved, d, old_numbers.c_ptr1());
 
           RestoreProblemNodeNumbers(old_numbers);
 
-          WriteStructuralResults (stdout, title, R);
+          WriteStructuralResults (output, title, R);
 
           break;
 
@@ -356,43 +529,63 @@ int main (int argc, char *argv[])
        case StaticLoadRange:
           status = CheckAnalysisParameters (mode);
           if (status)
-             Fatal ("%d errors found in analysis parameters.", status);
+             return Failure ("%d errors found in analysis parameters.", status);
 
-          K = ConstructStiffness(&status);
+          if (analysis.solver == 's' || analysis.solver == 'c')
+             Ks = ConstructSparseStiffness(&status);
+          else
+             K = ConstructStiffness(&status);
           if (status)
-             Fatal ("%d Fatal errors in element stiffness definitions", status);
+             return Failure ("%d Fatal errors in element stiffness definitions", status);
+
+          if (Ks && (matrices || matlab))
+             K = MakeCompactFromSparse (Ks);
 
           if (matrices)
-             PrintGlobalMatrices (stdout, Matrix(), Matrix(), K);
+             PrintGlobalMatrices (output, Matrix(), Matrix(), K);
 
           if (matlab) 
              MatlabGlobalMatrices (matlab, Matrix(), Matrix(), K);
 
           F = ConstructForceVector ( );
           
-          ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
-           
-          if (mode == StaticLoadCases)
-             dtable = SolveStaticLoadCases (Kcond, Fcond);
-          else
-             dtable = SolveStaticLoadRange (Kcond, Fcond);
+          if (Ks) {
+             ApplyConstraints (Ks, F, &saved);
+             if (mode == StaticLoadCases)
+                dtable = SolveStaticLoadCases (Ks, F, &saved, &rtable);
+             else
+                dtable = SolveStaticLoadRange (Ks, F, &saved, &rtable);
+          }
+          else {
+             ApplyConstraints (K, F, &saved);
+             if (mode == StaticLoadCases)
+                dtable = SolveStaticLoadCases (K, F, &saved, &rtable);
+             else
+                dtable = SolveStaticLoadRange (K, F, &saved, &rtable);
+          }
 
           if (!dtable)
-             Fatal ("could not solve for global displacements");
+             return Failure ("could not solve for global displacements");
             
           RestoreProblemNodeNumbers(old_numbers);
 
-          if (dotable)
-             if (mode == StaticLoadCases)
-                WriteLoadCaseTable (dtable, stdout);
-             else 
-                WriteLoadRangeTable (dtable, stdout);
+          if (dotable) {
+             R = FindReactionDOF (NULL);
+             if (mode == StaticLoadCases) {
+                WriteLoadCaseTable (dtable, output);
+                WriteLoadCaseReactions (rtable, R, output);
+             }
+             else {
+                WriteLoadRangeTable (dtable, output);
+                WriteLoadRangeReactions (rtable, R, output);
+             }
+          }
 
           if (doplot)
              if (mode == StaticLoadCases)
-                PlotLoadCaseTable (dtable, stdout);
+                PlotLoadCaseTable (dtable, output);
              else 
-                PlotLoadRangeTable (dtable, stdout);
+                PlotLoadRangeTable (dtable, output);
 
           break; 
 
@@ -401,29 +594,34 @@ int main (int argc, char *argv[])
           status = CheckAnalysisParameters (StaticSubstitution);
           status += CheckAnalysisParameters (StaticLoadRange);
           if (status) 
-             Fatal ("%d errors found in analysis parameters.", status);
+             return Failure ("%d errors found in analysis parameters.", status);
 
-          K = CreateNonlinearStiffness (&status);
+          if (analysis.solver == 's' || analysis.solver == 'c')
+             Ks = CreateNonlinearSparseStiffness (&status);
+          else
+             K = CreateNonlinearStiffness (&status);
           if (status)
-             Fatal ("could not create global stiffness matrix");
+             return Failure ("could not create global stiffness matrix");
          
           F = ConstructForceVector ( );
  
-          if (mode == StaticSubstitutionLoadRange)
+          if (Ks)
+             dtable = SolveNonlinearLoadRange (Ks, F, 0);
+          else if (mode == StaticSubstitutionLoadRange)
              dtable = SolveNonlinearLoadRange (K, F, 0);
           else
              dtable = SolveNonlinearLoadRange (K, F, 0); /* should be 1*/
              
           if (!dtable)
-             Fatal ("did not converge on a solution");
+             return Failure ("did not converge on a solution");
          
           RestoreProblemNodeNumbers(old_numbers);
                 
           if (dotable)
-             WriteLoadRangeTable (dtable, stdout);
+             WriteLoadRangeTable (dtable, output);
 
           if (doplot)
-             PlotLoadRangeTable (dtable, stdout);
+             PlotLoadRangeTable (dtable, output);
 
           break;
 
@@ -431,25 +629,30 @@ int main (int argc, char *argv[])
        case StaticIncremental:
           status = CheckAnalysisParameters (mode);
           if (status) 
-             Fatal ("%d errors found in analysis parameters.", status);
+             return Failure ("%d errors found in analysis parameters.", status);
 
-          K = CreateNonlinearStiffness (&status);
+          if (analysis.solver == 's' || analysis.solver == 'c')
+             Ks = CreateNonlinearSparseStiffness (&status);
+          else
+             K = CreateNonlinearStiffness (&status);
           if (status)
-             Fatal ("could not create global stiffness matrix");
+             return Failure ("could not create global stiffness matrix");
          
           F = ConstructForceVector ( );
  
-          if (mode == StaticSubstitution)
+          if (Ks)
+             d = StaticNonlinearDisplacements (Ks, F, 0);
+          else if (mode == StaticSubstitution)
              d = StaticNonlinearDisplacements (K, F, 0);
           else
              d = StaticNonlinearDisplacements (K, F, 0); /* should be 1 */
              
           if (!d)
-             Fatal ("did not converge on a solution");
+             return Failure ("did not converge on a solution");
          
           RestoreProblemNodeNumbers(old_numbers);
                 
-          WriteStructuralResults (stdout, title, cvector1<Reaction>(0));
+          WriteStructuralResults (output, title, cvector1<Reaction>(0));
 
           break;
 
@@ -458,25 +661,25 @@ int main (int argc, char *argv[])
           K = ConstructStiffness(&status);
 
           if (status)
-             Fatal ("%d Fatal errors in element stiffness definitions", status);
+             return Failure ("%d Fatal errors in element stiffness definitions", status);
 
           if (matrices)
-             PrintGlobalMatrices (stdout, Matrix(), Matrix(), K);
+             PrintGlobalMatrices (output, Matrix(), Matrix(), K);
 
           if (matlab) 
              MatlabGlobalMatrices (matlab, Matrix(), Matrix(), K);
 
           F = ConstructForceVector ( );
           
-          ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
+          ApplyConstraints (K, F, NULL);
      
-          d = SolveForDisplacements (Kcond, Fcond);
+          d = SolveForDisplacements (K, F);
           if (!d)
-             exit (1);
+             return 1;
 
           RestoreProblemNodeNumbers(old_numbers);
 
-          WriteTemperatureResults (stdout, title);
+          WriteTemperatureResults (output, title);
 
           break;
 
@@ -484,37 +687,57 @@ int main (int argc, char *argv[])
           status = CheckAnalysisParameters (Modal);
 
           if (status) 
-             Fatal ("%d Errors found in analysis parameters.", status);
+             return Failure ("%d Errors found in analysis parameters.", status);
 
-          status = ConstructDynamic (&K, &M, &C);
+          if (analysis.solver == 's' || analysis.solver == 'c')
+             status = ConstructSparseDynamic (&Ks, &Ms, &Cs);
+          else
+             status = ConstructDynamic (&K, &M, &C);
           
           if (status)
-             Fatal ("%d fatal errors in stiffness and mass definitions",status);
+             return Failure ("%d fatal errors in stiffness and mass definitions",status);
 
-          RemoveConstrainedDOF (K, M, C, Kcond, Mcond, Ccond);
+	/*
+	 * the modal matrices are formed from compact copies of the
+	 * condensed sparse ones
+	 */
+
+          if (Ks) {
+             CondenseConstrainedDOF (Ks, Ms, Cs);
+             if (matrices || matlab || domodal) {
+                K = MakeCompactFromSparse (Ks);
+                M = MakeCompactFromSparse (Ms);
+                C = MakeCompactFromSparse (Cs);
+             }
+          }
+          else
+             CondenseConstrainedDOF (K, M, C);
 
           if (matrices)
-             PrintGlobalMatrices (stdout, Mcond, Ccond, Kcond);
+             PrintGlobalMatrices (output, M, C, K);
  
           if (matlab) 
-             MatlabGlobalMatrices (matlab, Mcond, Ccond, Kcond);
+             MatlabGlobalMatrices (matlab, M, C, K);
 
-          status = ComputeEigenModes (Kcond, Mcond, lambda, x);
+          if (Ks)
+             status = ComputeEigenModes (Ks, Ms, lambda, x);
+          else
+             status = ComputeEigenModes (K, M, lambda, x);
 
           if (status == M_NOTPOSITIVEDEFINITE)
-             Fatal ("coefficient matrix is not positive definite.");
+             return Failure ("coefficient matrix is not positive definite.");
           else if (status)
-             Fatal ("could not compute eigenmodes (report status code %d).", status);
+             return Failure ("could not compute eigenmodes (report status code %d).", status);
 
           NormalizeByFirst (x, x);
-          WriteEigenResults (lambda, x, title, stdout);
+          WriteEigenResults (lambda, x, title, output);
 
           if (doplot)
-             PlotModeShapes (x, stdout);
+             PlotModeShapes (x, output);
             
           if (domodal) {
-             FormModalMatrices (x, Mcond, Ccond, Kcond, Mm, Cm, Km, orthonormal);
-             WriteModalResults (stdout, Mm, Cm, Km, lambda);
+             FormModalMatrices (x, M, C, K, Mm, Cm, Km, orthonormal);
+             WriteModalResults (output, Mm, Cm, Km, lambda);
           }
            
           break;
@@ -523,26 +746,26 @@ int main (int argc, char *argv[])
           status = CheckAnalysisParameters (Spectral);
 
           if (status) 
-             Fatal ("%d Errors found in analysis parameters.", status);
+             return Failure ("%d Errors found in analysis parameters.", status);
 
           status = ConstructDynamic (&K, &M, &C);
 
           if (status)
-             Fatal ("%d fatal errors in stiffness and mass definitions",status);
+             return Failure ("%d fatal errors in stiffness and mass definitions",status);
  
-          ZeroConstrainedDOF (K, Matrix(), &Kcond, NULL);
-          ZeroConstrainedDOF (M, Matrix(), &Mcond, NULL);
-          ZeroConstrainedDOF (C, Matrix(), &Ccond, NULL);
+          ApplyConstraints (K, Matrix(), NULL);
+          ApplyConstraints (M, Matrix(), NULL);
+          ApplyConstraints (C, Matrix(), NULL);
 
           if (matrices)
-             PrintGlobalMatrices (stdout, Mcond, Ccond, Kcond);
+             PrintGlobalMatrices (output, M, C, K);
 
           if (matlab) 
-             MatlabGlobalMatrices (matlab, Mcond, Ccond, Kcond);
+             MatlabGlobalMatrices (matlab, M, C, K);
 
           const cvector1<NodeDOF> forced = FindForcedDOF();
 
-          H = ComputeTransferFunctions (Mcond, Ccond, Kcond, forced);
+          H = ComputeTransferFunctions (M, C, K, forced);
 
           if (dospectra) {
               S = ComputeOutputSpectra (H, forced);
@@ -554,24 +777,258 @@ int main (int argc, char *argv[])
 
           if (!dospectra) {
              if (dotable)
-                 WriteTransferFunctions (H, forced, stdout);
+                 WriteTransferFunctions (H, forced, output);
              if (doplot)
-                 PlotTransferFunctions (H, forced,  stdout);
+                 PlotTransferFunctions (H, forced,  output);
 
              break;
           }
 
           if (dotable)  
-             WriteOutputSpectra (S, stdout);
+             WriteOutputSpectra (S, output);
        
           if (doplot)
-             PlotOutputSpectra (S, stdout);
+             PlotOutputSpectra (S, output);
 
           break;
     }
 
     if (summary)
-       WriteMaterialStatistics (stdout);
+       WriteMaterialStatistics (output);
+
+    return 0;
+}
+
+/************************************************************************
+ * Function:	OutputName						*
+ *									*
+ * Description:	Forms the name of the results file for a batch input:	*
+ *		the input with its extension replaced by .out, placed	*
+ *		in the output directory if one was given.		*
+ ************************************************************************/
+
+static std::string OutputName (const std::string &input)
+{
+    std::string::size_type slash;
+    std::string::size_type dot;
+    std::string		   name;
+
+
+    slash = input.rfind ('/');
+    dot = input.rfind ('.');
+
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+	name = input;
+    else
+	name = input.substr (0, dot);
+
+    if (outdir != NULL)
+	name = std::string (outdir) + "/" +
+	       (slash == std::string::npos ? name : name.substr (slash + 1));
+
+    return name + ".out";
+}
+
+	/*
+	 * each worker takes the next file from the list and solves it
+	 * in a problem context of its own.  Everything SolveProblem
+	 * does, node renumbering included, keeps its working state per
+	 * thread, so the workers never share anything but the queue.
+	 */
+
+struct BatchQueue {
+    std::vector<std::string>	inputs;
+    boost::atomic<unsigned>	next;
+    boost::atomic<unsigned>	failed;
+};
+
+static void BatchWorker (BatchQueue *queue)
+{
+    unsigned i;
+    int      status;
+    FILE    *output;
+
+
+    while ((i = queue -> next.fetch_add (1)) < queue -> inputs.size ( )) {
+	const std::string &input = queue -> inputs [i];
+	const std::string name = OutputName (input);
+
+	if (!(output = fopen (name.c_str ( ), "w"))) {
+	    fprintf (stderr, "felt: unable to open %s\n", name.c_str ( ));
+	    queue -> failed ++;
+	    continue;
+	}
+
+	ProblemContext context;
+	SetProblemContext (&context);
+
+	status = SolveProblem (input.c_str ( ), output);
+
+	SetDetailStream (NULL);
+	SetProblemContext (NULL);
+	fclose (output);
+
+	if (status)
+	    queue -> failed ++;
+    }
+}
+
+/************************************************************************
+ * Function:	SolveBatch						*
+ *									*
+ * Description:	Solves every file named on the command line or in the	*
+ *		manifest, several at a time, in one process.  The	*
+ *		definitions are added and the options parsed only	*
+ *		once.  Returns non-zero if any file failed.		*
+ ************************************************************************/
+
+static int SolveBatch (int argc, char *argv[])
+{
+    BatchQueue	   queue;
+    FILE	  *fp;
+    char	   line [2048];
+    char	  *ptr;
+    int		   i;
+    unsigned	   nthreads;
+    struct timeval start;
+    struct timeval stop;
+    double	   elapsed;
+
+
+    if (graphics != NULL || matlab != NULL || profile != NULL) {
+	fputs ("felt: -graphics, -matlab and -profile cannot be used in batch mode\n", stderr);
+	return 1;
+    }
+
+    for (i = 1; i < argc; i ++)
+	queue.inputs.push_back (argv [i]);
+
+	/*
+	 * a manifest lists one file per line; blank lines and lines
+	 * starting with # are skipped
+	 */
+
+    if (manifest != NULL) {
+	if (!(fp = fopen (manifest, "r"))) {
+	    fprintf (stderr, "felt: unable to open %s\n", manifest);
+	    return 1;
+	}
+
+	while (fgets (line, sizeof (line), fp)) {
+	    line [strcspn (line, "\r\n")] = 0;
+	    for (ptr = line; *ptr == ' ' || *ptr == '\t'; ptr ++);
+	    if (*ptr && *ptr != '#')
+		queue.inputs.push_back (ptr);
+	}
+
+	fclose (fp);
+    }
+
+    if (queue.inputs.empty ( )) {
+	fputs (usage, stderr);
+	return 1;
+    }
+
+    for (i = 0; i < (int) queue.inputs.size ( ); i ++)
+	if (queue.inputs [i] == "-") {
+	    fputs ("felt: standard input cannot be used in batch mode\n", stderr);
+	    return 1;
+	}
+
+    nthreads = jobs ? jobs : boost::thread::hardware_concurrency ( );
+    if (nthreads < 1)
+	nthreads = 1;
+    if (nthreads > queue.inputs.size ( ))
+	nthreads = queue.inputs.size ( );
+
+    add_all_definitions ( );
+
+	/*
+	 * a file that needs nothing from the preprocessor is read
+	 * without starting one
+	 */
+
+    SetPreprocessorSkip (1);
+
+    queue.next.store (0);
+    queue.failed.store (0);
+
+    gettimeofday (&start, NULL);
+
+    boost::thread_group pool;
+    for (i = 1; i < (int) nthreads; i ++)
+	pool.create_thread (boost::bind (BatchWorker, &queue));
+
+    BatchWorker (&queue);
+    pool.join_all ( );
+
+    gettimeofday (&stop, NULL);
+    elapsed = (stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec)*1e-6;
+
+    if (details)
+	printf ("solved %u of %u files with %u jobs in %.3f s (%.1f files per second)\n",
+		(unsigned) queue.inputs.size ( ) - queue.failed.load ( ),
+		(unsigned) queue.inputs.size ( ), nthreads, elapsed,
+		elapsed > 0 ? queue.inputs.size ( )/elapsed : 0.0);
+
+    return queue.failed.load ( ) != 0;
+}
+
+/************************************************************************
+ * Function:	 main							*
+ *									*
+ * Description:	 Main is the driver function for the felt package.	*
+ ************************************************************************/
+
+int main (int argc, char *argv[])
+{
+    FILE *fp;
+    int   status;
+
+
+        /*
+         * Do everything to setup the problem
+         */
+
+    if (ParseCppOptions (&argc, argv)) {
+	fputs (usage, stderr);
+	exit (1);
+    }
+
+    if (ParseFeltOptions (&argc, argv)) {
+	fputs (usage, stderr);
+	exit (1);
+    }
+
+    if (batch)
+	return SolveBatch (argc, argv);
+
+    if (argc > 2) {
+	fputs (usage, stderr);
+	exit (1);
+    }
+
+    add_all_definitions ( );
+
+    if (profile != NULL)
+	EnableProfile (1);
+
+    status = SolveProblem (argc == 2 ? argv [1] : "-", stdout);
+
+	/*
+	 * the profile is written even if the problem could not be
+	 * solved; it shows how far the solution got
+	 */
+
+    if (profile != NULL) {
+	if (!(fp = fopen (profile, "w")) || WriteProfile (fp, argc == 2 ? argv [1] : "-"))
+	    error ("unable to write profile to %s", profile);
+	if (fp)
+	    fclose (fp);
+    }
+
+    if (status)
+	exit (1);
 
     // try cleanup
     problem.nodes.clear();
@@ -247,18 +247,18 @@ int main (int argc, char **argv)
     int		 i;
     char	*title;			/* title of problem		*/
     Matrix	 M, K, C;		/* global matrices		*/
-    Matrix	 Mcond, Ccond, Kcond;	/* condensed matrices		*/
+    ConstrainedRows saved;		/* constrained rows of K	*/
     Matrix	 Mm, Km, Cm;		/* modal matrices		*/
     cvector1<Matrix>	 H;			/* transfer function matrices   */
     Matrix	 S;			/* output spectra		*/
-    Vector	 F,			/* force vector			*/
-		 Fcond;			/* condensed force vector	*/
+    Vector	 F;			/* force vector			*/
     Vector	 d;			/* displacement vector		*/
     Matrix	 x;			/* eigenvectors			*/
     Vector	 lambda;		/* eigenvalues			*/
     int		 status;		/* return status		*/
     cvector1<Reaction>	 R;			/* reaction force vector	*/
     Matrix	 dtable;		/* time-displacement table	*/
+    Matrix	 rtable;		/* reaction force table		*/
     cvector1u    old_numbers;		/* original node numbering	*/
     AnalysisType mode;
 
@@ -397,6 +397,29 @@ int main (int argc, char **argv)
              WriteLineGraph (dtable, "Nodal Time-Displacement", "time", "dx", graph_out);
 
           break;
+
+       case TransientExplicit:
+          status = CheckAnalysisParameters (TransientExplicit);
+
+          if (status) 
+             Fatal ("%d Errors found in analysis parameters.", status);
+
+          status = ConstructLumpedMass (&M);
+          if (status)
+             Fatal ("%d fatal errors in stiffness and mass definitions",status);
+
+          dtable = IntegrateExplicitDE (M);
+
+          if (!dtable)
+             Fatal ("fatal error in integration (no mass or no stable step).");
+
+          if (table)
+              WriteTransientTable (dtable, Matrix(), fp_out);
+    
+          if (graph_out)
+             WriteLineGraph (dtable, "Nodal Time-Displacement", "time", "dx", graph_out);
+
+          break;
        
        case TransientThermal:
           analysis.dofs [1] = Tx;
@@ -438,9 +461,9 @@ int main (int argc, char **argv)
 
           F = ConstructForceVector ( );
           
-          ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
+          ApplyConstraints (K, F, &saved);
      
-          d = SolveForDisplacements (Kcond, Fcond);
+          d = SolveForDisplacements (K, F);
           if (!d)
              Fatal("could not solve for displacements, probably a singularity");
     
@@ -449,7 +472,7 @@ int main (int argc, char **argv)
           if (status) 
              Fatal ("%d Fatal errors found computing element stresses", status);
 
-          R = SolveForReactions (K, d, old_numbers.c_ptr1());
+          R = SolveForReactions (saved, d, old_numbers.c_ptr1());
 
           RestoreProblemNodeNumbers(old_numbers);
 
@@ -491,9 +514,9 @@ int main (int argc, char **argv)
 
           F = ConstructForceVector ( );
           
-          ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
+          ApplyConstraints (K, F, NULL);
      
-          d = SolveForDisplacements (Kcond, Fcond);
+          d = SolveForDisplacements (K, F);
           if (!d)
              Fatal("could not solve for displacements, probably a singularity");
 
@@ -528,23 +551,29 @@ int main (int argc, char **argv)
 
           F = ConstructForceVector ( );
           
-          ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
+          ApplyConstraints (K, F, &saved);
            
           if (mode == StaticLoadCases)
-             dtable = SolveStaticLoadCases (Kcond, Fcond);
+             dtable = SolveStaticLoadCases (K, F, &saved, &rtable);
           else
-             dtable = SolveStaticLoadRange (Kcond, Fcond);
+             dtable = SolveStaticLoadRange (K, F, &saved, &rtable);
 
           if (!dtable)
              Fatal ("could not solve for global displacements");
             
           RestoreProblemNodeNumbers(old_numbers);
 
-          if (table)
-             if (mode == StaticLoadCases)
+          if (table) {
+             R = FindReactionDOF (NULL);
+             if (mode == StaticLoadCases) {
                 WriteLoadCaseTable (dtable, fp_out);
-             else 
+                WriteLoadCaseReactions (rtable, R, fp_out);
+             }
+             else {
                 WriteLoadRangeTable (dtable, fp_out);
+                WriteLoadRangeReactions (rtable, R, fp_out);
+             }
+          }
 
           if (graph_out && mode == StaticLoadRange)
              WriteLineGraph (dtable, "Displacement vs. Force Level", "force", "dx", graph_out);
@@ -631,12 +660,12 @@ int main (int argc, char **argv)
           if (status)
              Fatal ("%d fatal errors in stiffness and mass definitions",status);
 
-          RemoveConstrainedDOF (K, M, C, Kcond, Mcond, Ccond);
+          CondenseConstrainedDOF (K, M, C);
 
           if (matrices)
-             PrintGlobalMatrices (fp_out, Mcond, Ccond, Kcond);
+             PrintGlobalMatrices (fp_out, M, C, K);
  
-          status = ComputeEigenModes (Kcond, Mcond, lambda, x);
+          status = ComputeEigenModes (K, M, lambda, x);
 
           if (status == M_NOTPOSITIVEDEFINITE)
              Fatal ("coefficient matrix is not positive definite.");
@@ -650,7 +679,7 @@ int main (int argc, char **argv)
              PlotModeShapes (x, fp_out);
 */           
           if (!eigen) {
-             FormModalMatrices (x, Mcond, Ccond, Kcond, Mm, Cm, Km, orthonormal);
+             FormModalMatrices (x, M, C, K, Mm, Cm, Km, orthonormal);
              WriteModalResults (fp_out, Mm, Cm, Km, lambda);
           }
            
@@ -667,16 +696,16 @@ int main (int argc, char **argv)
           if (status)
              Fatal ("%d fatal errors in stiffness and mass definitions",status);
  
-          ZeroConstrainedDOF (K, Matrix(), &Kcond, NULL);
-          ZeroConstrainedDOF (M, Matrix(), &Mcond, NULL);
-          ZeroConstrainedDOF (C, Matrix(), &Ccond, NULL);
+          ApplyConstraints (K, Matrix(), NULL);
+          ApplyConstraints (M, Matrix(), NULL);
+          ApplyConstraints (C, Matrix(), NULL);
 
           if (matrices)
-             PrintGlobalMatrices (fp_out, Mcond, Ccond, Kcond);
+             PrintGlobalMatrices (fp_out, M, C, K);
 
           const cvector1<NodeDOF> forced = FindForcedDOF();
 
-          H = ComputeTransferFunctions (Mcond, Ccond, Kcond, forced);
+          H = ComputeTransferFunctions (M, C, K, forced);
 
           if (transfer) {
              if (table)
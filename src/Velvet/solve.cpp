@@ -108,15 +108,12 @@ int SolveProblem (void)
 {
     unsigned	 numnodes;		/* total number of nodes	*/
     unsigned	 numelts;		/* total number of elements	*/
-    Matrix	 K,			/* global stiffness matrix	*/
-		 Kcond;			/* condensed stiffness matrix	*/
+    Matrix	 K;			/* global stiffness matrix	*/
+    ConstrainedRows saved;		/* constrained rows of K	*/
     Matrix	 M, C;
-    Matrix	 Ccond;
-    Matrix	 Mcond;			/* condensed mass matrix	*/
     Matrix	 Mm, Cm, Km;
     Matrix	 S;
     Vector	 F,			/* force vector			*/
-		 Fcond,			/* condensed force vector	*/
 		 d;			/* displacement vector		*/
     Matrix	 x;			/* eigenvectors			*/
     Vector	 lambda;		/* eigenvalues			*/
@@ -128,6 +125,7 @@ int SolveProblem (void)
     FILE	*output;
     cvector1u	old_numbers;
     Matrix	 dtable;
+    Matrix	 rtable;
     Matrix	 ttable;
     int		 error_flag;
     AnalysisType mode;
@@ -242,6 +240,40 @@ int SolveProblem (void)
 
        break;
 
+    case TransientExplicit:
+       status = CheckAnalysisParameters (TransientExplicit);
+    
+       if (status) {
+          error ("%d errors found in analysis parameters.", status);
+          error_flag = 1;
+          break;
+       }
+
+       status = ConstructLumpedMass (&M);
+     
+       if (status) {
+          error ("%d errors in stiffness and mass definitions.", status);
+          error_flag = 1;
+          break;
+       }
+
+       dtable = IntegrateExplicitDE (M);
+
+       if (!dtable) {
+          error ("could not perform integration - no mass or no stable step.");
+          error_flag = 1;
+          break;
+       }
+      
+       RestoreProblemNodeNumbers(old_numbers);
+       
+       WriteTransientTable (dtable, Matrix(), output);
+
+       if (solution -> plot)
+          VelvetPlotTD (dtable, Matrix(), "time", "dx", "Nodal Time-Displacement", True);
+
+       break;
+
     case Spectral:
        status = CheckAnalysisParameters (Spectral);
     
@@ -259,18 +291,18 @@ int SolveProblem (void)
           break;
        }
 
-       ZeroConstrainedDOF (K, Matrix(), &Kcond, NULL);
-       ZeroConstrainedDOF (M, Matrix(), &Mcond, NULL);
-       ZeroConstrainedDOF (C, Matrix(), &Ccond, NULL);
+       ApplyConstraints (K, Matrix(), NULL);
+       ApplyConstraints (M, Matrix(), NULL);
+       ApplyConstraints (C, Matrix(), NULL);
 
        if (solution -> matrices)
-          PrintGlobalMatrices (output, Mcond, Ccond, Kcond);
+          PrintGlobalMatrices (output, M, C, K);
 
        { // put local variables in temp scope
            
            const cvector1<NodeDOF> forced = FindForcedDOF();
 
-           const cvector1<Matrix> H = ComputeTransferFunctions (Mcond, Ccond, Kcond, forced);
+           const cvector1<Matrix> H = ComputeTransferFunctions (M, C, K, forced);
 
            if (!solution -> transfer)
                S = ComputeOutputSpectra (H, forced);
@@ -311,14 +343,14 @@ int SolveProblem (void)
 
        F = ConstructForceVector ( );
 
-       ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
+       ApplyConstraints (K, F, &saved);
 
 	/*
 	 * the result will not have new space - it will get returned
-	 * in the same space that Fcond used to occupy ...
+	 * in the same space that F used to occupy ...
 	 */
 
-       d = SolveForDisplacements (Kcond, Fcond);
+       d = SolveForDisplacements (K, F);
 
        if (!d) {
           error ("singluarity in final system of equations - cannot proceed.");
@@ -326,7 +358,7 @@ int SolveProblem (void)
           break;
        }    
 
-       R = SolveForReactions (K, d, old_numbers.c_ptr1());
+       R = SolveForReactions (saved, d, old_numbers.c_ptr1());
 
        status = ElementStresses ( );
        if (status) {
@@ -362,12 +394,12 @@ int SolveProblem (void)
 
        F = ConstructForceVector ( );
           
-       ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
+       ApplyConstraints (K, F, &saved);
 
        if (mode == StaticLoadCases)
-          dtable = SolveStaticLoadCases (Kcond, Fcond);
+          dtable = SolveStaticLoadCases (K, F, &saved, &rtable);
        else
-          dtable = SolveStaticLoadRange (Kcond, Fcond);
+          dtable = SolveStaticLoadRange (K, F, &saved, &rtable);
 
        if (!dtable) {
           error ("could not solve for global displacements.");
@@ -377,10 +409,15 @@ int SolveProblem (void)
          
        RestoreProblemNodeNumbers(old_numbers);
 
-       if (mode == StaticLoadCases)
+       R = FindReactionDOF (NULL);
+       if (mode == StaticLoadCases) {
           WriteLoadCaseTable (dtable, output);
-       else 
+          WriteLoadCaseReactions (rtable, R, output);
+       }
+       else {
           WriteLoadRangeTable (dtable, output);
+          WriteLoadRangeReactions (rtable, R, output);
+       }
 
        if (solution -> plot && mode == StaticLoadRange) 
           VelvetPlotLoadRange (dtable);
@@ -478,12 +515,12 @@ int SolveProblem (void)
           break;
        }
 
-       RemoveConstrainedDOF (K, M, C, Kcond, Mcond, Ccond);
+       CondenseConstrainedDOF (K, M, C);
  
        if (solution -> matrices)
-          PrintGlobalMatrices (output, Mcond, Ccond, Kcond);
+          PrintGlobalMatrices (output, M, C, K);
 
-       status = ComputeEigenModes (Kcond, Mcond, lambda, x);
+       status = ComputeEigenModes (K, M, lambda, x);
        if (status == M_NOTPOSITIVEDEFINITE) {
           error ("coefficient matrix is not positive definite.");
           error_flag = 1;
@@ -504,7 +541,7 @@ int SolveProblem (void)
        WriteEigenResults (lambda, x, solution -> title, output);
        
        if (!solution -> eigen) {
-          FormModalMatrices (x, Mcond, Ccond, Kcond, Mm, Cm, Km, solution -> orthonormal);
+          FormModalMatrices (x, M, C, K, Mm, Cm, Km, solution -> orthonormal);
           WriteModalResults (output, Mm, Cm, Km, lambda);
        }
 
@@ -563,9 +600,9 @@ int SolveProblem (void)
 
        F = ConstructForceVector ( );
        
-       ZeroConstrainedDOF (K, F, &Kcond, &Fcond);
+       ApplyConstraints (K, F, NULL);
   
-       d = SolveForDisplacements (Kcond, Fcond);
+       d = SolveForDisplacements (K, F);
 
        if (!d) {
           error ("singluarity in final system of equations - cannot proceed.");